@@ -74,17 +74,12 @@ static void *readfile(const char *fname, size_t *_len)
     return buf;
 }
 
-static void initPib(void)
+// (cmdlinebuf) is laid out like /proc/self/cmdline: null-terminated args, back to back.
+static void initPib(const char *cmdlinebuf, const size_t cmdlinebuflen)
 {
     LxPIB *pib = &GLoaderState.pib;
     memset(pib, '\0', sizeof (*pib));
 
-    size_t cmdlinebuflen = 0;
-    char *cmdlinebuf = readfile("/proc/self/cmdline", &cmdlinebuflen);
-    if (!cmdlinebuf) {
-        abort();
-    }
-
     int argc = 0;
     for (size_t i = 0; i < cmdlinebuflen; i++) {
         if (cmdlinebuf[i] == '\0') {
@@ -98,12 +93,12 @@ static void initPib(void)
         abort();
     }
 
-    argv[0] = cmdlinebuf;
+    argv[0] = (char *) cmdlinebuf;
     argc = 0;
     for (size_t i = 0; i < cmdlinebuflen; i++) {
         if (cmdlinebuf[i] == '\0') {
             argc++;
-            argv[argc] = &cmdlinebuf[i + 1];
+            argv[argc] = (char *) &cmdlinebuf[i + 1];
         }
     }
     argv[argc] = NULL;
@@ -160,7 +155,7 @@ static void initPib(void)
         if (strncmp(str, "PATH=", 5) == 0) {
             if (!GLoaderState.subprocess)
                 str = path;
-        } else if (strncmp(str, "IS_2INE=", 8) == 0) {
+        } else if ((strncmp(str, "IS_2INE=", 8) == 0) || (strncmp(str, "IS_2INE_NOASLR=", 15) == 0)) {
             continue;
         } // if
         len += strlen(str) + 1;
@@ -191,7 +186,7 @@ static void initPib(void)
                 str = path;
         } else if (strncmp(str, "LIBPATH=", 8) == 0) {
             libpath = str + 8;
-        } else if (strncmp(str, "IS_2INE=", 8) == 0) {
+        } else if ((strncmp(str, "IS_2INE=", 8) == 0) || (strncmp(str, "IS_2INE_NOASLR=", 15) == 0)) {
             continue;
         } // if
 
@@ -257,7 +252,6 @@ static void initPib(void)
         argv--;
     }
 
-    free(cmdlinebuf);
     free(argv);
 } // initPib
 
@@ -395,6 +389,18 @@ static void cfgProcessFloatString(const char *fname, const int lineno, float *ou
     }
 }
 
+static void cfgProcessIntString(const char *fname, const int lineno, int *output, const char *val)
+{
+    char *endp = NULL;
+    errno = 0;
+    const long converted = strtol(val, &endp, 10);
+    if (!errno && (endp != val) && (*endp == '\0') && (converted >= 0) && (converted <= 1024)) {
+        *output = (int) converted;
+    } else {
+        cfgWarn(fname, lineno, "\"%s\" is not valid for this setting. Try a whole number.", val);
+    }
+}
+
 static void cfgProcessMountPoint(const char *fname, const int lineno, const char *var, const char *val)
 {
     char letter = var[0];
@@ -439,6 +445,25 @@ static void cfgProcessSystem(const char *fname, const int lineno, const char *va
         cfgProcessBoolString(fname, lineno, &GLoaderState.trace_events, val);
     } else if (strcmp(var, "beep_volume") == 0) {
         cfgProcessFloatString(fname, lineno, &GLoaderState.beep_volume, val);
+    } else if (strcmp(var, "lazy_load") == 0) {
+        cfgProcessBoolString(fname, lineno, &GLoaderState.lazy_load, val);
+    } else if (strcmp(var, "module_cache") == 0) {
+        cfgProcessBoolString(fname, lineno, &GLoaderState.module_cache, val);
+    } else if (strcmp(var, "module_cache_max") == 0) {
+        cfgProcessIntString(fname, lineno, &GLoaderState.module_cache_max, val);
+    } else if (strcmp(var, "loader_threads") == 0) {
+        cfgProcessIntString(fname, lineno, &GLoaderState.loader_threads, val);
+    } else if (strcmp(var, "thread_pool") == 0) {
+        cfgProcessIntString(fname, lineno, &GLoaderState.thread_pool, val);
+    } else if (strcmp(var, "file_buffering") == 0) {
+        cfgProcessBoolString(fname, lineno, &GLoaderState.file_buffering, val);
+    } else if (strcmp(var, "path_cache") == 0) {
+        cfgProcessBoolString(fname, lineno, &GLoaderState.path_cache, val);
+    } else if (strcmp(var, "zygote") == 0) {
+        cfgProcessBoolString(fname, lineno, &GLoaderState.zygote, val);
+    } else if (strcmp(var, "zygote_preload") == 0) {
+        free(GLoaderState.zygote_preload);
+        GLoaderState.zygote_preload = strdup(val);
     } else {
         cfgWarn(fname, lineno, "Unknown variable system.%s", var);
     }
@@ -776,6 +801,48 @@ static int registerAudioGenerator_lib2ine(LxAudioGeneratorFn fn, void *data, con
 } // registerAudioGenerator_lib2ine
 
 
+static void applyEnvironmentOverrides(void)
+{
+    // these override config files (for now).
+    if (getenv("TRACE_NATIVE")) {
+        GLoaderState.trace_native = 1;
+    }
+
+    if (getenv("TRACE_EVENTS")) {
+        GLoaderState.trace_events = 1;
+    }
+
+    if (getenv("LAZY_LOAD")) {
+        GLoaderState.lazy_load = 1;
+    }
+
+    GLoaderState.subprocess = (getenv("IS_2INE") != NULL);
+}
+
+// lx_loader's zygote forks new OS/2 processes without exec'ing, so they
+//  inherit everything we set up for the zygote itself. This rebuilds the
+//  parts that depend on the command line, environment and current directory.
+static void reinitProcess_lib2ine(const char *cmdline, const size_t cmdlinelen)
+{
+    for (int i = 0; i < (sizeof (GLoaderState.current_dir) / sizeof (GLoaderState.current_dir[0])); i++) {
+        free(GLoaderState.current_dir[i]);
+        GLoaderState.current_dir[i] = NULL;
+    }
+
+    prepOs2Drives();
+    applyEnvironmentOverrides();
+
+    free(GLoaderState.pib.pib_pchenv);
+    free(GLoaderState.libpath);
+    GLoaderState.libpath = NULL;
+    initPib(cmdline, cmdlinelen);
+}
+
+static int execViaZygote_lib2ine(char * const *argv, char * const *envp, uint32 *pid, int *statusfd)
+{
+    return 0;  // only lx_loader has a zygote.
+}
+
 static void lib2ine_shutdown(void)
 {
     if (sdl_audio_device) {
@@ -802,6 +869,9 @@ static void lib2ine_shutdown(void)
     free(GLoaderState.pib.pib_pchenv);
     GLoaderState.pib.pib_pchenv = NULL;
 
+    free(GLoaderState.zygote_preload);
+    GLoaderState.zygote_preload = NULL;
+
     pthread_key_delete(tlskey);
 }
 
@@ -829,10 +899,21 @@ LX_NATIVE_CONSTRUCTOR(lib2ine)
     GLoaderState.terminate = terminate_lib2ine;
     GLoaderState.registerAudioGenerator = registerAudioGenerator_lib2ine;
     GLoaderState.lib2ine_shutdown = lib2ine_shutdown;
+    GLoaderState.execViaZygote = execViaZygote_lib2ine;
+    GLoaderState.reinitProcess = reinitProcess_lib2ine;
 
     // VMware emulates the PC Speaker on a sound card _really_ quietly.
     GLoaderState.beep_volume = 0.05f;
 
+    // decode/fixup module pages serially unless the config says otherwise.
+    GLoaderState.loader_threads = 1;
+
+    // keep the module cache (if enabled) under 256 megabytes.
+    GLoaderState.module_cache_max = 256;
+
+    // cache case-insensitive directory scans unless the config says otherwise.
+    GLoaderState.path_cache = 1;
+
     cfgLoadFiles();
     prepOs2Drives();
 
@@ -843,18 +924,15 @@ LX_NATIVE_CONSTRUCTOR(lib2ine)
     GLoaderState.initOs2Tib(GLoaderState.main_tibspace, &rlim, rlim.rlim_cur, 0);  // hopefully that's close enough on the stack address.
     GLoaderState.main_tib_selector = GLoaderState.setOs2Tib(GLoaderState.main_tibspace);
 
-    // these override config files (for now).
-    if (getenv("TRACE_NATIVE")) {
-        GLoaderState.trace_native = 1;
-    }
+    applyEnvironmentOverrides();
 
-    if (getenv("TRACE_EVENTS")) {
-        GLoaderState.trace_events = 1;
+    size_t cmdlinebuflen = 0;
+    char *cmdlinebuf = readfile("/proc/self/cmdline", &cmdlinebuflen);
+    if (!cmdlinebuf) {
+        abort();
     }
-
-    GLoaderState.subprocess = (getenv("IS_2INE") != NULL);
-
-    initPib();
+    initPib(cmdlinebuf, cmdlinebuflen);
+    free(cmdlinebuf);
 }
 
 LX_NATIVE_DESTRUCTOR(lib2ine)
@@ -189,6 +189,8 @@ typedef struct LxMmaps
     size_t size;
     int prot;
     uint16 alias;  // 16:16 alias, if one.
+    uint8 *lazypages;  // nonzero for each page not decoded yet (demand-paged objects only, otherwise NULL).
+    uint32 *lazyimportidx;  // per page, where its imports start in LxModule::lazyimports (demand-paged objects only).
 } LxMmaps;
 
 typedef struct LxExport
@@ -199,6 +201,35 @@ typedef struct LxExport
     const LxMmaps *object;
 } LxExport;
 
+typedef struct LxLazyImport
+{
+    uint32 finalval;
+    uint32 objaddr;  // base address of the export's object, copied out of the LxExport.
+    uint16 alias;  // the export object's 16:16 alias selector, 0xFFFF if none.
+    int resolved;
+} LxLazyImport;
+
+// a trampoline generated for an entry point a module doesn't have. These are
+//  kept with the module that's missing the entry point, and freed with it.
+typedef struct LxMissingEntry
+{
+    uint32 ordinal;  // zero if this was looked up by name.
+    char *name;  // NULL if this was looked up by ordinal.
+    int is16bit;
+    void *addr;
+    LxExport lxexp;  // 16-bit trampolines only: fixup-to-alias records need the selector.
+    LxMmaps lxmmap;
+    struct LxMissingEntry *next;
+} LxMissingEntry;
+
+typedef struct LxForwarder
+{
+    uint32 ordinal;  // our export that forwards to another module.
+    uint16 module;  // index into our import module table (1-based).
+    uint32 import_ordinal;  // target's ordinal, if import_name is NULL.
+    char *import_name;  // target's name, if importing by name.
+} LxForwarder;
+
 struct LxModule;
 typedef struct LxModule LxModule;
 struct LxModule
@@ -221,12 +252,25 @@ struct LxModule
 
     const LxExport *exports;
     uint32 num_exports;
+    const LxExport **exports_by_ordinal;  // [max_ordinal+1], NULL for unused ordinals.
+    void **resolved_ordinals;  // [max_ordinal+1], cached getModuleProcAddrByOrdinal() results.
+    uint32 max_ordinal;
+    const LxExport **exports_by_name;  // open-addressed hash table of named exports.
+    uint32 exports_by_name_mask;  // number of hash buckets minus one.
+    LxForwarder *forwarders;  // entry table forwarders that aren't resolved yet (NULL once they are).
+    uint32 num_forwarders;
+    LxMissingEntry *missing_entries;  // trampolines for entry points other modules wanted from us (guarded by the loader's trampoline mutex).
     void *nativelib;
     uint32 eip;
     uint32 esp;
     uint16 autodatasize;  // only used for NE binaries.
     int initialized;
     char *os2path;  // absolute path to module, in OS/2 format
+    uint8 *lazyimage;  // the module file, kept around if objects are demand-paged (otherwise NULL).
+    uint32 lazyimagelen;
+    const uint8 *lazyexe;  // points to the LX header inside lazyimage.
+    LxLazyImport *lazyimports;  // what every import fixup in a demand-paged page resolved to, at load time.
+    LxModule *lazynext;  // modules with demand-paged objects are in a singly-linked list.
     // !!! FIXME: put this elsewhere?
     uint32 signal_exception_focus_count;
     LxModule *prev;  // all loaded modules are in a doubly-linked list.
@@ -300,6 +344,22 @@ typedef struct LxLoaderState
     int current_disk;  // 1==A:\\, 2==B:\\, etc.
     uint32 diskmap;  // 1<<0==drive A mounted, 1<<1==drive B mounted, etc.
     float beep_volume;
+    int lazy_load;  // decode LX object pages on first access instead of at load time.
+    uint32 lazy_pages_deferred;  // pages that were left for demand-paging at load time.
+    uint32 lazy_pages_materialized;  // demand-paged pages that actually got touched.
+    uint32 file_mapped_pages;  // object pages mmap()'d directly from module files.
+    int module_cache;  // keep relocated LX modules in an on-disk cache.
+    int module_cache_max;  // megabytes the module cache directory can use before old entries get evicted.
+    int loader_threads;  // threads to decode/fixup module pages with (0 == one per CPU).
+    int thread_pool;  // parked pthreads DosCreateThread can hand OS/2 threads to (0 == a new pthread per thread).
+    int file_buffering;  // buffer regular file HFILEs: read-ahead for sequential reads, coalesced small writes.
+    uint32 module_cache_hits;
+    uint32 module_cache_misses;
+    int path_cache;  // index directories we scan for case-insensitive path lookups.
+    uint32 path_cache_hits;
+    uint32 path_cache_misses;
+    int zygote;  // launch OS/2 child processes by forking a pre-initialized helper process.
+    char *zygote_preload;  // comma-separated native modules the zygote loads up front (NULL == just DOSCALLS).
     uint8 main_tib_selector;
     uint32 mainstacksize;
     uint16 original_cs;
@@ -313,6 +373,7 @@ typedef struct LxLoaderState
     uint32 tlsmask;  // one bit for each TLS slot in use.
     uint8 tlsallocs[32];  // number of TLS slots allocated in one block, indexed by starting block (zero if not the starting block).
     void (*dosExit)(uint32 action, uint32 result);
+    void (*dosReinitProcess)(void);  // DOSCALLS sets this: refresh per-process state in a process the zygote forked.
     void (*initOs2Tib)(uint8 *tibspace, void *_topOfStack, const size_t stacklen, const uint32 tid);
     uint16 (*setOs2Tib)(uint8 *tibspace);
     LxTIB *(*getOs2Tib)(void);
@@ -328,6 +389,8 @@ typedef struct LxLoaderState
     void __attribute__((noreturn)) (*terminate)(const uint32 exitcode);
     int (*registerAudioGenerator)(LxAudioGeneratorFn fn, void *data, const int singleton);
     void (*lib2ine_shutdown)(void);
+    int (*execViaZygote)(char * const *argv, char * const *envp, uint32 *pid, int *statusfd);
+    void (*reinitProcess)(const char *cmdline, const size_t cmdlinelen);
 } LxLoaderState;
 
 typedef const LxExport *(*LxNativeModuleInitEntryPoint)(uint32 *lx_num_exports);
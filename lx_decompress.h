@@ -0,0 +1,168 @@
+/**
+ * 2ine; an OS/2 emulator for Linux.
+ *
+ * Please see the file LICENSE.txt in the source's root directory.
+ *
+ *  This file written by Ryan C. Gordon.
+ */
+
+/* LX page decompressors. These are static functions, included directly by
+   lx_loader.c (and the EXEPACK2 benchmark in tests/, so it measures the real
+   thing). Include lib2ine.h first, for the integer types. */
+
+#ifndef _INCL_LX_DECOMPRESS_H_
+#define _INCL_LX_DECOMPRESS_H_ 1
+
+// Copy a back-reference of (len) bytes from (dist) bytes behind (dst).
+//  The source and destination can overlap (that's how runs get encoded),
+//  in which case this has to behave exactly like a forward byte-by-byte copy.
+static inline void copyBackReference(uint8 *dst, const uint32 dist, uint32 len)
+{
+    const uint8 *src = dst - dist;
+
+    if (dist >= len) {  // no overlap, just copy it.
+        memcpy(dst, src, len);
+    } else if (dist == 1) {  // a run of a single byte.
+        memset(dst, *src, len);
+    } else if (dist == 0) {
+        // byte-by-byte, this copies each byte onto itself, so leave it alone.
+    } else {
+        // Overlapping pattern: everything from src up to dst repeats with a
+        //  period of (dist), so each copy can be as big as everything we've
+        //  written so far plus the original pattern, doubling each time.
+        //  This gets us to wide memcpy()s after a few iterations instead of
+        //  moving a byte at a time.
+        uint32 avail = dist;
+        while (len > avail) {
+            memcpy(dst, src, avail);
+            dst += avail;
+            len -= avail;
+            avail += avail;
+        } // while
+        memcpy(dst, src, len);
+    } // else
+} // copyBackReference
+
+/* this algorithm is from lxlite 138u. */
+static int decompressExePack2(uint8 *dst, const uint32 dstlen, const uint8 *src, const uint32 srclen)
+{
+    const uint8 *srcend = src + srclen;
+    uint8 *dstptr = dst;
+    uint8 *dstend = dst + dstlen;
+
+    // Every token is validated once against the buffer bounds up front, then
+    //  decoded without any further checks.
+    do {
+        uint32 srcavail = (uint32) (srcend - src);
+        uint32 hdrlen, litlen, matchlen, dist;
+        uint8 b1;
+
+        if (srcavail < 1)
+            break;
+
+        b1 = *src;
+        switch (b1 & 3) {
+            case 0:
+                if (b1 != 0) {  // literal run.
+                    litlen = b1 >> 2;
+                    if ((srcavail < (litlen + 1)) || (((uint32) (dstend - dstptr)) < litlen))
+                        return 0;
+                    memcpy(dstptr, src + 1, litlen);
+                    dstptr += litlen;
+                    src += litlen + 1;
+                } else if (srcavail < 2) {
+                    return 0;
+                } else if (src[1] == 0) {  // no-op.
+                    src += 2;
+                } else {  // repeated byte.
+                    if ((srcavail < 3) || (((uint32) (dstend - dstptr)) < src[1]))
+                        return 0;
+                    memset(dstptr, src[2], src[1]);
+                    dstptr += src[1];
+                    src += 3;
+                } // else
+                continue;
+
+            case 1:  // short literal run plus a back-reference.
+                if (srcavail < 2)
+                    return 0;
+                hdrlen = 2;
+                dist = ((uint32) (src[0] | (src[1] << 8))) >> 7;
+                matchlen = ((b1 >> 4) & 7) + 3;
+                litlen = (b1 >> 2) & 3;
+                break;
+
+            case 2:  // back-reference only.
+                if (srcavail < 2)
+                    return 0;
+                hdrlen = 2;
+                dist = ((uint32) (src[0] | (src[1] << 8))) >> 4;
+                matchlen = ((b1 >> 2) & 3) + 3;
+                litlen = 0;
+                break;
+
+            default:  // case 3: longer literal run plus a back-reference.
+                if (srcavail < 3)
+                    return 0;
+                hdrlen = 3;
+                matchlen = (((uint32) (src[0] | (src[1] << 8))) >> 6) & 0x3F;
+                litlen = (b1 >> 2) & 0x0F;
+                dist = ((uint32) (src[1] | (src[2] << 8))) >> 4;
+                break;
+        } // switch
+
+        if (srcavail < (hdrlen + litlen))
+            return 0;
+        else if (((uint32) (dstend - dstptr)) < (litlen + matchlen))
+            return 0;
+        else if (dist > (((uint32) (dstptr - dst)) + litlen))
+            return 0;  // back-reference to before the start of the page.
+
+        memcpy(dstptr, src + hdrlen, litlen);
+        dstptr += litlen;
+        src += hdrlen + litlen;
+        copyBackReference(dstptr, dist, matchlen);
+        dstptr += matchlen;
+    } while (dstptr < dstend);
+
+    // pad out the rest of the page with zeroes.
+    if (dstptr < dstend)
+        memset(dstptr, '\0', (size_t) (dstend - dstptr));
+
+    return 1;
+} // decompressExePack2
+
+static int decompressIterated(uint8 *dst, uint32 dstlen, const uint8 *src, uint32 srclen)
+{
+    while (srclen) {
+        if (srclen < 4)
+            return 0;
+        const uint16 iterations = *((uint16 *) src); src += 2;
+        const uint16 len = *((uint16 *) src); src += 2;
+        srclen -= 4;
+        if (dstlen < (iterations * len))
+            return 0;
+        else if (srclen < len)
+            return 0;
+
+        for (uint16 i = 0; i < iterations; i++) {
+            memcpy(dst, src, len);
+            dst += len;
+            dstlen -= len;
+        } // for
+
+        src += len;
+        srclen -= len;
+    } // while
+
+    // pad out the rest of the page with zeroes.
+    if (dstlen > 0)
+        memset(dst, '\0', dstlen);
+
+    return 1;
+} // decompressIterated
+
+#endif
+
+// end of lx_decompress.h ...
+
@@ -453,7 +453,7 @@ static int parseLxExe(const uint8 *origexe, const uint8 *exe)
                 }
                 break;
 
-            case 0x04: printf("FORWARDER\n"); break;
+            case 0x04: printf("FORWARDER\n");
                 printf(" Reserved field: %u\n", (uint) *((const uint16 *) entryptr)); entryptr += 2;
                 for (uint8 i = 0; i < numentries; i++) {
                     printf(" %d:\n", ordinal++);
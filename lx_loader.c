@@ -14,11 +14,19 @@
 #include <unistd.h>
 #include <stdint.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/personality.h>
+#include <sys/prctl.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
 #include <assert.h>
 #include <dlfcn.h>
 #include <dirent.h>
 #include <pthread.h>
+#include <sched.h>
 #include <signal.h>
 #include <ucontext.h>
 
@@ -28,6 +36,7 @@
 #include <asm/ldt.h>
 
 #include "lib2ine.h"
+#include "lx_decompress.h"
 
 // !!! FIXME: move this into an lx_common.c file.
 static int sanityCheckLxModule(const uint8 *exe, const uint32 exelen)
@@ -138,6 +147,260 @@ static char *makeOS2Path(const char *fname)
     return retval;
 } // makeOS2Path
 
+// Case-insensitive lookups that miss have to scan a whole directory, which
+//  adds up fast when a mixed-case OS/2 build opens thousands of files in a
+//  big tree. So we keep an index of each directory we've scanned: a hash table
+//  from the case-folded name to the name as it's actually spelled on disk.
+//  An index is trusted until the directory's inode or mtime changes. A
+//  directory modified within a second of when we scanned it might change
+//  again without the timestamp moving, so those are "racy" and get rescanned
+//  on their next lookup instead of trusted (the same trick git's index uses).
+//  Directories are keyed by path plus dev/inode, so different mounts never
+//  share an index, and "." stops matching when the cwd changes.
+// !!! FIXME: this has the same ASCII-only case folding as strcasecmp.
+#define PATHCACHE_MAX_DIRS 1024
+#define PATHCACHE_DIR_BUCKETS 256
+
+typedef struct PathCacheEntry
+{
+    uint32 hash;
+    uint32 next;  // index+1 of next entry in this bucket, 0 for none.
+    const char *name;  // points into the directory's name pool.
+} PathCacheEntry;
+
+typedef struct PathCacheDir
+{
+    char *path;
+    uint32 pathhash;
+    dev_t dev;
+    ino_t ino;
+    struct timespec mtime;
+    int racy;
+    uint32 mask;
+    uint32 *buckets;  // index+1 of first entry in each bucket, 0 for none.
+    PathCacheEntry *entries;
+    char *names;
+    struct PathCacheDir *next;
+} PathCacheDir;
+
+static pthread_mutex_t GMutexPathCache = PTHREAD_MUTEX_INITIALIZER;
+static PathCacheDir *GPathCache[PATHCACHE_DIR_BUCKETS];
+static uint32 GNumPathCacheDirs = 0;
+
+static uint32 hashPathCaseFolded(const char *name)
+{
+    uint32 hash = 0x811C9DC5;  // FNV-1a
+    while (*name) {
+        uint8 ch = (uint8) *(name++);
+        if ((ch >= 'A') && (ch <= 'Z'))
+            ch += 'a' - 'A';
+        hash ^= (uint32) ch;
+        hash *= 0x01000193;
+    } // while
+    return hash;
+} // hashPathCaseFolded
+
+static void freePathCacheDir(PathCacheDir *dir)
+{
+    if (dir) {
+        free(dir->path);
+        free(dir->buckets);
+        free(dir->entries);
+        free(dir->names);
+        free(dir);
+    } // if
+} // freePathCacheDir
+
+// call with GMutexPathCache held.
+static void flushPathCache(void)
+{
+    for (uint32 i = 0; i < PATHCACHE_DIR_BUCKETS; i++) {
+        PathCacheDir *next;
+        for (PathCacheDir *dir = GPathCache[i]; dir; dir = next) {
+            next = dir->next;
+            freePathCacheDir(dir);
+        } // for
+        GPathCache[i] = NULL;
+    } // for
+    GNumPathCacheDirs = 0;
+} // flushPathCache
+
+// Scans (dirp) into a new index. Doesn't need the lock.
+static PathCacheDir *buildPathCacheDir(const char *path, const uint32 pathhash, DIR *dirp, const struct stat *statbuf)
+{
+    PathCacheDir *dir = (PathCacheDir *) calloc(1, sizeof (PathCacheDir));
+    if (!dir)
+        return NULL;
+
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+
+    size_t poollen = 0;
+    size_t poolalloc = 0;
+    uint32 count = 0;
+    uint32 alloc = 0;
+    for (struct dirent *dent = readdir(dirp); dent; dent = readdir(dirp)) {
+        const size_t len = strlen(dent->d_name) + 1;
+        if ((poollen + len) > poolalloc) {
+            poolalloc = (poolalloc ? poolalloc : 4096);
+            while ((poollen + len) > poolalloc)
+                poolalloc *= 2;
+            void *ptr = realloc(dir->names, poolalloc);
+            if (!ptr) {
+                freePathCacheDir(dir);
+                return NULL;
+            } // if
+            dir->names = (char *) ptr;
+        } // if
+
+        if (count == alloc) {
+            alloc = alloc ? (alloc * 2) : 64;
+            void *ptr = realloc(dir->entries, alloc * sizeof (PathCacheEntry));
+            if (!ptr) {
+                freePathCacheDir(dir);
+                return NULL;
+            } // if
+            dir->entries = (PathCacheEntry *) ptr;
+        } // if
+
+        memcpy(dir->names + poollen, dent->d_name, len);
+        dir->entries[count].hash = hashPathCaseFolded(dent->d_name);
+        dir->entries[count].name = (const char *) (size_t) poollen;  // fixed up below, the pool might move.
+        poollen += len;
+        count++;
+    } // for
+
+    uint32 buckets = 16;
+    while (buckets < count)
+        buckets *= 2;
+
+    dir->path = strdup(path);
+    dir->buckets = (uint32 *) calloc(buckets, sizeof (uint32));
+    if (!dir->path || !dir->buckets) {
+        freePathCacheDir(dir);
+        return NULL;
+    } // if
+
+    dir->mask = buckets - 1;
+    for (uint32 i = 0; i < count; i++) {
+        PathCacheEntry *entry = &dir->entries[i];
+        const uint32 bucket = entry->hash & dir->mask;
+        entry->name = dir->names + (size_t) entry->name;
+        entry->next = dir->buckets[bucket];
+        dir->buckets[bucket] = i + 1;
+    } // for
+
+    dir->pathhash = pathhash;
+    dir->dev = statbuf->st_dev;
+    dir->ino = statbuf->st_ino;
+    dir->mtime = statbuf->st_mtim;
+    dir->racy = (statbuf->st_mtim.tv_sec >= (now.tv_sec - 1));
+    return dir;
+} // buildPathCacheDir
+
+// call with GMutexPathCache held.
+static PathCacheDir *findPathCacheDir(const char *path, const uint32 pathhash, const struct stat *statbuf)
+{
+    PathCacheDir **bucket = &GPathCache[pathhash % PATHCACHE_DIR_BUCKETS];
+    PathCacheDir *prev = NULL;
+    for (PathCacheDir *dir = *bucket; dir; dir = dir->next) {
+        if ((dir->pathhash == pathhash) && (strcmp(dir->path, path) == 0)) {
+            if (dir->racy || (dir->dev != statbuf->st_dev) || (dir->ino != statbuf->st_ino) ||
+                (dir->mtime.tv_sec != statbuf->st_mtim.tv_sec) || (dir->mtime.tv_nsec != statbuf->st_mtim.tv_nsec)) {
+                if (prev)  // stale, drop it.
+                    prev->next = dir->next;
+                else
+                    *bucket = dir->next;
+                freePathCacheDir(dir);
+                GNumPathCacheDirs--;
+                return NULL;
+            } // if
+
+            if (prev) {  // move to the front of the bucket.
+                prev->next = dir->next;
+                dir->next = *bucket;
+                *bucket = dir;
+            } // if
+            return dir;
+        } // if
+        prev = dir;
+    } // for
+    return NULL;
+} // findPathCacheDir
+
+// call with GMutexPathCache held.
+static void addPathCacheDir(PathCacheDir *dir)
+{
+    if (GNumPathCacheDirs >= PATHCACHE_MAX_DIRS)
+        flushPathCache();  // !!! FIXME: evict something smarter than "everything".
+    PathCacheDir **bucket = &GPathCache[dir->pathhash % PATHCACHE_DIR_BUCKETS];
+    dir->next = *bucket;
+    *bucket = dir;
+    GNumPathCacheDirs++;
+} // addPathCacheDir
+
+static const char *findPathCacheEntry(const PathCacheDir *dir, const char *name)
+{
+    const uint32 hash = hashPathCaseFolded(name);
+    for (uint32 i = dir->buckets[hash & dir->mask]; i; i = dir->entries[i-1].next) {
+        const PathCacheEntry *entry = &dir->entries[i-1];
+        if ((entry->hash == hash) && (strcasecmp(entry->name, name) == 0))
+            return entry->name;
+    } // for
+    return NULL;
+} // findPathCacheEntry
+
+// Find (name) in the directory (path), case-insensitively. On success,
+//  (name) is overwritten with the on-disk spelling.
+static int locateOneElementCached(const char *path, char *name)
+{
+    struct stat statbuf;
+    if (stat(path, &statbuf) == -1)
+        return 0;
+
+    const uint32 pathhash = hashPathCaseFolded(path);
+    const char *found = NULL;
+    pthread_mutex_lock(&GMutexPathCache);
+    PathCacheDir *dir = findPathCacheDir(path, pathhash, &statbuf);
+    if (dir) {
+        GLoaderState.path_cache_hits++;
+        found = findPathCacheEntry(dir, name);
+        if (found)
+            strcpy(name, found);
+        pthread_mutex_unlock(&GMutexPathCache);
+        return found ? 1 : 0;
+    } // if
+    GLoaderState.path_cache_misses++;
+    pthread_mutex_unlock(&GMutexPathCache);
+
+    DIR *dirp = opendir(path);
+    if (!dirp)
+        return 0;
+    dir = buildPathCacheDir(path, pathhash, dirp, &statbuf);
+    closedir(dirp);
+    if (!dir)
+        return -1;  // out of memory? Let the caller scan the slow way.
+
+    pthread_mutex_lock(&GMutexPathCache);
+    found = findPathCacheEntry(dir, name);
+    if (found)
+        strcpy(name, found);
+    if (findPathCacheDir(path, pathhash, &statbuf) == NULL)  // another thread might have beat us here.
+        addPathCacheDir(dir);
+    else
+        freePathCacheDir(dir);
+    pthread_mutex_unlock(&GMutexPathCache);
+
+    return found ? 1 : 0;
+} // locateOneElementCached
+
+static void freePathCache(void)
+{
+    pthread_mutex_lock(&GMutexPathCache);
+    flushPathCache();
+    pthread_mutex_unlock(&GMutexPathCache);
+} // freePathCache
+
 // based on case-insensitive search code from PhysicsFS:
 //    https://icculus.org/physfs/
 //  It's also zlib-licensed, plus I wrote it.  :)  --ryan.
@@ -148,31 +411,41 @@ static int locateOneElement(char *buf)
     if (access(buf, F_OK) == 0)
         return 1;  // quick rejection: exists in current case.
 
-    DIR *dirp;
+    const char *dirname;
+    char *name;
     char *ptr = strrchr(buf, '/');  // find entry at end of path.
     if (ptr == NULL) {
-        dirp = opendir(".");
-        ptr = buf;
+        dirname = ".";
+        name = buf;
     } else if (ptr == buf) {
-        dirp = opendir("/");
+        dirname = "/";
+        name = ptr + 1;
     } else {
         *ptr = '\0';
-        dirp = opendir(buf);
-        *ptr = '/';
-        ptr++;  // point past dirsep to entry itself.
+        dirname = buf;
+        name = ptr + 1;  // point past dirsep to entry itself.
     } // else
 
-    for (struct dirent *dent = readdir(dirp); dent; dent = readdir(dirp)) {
-        if (strcasecmp(dent->d_name, ptr) == 0) {
-            strcpy(ptr, dent->d_name); // found a match. Overwrite with this case.
+    int rc = GLoaderState.path_cache ? locateOneElementCached(dirname, name) : -1;
+    if (rc == -1) {  // no cache (or it failed), scan the directory.
+        rc = 0;
+        DIR *dirp = opendir(dirname);
+        if (dirp) {
+            for (struct dirent *dent = readdir(dirp); dent; dent = readdir(dirp)) {
+                if (strcasecmp(dent->d_name, name) == 0) {
+                    strcpy(name, dent->d_name); // found a match. Overwrite with this case.
+                    rc = 1;
+                    break;
+                } // if
+            } // for
             closedir(dirp);
-            return 1;
         } // if
-    } // for
+    } // if
 
-    // no match at all...
-    closedir(dirp);
-    return 0;
+    if (dirname == buf)
+        *ptr = '/';  // restore path separator.
+
+    return rc;
 } // locateOneElement
 
 static int locatePathCaseInsensitive(char *buf)
@@ -255,167 +528,109 @@ static char *lxMakeUnixPath(const char *os2path, uint32 *err)
     return retval;
 } // lxMakeUnixPath
 
-
-// So exepack2 sometimes copies between pieces of the destination buffer,
-//  but you can't memmove() since you actually want it to copy the data as
-//  it changes in case of overlap. But to prevent debugging tools from
-//  complaining about overlapping memcpy()'s, we just do a simple for-loop.
-static void linearmove(uint8 *dst, const uint8 *src, uint8 len)
+static inline uint16 lxSelectorToSegment(const uint16 selector)
 {
-    while (len--) {
-        *dst = *src;
-        dst++;
-        src++;
-    }
-} // linearmove
+    return (selector << 3) | 7;
+} // lxSelectorToSegment
 
-/* this algorithm is from lxlite 138u. */
-static int decompressExePack2(uint8 *dst, const uint32 dstlen, const uint8 *src, const uint32 srclen)
+// Selector management. GLoaderState.ldt holds the base address of each LDT
+//  slot (zero if unused), and every segment we hand out is 64k, starting on
+//  a 64k boundary, so we also keep a table that maps each 64k "tile" of the
+//  address space back to the selectors that point at it (more than one can,
+//  so each tile has a list, threaded through GTileSelectorNext). Free slots are tracked in a two-level
+//  bitmap, so allocation, lookup, and freeing never have to walk the LDT.
+// Selectors are refcounted: things that explicitly own a selector (module
+//  aliases, allocated segments, stack tiles) hold a reference, and
+//  lxFreeSelector() only releases the slot when the last one goes away.
+//  Selectors that only exist because someone converted a pointer to 16:16
+//  have no owner and live until explicitly freed, like before.
+#define LX_SELECTOR_BITMAP_WORDS (LX_MAX_LDT_SLOTS / 32)
+static pthread_mutex_t GMutexSelectors = PTHREAD_MUTEX_INITIALIZER;
+static uint32 GFreeSelectors[LX_SELECTOR_BITMAP_WORDS];  // bit set == slot is free.
+static uint32 GFreeSelectorsSummary[(LX_SELECTOR_BITMAP_WORDS + 31) / 32];  // bit set == that GFreeSelectors word has a free slot.
+static uint16 GSelectorRefcount[LX_MAX_LDT_SLOTS];
+static uint16 GTileSelectors[0x10000];  // (selector + 1) of the first selector for each 64k tile of the address space, zero if none.
+static uint16 GTileSelectorNext[LX_MAX_LDT_SLOTS];  // (selector + 1) of the next selector on the same tile, zero if none.
+
+static void initSelectors(void)
 {
-    sint32 sOf = 0;
-    sint32 dOf = 0;
-    sint32 bOf = 0;
-    uint8 b1 = 0;
-    uint8 b2 = 0;
-
-    #define SRCAVAIL(n) ((sOf + (n)) <= srclen)
-    #define DSTAVAIL(n) ((dOf + (n)) <= dstlen)
-
-    do {
-        if (!SRCAVAIL(1))
-            break;
-
-        b1 = src[sOf];
-        switch (b1 & 3) {
-            case 0:
-                if (b1 == 0) {
-                    if (SRCAVAIL(2)) {
-                        if (src[sOf + 1] == 0) {
-                            sOf += 2;
-                            break;
-                        } else if (SRCAVAIL(3) && DSTAVAIL(src[sOf + 1])) {
-                            memset(dst + dOf, src[sOf + 2], src[sOf + 1]);
-                            sOf += 3;
-                            dOf += src[sOf - 2];
-                        } else {
-                            return 0;
-                        }
-                    } else {
-                        return 0;
-                    }
-                } else if (SRCAVAIL((b1 >> 2) + 1) && DSTAVAIL(b1 >> 2)) {
-                    memcpy(dst + dOf, src + (sOf + 1), b1 >> 2);
-                    dOf += b1 >> 2;
-                    sOf += (b1 >> 2) + 1;
-                } else {
-                    return 0;
-                }
-                break;
-
-            case 1:
-                if (!SRCAVAIL(2))
-                    return 0;
-                bOf = (*((const uint16 *) (src + sOf))) >> 7;
-                b2 = ((b1 >> 4) & 7) + 3;
-                b1 = ((b1 >> 2) & 3);
-                sOf += 2;
-                if (SRCAVAIL(b1) && DSTAVAIL(b1 + b2) && ((dOf + b1 - bOf) >= 0)) {
-                    memcpy(dst + dOf, src + sOf, b1);
-                    dOf += b1;
-                    sOf += b1;
-                    linearmove(dst + dOf, dst + (dOf - bOf), b2);
-                    dOf += b2;
-                } else {
-                    return 0;
-                } // else
-                break;
-
-            case 2:
-                if (!SRCAVAIL(2))
-                    return 0;
-                bOf = (*((const uint16 *) (src + sOf))) >> 4;
-                b1 = ((b1 >> 2) & 3) + 3;
-                if (DSTAVAIL(b1) && (dOf - bOf >= 0)) {
-                    linearmove(dst + dOf, dst + (dOf - bOf), b1);
-                    dOf += b1;
-                    sOf += 2;
-                } else {
-                    return 0;
-                } // else
-                break;
-
-            case 3:
-                if (!SRCAVAIL(3))
-                    return 0;
-                b2 = ((*((const uint16 *) (src + sOf))) >> 6) & 0x3F;
-                b1 = (src[sOf] >> 2) & 0x0F;
-                bOf = (*((const uint16 *) (src + (sOf + 1)))) >> 4;
-                sOf += 3;
-                if (SRCAVAIL(b1) && DSTAVAIL(b1 + b2) && ((dOf + b1 - bOf) >= 0))
-                {
-                    memcpy(dst + dOf, src + sOf, b1);
-                    dOf += b1;
-                    sOf += b1;
-                    linearmove(dst + dOf, dst + (dOf - bOf), b2);
-                    dOf += b2;
-                } else {
-                    return 0;
-                } // else
-                break;
-        } // switch
-    } while (dOf < dstlen);
-    #undef SRCAVAIL
-    #undef DSTAVAIL
-
-    // pad out the rest of the page with zeroes.
-    if ((dstlen - dOf) > 0)
-        memset(dst + dOf, '\0', dstlen - dOf);
-
-    return 1;
-} // decompressExePack2
-
-static int decompressIterated(uint8 *dst, uint32 dstlen, const uint8 *src, uint32 srclen)
+    memset(GFreeSelectors, 0xFF, sizeof (GFreeSelectors));
+    memset(GFreeSelectorsSummary, '\0', sizeof (GFreeSelectorsSummary));
+    for (uint32 i = 0; i < LX_SELECTOR_BITMAP_WORDS; i++)
+        GFreeSelectorsSummary[i / 32] |= (1u << (i % 32));
+    memset(GSelectorRefcount, '\0', sizeof (GSelectorRefcount));
+    memset(GTileSelectors, '\0', sizeof (GTileSelectors));
+    memset(GTileSelectorNext, '\0', sizeof (GTileSelectorNext));
+} // initSelectors
+
+// call these with GMutexSelectors held.
+static void markSelectorUsed(const uint16 selector)
 {
-    while (srclen) {
-        if (srclen < 4)
-            return 0;
-        const uint16 iterations = *((uint16 *) src); src += 2;
-        const uint16 len = *((uint16 *) src); src += 2;
-        srclen -= 4;
-        if (dstlen < (iterations * len))
-            return 0;
-        else if (srclen < len)
-            return 0;
-
-        for (uint16 i = 0; i < iterations; i++) {
-            memcpy(dst, src, len);
-            dst += len;
-            dstlen -= len;
-        } // for
-
-        src += len;
-        srclen -= len;
-    } // while
+    const uint32 word = selector / 32;
+    GFreeSelectors[word] &= ~(1u << (selector % 32));
+    if (GFreeSelectors[word] == 0)
+        GFreeSelectorsSummary[word / 32] &= ~(1u << (word % 32));
+} // markSelectorUsed
 
-    // pad out the rest of the page with zeroes.
-    if (dstlen > 0)
-        memset(dst, '\0', dstlen);
-
-    return 1;
-} // decompressIterated
+static void markSelectorFree(const uint16 selector)
+{
+    const uint32 word = selector / 32;
+    GFreeSelectors[word] |= (1u << (selector % 32));
+    GFreeSelectorsSummary[word / 32] |= (1u << (word % 32));
+} // markSelectorFree
+
+// The selector that tiles this address 1:1 goes first in the tile's list, so
+//  lookups prefer it; anything else goes after it.
+static void addTileSelector(const uint16 selector, const uint32 addr)
+{
+    const uint16 tile = (uint16) (addr >> 16);
+    const uint16 head = GTileSelectors[tile];
+    if ((head == 0) || (selector == tile)) {
+        GTileSelectorNext[selector] = head;
+        GTileSelectors[tile] = selector + 1;
+    } else {
+        GTileSelectorNext[selector] = GTileSelectorNext[head - 1];
+        GTileSelectorNext[head - 1] = selector + 1;
+    } // else
+} // addTileSelector
 
-static inline uint16 lxSelectorToSegment(const uint16 selector)
+static void removeTileSelector(const uint16 selector, const uint32 addr)
 {
-    return (selector << 3) | 7;
-} // lxSelectorToSegment
+    uint16 *link = &GTileSelectors[addr >> 16];
+    while (*link && (*link != (selector + 1)))
+        link = &GTileSelectorNext[*link - 1];
+    if (*link)
+        *link = GTileSelectorNext[selector];
+    GTileSelectorNext[selector] = 0;
+} // removeTileSelector
+
+// We hand out the highest free slot first, since the low ones are
+//  tiled 1:1 with the bottom 512 megabytes of the address space.
+static int findFreeSelector(void)
+{
+    for (int i = (int) (sizeof (GFreeSelectorsSummary) / sizeof (GFreeSelectorsSummary[0])) - 1; i >= 0; i--) {
+        const uint32 summary = GFreeSelectorsSummary[i];
+        if (summary) {
+            const uint32 word = (((uint32) i) * 32) + (31 - __builtin_clz(summary));
+            return (int) ((word * 32) + (31 - __builtin_clz(GFreeSelectors[word])));
+        } // if
+    } // for
+    return -1;
+} // findFreeSelector
 
-// !!! FIXME: mutex this
+// call this with GMutexSelectors held.
 static int allocateSelector(const uint16 selector, const int pages, const uint32 addr, const unsigned int contents, const int is32bit)
 {
     assert(selector < LX_MAX_LDT_SLOTS);
 
-    if (GLoaderState.ldt[selector])
-        return 0;  // already in use.
+    if (addr && (GLoaderState.ldt[selector] == addr)) {
+        // already pointing at the same tile? If it was a conversion selector
+        //  that nobody owned, it's ours now; otherwise share it.
+        GSelectorRefcount[selector]++;
+        return 1;
+    } else if (GLoaderState.ldt[selector]) {
+        return 0;  // already in use for something else.
+    } // else if
 
     //const int expand_down = (contents == MODIFY_LDT_CONTENTS_STACK);
 
@@ -433,52 +648,48 @@ static int allocateSelector(const uint16 selector, const int pages, const uint32
         return 0;
 
     GLoaderState.ldt[selector] = addr;
+    GSelectorRefcount[selector] = 1;
+    markSelectorUsed(selector);
+    addTileSelector(selector, addr);
     return 1;
 } // allocateSelector
 
-// !!! FIXME: mutex this
-static int lxFindSelector(const uint32 _addr, uint16 *outselector, uint16 *outoffset, int iscode)
+// if (addref), the caller owns a reference to the selector and must lxFreeSelector() it.
+static int findSelector(const uint32 _addr, uint16 *outselector, uint16 *outoffset, int iscode, const int addref)
 {
     uint32 addr = _addr;
     if (addr < 4096)
         return 0;   // we won't map the NULL page.
 
-    const uint32 *ldt = GLoaderState.ldt;
-
-    int available = -1;
-    int preferred = -1;
-
-    // optimize for the case where we need a selector that happens to be in tiled memory,
-    //  since it's fast to look up.
-    if (addr < (1024 * 1024 * 512)) {
-        const uint16 idx = (uint16) (addr >> 16);
-        const uint32 tile = ldt[idx];
-        if (tile == 0) {
-            preferred = available = idx;  // we can use this piece.
-        } else if ((tile <= addr) && ((tile + 0x10000) > addr)) {
-            *outselector = idx;
-            *outoffset = (uint16) (addr - tile);
-            //printf("SELECTOR: found tiled selector 0x%X for address %p\n", (uint) idx, (void *) addr);
-            return 1;  // already allocated to this address.
-        } // if
+    const uint32 diff = addr % 0x10000;
+    const uint16 tile = (uint16) (addr >> 16);
+    int retval = 0;
+
+    pthread_mutex_lock(&GMutexSelectors);
+
+    // already have a selector for this piece of memory?
+    if (GTileSelectors[tile] != 0) {
+        const uint16 selector = GTileSelectors[tile] - 1;
+        if (addref)
+            GSelectorRefcount[selector]++;
+        *outselector = selector;
+        *outoffset = (uint16) diff;
+        pthread_mutex_unlock(&GMutexSelectors);
+        return 1;
     } // if
 
-    for (int i = 0; i < LX_MAX_LDT_SLOTS; i++) {
-        const uint32 tile = ldt[i];
-        if (tile == 0)
-            available = i;
-        else if ((tile <= addr) && ((tile + 0x10000) > addr)) {
-            *outselector = (uint16) i;
-            *outoffset = (uint16) (addr - tile);
-            //printf("SELECTOR: found existing selector 0x%X for address %p\n", (uint) i, (void *) addr);
-            return 1;  // already allocated to this address.
-        } // else if
-    } // for
+    // memory under 512 megabytes prefers the selector that tiles it, since
+    //  code (EMX, etc) assumes it can convert these with bit twiddling.
+    int selector = -1;
+    if ((addr < (1024 * 1024 * 512)) && (GLoaderState.ldt[tile] == 0))
+        selector = (int) tile;
+    else
+        selector = findFreeSelector();
 
     // nothing allocated to this address so far. Try to allocate something.
-    if (available == -1) {
+    if (selector == -1) {
         fprintf(stderr, "Uhoh, we've run out of LDT selectors! Probably about to crash...\n"); fflush(stderr);
-        return 0;  // uh oh, out of selectors!
+        goto findselector_done;  // uh oh, out of selectors!
     } // if
 
     // decide if there is code or data mapped here. If there's an OS/2 API to
@@ -499,40 +710,65 @@ static int lxFindSelector(const uint32 _addr, uint16 *outselector, uint16 *outof
         iscode = 0;
     }
 
-    const uint32 diff = addr % 0x10000;
     addr -= diff;   // make sure we start on a 64k border.
 
-    const uint16 selector = (uint16) (preferred != -1) ? preferred : available;
     //printf("setting up LDT mapping for %s at selector %u\n", iscode ? "code" : "data", (unsigned int) selector);
 
-    if (!allocateSelector(selector, 16, addr, iscode ? MODIFY_LDT_CONTENTS_CODE : MODIFY_LDT_CONTENTS_DATA, 0)) {
+    if (!allocateSelector((uint16) selector, 16, addr, iscode ? MODIFY_LDT_CONTENTS_CODE : MODIFY_LDT_CONTENTS_DATA, 0)) {
         fprintf(stderr, "Uhoh, we've failed to allocate LDT selector %u! Probably about to crash...\n", (uint) selector); fflush(stderr);
-        return 0;
+        goto findselector_done;
     } // if
 
+    if (!addref)
+        GSelectorRefcount[selector] = 0;  // nobody owns this one.
+
     //printf("SELECTOR: allocated selector 0x%X for address %p\n", (uint) selector, (void *) addr);
-    *outselector = selector;
+    *outselector = (uint16) selector;
     *outoffset = (uint16) diff;
-    return 1;
+    retval = 1;
+
+findselector_done:
+    pthread_mutex_unlock(&GMutexSelectors);
+    return retval;
+} // findSelector
+
+static int lxFindSelector(const uint32 addr, uint16 *outselector, uint16 *outoffset, int iscode)
+{
+    return findSelector(addr, outselector, outoffset, iscode, 1);
 } // lxFindSelector
 
-// !!! FIXME: mutex this
 static void lxFreeSelector(const uint16 selector)
 {
     assert(selector < LX_MAX_LDT_SLOTS);
 
-    if (!GLoaderState.ldt[selector])
+    pthread_mutex_lock(&GMutexSelectors);
+
+    const uint32 addr = GLoaderState.ldt[selector];
+    if (!addr) {
+        pthread_mutex_unlock(&GMutexSelectors);
         return;  // already free.
+    } else if (GSelectorRefcount[selector] > 1) {
+        GSelectorRefcount[selector]--;
+        pthread_mutex_unlock(&GMutexSelectors);
+        return;  // someone else still owns this.
+    } // else if
 
     struct user_desc entry;
     memset(&entry, '\0', sizeof (entry));
     entry.entry_number = (unsigned int) selector;
     entry.read_exec_only = 1;
     entry.seg_not_present = 1;
-    if (syscall(SYS_modify_ldt, 1, &entry, sizeof (entry)) != 0)
+    if (syscall(SYS_modify_ldt, 1, &entry, sizeof (entry)) != 0) {
+        pthread_mutex_unlock(&GMutexSelectors);
         return;  // oh well.
+    } // if
 
     GLoaderState.ldt[selector] = 0;
+    GSelectorRefcount[selector] = 0;
+    markSelectorFree(selector);
+    removeTileSelector(selector, addr);
+
+    pthread_mutex_unlock(&GMutexSelectors);
 } // lxFreeSelector
 
 static void *lxConvert1616to32(const uint32 addr1616)
@@ -554,7 +790,7 @@ static uint32 lxConvert32to1616(void *addr32)
 
     uint16 selector = 0;
     uint16 offset = 0;
-    if (!lxFindSelector((uint32) addr32, &selector, &offset, -1)) {
+    if (!findSelector((uint32) addr32, &selector, &offset, -1, 0)) {
         fprintf(stderr, "Uhoh, ran out of LDT entries?!\n");
         return 0;  // oh well, crash, probably.
     } // if
@@ -574,7 +810,6 @@ static inline void *lxConvertSegmentOffsetto32(const uint16 seg, const uint16 of
 //  without calling DosFlatToSel(). So we tile the main thread's stack and
 //  pray that covers it. If we have to tile _every_ thread's stack, we can do
 //  that later.
-// !!! FIXME: if we do this for secondary thread stacks, we'll need to mutex this.
 static void initOs2StackSegments(uint32 addr, uint32 stacklen, const int deinit)
 {
     //printf("base == %p, stacklen == %u\n", (void*)addr, (uint) stacklen);
@@ -592,7 +827,10 @@ static void initOs2StackSegments(uint32 addr, uint32 stacklen, const int deinit)
         if (deinit) {
             lxFreeSelector((uint16) (addr >> 16));
         } else {
-            if (!allocateSelector((uint16) (addr >> 16), 16, addr, MODIFY_LDT_CONTENTS_DATA, 0)) {
+            pthread_mutex_lock(&GMutexSelectors);
+            const int rc = allocateSelector((uint16) (addr >> 16), 16, addr, MODIFY_LDT_CONTENTS_DATA, 0);
+            pthread_mutex_unlock(&GMutexSelectors);
+            if (!rc) {
                 FIXME("uhoh, couldn't set up an LDT entry for a stack segment! Might crash later!");
             } // if
         } // else
@@ -688,6 +926,24 @@ static __attribute__((noreturn)) void lxTerminate(const uint32 exitcode)
     free(GLoaderState.ldt);
     GLoaderState.ldt = NULL;
 
+    if (GLoaderState.trace_native) {
+        fprintf(stderr, "2INE: mapped %u object pages directly from module files.\n", (uint) GLoaderState.file_mapped_pages);
+        if (GLoaderState.lazy_load) {
+            fprintf(stderr, "2INE: demand-paged %u of %u deferred object pages.\n",
+                    (uint) GLoaderState.lazy_pages_materialized, (uint) GLoaderState.lazy_pages_deferred);
+        } // if
+        if (GLoaderState.module_cache) {
+            fprintf(stderr, "2INE: module cache had %u hits, %u misses.\n",
+                    (uint) GLoaderState.module_cache_hits, (uint) GLoaderState.module_cache_misses);
+        } // if
+        if (GLoaderState.path_cache) {
+            fprintf(stderr, "2INE: path cache had %u hits, %u misses.\n",
+                    (uint) GLoaderState.path_cache_hits, (uint) GLoaderState.path_cache_misses);
+        } // if
+    } // if
+
+    freePathCache();
+
     // OS/2's docs say this only keeps the lower 16 bits of exitcode.
     // !!! FIXME: ...but Unix only keeps the lowest 8 bits. Will have to
     // !!! FIXME:  tapdance to pass larger values back to OS/2 parent processes.
@@ -749,6 +1005,13 @@ static void missingEntryPointCalled(const char *module, const char *entry)
     lxTerminate(1);
 } // missingEntryPointCalled
 
+// bumped every time we hand out a trampoline for a missing entry point.
+static uint32 GMissingTrampolines = 0;
+
+// the loader might be fixing up pages on several threads at once.
+static pthread_mutex_t GMutexTrampolines = PTHREAD_MUTEX_INITIALIZER;
+
+// GMutexTrampolines must be held.
 static void *generateMissingTrampoline(const char *_module, const char *_entry)
 {
     static void *page = NULL;
@@ -799,7 +1062,9 @@ static void *generateMissingTrampoline(const char *_module, const char *_entry)
     return trampoline;
 } // generateMissingTrampoline
 
-static void *generateMissingTrampoline16(const char *_module, const char *_entry, const LxExport **_lxexp)
+// GMutexTrampolines must be held. Fills in (missing)'s export, since fixups
+//  to the trampoline's 16:16 alias need to know its segment.
+static void *generateMissingTrampoline16(const char *_module, const char *_entry, LxMissingEntry *missing)
 {
     static void *segment = NULL;
     static uint32 segmentused = 0;
@@ -893,19 +1158,83 @@ static void *generateMissingTrampoline16(const char *_module, const char *_entry
 
     //printf("Generated trampoline %p for module '%s' 16-bit export '%s'\n", trampoline, module, entry);
 
-    // this hack is not thread safe and only works at all because we don't store this long-term.
-    static LxExport lxexp;
-    static LxMmaps lxmmap;
-    lxexp.addr = trampoline;
-    lxexp.object = &lxmmap;
-    lxmmap.mapped = lxmmap.addr = segment;
-    lxmmap.size = 0x10000;
-    lxmmap.alias = selector;
-    *_lxexp = &lxexp;
+    missing->lxexp.addr = trampoline;
+    missing->lxexp.object = &missing->lxmmap;
+    missing->lxmmap.addr = segment;
+    missing->lxmmap.mapped = NULL;  // the trampoline segment is shared, don't let anyone unmap it.
+    missing->lxmmap.size = segmentsize;
+    missing->lxmmap.alias = selector;
 
     return trampoline;
 } // generateMissingTrampoline16
 
+// GMutexTrampolines must be held.
+static LxMissingEntry *findMissingEntry(const LxModule *module, const uint32 ordinal, const char *name, const int want16bit)
+{
+    for (LxMissingEntry *missing = module->missing_entries; missing; missing = missing->next) {
+        if (missing->is16bit != want16bit)
+            continue;
+        else if (name ? (missing->name && (strcmp(missing->name, name) == 0)) : (!missing->name && (missing->ordinal == ordinal)))
+            return missing;
+    } // for
+    return NULL;
+} // findMissingEntry
+
+// Get the trampoline that reports a missing entry point in (module) when
+//  it's called, making it the first time something asks for it. These are
+//  counted every time they're handed out, not just when they're made, so the
+//  module cache knows not to store any importer that points at one.
+static void *getMissingEntryTrampoline(LxModule *module, const uint32 ordinal, const char *name, const int want16bit, const LxExport **_lxexp)
+{
+    pthread_mutex_lock(&GMutexTrampolines);
+    LxMissingEntry *missing = findMissingEntry(module, ordinal, name, want16bit);
+    if (missing)
+        GMissingTrampolines++;
+    pthread_mutex_unlock(&GMutexTrampolines);
+
+    if (missing) {
+        if (_lxexp)
+            *_lxexp = want16bit ? &missing->lxexp : NULL;
+        return missing->addr;
+    } // if
+
+    char entry[128];
+    if (name)
+        snprintf(entry, sizeof (entry), "%s", name);
+    else
+        snprintf(entry, sizeof (entry), "ordinal #%u", (uint) ordinal);
+
+    LxMissingEntry *newmissing = (LxMissingEntry *) calloc(1, sizeof (LxMissingEntry));
+    char *namecpy = name ? strdup(name) : NULL;
+    if (!newmissing || (name && !namecpy)) {
+        fprintf(stderr, "Out of memory!\n");
+        lxTerminate(1);
+    } // if
+
+    pthread_mutex_lock(&GMutexTrampolines);
+
+    missing = findMissingEntry(module, ordinal, name, want16bit);  // another loader thread might have beat us to it.
+    if (missing) {
+        free(namecpy);
+        free(newmissing);
+    } else {
+        missing = newmissing;
+        missing->ordinal = name ? 0 : ordinal;
+        missing->name = namecpy;
+        missing->is16bit = want16bit;
+        missing->addr = want16bit ? generateMissingTrampoline16(module->name, entry, missing) : generateMissingTrampoline(module->name, entry);
+        missing->next = module->missing_entries;
+        module->missing_entries = missing;
+    } // else
+    GMissingTrampolines++;
+
+    pthread_mutex_unlock(&GMutexTrampolines);
+
+    if (_lxexp)
+        *_lxexp = want16bit ? &missing->lxexp : NULL;
+    return missing->addr;
+} // getMissingEntryTrampoline
+
 static __attribute__((noreturn)) void runLxModule(LxModule *lxmod)
 {
     uint8 *stack = (uint8 *) ((size_t) lxmod->esp);
@@ -1158,6 +1487,17 @@ static void runLibraryTerm(LxModule *lxmod)
     }
 } // runLibraryTerm
 
+static void freeLxForwarders(LxModule *lxmod)
+{
+    for (uint32 i = 0; i < lxmod->num_forwarders; i++)
+        free(lxmod->forwarders[i].import_name);
+    free(lxmod->forwarders);
+    lxmod->forwarders = NULL;
+    lxmod->num_forwarders = 0;
+} // freeLxForwarders
+
+static void unregisterLazyModule(LxModule *lxmod);
+
 static void freeLxModule(LxModule *lxmod)
 {
     if (!lxmod)
@@ -1206,13 +1546,35 @@ static void freeLxModule(LxModule *lxmod)
     } // for
     free(lxmod->dependencies);
 
+    if (lxmod->lazyexe)
+        unregisterLazyModule(lxmod);
+
     for (uint32 i = 0; i < lxmod->num_mmaps; i++) {
         if (lxmod->mmaps[i].alias != 0xFFFF)
             lxFreeSelector(lxmod->mmaps[i].alias);
         if (lxmod->mmaps[i].mapped)
             munmap(lxmod->mmaps[i].mapped, lxmod->mmaps[i].size);
+        free(lxmod->mmaps[i].lazypages);
+        free(lxmod->mmaps[i].lazyimportidx);
     } // for
+    free(lxmod->lazyimports);
     free(lxmod->mmaps);    
+    if (lxmod->lazyimage)
+        munmap(lxmod->lazyimage, lxmod->lazyimagelen);
+
+    free((void *) lxmod->exports_by_ordinal);
+    free((void *) lxmod->exports_by_name);
+    free(lxmod->resolved_ordinals);
+    freeLxForwarders(lxmod);
+
+    // the trampolines themselves stay put; importers we don't know about might still point at them.
+    LxMissingEntry *missing = lxmod->missing_entries;
+    while (missing) {
+        LxMissingEntry *next = missing->next;
+        free(missing->name);
+        free(missing);
+        missing = next;
+    } // while
 
     if (lxmod->nativelib)
         dlclose(lxmod->nativelib);
@@ -1228,61 +1590,264 @@ static void freeLxModule(LxModule *lxmod)
 
 static LxModule *loadModuleByModuleNameInternal(const char *modname, const int dependency_tree_depth);
 
-static void *getModuleProcAddrByOrdinal(const LxModule *module, const uint32 ordinal, const LxExport **_lxexp, const int want16bit, const int native)
+// Build an ordinal-indexed table of a module's exports, so fixups don't
+//  have to walk the whole export list every time. Call this once the
+//  module's exports are set up, before names are assigned.
+static int indexModuleOrdinals(LxModule *lxmod)
 {
-    //printf("lookup module == '%s', ordinal == %u\n", module->name, (uint) ordinal);
+    uint32 max_ordinal = 0;
+    for (uint32 i = 0; i < lxmod->num_exports; i++) {
+        if (lxmod->exports[i].ordinal > max_ordinal)
+            max_ordinal = lxmod->exports[i].ordinal;
+    } // for
+
+    const LxExport **byordinal = (const LxExport **) calloc(max_ordinal + 1, sizeof (LxExport *));
+    void **resolved = (void **) calloc(max_ordinal + 1, sizeof (void *));
+    if (!byordinal || !resolved) {
+        fprintf(stderr, "Out of memory!\n");
+        free(byordinal);
+        free(resolved);
+        return 0;
+    } // if
+
+    // if there are duplicate ordinals, the first one wins, like a linear search would do.
+    for (uint32 i = lxmod->num_exports; i > 0; i--) {
+        const LxExport *lxexp = &lxmod->exports[i-1];
+        byordinal[lxexp->ordinal] = lxexp;
+    } // for
+
+    lxmod->exports_by_ordinal = byordinal;
+    lxmod->resolved_ordinals = resolved;
+    lxmod->max_ordinal = max_ordinal;
+    return 1;
+} // indexModuleOrdinals
+
+static uint32 hashExportName(const char *name)
+{
+    uint32 hash = 0x811C9DC5;  // FNV-1a
+    while (*name) {
+        hash ^= (uint32) (uint8) *(name++);
+        hash *= 0x01000193;
+    } // while
+    return hash;
+} // hashExportName
+
+// Build a hash table of a module's named exports. Call this after all the
+//  name tables are loaded.
+static int indexModuleNames(LxModule *lxmod)
+{
+    uint32 total = 0;
+    for (uint32 i = 0; i < lxmod->num_exports; i++) {
+        if (lxmod->exports[i].name)
+            total++;
+    } // for
+
+    uint32 buckets = 16;
+    while (buckets < (total * 2))  // keep the load factor at 50% or less.
+        buckets <<= 1;
 
-    const LxExport *lxexp = module->exports;
-    for (uint32 i = 0; i < module->num_exports; i++, lxexp++) {
-        if (lxexp->ordinal == ordinal) {
-            if (_lxexp)
-                *_lxexp = lxexp;
-            void *retval = lxexp->addr;
-            if (native && lxexp->object && lxexp->object->alias != 0xFFFF)  // 16-bit bridge? this is actually a void**, due to some macro salsa.  :/
-                retval = *((void**) retval);
-            return retval;
+    const LxExport **byname = (const LxExport **) calloc(buckets, sizeof (LxExport *));
+    if (!byname) {
+        fprintf(stderr, "Out of memory!\n");
+        return 0;
+    } // if
+
+    // linear probing, inserted in export order, so the first match in the
+    //  export list is the first one a lookup will find.
+    const uint32 mask = buckets - 1;
+    for (uint32 i = 0; i < lxmod->num_exports; i++) {
+        const LxExport *lxexp = &lxmod->exports[i];
+        if (lxexp->name) {
+            uint32 bucket = hashExportName(lxexp->name) & mask;
+            while (byname[bucket])
+                bucket = (bucket + 1) & mask;
+            byname[bucket] = lxexp;
         } // if
     } // for
 
+    lxmod->exports_by_name = byname;
+    lxmod->exports_by_name_mask = mask;
+    return 1;
+} // indexModuleNames
+
+static const LxExport *findModuleExportByName(const LxModule *module, const char *name)
+{
+    if (!module->exports_by_name)
+        return NULL;
+
+    const uint32 mask = module->exports_by_name_mask;
+    uint32 bucket = hashExportName(name) & mask;
+    const LxExport *lxexp;
+    while ((lxexp = module->exports_by_name[bucket]) != NULL) {
+        if (strcmp(lxexp->name, name) == 0)
+            return lxexp;
+        bucket = (bucket + 1) & mask;
+    } // while
+    return NULL;
+} // findModuleExportByName
+
+// A module can have an entry forward to another module, which can forward to
+//  another, etc. The spec says chains longer than this are a load error.
+#define LX_MAX_FORWARDER_CHAIN 1024
+
+static const LxForwarder *findLxForwarder(const LxModule *lxmod, const uint32 ordinal)
+{
+    // these are in entry table order, which is sorted by ordinal.
+    uint32 lo = 0;
+    uint32 hi = lxmod->num_forwarders;
+    while (lo < hi) {
+        const uint32 mid = lo + ((hi - lo) / 2);
+        const LxForwarder *fwd = &lxmod->forwarders[mid];
+        if (fwd->ordinal == ordinal)
+            return fwd;
+        else if (fwd->ordinal < ordinal)
+            lo = mid + 1;
+        else
+            hi = mid;
+    } // while
+    return NULL;
+} // findLxForwarder
+
+// Point each forwarder export at whatever the chain of forwarders finally
+//  lands on, so importing a forwarded entry point costs exactly what
+//  importing the real one does. Call this once dependencies are loaded.
+//  Forwarders that end at a missing entry point keep a NULL address, and
+//  lookups treat them like any other missing export.
+static int resolveLxForwarders(LxModule *lxmod)
+{
+    const LxExport *chain[LX_MAX_FORWARDER_CHAIN];
+
+    for (uint32 i = 0; i < lxmod->num_forwarders; i++) {
+        const LxModule *module = lxmod;
+        const LxForwarder *fwd = &lxmod->forwarders[i];
+        const LxExport *lxexp = lxmod->exports_by_ordinal[fwd->ordinal];
+        const LxMmaps *object = NULL;
+        void *addr = NULL;
+        uint32 chainlen = 0;
+
+        if (lxexp->addr)
+            continue;  // already collapsed while walking an earlier chain.
+
+        while (1) {
+            if (chainlen == LX_MAX_FORWARDER_CHAIN) {
+                fprintf(stderr, "Forwarder chain for '%s' ordinal #%u is circular or longer than %u entries!\n", lxmod->name, (uint) lxmod->forwarders[i].ordinal, (uint) LX_MAX_FORWARDER_CHAIN);
+                return 0;
+            } // if
+
+            chain[chainlen++] = lxexp;
+
+            if ((fwd->module == 0) || (fwd->module > module->num_dependencies) || !module->dependencies[fwd->module - 1]) {
+                fprintf(stderr, "Forwarder for '%s' ordinal #%u points to bogus import module #%u!\n", module->name, (uint) fwd->ordinal, (uint) fwd->module);
+                return 0;
+            } // if
+
+            const LxModule *target = module->dependencies[fwd->module - 1];
+            const LxExport *targetexp = NULL;
+            if (fwd->import_name)
+                targetexp = findModuleExportByName(target, fwd->import_name);
+            else if (target->exports_by_ordinal && (fwd->import_ordinal <= target->max_ordinal))
+                targetexp = target->exports_by_ordinal[fwd->import_ordinal];
+
+            if (!targetexp) {
+                // leave it unresolved (NULL), so every importer generates
+                //  (and counts) its own missing-entry trampoline.
+                break;
+            } else if (targetexp->addr || !target->forwarders) {  // a real entry point, we're done.
+                addr = targetexp->addr;
+                object = targetexp->object;
+                break;
+            } // else if
+
+            // the target is a forwarder that isn't resolved yet; keep walking.
+            fwd = findLxForwarder(target, targetexp->ordinal);
+            if (!fwd) {
+                fprintf(stderr, "Export '%s' ordinal #%u has no address!\n", target->name, (uint) targetexp->ordinal);
+                return 0;
+            } // if
+            module = target;
+            lxexp = targetexp;
+        } // while
+
+        // collapse the whole chain, so nothing has to walk it again.
+        for (uint32 j = 0; j < chainlen; j++) {
+            LxExport *fwdexp = (LxExport *) chain[j];
+            fwdexp->addr = addr;
+            fwdexp->object = object;
+        } // for
+    } // for
+
+    freeLxForwarders(lxmod);
+    return 1;
+} // resolveLxForwarders
+
+static void *getModuleProcAddrByOrdinal(LxModule *module, const uint32 ordinal, const LxExport **_lxexp, const int want16bit, const int native)
+{
+    const int indexed = (module->exports_by_ordinal != NULL) && (ordinal <= module->max_ordinal);
+    const LxExport *lxexp = indexed ? module->exports_by_ordinal[ordinal] : NULL;
+
+    // 32-bit import fixups are by far the most common lookup, and the same
+    //  import tends to get fixed up over and over, so we cache the final
+    //  answer for those. Missing-entry trampolines aren't cached here,
+    //  they're kept per module by getMissingEntryTrampoline(), which counts
+    //  every lookup that returns one.
+    //  Loader threads can race to fill in a slot, but they'd all store the
+    //  same value, so atomic loads and stores are all this needs.
+    void **resolved = (indexed && native && !want16bit) ? &module->resolved_ordinals[ordinal] : NULL;
+    void *cached = resolved ? __atomic_load_n(resolved, __ATOMIC_ACQUIRE) : NULL;
+    if (cached) {
+        if (_lxexp)
+            *_lxexp = lxexp;
+        return cached;
+    } // if
+
+    if (lxexp && lxexp->addr) {
+        if (_lxexp)
+            *_lxexp = lxexp;
+        void *retval = lxexp->addr;
+        if (native && lxexp->object && lxexp->object->alias != 0xFFFF)  // 16-bit bridge? this is actually a void**, due to some macro salsa.  :/
+            retval = *((void**) retval);
+        if (resolved)
+            __atomic_store_n(resolved, retval, __ATOMIC_RELEASE);
+        return retval;
+    } // if
+
     if (_lxexp)
         *_lxexp = NULL;
 
     #if 1
-    char entry[128];
-    snprintf(entry, sizeof (entry), "ordinal #%u", (uint) ordinal);
-    return want16bit ? generateMissingTrampoline16(module->name, entry, _lxexp) : generateMissingTrampoline(module->name, entry);
+    return getMissingEntryTrampoline(module, ordinal, NULL, want16bit, _lxexp);
     #else
     return NULL;
     #endif
 } // getModuleProcAddrByOrdinal
 
-static void *getModuleProcAddrByName(const LxModule *module, const char *name, const LxExport **_lxexp, const int want16bit)
+static void *getModuleProcAddrByName(LxModule *module, const char *name, const LxExport **_lxexp, const int want16bit)
 {
-    //printf("lookup module == '%s', name == '%s'\n", module->name, name);
-
-    const LxExport *lxexp = module->exports;
-    for (uint32 i = 0; i < module->num_exports; i++, lxexp++) {
-        if (strcmp(lxexp->name, name) == 0) {
-            if (_lxexp)
-                *_lxexp = lxexp;
-            void *retval = lxexp->addr;
-            if (lxexp->object && lxexp->object->alias != 0xFFFF)  // 16-bit bridge? this is actually a void**, due to some macro salsa.  :/
-                retval = *((void**) retval);
-            return retval;
-        } // if
-    } // for
+    const LxExport *lxexp = findModuleExportByName(module, name);
+    if (lxexp && lxexp->addr) {
+        if (_lxexp)
+            *_lxexp = lxexp;
+        void *retval = lxexp->addr;
+        if (lxexp->object && lxexp->object->alias != 0xFFFF)  // 16-bit bridge? this is actually a void**, due to some macro salsa.  :/
+            retval = *((void**) retval);
+        return retval;
+    } // if
 
     if (_lxexp)
         *_lxexp = NULL;
 
     #if 1
-    return want16bit ? generateMissingTrampoline16(module->name, name, _lxexp) : generateMissingTrampoline(module->name, name);
+    return getMissingEntryTrampoline(module, 0, name, want16bit, _lxexp);
     #else
     return NULL;
     #endif
 } // getModuleProcAddrByName
 
-static void doFixup(uint8 *page, const sint16 offset, const uint32 finalval, const uint16 finalval2, const uint32 finalsize)
+// A fixup that crosses a page boundary has a record in each page it touches
+//  (the second one at a negative offset), so we only write the bytes that
+//  land inside this page. That keeps pages independent of each other, so
+//  several threads can fix up different pages of an object at once.
+static void doFixup(uint8 *page, const uint32 pagelen, const sint16 offset, const uint32 finalval, const uint16 finalval2, const uint32 finalsize)
 {
     #if 0
     if (finalsize == 6) {
@@ -1293,6 +1858,19 @@ static void doFixup(uint8 *page, const sint16 offset, const uint32 finalval, con
     fflush(stdout);
     #endif
 
+    if ((offset < 0) || (((uint32) offset) + finalsize > pagelen)) {
+        const uint8 bytes[6] = {
+            (uint8) finalval, (uint8) (finalval >> 8), (uint8) (finalval >> 16), (uint8) (finalval >> 24),
+            (uint8) finalval2, (uint8) (finalval2 >> 8)
+        };
+        for (uint32 i = 0; i < finalsize; i++) {
+            const sint32 pos = ((sint32) offset) + ((sint32) i);
+            if ((pos >= 0) && (((uint32) pos) < pagelen))
+                page[pos] = bytes[i];
+        } // for
+        return;
+    } // if
+
     switch (finalsize) {
         case 1: { uint8 *dst = (uint8 *) (page + offset); *dst = (uint8) finalval; } break;
         case 2: { uint16 *dst = (uint16 *) (page + offset); *dst = (uint16) finalval; } break;
@@ -1310,7 +1888,13 @@ static void doFixup(uint8 *page, const sint16 offset, const uint32 finalval, con
     } // switch
 } // doFixup
 
-static void fixupPage(const uint8 *exe, LxModule *lxmod, const LxObjectTableEntry *obj, const uint32 pagenum, uint8 *page)
+// (page) is where this page lives in the address space (self-relative fixups
+//  need this), (dst) is where the fixed-up bytes actually get written. These
+//  are the same unless we're demand-paging into a scratch buffer.
+// If (imports) isn't NULL, it has an entry for each import fixup record on
+//  this page: resolved entries are used as-is, unresolved ones get filled in.
+//  Returns the number of import fixup records on the page.
+static uint32 fixupPage(const uint8 *exe, LxModule *lxmod, const LxObjectTableEntry *obj, const uint32 pagenum, const uint8 *page, uint8 *dst, LxLazyImport *imports)
 {
     assert(lxmod->is_lx);  // this should only be called from the LX loader.
     const LxHeader *lx = &lxmod->header.lx;
@@ -1320,6 +1904,7 @@ static void fixupPage(const uint8 *exe, LxModule *lxmod, const LxObjectTableEntr
     const uint32 fixuplen = fixuppage[1] - fixuppage[0];
     const uint8 *fixup = (exe + lx->fixup_record_table_offset) + fixupoffset;
     const uint8 *fixupend = fixup + fixuplen;
+    uint32 numimports = 0;
 //int record = 0;
     while (fixup < fixupend) {
 //record++; printf("FIXUP obj #%u page #%u record #: %d\n", (uint) (obj - origobj), (uint) pagenum, record);
@@ -1428,7 +2013,13 @@ static void fixupPage(const uint8 *exe, LxModule *lxmod, const LxObjectTableEntr
                 } // else
 
                 const LxExport *lxexp = NULL;
-                if (moduleid == 0) {
+                uint32 objaddr = 0;
+                uint16 objalias = 0xFFFF;
+                if (imports && imports[numimports].resolved) {
+                    finalval = imports[numimports].finalval;
+                    objaddr = imports[numimports].objaddr;
+                    objalias = imports[numimports].alias;
+                } else if (moduleid == 0) {
                     fprintf(stderr, "uhoh, looking for module ordinal 0, which is illegal.\n");
                 } else if (moduleid > lx->num_import_mod_entries) {
                     fprintf(stderr, "uhoh, looking for module ordinal %u, but only %u available.\n", (uint) moduleid, (uint) lx->num_import_mod_entries);
@@ -1437,15 +2028,29 @@ static void fixupPage(const uint8 *exe, LxModule *lxmod, const LxObjectTableEntr
                     finalval = (uint32) (size_t) getModuleProcAddrByOrdinal(lxmod->dependencies[moduleid-1], importid, &lxexp, fixup_to_alias, 1);
                 } // else
 
+                if (lxexp && lxexp->object) {
+                    objaddr = (uint32) (size_t) lxexp->object->addr;
+                    objalias = lxexp->object->alias;
+                } // if
+
+                // copy what we need out of the export; the demand pager can't chase pointers later.
+                if (imports) {
+                    imports[numimports].finalval = finalval;
+                    imports[numimports].objaddr = objaddr;
+                    imports[numimports].alias = objalias;
+                    imports[numimports].resolved = 1;
+                } // if
+                numimports++;
+
                 if (fixup_to_alias) {
-                    if (!lxexp || !lxexp->object || (lxexp->object->alias == 0xFFFF)) {
+                    if (objalias == 0xFFFF) {
                         fprintf(stderr, "uhoh, couldn't find a selector for a fixup-to-alias address!\n");
                     } else {
-                        const uint16 segment = lxSelectorToSegment(lxexp->object->alias);
+                        const uint16 segment = lxSelectorToSegment(objalias);
                         switch (srctype & 0xF) {
                             case 0x2: finalval = segment; break; // 16-bit selector fixup?  !!! FIXME:
-                            case 0x3: finalval = (((uint32) segment) << 16) | (finalval - ((uint32)lxexp->object->addr)); break; // 16:16 pointer fixup
-                            case 0x6: finalval -= ((uint32)lxexp->object->addr); finalval2 = segment; break; // 16:32 pointer fixup
+                            case 0x3: finalval = (((uint32) segment) << 16) | (finalval - objaddr); break; // 16:16 pointer fixup
+                            case 0x6: finalval -= objaddr; finalval2 = segment; break; // 16:32 pointer fixup
                             default: assert(!"shouldn't hit this code"); break;
                         } // switch
                     } // else
@@ -1469,7 +2074,13 @@ static void fixupPage(const uint8 *exe, LxModule *lxmod, const LxObjectTableEntr
                 } // else
 
                 const LxExport *lxexp = NULL;
-                if (moduleid == 0) {
+                uint32 objaddr = 0;
+                uint16 objalias = 0xFFFF;
+                if (imports && imports[numimports].resolved) {
+                    finalval = imports[numimports].finalval;
+                    objaddr = imports[numimports].objaddr;
+                    objalias = imports[numimports].alias;
+                } else if (moduleid == 0) {
                     fprintf(stderr, "uhoh, looking for module ordinal 0, which is illegal.\n");
                 } else if (moduleid > lx->num_import_mod_entries) {
                     fprintf(stderr, "uhoh, looking for module ordinal %u, but only %u available.\n", (uint) moduleid, (uint) lx->num_import_mod_entries);
@@ -1483,15 +2094,29 @@ static void fixupPage(const uint8 *exe, LxModule *lxmod, const LxObjectTableEntr
                     finalval = (uint32) (size_t) getModuleProcAddrByName(lxmod->dependencies[moduleid-1], name, &lxexp, fixup_to_alias);
                 } // else
 
+                if (lxexp && lxexp->object) {
+                    objaddr = (uint32) (size_t) lxexp->object->addr;
+                    objalias = lxexp->object->alias;
+                } // if
+
+                // copy what we need out of the export; the demand pager can't chase pointers later.
+                if (imports) {
+                    imports[numimports].finalval = finalval;
+                    imports[numimports].objaddr = objaddr;
+                    imports[numimports].alias = objalias;
+                    imports[numimports].resolved = 1;
+                } // if
+                numimports++;
+
                 if (fixup_to_alias) {
-                    if (!lxexp || !lxexp->object || (lxexp->object->alias == 0xFFFF)) {
+                    if (objalias == 0xFFFF) {
                         fprintf(stderr, "uhoh, couldn't find a selector for a fixup-to-alias address!\n");
                     } else {
-                        const uint16 segment = lxSelectorToSegment(lxexp->object->alias);
+                        const uint16 segment = lxSelectorToSegment(objalias);
                         switch (srctype & 0xF) {
                             case 0x2: finalval = segment; break; // 16-bit selector fixup?  !!! FIXME:
-                            case 0x3: finalval = (((uint32) segment) << 16) | (finalval - ((uint32)lxexp->object->addr)); break; // 16:16 pointer fixup
-                            case 0x6: finalval -= ((uint32)lxexp->object->addr); finalval2 = segment; break; // 16:32 pointer fixup
+                            case 0x3: finalval = (((uint32) segment) << 16) | (finalval - objaddr); break; // 16:16 pointer fixup
+                            case 0x6: finalval -= objaddr; finalval2 = segment; break; // 16:32 pointer fixup
                             default: assert(!"shouldn't hit this code"); break;
                         } // switch
                     } // else
@@ -1523,20 +2148,22 @@ static void fixupPage(const uint8 *exe, LxModule *lxmod, const LxObjectTableEntr
                 const sint16 offset = *((sint16 *) fixup); fixup += 2;
                 if ((srctype & 0xF) == 0x08) {  // self-relative fixup?
                     assert(finalval2 == 0);
-                    doFixup(page, offset, finalval - (((uint32)page)+offset+4), 0, finalsize);
+                    doFixup(dst, lx->page_size, offset, finalval - (((uint32)page)+offset+4), 0, finalsize);
                 } else {
-                    doFixup(page, offset, finalval, finalval2, finalsize);
+                    doFixup(dst, lx->page_size, offset, finalval, finalval2, finalsize);
                 } // else
             } // for
         } else {
             if ((srctype & 0xF) == 0x08) {  // self-relative fixup?
                 assert(finalval2 == 0);
-                doFixup(page, srcoffset, finalval - (((uint32)page)+srcoffset+4), 0, finalsize);
+                doFixup(dst, lx->page_size, srcoffset, finalval - (((uint32)page)+srcoffset+4), 0, finalsize);
             } else {
-                doFixup(page, srcoffset, finalval, finalval2, finalsize);
+                doFixup(dst, lx->page_size, srcoffset, finalval, finalval2, finalsize);
             } // else
         } // else
     } // while
+
+    return numimports;
 } // fixupPage
 
 static int loadLxNameTable(LxModule *lxmod, const uint8 *name_table)
@@ -1550,10 +2177,9 @@ static int loadLxNameTable(LxModule *lxmod, const uint8 *name_table)
         if (ordinal == 0)
             continue;  // skip this one.
 
-        LxExport *export = (LxExport *) lxmod->exports;
-        const uint32 num_exports = lxmod->num_exports;
-        for (uint32 i = 0; i < num_exports; i++, export++) {
-            if (export->ordinal == ordinal) {
+        if (ordinal <= lxmod->max_ordinal) {
+            LxExport *export = (LxExport *) lxmod->exports_by_ordinal[ordinal];
+            if (export) {
                 char *name = (char *) malloc(namelen + 1);
                 if (!name) {
                     fprintf(stderr, "Out of memory!\n");
@@ -1562,19 +2188,86 @@ static int loadLxNameTable(LxModule *lxmod, const uint8 *name_table)
                 memcpy(name, nameptr, namelen);
                 name[namelen] = '\0';
                 export->name = name;
-                break;
             } // if
-        } // for
+        } // if
     } // for
 
     return 1;
 } // loadLxNameTable
 
 
-// This is how I understand this mess, which I could be wrong about.
-// Apparently 32-bit ring-3 code on OS/2 uses code segment 0x5B, even though
-//  generally 32-bit apps don't think about their _segment_ because they have
-//  a linear address space. This is true on Linux, too, and the kernel
+// Decode one page of an LX object from the module file into (dst), which must hold lx->page_size bytes.
+static int decodeLxPage(const LxHeader *lx, const uint8 *origexe, const LxObjectPageTableEntry *objpage, uint8 *dst)
+{
+    const uint8 *src;
+    switch (objpage->flags) {
+        case 0x00:  // preload
+            src = origexe + lx->data_pages_offset + (objpage->page_data_offset << lx->page_offset_shift);
+            memcpy(dst, src, objpage->data_size);
+            if (objpage->data_size < lx->page_size) {
+                memset(dst + objpage->data_size, '\0', lx->page_size - objpage->data_size);
+            }
+            break;
+
+        case 0x01:  // iterated data.
+            // LX format docs say object_iter_pages_offset must be zero or equal to data_pages_offset for OS/2 2.0. So just use data_pages_offset here.
+            //src = origexe + lx->object_iter_pages_offset + (objpage->page_data_offset << lx->page_offset_shift);
+            src = origexe + lx->data_pages_offset + (objpage->page_data_offset << lx->page_offset_shift);
+            if (!decompressIterated(dst, lx->page_size, src, objpage->data_size)) {
+                fprintf(stderr, "Failed to decompress iterated object page (corrupt file or bug).\n");
+                return 0;
+            } // if
+            break;
+
+        case 0x02: // INVALID, just zero it out.
+        case 0x03: // ZEROFILL, just zero it out.
+            memset(dst, '\0', lx->page_size);
+            break;
+
+        case 0x05:  // exepack2
+            src = origexe + lx->data_pages_offset + (objpage->page_data_offset << lx->page_offset_shift);
+            if (!decompressExePack2(dst, lx->page_size, src, objpage->data_size)) {
+                fprintf(stderr, "Failed to decompress object page (corrupt file or bug).\n");
+                return 0;
+            } // if
+            break;
+
+        case 0x08: // !!! FIXME: this is listed in lxlite, presumably this is exepack3 or something. Maybe this was new to Warp4, like exepack2 was new to Warp3. Pull this algorithm in from lxlite later.
+        default:
+            fprintf(stderr, "Don't know how to load an object page of type %u!\n", (uint) objpage->flags);
+            return 0;
+    } // switch
+
+    return 1;
+} // decodeLxPage
+
+// Preload pages that are page-aligned in the module file, fill an entire
+//  page, and have no fixups can be mapped straight from the file (MAP_PRIVATE,
+//  so a write just makes a private copy). These share the page cache between
+//  every process that has this module loaded.
+static int lxPageCanMapFromFile(const LxHeader *lx, const uint8 *exe, const uint32 filelen, const int fd, const LxObjectTableEntry *obj, const LxObjectPageTableEntry *objpage, const uint32 pagenum)
+{
+    if (fd == -1)
+        return 0;
+    else if (objpage->flags != 0x00)  // preload pages only.
+        return 0;
+    else if ((lx->page_size != (uint32) getpagesize()) || (objpage->data_size != lx->page_size))
+        return 0;
+
+    const uint32 offset = lx->data_pages_offset + (objpage->page_data_offset << lx->page_offset_shift);
+    if ((offset % lx->page_size) != 0)
+        return 0;  // not page-aligned in the file.
+    else if ((offset + lx->page_size) > filelen)
+        return 0;  // truncated file? Let decodeLxPage() deal with it.
+
+    const uint32 *fixuppage = ((const uint32 *) (exe + lx->fixup_page_table_offset)) + ((obj->page_table_index - 1) + pagenum);
+    return (fixuppage[0] == fixuppage[1]);  // no fixup records for this page?
+} // lxPageCanMapFromFile
+
+// This is how I understand this mess, which I could be wrong about.
+// Apparently 32-bit ring-3 code on OS/2 uses code segment 0x5B, even though
+//  generally 32-bit apps don't think about their _segment_ because they have
+//  a linear address space. This is true on Linux, too, and the kernel
 //  hardcodes a segment for user-space code (0x23 at the moment, at least for
 //  x86-32 code running on an x86-64 kernel. It's a different hardcoded number
 //  on x86-32 kernels, too).
@@ -1615,9 +2308,787 @@ static void fixupLinearCodeSegmentReferences(uint8 *addr, size_t size)
     } // while
 } // fixupLinearCodeSegmentReferences
 
+// Demand-paging: if system.lazy_load is enabled, some objects are mapped
+//  PROT_NONE and each page is decoded and fixed up the first time something
+//  touches it, from the SIGSEGV handler. This only happens for modules that
+//  have finished resolving their dependencies, and every import on those
+//  pages is resolved at load time (preresolveLazyImports()), so the handler
+//  never has to look anything up, allocate, or print.
+// The kernel doesn't raise SIGSEGV for pages it touches on our behalf (a
+//  write() from a buffer, etc), it just fails with EFAULT, so native APIs
+//  that hand app buffers straight to a syscall have to touch them first
+//  (see touchAppBuffer() in DOSCALLS). That's also why we only demand-page
+//  read-only objects: nothing can legitimately have the kernel write into them.
+// The module list is guarded by a spinlock, since the fault handler can't
+//  use a pthread mutex. Whoever holds it blocks signals first, so a handler
+//  can never interrupt the lock holder on its own thread.
+static volatile int GLazyModulesLock = 0;
+static LxModule *GLazyModules = NULL;
+
+static void lockLazyModules(sigset_t *oldmask)
+{
+    sigset_t mask;
+    sigfillset(&mask);
+    pthread_sigmask(SIG_BLOCK, &mask, oldmask);
+    while (__sync_lock_test_and_set(&GLazyModulesLock, 1))
+        sched_yield();
+} // lockLazyModules
+
+static void unlockLazyModules(const sigset_t *oldmask)
+{
+    __sync_lock_release(&GLazyModulesLock);
+    pthread_sigmask(SIG_SETMASK, oldmask, NULL);
+} // unlockLazyModules
+
+static void registerLazyModule(LxModule *lxmod)
+{
+    sigset_t oldmask;
+    lockLazyModules(&oldmask);
+    lxmod->lazynext = GLazyModules;
+    GLazyModules = lxmod;
+    unlockLazyModules(&oldmask);
+} // registerLazyModule
+
+static void unregisterLazyModule(LxModule *lxmod)
+{
+    sigset_t oldmask;
+    lockLazyModules(&oldmask);
+    for (LxModule **prev = &GLazyModules; *prev; prev = &(*prev)->lazynext) {
+        if (*prev == lxmod) {
+            *prev = lxmod->lazynext;
+            break;
+        } // if
+    } // for
+    lxmod->lazynext = NULL;
+    unlockLazyModules(&oldmask);
+} // unregisterLazyModule
+
+// Run the fixups for every demand-paged page into a throwaway buffer, so
+//  every import (including missing-entry trampolines, which allocate) is
+//  resolved now, outside the fault handler, and remember what they were.
+static int preresolveLazyImports(LxModule *lxmod, const uint8 *exe)
+{
+    uint8 scratch[4096];
+    const LxHeader *lx = &lxmod->header.lx;
+    const LxObjectTableEntry *obj = ((const LxObjectTableEntry *) (exe + lx->object_table_offset));
+    uint32 numimports = 0;
+
+    assert(lx->page_size <= 4096);
+
+    for (uint32 i = 0; i < lx->module_num_objects; i++, obj++) {
+        LxMmaps *lxmmap = &lxmod->mmaps[i];
+        if (!lxmmap->lazypages)
+            continue;
+
+        lxmmap->lazyimportidx = (uint32 *) malloc(sizeof (uint32) * obj->num_page_table_entries);
+        if (!lxmmap->lazyimportidx)
+            return 0;
+
+        for (uint32 pagenum = 0; pagenum < obj->num_page_table_entries; pagenum++) {
+            // no import fixup record is smaller than 5 bytes, so this is plenty.
+            const uint32 *fixuppage = (((const uint32 *) (exe + lx->fixup_page_table_offset)) + ((obj->page_table_index - 1) + pagenum));
+            const uint32 maximports = ((fixuppage[1] - fixuppage[0]) / 5) + 1;
+            void *ptr = realloc(lxmod->lazyimports, sizeof (LxLazyImport) * (numimports + maximports));
+            if (!ptr)
+                return 0;
+            lxmod->lazyimports = (LxLazyImport *) ptr;
+            memset(lxmod->lazyimports + numimports, '\0', sizeof (LxLazyImport) * maximports);
+            lxmmap->lazyimportidx[pagenum] = numimports;
+            const uint8 *page = ((const uint8 *) lxmmap->addr) + (pagenum * lx->page_size);
+            numimports += fixupPage(exe, lxmod, obj, pagenum, page, scratch, lxmod->lazyimports + numimports);
+            assert(numimports <= (lxmmap->lazyimportidx[pagenum] + maximports));
+        } // for
+    } // for
+
+    return 1;
+} // preresolveLazyImports
+
+// The object must be RO or RX, and not otherwise need all its pages up front.
+static int lxObjectCanDemandPage(const LxModule *lxmod, const LxObjectTableEntry *obj, const uint32 objidx, const int isDLL)
+{
+    const LxHeader *lx = &lxmod->header.lx;
+    if (!GLoaderState.lazy_load)
+        return 0;
+    else if (lx->page_size != (uint32) getpagesize())
+        return 0;  // can't mprotect() individual LX pages.
+    else if (obj->object_flags & (0x2 | 0x1000))
+        return 0;  // writable, or has a 16:16 alias (which gets scanned by fixupLinearCodeSegmentReferences).
+    else if (!isDLL && ((objidx + 1) == lx->esp_object))
+        return 0;  // the stack.
+    else if ((objidx == 1) && (strcasecmp(lxmod->name, "EMX") == 0))
+        return 0;  // we patch this one after fixups (see loadLxModule).
+    return (obj->num_page_table_entries > 0);
+} // lxObjectCanDemandPage
+
+// call this with the lazy module lock held. This runs in the SIGSEGV handler,
+//  so it sticks to async-signal-safe stuff (fixupPage() doesn't look anything
+//  up once lazyimports is filled in).
+static void materializeLazyPage(LxModule *lxmod, const uint32 objidx, const uint32 pagenum)
+{
+    // fixups that straddle a page boundary show up in both pages' fixup
+    //  records, and doFixup() only writes this page's share of them, so the
+    //  neighboring page writes the rest when it gets materialized itself.
+    static uint8 scratch[4096];
+    const uint8 *exe = lxmod->lazyexe;
+    const LxHeader *lx = &lxmod->header.lx;
+    const LxObjectTableEntry *obj = ((const LxObjectTableEntry *) (exe + lx->object_table_offset)) + objidx;
+    const LxObjectPageTableEntry *objpage = ((const LxObjectPageTableEntry *) (exe + lx->object_page_table_offset)) + ((obj->page_table_index - 1) + pagenum);
+    LxMmaps *lxmmap = &lxmod->mmaps[objidx];
+    uint8 *page = ((uint8 *) lxmmap->addr) + (pagenum * lx->page_size);
+    uint8 *dst = scratch;
+
+    assert(lx->page_size <= 4096);
+
+    // (the module was already fully decoded once, so this can only fail if
+    //  something scribbled on the module image; there's no recovering.)
+    if (!decodeLxPage(lx, lxmod->lazyimage, objpage, dst)) {
+        static const char msg[] = "Failed to demand-load a module page! Aborting!\n";
+        write(2, msg, sizeof (msg) - 1);
+        abort();
+    } // if
+
+    fixupPage(exe, lxmod, obj, pagenum, page, dst, lxmod->lazyimports + lxmmap->lazyimportidx[pagenum]);
+
+    if (mprotect(page, lx->page_size, PROT_READ|PROT_WRITE) == -1) {
+        static const char msg[] = "mprotect() failed while demand-loading a module page! Aborting!\n";
+        write(2, msg, sizeof (msg) - 1);
+        abort();
+    } // if
+
+    memcpy(page, dst, lx->page_size);
+
+    if (mprotect(page, lx->page_size, lxmmap->prot) == -1) {
+        static const char msg[] = "mprotect() failed while demand-loading a module page! Aborting!\n";
+        write(2, msg, sizeof (msg) - 1);
+        abort();
+    } // if
+
+    lxmmap->lazypages[pagenum] = 0;
+    GLoaderState.lazy_pages_materialized++;
+} // materializeLazyPage
+
+// returns non-zero if (addr) was in a demand-paged object and is ready now.
+static int handleLazyPageFault(const void *addr)
+{
+    const size_t ptr = (size_t) addr;
+    int retval = 0;
+
+    sigset_t oldmask;
+    lockLazyModules(&oldmask);
+    for (LxModule *lxmod = GLazyModules; !retval && lxmod; lxmod = lxmod->lazynext) {
+        const uint32 pagesize = lxmod->header.lx.page_size;
+        for (uint32 j = 0; j < lxmod->num_mmaps; j++) {
+            const LxMmaps *lxmmap = &lxmod->mmaps[j];
+            const size_t base = (size_t) lxmmap->addr;
+            if (!lxmmap->lazypages || (ptr < base) || (ptr >= (base + lxmmap->size)))
+                continue;
+
+            const uint32 pagenum = (uint32) ((ptr - base) / pagesize);
+            const LxObjectTableEntry *obj = ((const LxObjectTableEntry *) (lxmod->lazyexe + lxmod->header.lx.object_table_offset)) + j;
+            if (pagenum < obj->num_page_table_entries) {
+                if (lxmmap->lazypages[pagenum])  // another thread might have beat us to it.
+                    materializeLazyPage(lxmod, j, pagenum);
+                retval = 1;
+            } // if
+            break;
+        } // for
+    } // for
+    unlockLazyModules(&oldmask);
+
+    return retval;
+} // handleLazyPageFault
+
+// The module cache: once a module is decoded and fixed up, we can write its
+//  objects out to disk, and the next time we load the same file against
+//  the same addresses, mmap() the finished objects back in instead of doing
+//  all that work again. The cache key covers the module file's identity
+//  (device, inode, size, and timestamps, so we never have to read the whole
+//  file to build it), where each of its objects landed, and every export of
+//  every dependency (which covers both native library versions and where
+//  they got loaded). The whole key is stored in the cache entry and compared
+//  byte-for-byte before we map anything, so the hash that names the file
+//  only has to find it. Cache files live in $XDG_CACHE_HOME/2ine/modules (or
+//  ~/.cache/2ine/modules), which is private to the user, and we ignore
+//  anything in there that someone else owns or could have written to.
+#define LX_MODULE_CACHE_MAGIC 0x45434932  // "2ICE" in little endian.
+#define LX_MODULE_CACHE_VERSION 2
+
+typedef struct LxModuleCacheHeader
+{
+    uint32 magic;
+    uint32 version;
+    uint64 key;
+    uint32 num_objects;
+    uint32 keylen;  // this many bytes of key data follow the header.
+} LxModuleCacheHeader;
+
+typedef struct LxModuleCacheObject
+{
+    uint32 objidx;
+    uint32 addr;
+    uint32 size;
+    uint32 offset;  // from start of cache file, page-aligned.
+} LxModuleCacheObject;
+
+typedef struct LxModuleCacheKey
+{
+    uint8 *data;  // everything the cached objects depend on.
+    uint32 len;
+    uint32 allocated;
+    int failed;
+    uint64 hash;  // of (data), names the cache file.
+} LxModuleCacheKey;
+
+static uint64 fnv1a64(uint64 hash, const void *data, size_t len)
+{
+    const uint8 *ptr = (const uint8 *) data;
+    while (len--) {
+        hash ^= (uint64) *(ptr++);
+        hash *= 0x100000001B3ULL;
+    } // while
+    return hash;
+} // fnv1a64
+
+static void addLxModuleCacheKey(LxModuleCacheKey *key, const void *data, const size_t len)
+{
+    if (key->failed)
+        return;
+    else if ((((size_t) key->len) + len) > key->allocated) {
+        size_t allocated = key->allocated ? key->allocated : 1024;
+        while (allocated < (((size_t) key->len) + len))
+            allocated *= 2;
+        void *ptr = (allocated <= 0xFFFFFFFF) ? realloc(key->data, allocated) : NULL;
+        if (!ptr) {
+            key->failed = 1;
+            return;
+        } // if
+        key->data = (uint8 *) ptr;
+        key->allocated = (uint32) allocated;
+    } // else if
+
+    memcpy(key->data + key->len, data, len);
+    key->len += (uint32) len;
+} // addLxModuleCacheKey
+
+// the parts of a file's stat() data that change whenever its contents do.
+static void addLxModuleCacheFileIdentity(LxModuleCacheKey *key, const struct stat *statbuf)
+{
+    const uint64 identity[] = {
+        (uint64) statbuf->st_dev, (uint64) statbuf->st_ino, (uint64) statbuf->st_size,
+        (uint64) statbuf->st_mtim.tv_sec, (uint64) statbuf->st_mtim.tv_nsec,
+        (uint64) statbuf->st_ctim.tv_sec, (uint64) statbuf->st_ctim.tv_nsec
+    };
+    addLxModuleCacheKey(key, identity, sizeof (identity));
+} // addLxModuleCacheFileIdentity
+
+static void freeLxModuleCacheKey(LxModuleCacheKey *key)
+{
+    free(key->data);
+    memset(key, '\0', sizeof (*key));
+} // freeLxModuleCacheKey
+
+static int buildLxModuleCacheKey(LxModuleCacheKey *key, const LxModule *lxmod, const struct stat *statbuf)
+{
+    memset(key, '\0', sizeof (*key));
+
+    const uint32 version = LX_MODULE_CACHE_VERSION;
+    addLxModuleCacheKey(key, &version, sizeof (version));
+    addLxModuleCacheKey(key, &GLoaderState.original_cs, sizeof (GLoaderState.original_cs));  // 16:32 fixups use this.
+    addLxModuleCacheFileIdentity(key, statbuf);
+
+    for (uint32 i = 0; i < lxmod->num_mmaps; i++) {
+        const LxMmaps *lxmmap = &lxmod->mmaps[i];
+        const uint32 addr = (uint32) (size_t) lxmmap->addr;
+        addLxModuleCacheKey(key, &addr, sizeof (addr));
+        addLxModuleCacheKey(key, &lxmmap->alias, sizeof (lxmmap->alias));
+    } // for
+
+    for (uint32 i = 0; i < lxmod->num_dependencies; i++) {
+        const LxModule *dep = lxmod->dependencies[i];
+        addLxModuleCacheKey(key, dep->name, strlen(dep->name) + 1);
+        for (uint32 j = 0; j < dep->num_exports; j++) {
+            const LxExport *lxexp = &dep->exports[j];
+            const uint32 addr = (uint32) (size_t) lxexp->addr;
+            addLxModuleCacheKey(key, &lxexp->ordinal, sizeof (lxexp->ordinal));
+            addLxModuleCacheKey(key, &addr, sizeof (addr));
+            if (lxexp->name)
+                addLxModuleCacheKey(key, lxexp->name, strlen(lxexp->name) + 1);
+            if (lxexp->object && (lxexp->object->alias != 0xFFFF)) {
+                // 16-bit bridges get dereferenced when fixing up, and they point to the selector, too.
+                const uint32 bridge = (uint32) (size_t) *((void **) lxexp->addr);
+                addLxModuleCacheKey(key, &bridge, sizeof (bridge));
+                addLxModuleCacheKey(key, &lxexp->object->alias, sizeof (lxexp->object->alias));
+            } // if
+        } // for
+    } // for
+
+    if (key->failed) {
+        freeLxModuleCacheKey(key);
+        return 0;
+    } // if
+
+    key->hash = fnv1a64(0xCBF29CE484222325ULL, key->data, key->len);  // FNV-1a offset basis.
+    return 1;
+} // buildLxModuleCacheKey
+
+// if (mkdirs), create the cache directory if it doesn't exist yet. Returns
+//  NULL if it isn't there, or if it isn't ours alone. Caller frees return value.
+static char *lxModuleCacheDir(const int mkdirs)
+{
+    const char *env = getenv("XDG_CACHE_HOME");
+    const char *subdir = "2ine/modules";
+    if (!env) {
+        env = getenv("HOME");
+        subdir = ".cache/2ine/modules";
+    } // if
+
+    if (!env)
+        return NULL;
+
+    const size_t buflen = strlen(env) + strlen(subdir) + 32;
+    char *retval = (char *) malloc(buflen);
+    if (!retval)
+        return NULL;
+
+    snprintf(retval, buflen, "%s/%s", env, subdir);
+    if (mkdirs) {
+        for (char *ptr = retval + strlen(env) + 1; *ptr; ptr++) {
+            if (*ptr == '/') {
+                *ptr = '\0';
+                mkdir(retval, 0700);
+                *ptr = '/';
+            } // if
+        } // for
+        mkdir(retval, 0700);
+    } // if
+
+    struct stat statbuf;
+    if ((lstat(retval, &statbuf) == -1) || !S_ISDIR(statbuf.st_mode) || (statbuf.st_uid != geteuid()) || (statbuf.st_mode & (S_IWGRP | S_IWOTH))) {
+        free(retval);
+        return NULL;
+    } // if
+
+    return retval;
+} // lxModuleCacheDir
+
+// Caller frees return value.
+static char *lxModuleCachePath(const uint64 hash, const char *ext, const int mkdirs)
+{
+    char *dir = lxModuleCacheDir(mkdirs);
+    if (!dir)
+        return NULL;
+
+    const size_t buflen = strlen(dir) + 32;
+    char *retval = (char *) malloc(buflen);
+    if (retval)
+        snprintf(retval, buflen, "%s/%016llx.%s", dir, (unsigned long long) hash, ext);
+    free(dir);
+    return retval;
+} // lxModuleCachePath
+
+// Open a file in the cache, if it's one we can trust: a regular file that
+//  we own and nobody else can write to.
+static int openLxModuleCacheFile(const char *path)
+{
+    const int fd = path ? open(path, O_RDONLY | O_NOFOLLOW) : -1;
+    struct stat statbuf;
+    if (fd == -1)
+        return -1;
+    else if ((fstat(fd, &statbuf) == -1) || !S_ISREG(statbuf.st_mode) || (statbuf.st_uid != geteuid()) || (statbuf.st_mode & (S_IWGRP | S_IWOTH))) {
+        close(fd);
+        return -1;
+    } // else if
+    return fd;
+} // openLxModuleCacheFile
+
+// map a module's finished objects from the cache, if we've seen it before.
+static int loadLxModuleFromCache(LxModule *lxmod, const LxModuleCacheKey *key)
+{
+    char *path = lxModuleCachePath(key->hash, "img", 0);
+    const int fd = openLxModuleCacheFile(path);
+    LxModuleCacheObject *objs = NULL;
+    uint8 *keydata = NULL;
+    LxModuleCacheHeader header;
+    int retval = 0;
+
+    free(path);
+
+    if (fd == -1) {
+        GLoaderState.module_cache_misses++;
+        return 0;
+    } // if
+
+    if (read(fd, &header, sizeof (header)) != sizeof (header))
+        goto cacheload_done;
+    else if ((header.magic != LX_MODULE_CACHE_MAGIC) || (header.version != LX_MODULE_CACHE_VERSION) || (header.key != key->hash))
+        goto cacheload_done;
+    else if ((header.keylen != key->len) || (header.num_objects > lxmod->num_mmaps))
+        goto cacheload_done;
+
+    // the hash just found the file; the whole key has to match, too.
+    keydata = (uint8 *) malloc(key->len ? key->len : 1);
+    if (!keydata || (read(fd, keydata, key->len) != (ssize_t) key->len))
+        goto cacheload_done;
+    else if (memcmp(keydata, key->data, key->len) != 0)
+        goto cacheload_done;
+
+    const size_t objslen = sizeof (LxModuleCacheObject) * header.num_objects;
+    objs = (LxModuleCacheObject *) malloc(objslen ? objslen : 1);
+    if (!objs || (read(fd, objs, objslen) != (ssize_t) objslen))
+        goto cacheload_done;
+
+    // make sure this all matches up before we start clobbering memory. A
+    //  truncated file would map fine and then SIGBUS on first touch, so
+    //  check every object's data is really in there, too.
+    struct stat statbuf;
+    if (fstat(fd, &statbuf) == -1)
+        goto cacheload_done;
+
+    const uint32 pagesize = (uint32) getpagesize();
+    const uint64 dataoffset = sizeof (header) + key->len + objslen;
+    for (uint32 i = 0; i < header.num_objects; i++) {
+        const LxModuleCacheObject *cobj = &objs[i];
+        const LxMmaps *lxmmap = (cobj->objidx < lxmod->num_mmaps) ? &lxmod->mmaps[cobj->objidx] : NULL;
+        if (!lxmmap || !lxmmap->mapped || (cobj->addr != (uint32) (size_t) lxmmap->addr))
+            goto cacheload_done;
+        else if (cobj->size != (uint32) ((((uint8 *) lxmmap->mapped) + lxmmap->size) - ((uint8 *) lxmmap->addr)))
+            goto cacheload_done;
+        else if (((cobj->offset % pagesize) != 0) || (((uint64) cobj->offset) < dataoffset))
+            goto cacheload_done;
+        else if ((((uint64) cobj->offset) + ((uint64) cobj->size)) > ((uint64) statbuf.st_size))
+            goto cacheload_done;
+    } // for
+
+    for (uint32 i = 0; i < header.num_objects; i++) {
+        const LxModuleCacheObject *cobj = &objs[i];
+        void *addr = lxmod->mmaps[cobj->objidx].addr;
+        if (mmap(addr, cobj->size, PROT_READ|PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, (off_t) cobj->offset) == ((void *) MAP_FAILED)) {
+            // we might have replaced some objects already, so we can't just decode the module normally now.
+            fprintf(stderr, "mmap() of cached module '%s' failed (%d): %s\n", lxmod->name, errno, strerror(errno));
+            fflush(stderr);
+            abort();
+        } // if
+    } // for
+
+    futimens(fd, NULL);  // mark it recently used, so eviction gets rid of something else.
+    GLoaderState.module_cache_hits++;
+    retval = 1;
+
+cacheload_done:
+    if (!retval)
+        GLoaderState.module_cache_misses++;
+    free(keydata);
+    free(objs);
+    close(fd);
+    return retval;
+} // loadLxModuleFromCache
+
+typedef struct LxModuleCacheEntry
+{
+    char *name;
+    off_t size;
+    time_t mtime;
+} LxModuleCacheEntry;
+
+static int cmpLxModuleCacheEntry(const void *_a, const void *_b)
+{
+    const LxModuleCacheEntry *a = (const LxModuleCacheEntry *) _a;
+    const LxModuleCacheEntry *b = (const LxModuleCacheEntry *) _b;
+    return (a->mtime < b->mtime) ? -1 : ((a->mtime > b->mtime) ? 1 : 0);
+} // cmpLxModuleCacheEntry
+
+// delete the least-recently-used entries until the cache directory fits in
+//  system.module_cache_max megabytes again. Cache hits touch their file's
+//  mtime, so that's our LRU order. Mappings of deleted entries stay valid.
+static void evictLxModuleCache(const char *dirpath)
+{
+    const uint64 maxbytes = ((uint64) ((GLoaderState.module_cache_max > 0) ? GLoaderState.module_cache_max : 0)) * 1024 * 1024;
+    DIR *dirp = opendir(dirpath);
+    if (!dirp)
+        return;
+
+    LxModuleCacheEntry *entries = NULL;
+    uint32 num_entries = 0;
+    uint64 total = 0;
+    struct dirent *dent;
+    while ((dent = readdir(dirp)) != NULL) {
+        struct stat statbuf;
+        if (dent->d_name[0] == '.')
+            continue;
+        else if ((fstatat(dirfd(dirp), dent->d_name, &statbuf, AT_SYMLINK_NOFOLLOW) == -1) || !S_ISREG(statbuf.st_mode))
+            continue;
+
+        total += (uint64) statbuf.st_size;
+        void *ptr = realloc(entries, sizeof (LxModuleCacheEntry) * (num_entries + 1));
+        char *name = ptr ? strdup(dent->d_name) : NULL;
+        if (!name) {
+            if (ptr)
+                entries = (LxModuleCacheEntry *) ptr;
+            break;
+        } // if
+        entries = (LxModuleCacheEntry *) ptr;
+        entries[num_entries].name = name;
+        entries[num_entries].size = statbuf.st_size;
+        entries[num_entries].mtime = statbuf.st_mtime;
+        num_entries++;
+    } // while
+
+    if (total > maxbytes) {
+        qsort(entries, num_entries, sizeof (LxModuleCacheEntry), cmpLxModuleCacheEntry);
+        for (uint32 i = 0; (i < num_entries) && (total > maxbytes); i++) {
+            if (unlinkat(dirfd(dirp), entries[i].name, 0) == 0)
+                total -= (uint64) entries[i].size;
+        } // for
+    } // if
+
+    for (uint32 i = 0; i < num_entries; i++)
+        free(entries[i].name);
+    free(entries);
+    closedir(dirp);
+} // evictLxModuleCache
+
+// write out a module's finished objects. Failures here aren't fatal, we just don't get a cache entry.
+// Set at startup if the program we're running can be identified. Once we
+//  store anything in the module cache for it, we leave a marker file, so
+//  later runs know it's worth turning off address space randomization.
+static int GHaveProgramCacheMarker = 0;
+static uint64 GProgramCacheMarker = 0;
+
+static void initProgramCacheMarker(const char *fname)
+{
+    struct stat statbuf;
+    if (!fname || (stat(fname, &statbuf) == -1))
+        return;
+
+    LxModuleCacheKey key;
+    memset(&key, '\0', sizeof (key));
+    const uint32 version = LX_MODULE_CACHE_VERSION;
+    addLxModuleCacheKey(&key, &version, sizeof (version));
+    addLxModuleCacheFileIdentity(&key, &statbuf);
+    if (!key.failed) {
+        GProgramCacheMarker = fnv1a64(0xCBF29CE484222325ULL, key.data, key.len);
+        GHaveProgramCacheMarker = 1;
+    } // if
+    freeLxModuleCacheKey(&key);
+} // initProgramCacheMarker
+
+// does the module cache have anything for the program we're running?
+static int programHasModuleCache(void)
+{
+    if (!GHaveProgramCacheMarker)
+        return 0;
+
+    char *path = lxModuleCachePath(GProgramCacheMarker, "run", 0);
+    const int fd = openLxModuleCacheFile(path);
+    free(path);
+    if (fd == -1)
+        return 0;
+
+    futimens(fd, NULL);  // mark it recently used, so eviction gets rid of something else.
+    close(fd);
+    return 1;
+} // programHasModuleCache
+
+static void markProgramHasModuleCache(void)
+{
+    char *path = GHaveProgramCacheMarker ? lxModuleCachePath(GProgramCacheMarker, "run", 0) : NULL;
+    const int fd = path ? open(path, O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW, 0600) : -1;
+    if (fd != -1)
+        close(fd);
+    free(path);
+} // markProgramHasModuleCache
+
+static void storeLxModuleInCache(const LxModule *lxmod, const LxModuleCacheKey *key)
+{
+    char *path = lxModuleCachePath(key->hash, "img", 1);
+    if (!path)
+        return;
+
+    const size_t pathlen = strlen(path) + 32;
+    char *tmppath = (char *) malloc(pathlen);
+    LxModuleCacheObject *objs = (LxModuleCacheObject *) malloc(sizeof (LxModuleCacheObject) * (lxmod->num_mmaps + 1));
+    int fd = -1;
+    if (!tmppath || !objs)
+        goto cachestore_failed;
+
+    // write to a temp file and rename it into place, so other processes never see a partial entry.
+    snprintf(tmppath, pathlen, "%s.%u.tmp", path, (uint) getpid());
+    if ((fd = open(tmppath, O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW, 0600)) == -1)
+        goto cachestore_failed;
+
+    const uint32 pagesize = (uint32) getpagesize();
+    LxModuleCacheHeader header;
+    memset(&header, '\0', sizeof (header));
+    header.magic = LX_MODULE_CACHE_MAGIC;
+    header.version = LX_MODULE_CACHE_VERSION;
+    header.key = key->hash;
+    header.keylen = key->len;
+
+    for (uint32 i = 0; i < lxmod->num_mmaps; i++) {
+        const LxMmaps *lxmmap = &lxmod->mmaps[i];
+        if (!lxmmap->mapped)
+            continue;  // resource object, etc.
+        LxModuleCacheObject *cobj = &objs[header.num_objects++];
+        cobj->objidx = i;
+        cobj->addr = (uint32) (size_t) lxmmap->addr;
+        cobj->size = (uint32) ((((uint8 *) lxmmap->mapped) + lxmmap->size) - ((uint8 *) lxmmap->addr));
+    } // for
+
+    uint32 offset = sizeof (header) + key->len + (sizeof (LxModuleCacheObject) * header.num_objects);
+    for (uint32 i = 0; i < header.num_objects; i++) {
+        offset = (offset + (pagesize - 1)) & ~(pagesize - 1);
+        objs[i].offset = offset;
+        offset += objs[i].size;
+    } // for
+
+    const size_t objslen = sizeof (LxModuleCacheObject) * header.num_objects;
+    if (write(fd, &header, sizeof (header)) != sizeof (header))
+        goto cachestore_failed;
+    else if (write(fd, key->data, key->len) != (ssize_t) key->len)
+        goto cachestore_failed;
+    else if (write(fd, objs, objslen) != (ssize_t) objslen)
+        goto cachestore_failed;
+
+    for (uint32 i = 0; i < header.num_objects; i++) {
+        const uint8 *ptr = (const uint8 *) lxmod->mmaps[objs[i].objidx].addr;
+        if (pwrite(fd, ptr, objs[i].size, (off_t) objs[i].offset) != (ssize_t) objs[i].size)
+            goto cachestore_failed;
+    } // for
+
+    if (close(fd) == -1) {
+        fd = -1;
+        goto cachestore_failed;
+    } // if
+    fd = -1;
+
+    if (rename(tmppath, path) == -1)
+        goto cachestore_failed;
+
+    markProgramHasModuleCache();
+
+    *strrchr(path, '/') = '\0';
+    evictLxModuleCache(path);
+
+    free(objs);
+    free(tmppath);
+    free(path);
+    return;
+
+cachestore_failed:
+    if (fd != -1)
+        close(fd);
+    if (tmppath)
+        unlink(tmppath);
+    free(objs);
+    free(tmppath);
+    free(path);
+} // storeLxModuleInCache
+
+// The per-page work of loading a module (decoding pages, then fixing them
+//  up) is independent between pages once imports are resolved, so large
+//  modules can spread it across a few threads (see system.loader_threads).
+//  Each thread just grabs the next page off a shared list until it's empty.
+#define LX_MIN_PAGES_PER_LOADER_THREAD 32
+
+typedef struct LxPageJob
+{
+    uint32 objidx;
+    uint32 pagenum;
+} LxPageJob;
+
+typedef struct LxPageJobs
+{
+    LxModule *lxmod;
+    const uint8 *origexe;
+    const uint8 *exe;
+    uint32 filelen;
+    int fd;
+    LxPageJob *jobs;
+    uint32 num_jobs;
+    int fixups;  // zero to decode pages, non-zero to fix them up.
+    volatile uint32 next_job;
+    volatile int failed;
+} LxPageJobs;
+
+static int decodeLxModulePage(const LxPageJobs *jobs, const LxPageJob *job)
+{
+    const LxHeader *lx = &jobs->lxmod->header.lx;
+    const LxObjectTableEntry *obj = ((const LxObjectTableEntry *) (jobs->exe + lx->object_table_offset)) + job->objidx;
+    const LxObjectPageTableEntry *objpage = ((const LxObjectPageTableEntry *) (jobs->exe + lx->object_page_table_offset)) + ((obj->page_table_index - 1) + job->pagenum);
+    uint8 *dst = ((uint8 *) jobs->lxmod->mmaps[job->objidx].addr) + (job->pagenum * lx->page_size);
+
+    if (lxPageCanMapFromFile(lx, jobs->exe, jobs->filelen, jobs->fd, obj, objpage, job->pagenum)) {
+        const off_t offset = (off_t) (lx->data_pages_offset + (objpage->page_data_offset << lx->page_offset_shift));
+        if (mmap(dst, lx->page_size, PROT_READ|PROT_WRITE, MAP_PRIVATE | MAP_FIXED, jobs->fd, offset) != ((void *) MAP_FAILED)) {
+            __sync_fetch_and_add(&GLoaderState.file_mapped_pages, 1);
+            return 1;
+        } // if
+        // (if this failed, our anonymous page is still there; just decode into it like normal.)
+    } // if
+
+    return decodeLxPage(lx, jobs->origexe, objpage, dst);
+} // decodeLxModulePage
+
+static void *runLxPageJobsThread(void *arg)
+{
+    LxPageJobs *jobs = (LxPageJobs *) arg;
+    const LxHeader *lx = &jobs->lxmod->header.lx;
+    const LxObjectTableEntry *objs = (const LxObjectTableEntry *) (jobs->exe + lx->object_table_offset);
+    uint32 idx;
+
+    while ((idx = __sync_fetch_and_add(&jobs->next_job, 1)) < jobs->num_jobs) {
+        const LxPageJob *job = &jobs->jobs[idx];
+        if (jobs->failed) {
+            break;
+        } else if (!jobs->fixups) {
+            if (!decodeLxModulePage(jobs, job))
+                jobs->failed = 1;
+        } else {
+            uint8 *dst = ((uint8 *) jobs->lxmod->mmaps[job->objidx].addr) + (job->pagenum * lx->page_size);
+            fixupPage(jobs->exe, jobs->lxmod, &objs[job->objidx], job->pagenum, dst, dst, NULL);
+        } // else
+    } // while
+
+    return NULL;
+} // runLxPageJobsThread
+
+// returns zero if any job failed.
+static int runLxPageJobs(LxPageJobs *jobs, const int fixups)
+{
+    jobs->fixups = fixups;
+    jobs->next_job = 0;
+    jobs->failed = 0;
+
+    int numthreads = GLoaderState.loader_threads;
+    if (numthreads <= 0) {  // zero means "as many as we have CPUs".
+        const long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        numthreads = (cpus > 0) ? (int) cpus : 1;
+    } // if
+
+    const int maxthreads = (int) (jobs->num_jobs / LX_MIN_PAGES_PER_LOADER_THREAD);
+    if (numthreads > maxthreads)
+        numthreads = maxthreads;  // not worth spinning up threads for a handful of pages.
+    if (numthreads > 64)
+        numthreads = 64;
+
+    pthread_t threads[64];
+    int spawned = 0;
+    for (int i = 1; i < numthreads; i++) {  // this thread does work, too.
+        if (pthread_create(&threads[spawned], NULL, runLxPageJobsThread, jobs) == 0)
+            spawned++;  // if this fails, the threads we do have (and this one) pick up the slack.
+    } // for
+
+    runLxPageJobsThread(jobs);
+
+    for (int i = 0; i < spawned; i++)
+        pthread_join(threads[i], NULL);
+
+    return !jobs->failed;
+} // runLxPageJobs
+
 /* LX ("Linear Executable") modules are 32-bit binaries that can contain 16-bit segments. */
 // !!! FIXME: break up this function.
-static LxModule *loadLxModule(const char *fname, const uint8 *origexe, uint8 *exe, uint32 exelen, int dependency_tree_depth)
+static LxModule *loadLxModule(const char *fname, const int fd, const uint8 *origexe, uint8 *exe, uint32 exelen, int dependency_tree_depth)
 {
     const LxHeader *lx = (const LxHeader *) exe;
     const uint32 module_type = lx->module_flags & 0x00038000;
@@ -1691,7 +3162,9 @@ static LxModule *loadLxModule(const char *fname, const uint8 *origexe, uint8 *ex
             goto loadlx_failed;
     } // if
 
+    const uint32 filelen = ((uint32) (exe - origexe)) + exelen;
     int uses_aliases = 0;
+    int has_lazy_pages = 0;
     const LxObjectTableEntry *obj = ((const LxObjectTableEntry *) (exe + lx->object_table_offset));
     for (uint32 i = 0; i < lx->module_num_objects; i++, obj++) {
         if (obj->object_flags & 0x8)  // !!! FIXME: resource object; ignore this until resource support is written, later.
@@ -1713,16 +3186,18 @@ static LxModule *loadLxModule(const char *fname, const uint8 *origexe, uint8 *ex
                 vsize += 0x10000;  // make sure we can align to a 64k boundary.
         } // if
 
+        // demand-paged objects start out inaccessible; the SIGSEGV handler fills them in.
+        const int demand_paged = lxObjectCanDemandPage(retval, obj, i, isDLL);
         const int mmapflags = MAP_ANONYMOUS | MAP_PRIVATE | (isDLL ? 0 : MAP_FIXED);
         void *base = isDLL ? NULL : (void *) ((size_t) obj->reloc_base_addr);
-        void *mmapaddr = mmap(base, vsize, PROT_READ|PROT_WRITE, mmapflags, -1, 0);
+        void *mmapaddr = mmap(base, vsize, demand_paged ? PROT_NONE : (PROT_READ|PROT_WRITE), mmapflags, -1, 0);
         // we'll mprotect() these pages to the proper permissions later.
 
         //fprintf(stderr, "%s lxobj #%u mmap(%p, %u, %c%c%c, ANON|PRIVATE%s, -1, 0) == %p\n", retval->name, (uint) i, base, (uint) vsize, (obj->object_flags & 0x1) ? 'R' : '-', (obj->object_flags & 0x2) ? 'W' : '-', (obj->object_flags & 0x4) ? 'X' : '-', isDLL ? "" : "|FIXED", mmapaddr);
 
         if (mmapaddr == ((void *) MAP_FAILED)) {
-            fprintf(stderr, "mmap(%p, %u, RW-, ANON|PRIVATE%s, -1, 0) failed (%d): %s\n",
-                    base, (uint) vsize, isDLL ? "" : "|FIXED", errno, strerror(errno));
+            fprintf(stderr, "mmap(%p, %u, %s, ANON|PRIVATE%s, -1, 0) failed (%d): %s\n",
+                    base, (uint) vsize, demand_paged ? "---" : "RW-", isDLL ? "" : "|FIXED", errno, strerror(errno));
             goto loadlx_failed;
         } // if
 
@@ -1742,62 +3217,22 @@ static LxModule *loadLxModule(const char *fname, const uint8 *origexe, uint8 *ex
         FIXME("Can we just unmap the adjusted pieces?");  // instead of keeping an extra pointer and wasted space...
         retval->mmaps[i].addr = mmapaddr;
 
-        const LxObjectPageTableEntry *objpage = ((const LxObjectPageTableEntry *) (exe + lx->object_page_table_offset));
-        objpage += obj->page_table_index - 1;
-
-        uint8 *dst = (uint8 *) mmapaddr;
-        const uint32 numPageTableEntries = obj->num_page_table_entries;
-        for (uint32 pagenum = 0; pagenum < numPageTableEntries; pagenum++, objpage++) {
-            const uint8 *src;
-            switch (objpage->flags) {
-                case 0x00:  // preload
-                    src = origexe + lx->data_pages_offset + (objpage->page_data_offset << lx->page_offset_shift);
-                    memcpy(dst, src, objpage->data_size);
-                    if (objpage->data_size < lx->page_size) {
-                        memset(dst + objpage->data_size, '\0', lx->page_size - objpage->data_size);
-                    }
-                    break;
-
-                case 0x01:  // iterated data.
-                    // LX format docs say object_iter_pages_offset must be zero or equal to data_pages_offset for OS/2 2.0. So just use data_pages_offset here.
-                    //src = origexe + lx->object_iter_pages_offset + (objpage->page_data_offset << lx->page_offset_shift);
-                    src = origexe + lx->data_pages_offset + (objpage->page_data_offset << lx->page_offset_shift);
-                    if (!decompressIterated(dst, lx->page_size, src, objpage->data_size)) {
-                        fprintf(stderr, "Failed to decompress iterated object page (corrupt file or bug).\n");
-                        goto loadlx_failed;
-                    } // if
-                    break;
-
-                case 0x02: // INVALID, just zero it out.
-                case 0x03: // ZEROFILL, just zero it out.
-                    memset(dst, '\0', lx->page_size);
-                    break;
-
-                case 0x05:  // exepack2
-                    src = origexe + lx->data_pages_offset + (objpage->page_data_offset << lx->page_offset_shift);
-                    if (!decompressExePack2(dst, lx->page_size, src, objpage->data_size)) {
-                        fprintf(stderr, "Failed to decompress object page (corrupt file or bug).\n");
-                        goto loadlx_failed;
-                    } // if
-                    break;
-
-                case 0x08: // !!! FIXME: this is listed in lxlite, presumably this is exepack3 or something. Maybe this was new to Warp4, like exepack2 was new to Warp3. Pull this algorithm in from lxlite later.
-                default:
-                    fprintf(stderr, "Don't know how to load an object page of type %u!\n", (uint) objpage->flags);
-                    goto loadlx_failed;
-            } // switch
-
-            dst += lx->page_size;
-        } // for
-
-        // any bytes at the end of this object that we didn't initialize? Zero them out.
-        const uint32 remain = vsize - ((uint32) (dst - ((uint8 *) mmapaddr)));
-        if (remain)
-            memset(dst, '\0', remain);
+        if (demand_paged) {
+            const uint32 numPageTableEntries = obj->num_page_table_entries;
+            retval->mmaps[i].lazypages = (uint8 *) malloc(numPageTableEntries);
+            if (!retval->mmaps[i].lazypages) {
+                fprintf(stderr, "Out of memory!\n");
+                goto loadlx_failed;
+            } // if
+            memset(retval->mmaps[i].lazypages, 1, numPageTableEntries);
+            GLoaderState.lazy_pages_deferred += numPageTableEntries;
+            has_lazy_pages = 1;
+        } // if
     } // for
 
-    // All the pages we need from the EXE are loaded into the appropriate spots in memory.
-    //printf("mmap()'d everything we need!\n");
+    // Address space for all the objects is reserved, but we don't decode any
+    //  pages until our dependencies are loaded, since we might be able to
+    //  pull the finished module out of the cache instead.
 
     retval->eip = lx->eip;
     if (lx->eip_object != 0) {
@@ -1836,22 +3271,26 @@ static LxModule *loadLxModule(const char *fname, const uint8 *origexe, uint8 *ex
                 goto loadlx_failed;
             } // if
             assert(offset == 0);
-
-            if (obj->object_flags & 0x4) {  // 16:16 segment with code.
-                fixupLinearCodeSegmentReferences((uint8 *) (size_t) retval->mmaps[i].mapped, retval->mmaps[i].size);
-            }
         } // for
     } // if
 
     // Set up our exports...
     uint32 total_ordinals = 0;
+    uint32 total_forwarders = 0;
     const uint8 *entryptr = exe + lx->entry_table_offset;
     while (*entryptr) {  /* end field has a value of zero. */
         const uint8 numentries = *(entryptr++);  /* number of entries in this bundle */
         const uint8 bundletype = *(entryptr++) & ~0x80;
         if (bundletype != 0x00) {
+            uint32 entrylen = 5;  // 286 call gates and 32-bit entries.
+            if (bundletype == 0x01)
+                entrylen = 3;
+            else if (bundletype == 0x04) {
+                entrylen = 7;
+                total_forwarders += numentries;
+            } // else if
             total_ordinals += numentries;
-            entryptr += 2 + ((bundletype == 0x01) ? 3 : 5) * numentries;
+            entryptr += 2 + (entrylen * numentries);
         } // if
     } // while
 
@@ -1863,6 +3302,16 @@ static LxModule *loadLxModule(const char *fname, const uint8 *origexe, uint8 *ex
     memset(lxexp, '\0', sizeof (LxExport) * total_ordinals);
     retval->exports = lxexp;
 
+    LxForwarder *lxfwd = NULL;
+    if (total_forwarders) {
+        lxfwd = (LxForwarder *) calloc(total_forwarders, sizeof (LxForwarder));
+        if (!lxfwd) {
+            fprintf(stderr, "Out of memory!\n");
+            goto loadlx_failed;
+        } // if
+        retval->forwarders = lxfwd;
+    } // if
+
     uint32 ordinal = 1;
     entryptr = exe + lx->entry_table_offset;
     while (*entryptr) {  /* end field has a value of zero. */
@@ -1902,9 +3351,50 @@ static LxModule *loadLxModule(const char *fname, const uint8 *origexe, uint8 *ex
                 break;
 
             case 0x02: // 286CALLGATE
+                // We don't have ring 2 (or call gates), so these are just
+                //  16-bit entry points. The callgate field is scratch space
+                //  for the OS/2 loader; nothing in the file uses it.
+                objidx = *((const uint16 *) entryptr) - 1;
+                entryptr += 2;
+                for (uint8 i = 0; i < numentries; i++) {
+                    entryptr++;
+                    lxexp->ordinal = ordinal++;
+                    lxexp->addr = ((uint8 *) retval->mmaps[objidx].addr) + *((const uint16 *) entryptr);
+                    lxexp->object = &retval->mmaps[objidx];
+                    lxexp++;
+                    entryptr += 4;
+                } // for
+                break;
+
             case 0x04: // FORWARDER
-                fprintf(stderr, "WRITE ME %s:%d\n", __FILE__, __LINE__);
-                goto loadlx_failed;
+                // these get an address once dependencies are loaded; see resolveLxForwarders().
+                entryptr += 2;  // reserved field.
+                for (uint8 i = 0; i < numentries; i++) {
+                    const uint8 flags = *(entryptr++);
+                    lxfwd->ordinal = ordinal;
+                    lxfwd->module = *((const uint16 *) entryptr);
+                    entryptr += 2;
+                    if (flags & 0x1) {  // import by ordinal
+                        lxfwd->import_ordinal = *((const uint32 *) entryptr);
+                    } else {
+                        const uint8 *import_name = (exe + lx->import_proc_table_offset) + *((const uint32 *) entryptr);
+                        const uint8 namelen = *(import_name++);
+                        lxfwd->import_name = (char *) malloc(namelen + 1);
+                        if (!lxfwd->import_name) {
+                            fprintf(stderr, "Out of memory!\n");
+                            goto loadlx_failed;
+                        } // if
+                        memcpy(lxfwd->import_name, import_name, namelen);
+                        lxfwd->import_name[namelen] = '\0';
+                    } // else
+                    entryptr += 4;
+                    retval->num_forwarders++;
+                    lxfwd++;
+
+                    lxexp->ordinal = ordinal++;
+                    lxexp++;
+                } // for
+                break;
 
             default:
                 fprintf(stderr, "UNKNOWN ENTRY TYPE (%u)\n\n", (uint) bundletype);
@@ -1913,6 +3403,8 @@ static LxModule *loadLxModule(const char *fname, const uint8 *origexe, uint8 *ex
     } // while
 
     retval->num_exports = (uint32) (lxexp - retval->exports);
+    if (!indexModuleOrdinals(retval))
+        goto loadlx_failed;
 
     // Now load named entry points.
     if (lx->resident_name_table_offset) {
@@ -1925,6 +3417,9 @@ static LxModule *loadLxModule(const char *fname, const uint8 *origexe, uint8 *ex
             goto loadlx_failed;
     } // if
 
+    if (!indexModuleNames(retval))
+        goto loadlx_failed;
+
     // Load other dependencies of this module.
     const uint8 *import_modules_table = exe + lx->import_module_table_offset;
     for (uint32 i = 0; i < lx->num_import_mod_entries; i++) {
@@ -1944,27 +3439,128 @@ static LxModule *loadLxModule(const char *fname, const uint8 *origexe, uint8 *ex
         } // if
     } // for
 
-    // Run through again and do all the fixups...
-    obj = ((const LxObjectTableEntry *) (exe + lx->object_table_offset));
-    for (uint32 i = 0; i < lx->module_num_objects; i++, obj++) {
-        if (obj->object_flags & 0x8)  // !!! FIXME: resource object; ignore this until resource support is written, later.
-            continue;
+    if (retval->forwarders && !resolveLxForwarders(retval))
+        goto loadlx_failed;
 
-        uint8 *dst = (uint8 *) retval->mmaps[i].addr;
-        const uint32 numPageTableEntries = obj->num_page_table_entries;
-        for (uint32 pagenum = 0; pagenum < numPageTableEntries; pagenum++) {
-            fixupPage(exe, retval, obj, pagenum, dst);
-            dst += lx->page_size;
+    // demand-paged objects need the module file until they're unloaded. The
+    //  caller hands ownership of it to us if we set this.
+    if (has_lazy_pages) {
+        retval->lazyimage = (uint8 *) origexe;
+        retval->lazyimagelen = ((uint32) (exe - origexe)) + exelen;
+        retval->lazyexe = exe;
+        if (!preresolveLazyImports(retval, exe)) {
+            fprintf(stderr, "Out of memory!\n");
+            goto loadlx_failed;
+        } // if
+        registerLazyModule(retval);
+    } // if
+
+    // Dependencies are loaded, so we know everything the fixups will point
+    //  to. If we've relocated this exact module against these exact addresses
+    //  before, just map the finished objects from the cache.
+    struct stat statbuf;
+    LxModuleCacheKey cachekey;
+    memset(&cachekey, '\0', sizeof (cachekey));
+    const int use_cache = GLoaderState.module_cache && !has_lazy_pages && (fstat(fd, &statbuf) == 0) && buildLxModuleCacheKey(&cachekey, retval, &statbuf);
+    const int cached = use_cache && loadLxModuleFromCache(retval, &cachekey);
+
+    if (!cached) {
+        const uint32 missing_trampolines = GMissingTrampolines;
+
+        // Every page we decode and fix up now (everything but demand-paged
+        //  objects) is a separate job, so we can spread them across threads.
+        LxPageJobs jobs;
+        memset(&jobs, '\0', sizeof (jobs));
+        jobs.lxmod = retval;
+        jobs.origexe = origexe;
+        jobs.exe = exe;
+        jobs.filelen = filelen;
+        jobs.fd = fd;
+
+        obj = ((const LxObjectTableEntry *) (exe + lx->object_table_offset));
+        for (uint32 i = 0; i < lx->module_num_objects; i++, obj++) {
+            if (!(obj->object_flags & 0x8) && !retval->mmaps[i].lazypages)
+                jobs.num_jobs += obj->num_page_table_entries;
         } // for
 
+        jobs.jobs = (LxPageJob *) malloc(sizeof (LxPageJob) * (jobs.num_jobs ? jobs.num_jobs : 1));
+        if (!jobs.jobs) {
+            fprintf(stderr, "Out of memory!\n");
+            freeLxModuleCacheKey(&cachekey);
+            goto loadlx_failed;
+        } // if
+
+        LxPageJob *job = jobs.jobs;
+        obj = ((const LxObjectTableEntry *) (exe + lx->object_table_offset));
+        for (uint32 i = 0; i < lx->module_num_objects; i++, obj++) {
+            if (obj->object_flags & 0x8)  // !!! FIXME: resource object; ignore this until resource support is written, later.
+                continue;
+            else if (retval->mmaps[i].lazypages)  // demand-paged objects get decoded and fixed up when each page is touched.
+                continue;
+            for (uint32 pagenum = 0; pagenum < obj->num_page_table_entries; pagenum++, job++) {
+                job->objidx = i;
+                job->pagenum = pagenum;
+            } // for
+        } // for
+
+        // Decode all the pages from the module file...
+        const int decoded = runLxPageJobs(&jobs, 0);
+
+        // ...then run through again and do all the fixups. Each page's
+        //  fixups only write inside that page (see doFixup()), so these jobs
+        //  never touch the same bytes, but import lookups can generate
+        //  trampolines and fill in caches, which are all thread-safe.
+        if (decoded) {
+            obj = ((const LxObjectTableEntry *) (exe + lx->object_table_offset));
+            for (uint32 i = 0; i < lx->module_num_objects; i++, obj++) {
+                if ((obj->object_flags & 0x8) || retval->mmaps[i].lazypages)
+                    continue;
+
+                // any bytes at the end of this object that we didn't initialize? Zero them out.
+                uint8 *dst = ((uint8 *) retval->mmaps[i].addr) + (obj->num_page_table_entries * lx->page_size);
+                const uint8 *objend = ((const uint8 *) retval->mmaps[i].mapped) + retval->mmaps[i].size;
+                if (dst < objend)
+                    memset(dst, '\0', (size_t) (objend - dst));
+
+                if ((obj->object_flags & 0x1000) && (obj->object_flags & 0x4)) {  // 16:16 segment with code.
+                    fixupLinearCodeSegmentReferences((uint8 *) (size_t) retval->mmaps[i].mapped, retval->mmaps[i].size);
+                }
+            } // for
+
+            runLxPageJobs(&jobs, 1);
+        } // if
+
+        free(jobs.jobs);
+
+        if (!decoded) {
+            freeLxModuleCacheKey(&cachekey);
+            goto loadlx_failed;
+        } // if
+
         // !!! FIXME: hack to nop out some 16-bit code in emx.dll startup...
-        if ((i == 1) && (strcasecmp(modname, "EMX") == 0)) {
+        if ((lx->module_num_objects > 1) && (strcasecmp(modname, "EMX") == 0)) {
             // This is the 16-bit signal handler installer. nop it out.
             uint8 *ptr = ((uint8 *) retval->mmaps[1].addr) + 28596;
             for (uint32 j = 0; j < 37; j++)
                 *(ptr++) = 0x90; // nop
         } // if
 
+        // if a fixup pointed at a missing-entry-point trampoline, the
+        //  trampoline won't be at the same address next time; don't cache.
+        if (use_cache && (missing_trampolines == GMissingTrampolines))
+            storeLxModuleInCache(retval, &cachekey);
+    } // if
+
+    freeLxModuleCacheKey(&cachekey);
+
+    // Now set all the objects to the proper final permissions...
+    obj = ((const LxObjectTableEntry *) (exe + lx->object_table_offset));
+    for (uint32 i = 0; i < lx->module_num_objects; i++, obj++) {
+        if (obj->object_flags & 0x8)  // !!! FIXME: resource object; ignore this until resource support is written, later.
+            continue;
+
+        const uint32 numPageTableEntries = obj->num_page_table_entries;
+
         // !!! FIXME: hack for Java that fails to mark a code page as executable
         // !!! FIXME:  (on 386 machines, read implies execute, so this error could go unnoticed).
         uint32 object_flags = obj->object_flags;
@@ -1973,16 +3569,23 @@ static LxModule *loadLxModule(const char *fname, const uint8 *origexe, uint8 *ex
             object_flags |= 0x4;
         } // if
 
-        // Now set all the pages of this object to the proper final permissions...
         const int prot = ((object_flags & 0x1) ? PROT_READ : 0) |
                          ((object_flags & 0x2) ? PROT_WRITE : 0) |
                          ((object_flags & 0x4) ? PROT_EXEC : 0);
 
         retval->mmaps[i].prot = prot;
 
-        if (mprotect(retval->mmaps[i].mapped, retval->mmaps[i].size, prot) == -1) {
+        // demand-paged objects only open up the zero-filled space past their last real page.
+        void *protaddr = retval->mmaps[i].mapped;
+        size_t protsize = retval->mmaps[i].size;
+        if (retval->mmaps[i].lazypages) {
+            protaddr = ((uint8 *) retval->mmaps[i].addr) + (numPageTableEntries * lx->page_size);
+            protsize -= (size_t) (((uint8 *) protaddr) - ((uint8 *) retval->mmaps[i].mapped));
+        } // if
+
+        if (protsize && (mprotect(protaddr, protsize, prot) == -1)) {
             fprintf(stderr, "mprotect(%p, %u, %s%s%s, ANON|PRIVATE|FIXED, -1, 0) failed (%d): %s\n",
-                    retval->mmaps[i].addr, (uint) retval->mmaps[i].size,
+                    protaddr, (uint) protsize,
                     (prot&PROT_READ) ? "R" : "-",
                     (prot&PROT_WRITE) ? "W" : "-",
                     (prot&PROT_EXEC) ? "X" : "-",
@@ -2017,6 +3620,8 @@ static LxModule *loadLxModule(const char *fname, const uint8 *origexe, uint8 *ex
     return retval;
 
 loadlx_failed:
+    if (retval)
+        retval->lazyimage = NULL;  // the caller still owns this on failure.
     freeLxModule(retval);
     return NULL;
 } // loadLxModule
@@ -2365,6 +3970,9 @@ static LxModule *loadNeModule(const char *fname, const uint8 *origexe, uint8 *ex
         } // if
     } // if
 
+    if (!indexModuleOrdinals(retval))
+        goto loadne_failed;
+
     // Now load named entry points.
     if (ne->resident_name_table_offset) {
         if (!loadLxNameTable(retval, exe + ne->resident_name_table_offset))
@@ -2376,6 +3984,9 @@ static LxModule *loadNeModule(const char *fname, const uint8 *origexe, uint8 *ex
             goto loadne_failed;
     } // if
 
+    if (!indexModuleNames(retval))
+        goto loadne_failed;
+
     // Load other dependencies of this module.
     const uint16 *import_modules_table = (const uint16 *) (exe + ne->module_reference_table_offset);
     for (uint32 i = 0; i < ne->num_module_ref_table_entries; i++) {
@@ -2447,7 +4058,7 @@ loadne_failed:
     return NULL;
 } // loadNeModule
 
-static LxModule *loadModule(const char *fname, uint8 *exe, uint32 exelen, int dependency_tree_depth)
+static LxModule *loadModule(const char *fname, const int fd, uint8 *exe, uint32 exelen, int dependency_tree_depth)
 {
     //printf("loadModule('%s')\n", fname); fflush(stdout);
     //const uint32 origexelen = exelen;
@@ -2459,7 +4070,7 @@ static LxModule *loadModule(const char *fname, uint8 *exe, uint32 exelen, int de
     }
 
     return is_lx ?
-        loadLxModule(fname, origexe, exe, exelen, dependency_tree_depth) :
+        loadLxModule(fname, fd, origexe, exe, exelen, dependency_tree_depth) :
         loadNeModule(fname, origexe, exe, exelen, dependency_tree_depth);
 } // loadModule
 
@@ -2469,31 +4080,36 @@ static LxModule *loadModuleByPathInternal(const char *fname, const int dependenc
     const char *what = NULL; (void) what;
     uint8 *module = NULL;
     uint32 modulelen = 0;
-    FILE *io = NULL;
+    struct stat statbuf;
+    void *ptr;
+    int fd = -1;
 
     // !!! FIXME: locate correct file (case-insensitive checking, convert '\\' to '/' etc)...
 
     #define LOADFAIL(x) { what = x; goto loadmod_failed; }
 
-    if ((io = fopen(fname, "rb")) == NULL) LOADFAIL("open");
-    if (fseek(io, 0, SEEK_END) < 0) LOADFAIL("seek");
-    modulelen = ftell(io);
-    if ((module = (uint8 *) malloc(modulelen)) == NULL) LOADFAIL("malloc");
-    rewind(io);
-    if (fread(module, modulelen, 1, io) != 1) LOADFAIL("read");
-    fclose(io);
+    // We mmap() the module instead of reading it, so pages that can be used
+    //  as-is can be mapped from the file by the loader (and shared with other
+    //  processes through the page cache), and we don't read the parts that
+    //  we never need. This is MAP_PRIVATE, so nothing here touches the file.
+    if ((fd = open(fname, O_RDONLY)) == -1) LOADFAIL("open");
+    if (fstat(fd, &statbuf) == -1) LOADFAIL("stat");
+    modulelen = (uint32) statbuf.st_size;
+    if ((ptr = mmap(NULL, modulelen, PROT_READ|PROT_WRITE, MAP_PRIVATE, fd, 0)) == MAP_FAILED) LOADFAIL("mmap");
+    module = (uint8 *) ptr;
 
     #undef LOADFAIL
 
-    LxModule *retval = loadModule(fname, module, modulelen, dependency_tree_depth);
-    free(module);
+    LxModule *retval = loadModule(fname, fd, module, modulelen, dependency_tree_depth);
+    close(fd);  // anything mapped from this keeps its own reference to the file.
+    if (!retval || (retval->lazyimage != module))  // demand-paged modules keep this.
+        munmap(module, modulelen);
     return retval;
 
 loadmod_failed:
     fprintf(stderr, "%s failure on '%s: %s'\n", what, fname, strerror(errno));
-    if (io)
-        fclose(io);
-    free(module);
+    if (fd != -1)
+        close(fd);
     return NULL;
 } // loadModuleByPathInternal
 
@@ -2536,6 +4152,13 @@ static LxModule *loadNativeModule(const char *fname, const char *modname)
     retval->os2path = os2path;
     retval->exports = exports;
     retval->num_exports = num_exports;
+    if (!indexModuleOrdinals(retval))
+        goto loadnative_failed;
+    else if (!indexModuleNames(retval)) {
+        free((void *) retval->exports_by_ordinal);
+        free(retval->resolved_ordinals);
+        goto loadnative_failed;
+    } // else if
     retval->initialized = 1;
 
     //fprintf(stderr, "Loaded native module '%s' (%u exports).\n", fname, (uint) num_exports);
@@ -2618,6 +4241,423 @@ static LxModule *loadModuleByPathOrModuleName(const char *modname)
     return retval;
 } // loadModuleByPathOrModuleName
 
+// The zygote is a helper process we fork before loading the main module,
+//  after the loader and whatever native modules it preloads are initialized.
+//  DosExecPgm() hands it the new process's command line, environment, current
+//  directory, umask, resource limits and every file descriptor that would
+//  survive an exec(), and it forks a copy of itself that puts all that back
+//  the way the requester had it, then loads and runs the program, skipping
+//  the exec and all the setup the zygote already did.
+//  The new process is the zygote's grandchild, not the requester's child, so
+//  the middleman between them sends the requester its pid and, when it ends,
+//  its waitpid() status, and DOSCALLS waits on that instead of waitpid().
+//  Requests go over a SOCK_SEQPACKET socket that's only inherited (never
+//  exec'd), so only our own descendants can talk to it.
+#define LX_ZYGOTE_MAX_REQUEST (128 * 1024)
+#define LX_ZYGOTE_MAX_FDS 252  // Linux allows 253 fds per SCM_RIGHTS message, and the reply socket needs one.
+
+typedef struct LxZygoteRequest
+{
+    uint32 numfds;  // inherited fds; their numbers come first in the payload, as sint32s.
+    uint32 cmdlinelen;  // null-terminated args, back to back.
+    uint32 envlen;  // null-terminated environment strings, back to back.
+    uint32 cwdlen;  // null-terminated current directory.
+    uint32 ppid;  // the requester, which is the new process's parent as far as OS/2 is concerned.
+    uint32 umask;
+    struct rlimit rlimits[RLIMIT_NLIMITS];
+} LxZygoteRequest;
+
+static int GZygoteFd = -1;  // our end of the zygote's request socket, -1 if there's no zygote.
+
+static uint32 packStrings(uint8 *dst, const uint32 avail, char * const *strs)
+{
+    uint32 total = 0;
+    for (char * const *ptr = strs; *ptr; ptr++) {
+        const uint32 len = (uint32) strlen(*ptr) + 1;
+        if ((total + len) > avail)
+            return 0xFFFFFFFF;
+        memcpy(dst + total, *ptr, len);
+        total += len;
+    } // for
+    return total;
+} // packStrings
+
+// Find every fd that would survive an exec() (all the inheritable HFILEs,
+//  plus anything native code opened without FD_CLOEXEC). Returns the number
+//  found, or -1 if we can't tell or there are more than (maxfds).
+static int collectInheritableFds(sint32 *fds, const int maxfds)
+{
+    DIR *dirp = opendir("/proc/self/fd");
+    if (!dirp)
+        return -1;
+
+    int retval = 0;
+    struct dirent *dent;
+    while ((dent = readdir(dirp)) != NULL) {
+        if (dent->d_name[0] == '.')
+            continue;
+        const int fd = atoi(dent->d_name);
+        if (fd == dirfd(dirp))
+            continue;
+        const int flags = fcntl(fd, F_GETFD);
+        if ((flags == -1) || (flags & FD_CLOEXEC))
+            continue;
+        else if (retval == maxfds) {
+            retval = -1;
+            break;
+        } // else if
+        fds[retval++] = (sint32) fd;
+    } // while
+
+    closedir(dirp);
+    return retval;
+} // collectInheritableFds
+
+// returns 1 if the zygote started the program: (*pid) is its process id, and
+//  its waitpid() status will arrive on (*statusfd), which the caller closes.
+//  Returns 0 if the caller should launch it the usual way.
+static int lxExecViaZygote(char * const *argv, char * const *envp, uint32 *pid, int *statusfd)
+{
+    if (GZygoteFd == -1)
+        return 0;
+
+    uint8 *buf = (uint8 *) malloc(LX_ZYGOTE_MAX_REQUEST);
+    char *cwd = getcwd(NULL, 0);
+    if (!buf || !cwd) {
+        free(buf);
+        free(cwd);
+        return 0;
+    } // if
+
+    LxZygoteRequest *req = (LxZygoteRequest *) buf;
+    memset(req, '\0', sizeof (*req));
+
+    // the zygote gets the reply socket first, then everything we'd pass down through exec().
+    int fds[LX_ZYGOTE_MAX_FDS + 1];
+    sint32 *fdnums = (sint32 *) (req + 1);
+    const int numfds = collectInheritableFds(fdnums, LX_ZYGOTE_MAX_FDS);
+    if (numfds == -1) {
+        free(buf);
+        free(cwd);
+        return 0;  // too many to send (or no /proc), just exec it instead.
+    } // if
+
+    req->numfds = (uint32) numfds;
+    for (int i = 0; i < numfds; i++)
+        fds[i + 1] = (int) fdnums[i];
+
+    req->ppid = (uint32) getpid();
+    const mode_t mask = umask(022);
+    umask(mask);
+    req->umask = (uint32) mask;
+    for (int i = 0; i < RLIMIT_NLIMITS; i++) {
+        if (getrlimit((__rlimit_resource_t) i, &req->rlimits[i]) == -1) {
+            req->rlimits[i].rlim_cur = RLIM_INFINITY;  // zygote leaves this one alone.
+            req->rlimits[i].rlim_max = RLIM_INFINITY;
+        } // if
+    } // for
+
+    const uint32 fdnumslen = sizeof (sint32) * req->numfds;
+    uint8 *payload = ((uint8 *) (req + 1)) + fdnumslen;
+    uint32 avail = LX_ZYGOTE_MAX_REQUEST - sizeof (*req) - fdnumslen;
+    const uint32 cwdlen = (uint32) strlen(cwd) + 1;
+    req->cmdlinelen = packStrings(payload, avail, argv);
+    if (req->cmdlinelen != 0xFFFFFFFF) {
+        avail -= req->cmdlinelen;
+        req->envlen = packStrings(payload + req->cmdlinelen, avail, envp);
+    } // if
+
+    if ((req->cmdlinelen == 0xFFFFFFFF) || (req->envlen == 0xFFFFFFFF) || (cwdlen > (avail - req->envlen))) {
+        free(buf);
+        free(cwd);
+        return 0;  // too big for one request, just exec it instead.
+    } // if
+
+    req->cwdlen = cwdlen;
+    memcpy(payload + req->cmdlinelen + req->envlen, cwd, cwdlen);
+    free(cwd);
+
+    int replyfds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, replyfds) == -1) {
+        free(buf);
+        return 0;
+    } // if
+
+    fds[0] = replyfds[1];
+    const size_t fdslen = sizeof (int) * (numfds + 1);
+    union { struct cmsghdr hdr; char buf[CMSG_SPACE(sizeof (fds))]; } control;
+    struct iovec iov;
+    struct msghdr msg;
+    memset(&control, '\0', sizeof (control));
+    memset(&msg, '\0', sizeof (msg));
+    iov.iov_base = buf;
+    iov.iov_len = sizeof (*req) + fdnumslen + req->cmdlinelen + req->envlen + req->cwdlen;
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = CMSG_SPACE(fdslen);
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(fdslen);
+    memcpy(CMSG_DATA(cmsg), fds, fdslen);
+
+    ssize_t rc;
+    do {
+        rc = sendmsg(GZygoteFd, &msg, MSG_NOSIGNAL);
+    } while ((rc == -1) && (errno == EINTR));
+
+    free(buf);
+    close(replyfds[1]);
+
+    if (rc == -1) {  // zygote is gone (or never got it), let the caller exec.
+        close(replyfds[0]);
+        return 0;
+    } // if
+
+    // the middleman sends the pid as soon as it forks. If we don't get one,
+    //  the program never started, so the caller can still launch it itself.
+    uint8 *ptr = (uint8 *) pid;
+    size_t remain = sizeof (*pid);
+    while (remain > 0) {
+        rc = read(replyfds[0], ptr, remain);
+        if ((rc == -1) && (errno == EINTR))
+            continue;
+        else if (rc <= 0)
+            break;
+        ptr += rc;
+        remain -= (size_t) rc;
+    } // while
+
+    if (remain > 0) {
+        close(replyfds[0]);
+        return 0;
+    } // if
+
+    *statusfd = replyfds[0];
+    return 1;
+} // lxExecViaZygote
+
+static __attribute__((noreturn)) void runZygoteProcess(const int serverfd, const int *fds, const uint8 *payload, const LxZygoteRequest *req)
+{
+    // The zygote ignores SIGCHLD so its children reap themselves, but we
+    //  need to wait on ours.
+    signal(SIGCHLD, SIG_DFL);
+
+    const pid_t pid = fork();
+    if (pid == -1) {
+        _exit(1);  // the requester will see the reply socket close.
+    } else if (pid == 0) {  // we're the new OS/2 process.
+        const sint32 *fdnums = (const sint32 *) payload;
+        const char *cmdline = (const char *) (fdnums + req->numfds);
+        const char *env = cmdline + req->cmdlinelen;
+        const char *cwd = env + req->envlen;
+        uint32 envc = 0;
+
+        close(serverfd);
+        close(fds[0]);
+
+        // Put each inherited fd at the number the requester had it at. Move
+        //  everything we're keeping (including our own zygote socket) above
+        //  all of those first, so nothing gets clobbered along the way.
+        int maxfd = 2;
+        for (uint32 i = 0; i < req->numfds; i++) {
+            if (fdnums[i] > maxfd)
+                maxfd = (int) fdnums[i];
+        } // for
+
+        if ((GZygoteFd != -1) && (GZygoteFd <= maxfd)) {
+            const int fd = fcntl(GZygoteFd, F_DUPFD_CLOEXEC, maxfd + 1);
+            close(GZygoteFd);
+            GZygoteFd = fd;
+        } // if
+
+        int moved[LX_ZYGOTE_MAX_FDS];
+        for (uint32 i = 0; i < req->numfds; i++) {
+            moved[i] = fcntl(fds[i + 1], F_DUPFD_CLOEXEC, maxfd + 1);
+            if (moved[i] == -1)
+                _exit(1);
+            close(fds[i + 1]);
+        } // for
+
+        // an exec'd process only gets the stdio the requester actually had open.
+        for (int i = 0; i <= 2; i++)
+            close(i);
+
+        for (uint32 i = 0; i < req->numfds; i++) {
+            if (dup2(moved[i], (int) fdnums[i]) == -1)  // (the copy isn't close-on-exec.)
+                _exit(1);
+            close(moved[i]);
+        } // for
+
+        if (chdir(cwd) == -1)
+            fprintf(stderr, "zygote: couldn't chdir to '%s': %s\n", cwd, strerror(errno));
+
+        umask((mode_t) req->umask);
+        for (int i = 0; i < RLIMIT_NLIMITS; i++) {
+            if (setrlimit((__rlimit_resource_t) i, &req->rlimits[i]) == -1)
+                fprintf(stderr, "zygote: couldn't set resource limit #%d: %s\n", i, strerror(errno));
+        } // for
+
+        for (uint32 i = 0; i < req->envlen; i++) {
+            if (env[i] == '\0')
+                envc++;
+        } // for
+
+        char **newenv = (char **) calloc(envc + 1, sizeof (char *));
+        if (!newenv)
+            _exit(1);
+        for (uint32 i = 0, j = 0; j < envc; j++) {
+            newenv[j] = (char *) (env + i);
+            i += strlen(newenv[j]) + 1;
+        } // for
+        environ = newenv;
+
+        GLoaderState.reinitProcess(cmdline, req->cmdlinelen);
+        GLoaderState.pib.pib_ulppid = req->ppid;  // not the middleman we forked from.
+        if (GLoaderState.dosReinitProcess)
+            GLoaderState.dosReinitProcess();
+
+        const char *modulename = getenv("IS_2INE");
+        LxModule *lxmod = modulename ? loadModuleByPath(modulename) : NULL;
+        if (lxmod != NULL)
+            runModule(lxmod);
+        _exit(1);
+    } // else if
+
+    // we're the middleman: tell the requester the new process's pid, then
+    //  wait for it and tell the requester how it went.
+    for (uint32 i = 0; i < req->numfds; i++)
+        close(fds[i + 1]);
+
+    const uint32 childpid = (uint32) pid;
+    send(fds[0], &childpid, sizeof (childpid), MSG_NOSIGNAL);
+
+    int status = 0;
+    pid_t rc;
+    do {
+        rc = waitpid(pid, &status, 0);
+    } while ((rc == -1) && (errno == EINTR));
+
+    if (rc == pid)
+        send(fds[0], &status, sizeof (status), MSG_NOSIGNAL);
+    _exit(0);
+} // runZygoteProcess
+
+static __attribute__((noreturn)) void runZygote(const int serverfd, const pid_t owner)
+{
+    // don't outlive the process that started us.
+    prctl(PR_SET_PDEATHSIG, SIGTERM);
+    if (getppid() != owner)
+        _exit(0);
+
+    signal(SIGCHLD, SIG_IGN);
+
+    // !!! FIXME: it would be nice to preload LX DLLs too, but their init
+    // !!! FIXME:  routines run on the main module's stack, so they can't
+    // !!! FIXME:  load before an .exe does. Native modules are fair game.
+    const char *preload = GLoaderState.zygote_preload ? GLoaderState.zygote_preload : "DOSCALLS";
+    char *names = strdup(preload);
+    if (names) {
+        for (char *name = strtok(names, ", \t"); name; name = strtok(NULL, ", \t")) {
+            if (!loadModuleByPathOrModuleName(name))
+                fprintf(stderr, "zygote: couldn't preload module '%s'\n", name);
+        } // for
+        free(names);
+    } // if
+
+    static union { LxZygoteRequest req; uint8 buf[LX_ZYGOTE_MAX_REQUEST]; } request;
+    while (1) {
+        int fds[LX_ZYGOTE_MAX_FDS + 1];
+        union { struct cmsghdr hdr; char buf[CMSG_SPACE(sizeof (fds))]; } control;
+        struct iovec iov;
+        struct msghdr msg;
+        memset(&msg, '\0', sizeof (msg));
+        iov.iov_base = request.buf;
+        iov.iov_len = sizeof (request.buf);
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control.buf;
+        msg.msg_controllen = sizeof (control.buf);
+
+        const ssize_t br = recvmsg(serverfd, &msg, MSG_CMSG_CLOEXEC);
+        if (br == 0)
+            _exit(0);  // everyone hung up.
+        else if (br == -1) {
+            if (errno == EINTR)
+                continue;
+            _exit(1);
+        } // else if
+
+        int numfds = 0;
+        for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+            if ((cmsg->cmsg_level == SOL_SOCKET) && (cmsg->cmsg_type == SCM_RIGHTS)) {
+                const int *rfds = (const int *) CMSG_DATA(cmsg);
+                const int total = (int) ((cmsg->cmsg_len - CMSG_LEN(0)) / sizeof (int));
+                for (int i = 0; i < total; i++) {
+                    if (numfds < (LX_ZYGOTE_MAX_FDS + 1))
+                        fds[numfds++] = rfds[i];
+                    else
+                        close(rfds[i]);
+                } // for
+            } // if
+        } // for
+
+        const LxZygoteRequest *req = &request.req;
+        const size_t payloadlen = (size_t) br - sizeof (*req);
+        int valid = ((msg.msg_flags & (MSG_TRUNC | MSG_CTRUNC)) == 0) && ((size_t) br > sizeof (*req));
+        valid = valid && (req->numfds <= LX_ZYGOTE_MAX_FDS) && (numfds == (int) (req->numfds + 1));
+        if (valid) {
+            const size_t fdnumslen = sizeof (sint32) * req->numfds;
+            const sint32 *fdnums = (const sint32 *) (req + 1);
+            const char *payload = ((const char *) (req + 1)) + fdnumslen;
+            valid = (((size_t) fdnumslen + req->cmdlinelen + req->envlen + req->cwdlen) == payloadlen) &&
+                    (req->cmdlinelen > 0) && (req->cwdlen > 0) &&
+                    (payload[req->cmdlinelen - 1] == '\0') &&
+                    ((req->envlen == 0) || (payload[req->cmdlinelen + req->envlen - 1] == '\0')) &&
+                    (payload[(payloadlen - fdnumslen) - 1] == '\0');
+            for (uint32 i = 0; valid && (i < req->numfds); i++)
+                valid = (fdnums[i] >= 0);
+        } // if
+
+        if (valid) {
+            const pid_t pid = fork();
+            if (pid == 0)
+                runZygoteProcess(serverfd, fds, (const uint8 *) (req + 1), req);
+            else if (pid == -1)
+                fprintf(stderr, "zygote: fork failed: %s\n", strerror(errno));
+        } // if
+
+        for (int i = 0; i < numfds; i++)
+            close(fds[i]);
+    } // while
+} // runZygote
+
+static void startZygote(void)
+{
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, fds) == -1) {
+        fprintf(stderr, "Couldn't create zygote socket, not using one: %s\n", strerror(errno));
+        return;
+    } // if
+
+    const pid_t owner = getpid();
+    const pid_t pid = fork();
+    if (pid == -1) {
+        fprintf(stderr, "Couldn't fork zygote, not using one: %s\n", strerror(errno));
+        close(fds[0]);
+        close(fds[1]);
+        return;
+    } // if
+
+    // the zygote keeps a copy of the client end, too, so the processes it
+    //  forks can send it their own requests.
+    GZygoteFd = fds[0];
+    if (pid == 0)
+        runZygote(fds[1], owner);
+    close(fds[1]);
+} // startZygote
+
 static __attribute__((noreturn)) void handleThreadLocalStorageAccess(const int slot, ucontext_t *uctx)
 {
     greg_t *gregs = uctx->uc_mcontext.gregs;
@@ -2699,6 +4739,10 @@ static void segfault_catcher(int sig, siginfo_t *info, void *ctx)
             handleThreadLocalStorageAccess(slot, uctx);
     } // if
 
+    // was the app touching a demand-paged page that we haven't loaded yet?
+    if (handleLazyPageFault(addr))
+        return;  // page is ready now, retry the instruction.
+
     static int faults = 0;
     faults++;
     switch (faults) {
@@ -2734,11 +4778,38 @@ int main(int argc, char **argv, char **envp)
         return 1;
     }
 
+    // The module cache only hits if native libraries (and the DLL objects we
+    //  mmap) land in the same place every time, so if the cache has entries
+    //  for this program, turn off address space randomization and restart
+    //  ourselves if it's in use. Programs that have never stored anything in
+    //  the cache keep ASLR. Personality flags are inherited, so once we're
+    //  restarted, turn it back on; that only affects future exec()s, so
+    //  anything we launch gets randomized again.
+    if (GLoaderState.module_cache)
+        initProgramCacheMarker(GLoaderState.subprocess ? getenv("IS_2INE") : argv[1]);
+
+    if (getenv("IS_2INE_NOASLR")) {
+        unsetenv("IS_2INE_NOASLR");
+        const int persona = personality(0xFFFFFFFF);
+        if (persona != -1)
+            personality(persona & ~ADDR_NO_RANDOMIZE);
+    } else if (GLoaderState.module_cache && programHasModuleCache()) {
+        const int persona = personality(0xFFFFFFFF);
+        if ((persona != -1) && ((persona & ADDR_NO_RANDOMIZE) == 0)) {
+            if ((setenv("IS_2INE_NOASLR", "1", 1) == 0) && (personality(persona | ADDR_NO_RANDOMIZE) != -1))
+                execv("/proc/self/exe", argv);
+            // if we're still here, oh well, we just won't get many cache hits.
+            personality(persona);
+            unsetenv("IS_2INE_NOASLR");
+        } // if
+    } // if
+
     GLoaderState.ldt = (uint32 *) calloc(LX_MAX_LDT_SLOTS, sizeof (*GLoaderState.ldt));
     if (!GLoaderState.ldt) {
         fprintf(stderr, "Out of memory\n");
         return 1;
     }
+    initSelectors();
 
     // cleanup some defaults lib2ine set up, since we'll set it up a different way.
     GLoaderState.using_lx_loader = 1;
@@ -2771,6 +4842,13 @@ int main(int argc, char **argv, char **envp)
     GLoaderState.loadModule = loadModuleByPathOrModuleName;
     GLoaderState.makeUnixPath = lxMakeUnixPath;
     GLoaderState.terminate = lxTerminate;
+    GLoaderState.execViaZygote = lxExecViaZygote;
+
+    // subprocesses either came from the zygote (and never get here), or were
+    //  exec'd normally because the zygote couldn't take them, so only the
+    //  first process starts one.
+    if (GLoaderState.zygote && !GLoaderState.subprocess)
+        startZygote();
 
     const char *modulename = GLoaderState.subprocess ? getenv("IS_2INE") : argv[1];
     LxModule *lxmod = loadModuleByPath(modulename);
@@ -403,6 +403,7 @@ LX_NATIVE_MODULE_INIT({ if (!init16_doscalls()) return 0; })
     LX_NATIVE_EXPORT16(Dos16ExecPgm, 144),
     LX_NATIVE_EXPORT16(Dos16MkDir2, 185),
     LX_NATIVE_EXPORT(DosSetMaxFH, 209),
+    LX_NATIVE_EXPORT(DosSetFileInfo, 218),
     LX_NATIVE_EXPORT(DosSetPathInfo, 219),
     LX_NATIVE_EXPORT(DosQueryPathInfo, 223),
     LX_NATIVE_EXPORT(DosQueryHType, 224),
@@ -411,6 +412,15 @@ LX_NATIVE_MODULE_INIT({ if (!init16_doscalls()) return 0; })
     LX_NATIVE_EXPORT(DosGetDateTime, 230),
     LX_NATIVE_EXPORT(DosDevConfig, 231),
     LX_NATIVE_EXPORT(DosExit, 234),
+    LX_NATIVE_EXPORT(DosResumeThread, 237),
+    LX_NATIVE_EXPORT(DosCreatePipe, 239),
+    LX_NATIVE_EXPORT(DosCallNPipe, 240),
+    LX_NATIVE_EXPORT(DosConnectNPipe, 241),
+    LX_NATIVE_EXPORT(DosDisConnectNPipe, 242),
+    LX_NATIVE_EXPORT(DosCreateNPipe, 243),
+    LX_NATIVE_EXPORT(DosQueryNPHState, 245),
+    LX_NATIVE_EXPORT(DosSetNPHState, 250),
+    LX_NATIVE_EXPORT(DosTransactNPipe, 252),
     LX_NATIVE_EXPORT(DosResetBuffer, 254),
     LX_NATIVE_EXPORT(DosSetCurrentDir, 255),
     LX_NATIVE_EXPORT(DosSetFilePtr, 256),
@@ -439,6 +449,7 @@ LX_NATIVE_MODULE_INIT({ if (!init16_doscalls()) return 0; })
     LX_NATIVE_EXPORT(DosAllocMem, 299),
     LX_NATIVE_EXPORT(DosFreeMem, 304),
     LX_NATIVE_EXPORT(DosSetMem, 305),
+    LX_NATIVE_EXPORT(DosQueryMem, 306),
     LX_NATIVE_EXPORT(DosCreateThread, 311),
     LX_NATIVE_EXPORT(DosGetInfoBlocks, 312),
     LX_NATIVE_EXPORT(DosLoadModule, 318),
@@ -447,36 +458,49 @@ LX_NATIVE_MODULE_INIT({ if (!init16_doscalls()) return 0; })
     LX_NATIVE_EXPORT(DosQueryProcAddr, 321),
     LX_NATIVE_EXPORT(DosQueryAppType, 323),
     LX_NATIVE_EXPORT(DosCreateEventSem, 324),
+    LX_NATIVE_EXPORT(DosOpenEventSem, 325),
     LX_NATIVE_EXPORT(DosCloseEventSem, 326),
     LX_NATIVE_EXPORT(DosResetEventSem, 327),
     LX_NATIVE_EXPORT(DosPostEventSem, 328),
     LX_NATIVE_EXPORT(DosWaitEventSem, 329),
     LX_NATIVE_EXPORT(DosQueryEventSem, 330),
     LX_NATIVE_EXPORT(DosCreateMutexSem, 331),
+    LX_NATIVE_EXPORT(DosOpenMutexSem, 332),
     LX_NATIVE_EXPORT(DosCloseMutexSem, 333),
     LX_NATIVE_EXPORT(DosRequestMutexSem, 334),
     LX_NATIVE_EXPORT(DosReleaseMutexSem, 335),
+    LX_NATIVE_EXPORT(DosCreateMuxWaitSem, 337),
+    LX_NATIVE_EXPORT(DosOpenMuxWaitSem, 338),
+    LX_NATIVE_EXPORT(DosCloseMuxWaitSem, 339),
+    LX_NATIVE_EXPORT(DosWaitMuxWaitSem, 340),
+    LX_NATIVE_EXPORT(DosAddMuxWaitSem, 341),
+    LX_NATIVE_EXPORT(DosDeleteMuxWaitSem, 342),
+    LX_NATIVE_EXPORT(DosQueryMuxWaitSem, 343),
     LX_NATIVE_EXPORT(DosSubSetMem, 344),
     LX_NATIVE_EXPORT(DosSubAllocMem, 345),
     LX_NATIVE_EXPORT(DosSubFreeMem, 346),
+    LX_NATIVE_EXPORT(DosSubUnsetMem, 347),
     LX_NATIVE_EXPORT(DosQuerySysInfo, 348),
     LX_NATIVE_EXPORT(DosWaitThread, 349),
     LX_NATIVE_EXPORT(DosSetExceptionHandler, 354),
     LX_NATIVE_EXPORT(DosUnsetExceptionHandler, 355),
     LX_NATIVE_EXPORT(DosQuerySysState, 368),
+    LX_NATIVE_EXPORT(DosEnumAttribute, 372),
     LX_NATIVE_EXPORT(DosSetSignalExceptionFocus, 378),
     LX_NATIVE_EXPORT(DosEnterMustComplete, 380),
     LX_NATIVE_EXPORT(DosExitMustComplete, 381),
     LX_NATIVE_EXPORT(DosSetRelMaxFH, 382),
     LX_NATIVE_EXPORT(DosFlatToSel, 425),
     LX_NATIVE_EXPORT(DosSelToFlat, 426),
+    LX_NATIVE_EXPORT(DosSetFileLocks, 428),
     LX_NATIVE_EXPORT(DosAllocThreadLocalMemory, 454),
     LX_NATIVE_EXPORT(DosFreeThreadLocalMemory, 455),
     LX_NATIVE_EXPORT(DosR3ExitAddr, 553),
     LX_NATIVE_EXPORT(DosQueryHeaderInfo, 582),
     LX_NATIVE_EXPORT(DosQueryExtLIBPATH, 874),
     LX_NATIVE_EXPORT(DosQueryThreadContext, 877),
-    LX_NATIVE_EXPORT(DosOpenL, 981)
+    LX_NATIVE_EXPORT(DosOpenL, 981),
+    LX_NATIVE_EXPORT(DosSetFileLocksL, 986)
 LX_NATIVE_MODULE_INIT_END()
 
 #endif /* LX_LEGACY */
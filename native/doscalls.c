@@ -11,6 +11,7 @@
 
 #include <unistd.h>
 #include <limits.h>
+#include <stddef.h>
 #include <time.h>
 #include <dirent.h>
 #include <fcntl.h>
@@ -21,11 +22,20 @@
 #include <sys/time.h>
 #include <sys/resource.h>
 #include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/xattr.h>
+#include <sys/file.h>
+#include <linux/futex.h>
+#include <poll.h>
+#include <ctype.h>
 
 #include "doscalls-lx.h"
 
 static pthread_mutex_t GMutexDosCalls;
 static pthread_mutex_t GMutexDosBeep;
+static pthread_mutex_t GMutexMemObjects;
 
 typedef struct ExitListItem
 {
@@ -61,16 +71,95 @@ enum {
     DAW_CHARACTER = (1 << 15)
 };
 
+// Named pipes are Unix domain sockets in the abstract namespace, under a
+//  per-user prefix, so they go away with the last process using them.
+//  Message pipes are SOCK_SEQPACKET, so the kernel keeps the message
+//  boundaries for us, and byte pipes are SOCK_STREAM. A server handle's fd is
+//  the listening socket until DosConnectNPipe() accepts a client, and the
+//  connected socket after that. Instances of the same pipe in this process
+//  share the listening socket.
+typedef struct NamedPipe
+{
+    int listenfd;  // -1 for the client end.
+    ULONG openmode;  // NP_ACCESS_*, NP_NOINHERIT, etc.
+    ULONG pipemode;  // NP_* for this end of the pipe.
+    char sockname[sizeof (((struct sockaddr_un *) NULL)->sun_path)];  // leading '\0' for the abstract namespace.
+    socklen_t socknamelen;
+    uint8 *pending;  // the rest of a message that didn't fit in the caller's buffer.
+    ULONG pendinglen;
+    ULONG pendingpos;
+    struct NamedPipe *next;  // GNamedPipes, server ends only.
+} NamedPipe;
+
+static NamedPipe *GNamedPipes = NULL;  // protected by GMutexDosCalls.
+
+// With system.file_buffering on, regular files get a buffer per HFILE, so
+//  apps that read and write in 512-byte or 4K chunks don't make a syscall
+//  for each one. Reads that look sequential pull in FILEBUFFER_SIZE at a
+//  time, and small writes are coalesced until the buffer fills or something
+//  else needs the file to be current. While a handle is buffered, its file
+//  position lives here and all its i/o goes through pread()/pwrite(), so the
+//  kernel's file offset is stale until syncFileBuffer() puts it back.
+//  Duplicated handles share a file offset, so those don't get buffered.
+#define FILEBUFFER_SIZE (64 * 1024)
+
+typedef struct FileBuffer
+{
+    pthread_mutex_t lock;
+    uint8 *data;
+    int writable;
+    int hintsequential;  // opened with OPEN_FLAGS_SEQUENTIAL.
+    int random;  // opened with OPEN_FLAGS_RANDOM.
+    int advised;  // already told the kernel we're reading sequentially.
+    int disabled;  // handle was duplicated, go straight to the fd.
+    int active;  // nonzero if (pos) is the file position, not the kernel's offset.
+    off_t pos;
+    off_t start;  // file offset of data[0].
+    uint32 avail;  // bytes of read-ahead in (data).
+    uint32 dirty;  // bytes of unwritten data in (data).
+    uint32 sequential;  // reads in a row that picked up where the last one left off.
+    off_t lastend;
+    int error;  // errno from a failed coalesced write, for the next DosWrite/DosClose to report.
+} FileBuffer;
+
 typedef struct HFileInfo
 {
     int fd;       // unix file descriptor.
     ULONG type;   // file, pipe, device, etc.
     ULONG attr;   // for character devices, DAW_*
     ULONG flags;  // OPEN_FLAGS_*
+    NamedPipe *npipe;  // non-NULL if this is one end of a named pipe.
+    FileBuffer *fbuf;  // non-NULL if system.file_buffering is buffering this handle.
+    uint32 share;  // ShareOpen (index + 1) in the share arena, 0 if nothing is tracked for this handle.
 } HFileInfo;
 
-static HFileInfo *HFiles = NULL;
-static uint32 MaxHFiles = 0;
+// File handles are looked up on every DosRead/DosWrite/etc, so readers don't
+//  take GMutexDosCalls. Slots live in fixed-size chunks that never move, and
+//  the table of chunk pointers is replaced wholesale (and published
+//  atomically) when it grows, so a reader holding an old table still sees
+//  the live slots. Replaced tables aren't freed until the module unloads,
+//  since a reader might still be looking at one; they're tiny and only
+//  replaced when someone raises the handle limit.
+// Slot contents are guarded by a generation counter, seqlock-style: it's odd
+//  while a writer is changing the slot, and readers retry if it changed
+//  while they were copying the slot out. Writers must hold GMutexDosCalls, or
+//  own the slot by having reserved it (fd == -2) under that lock.
+#define HFILE_CHUNK_SIZE 64
+
+typedef struct HFileSlot
+{
+    uint32 generation;
+    HFileInfo info;
+} HFileSlot;
+
+typedef struct HFileTable
+{
+    uint32 count;
+    struct HFileTable *replaced;  // the previous, smaller table; freed at unload.
+    HFileSlot *chunks[];
+} HFileTable;
+
+static HFileTable *GHFiles = NULL;
 
 typedef struct Thread
 {
@@ -79,28 +168,293 @@ typedef struct Thread
     PFNTHREAD fn;
     ULONG fnarg;
     uint16 selector;
+    uint32 suspended;  // futex word: nonzero until DosResumeThread() lets a CREATE_SUSPENDED thread run.
+    int pooled;  // runs on a pooled pthread, so there's nothing to pthread_join().
+    int finished;  // set (with GMutexDosCalls held) when it lands on GDeadThreads.
     struct Thread *prev;
     struct Thread *next;
 } Thread;
 
 static Thread *GDeadThreads = NULL;
+static pthread_cond_t GCondDeadThreads;  // signalled (with GMutexDosCalls held) when a thread lands on GDeadThreads.
+
+// With system.thread_pool set, OS/2 threads run on pooled pthreads that
+//  already have a stack and a TIB selector. When an OS/2 thread returns, its
+//  pthread parks on a futex until DosCreateThread() hands it another one,
+//  instead of exiting and taking the stack and selector with it. Threads that
+//  want a bigger stack than the pool offers still get a pthread of their own.
+#define THREAD_POOL_STACKLEN (1024 * 1024)
+
+enum
+{
+    THREADWORKER_IDLE,
+    THREADWORKER_ASSIGNED,
+    THREADWORKER_QUIT
+};
+
+typedef struct ThreadWorker
+{
+    pthread_t pthread;
+    uint32 state;  // futex word, THREADWORKER_*.
+    Thread *job;
+    struct ThreadWorker *next;
+} ThreadWorker;
+
+static ThreadWorker *GIdleThreadWorkers = NULL;  // protected by GMutexDosCalls.
+static int GNumIdleThreadWorkers = 0;
+
+
+// Event semaphores are a few 32-bit words that we wait on with futexes, so
+//  posting and resetting never leave user space. Mutexes are robust pthread
+//  mutexes, so an uncontended request is one compare-and-swap in glibc, and
+//  the kernel tells the next waiter right away if the owner's thread dies.
+//  Private semaphores are malloc'd and the handle is the pointer.
+//  Shared (DC_SEM_SHARED or named) semaphores live in a slot of a shared
+//  memory arena that every 2ine process maps, and their handle is the slot
+//  index with the low bit set, so it can't collide with a malloc'd pointer.
+#define SEM32_ARENA_SLOTS 4096
+#define SEM32_ARENA_MAGIC 0x32334D53  // 'SM32'
+#define SEM32_MAX_COUNT 0xFFFF
+#define SEM32_ARENA_MUXWAITERS 1024
+#define SEM32_ARENA_MUXLINKS (SEM32_ARENA_MUXWAITERS * 16)
+#define SEM32_MUXLINK_FREE 0xFFFFFFFF
+
+enum
+{
+    SEM32KIND_FREE = 0,
+    SEM32KIND_EVENT,
+    SEM32KIND_MUTEX,
+    SEM32KIND_MUXWAIT
+};
+
+typedef struct Sem32
+{
+    uint32 kind;  // SEM32KIND_*
+    uint32 opens;  // DosCreate*Sem/DosOpen*Sem calls that haven't been closed yet.
+    uint32 value;  // Events: the futex word, the post count. Mutexes: owner's thread id, 0 if unowned.
+    uint32 waiters;  // events: threads blocked in DosWaitEventSem.
+    uint32 recursion;  // mutexes: times the owner has requested it.
+    uint32 muxlinks;  // first MuxLink (index + 1) of muxwaits blocked on this semaphore, 0 if none.
+    uint32 ownerstamp;  // mutexes: owner's GSem32Thread.stamp, so a recycled thread id doesn't look like the owner.
+    uint32 ownerdied;  // mutexes: the last owner's OS/2 thread ended while its pooled pthread carried on.
+    pthread_mutex_t mutex;  // mutexes: robust, process-shared if the semaphore is.
+} Sem32;
+
+typedef struct Sem32Slot
+{
+    Sem32 sem;
+    char name[CCHMAXPATH];  // uppercased; empty for unnamed shared semaphores.
+} Sem32Slot;
+
+typedef struct MuxWaiter
+{
+    uint32 inuse;
+    uint32 pid;  // process that's waiting, so we can reap this if it dies mid-wait.
+    uint32 seq;  // futex word; bumped every time a member changes.
+    uint32 ready[DCMW_MAX_SEMRECORDS / 32];  // bitmask of members that changed since the waiter last looked.
+} MuxWaiter;
+
+typedef struct MuxLink
+{
+    uint32 next;  // index + 1, 0 at the end of the list.
+    uint32 waiter;  // index into muxwaiters, SEM32_MUXLINK_FREE while on the free list.
+    uint32 member;  // which of the waiter's muxwait records this is.
+} MuxLink;
+
+typedef struct Sem32Arena
+{
+    uint32 magic;  // set last, once the creating process finished initializing the arena.
+    pthread_mutex_t lock;  // process-shared, guards slot allocation, names, open counts and muxwait links.
+    Sem32Slot slots[SEM32_ARENA_SLOTS];
+    uint32 freelinks;  // first unused MuxLink (index + 1).
+    MuxWaiter muxwaiters[SEM32_ARENA_MUXWAITERS];
+    MuxLink muxlinks[SEM32_ARENA_MUXLINKS];
+} Sem32Arena;
+
+static Sem32Arena *GSem32Arena = NULL;
+static uint16 *GSem32Opens = NULL;  // how often this process opened each shared slot, so we can close them at exit.
+
+
+// DosOpen sharing modes and DosSetFileLocks ranges have to be seen by every
+//  2ine process, so they live in another shared arena, keyed by the file's
+//  device and inode. Each open file gets a ShareOpen record that says what
+//  it may do and what it denies everyone else, and new opens are checked
+//  against the file's other records. Locked ranges hang off the record that
+//  locked them, and are also taken as OFD locks on the handle's fd, so the
+//  kernel drops them if we die, and non-2ine processes using fcntl() locks
+//  see them. OS/2 locks are mandatory, so DosRead and DosWrite check for
+//  someone else's locks, but they only take the arena lock when the file's
+//  lock count says there are any. Records left behind by a dead process
+//  are dropped when somebody trips over them.
+// !!! FIXME: handles a DosExecPgm child inherits aren't in the table; the record stays with the parent.
+#define SHARE_ARENA_MAGIC 0x52485332  // '2SHR'
+#define SHARE_ARENA_FILES 4096  // power of two, hashed on (dev, inode).
+#define SHARE_ARENA_OPENS 8192
+#define SHARE_ARENA_LOCKS 16384
+#define SHARE_LOCK_POLL_MS 100  // how often lock waiters look for dead holders and non-2ine locks.
+#define SHARE_ACCESS_READ 0x1
+#define SHARE_ACCESS_WRITE 0x2
+
+enum
+{
+    SHAREFILE_UNUSED = 0,  // probes stop here.
+    SHAREFILE_INUSE,
+    SHAREFILE_DELETED  // probes keep going, new files can take it.
+};
+
+typedef struct ShareFile
+{
+    uint64 dev;
+    uint64 ino;
+    uint32 state;  // SHAREFILE_*
+    uint32 opens;  // first ShareOpen (index + 1) on this file.
+    uint32 numlocks;  // ranges locked through all of the file's opens. Read without the arena lock.
+    uint32 lockseq;  // futex: bumped when a range is unlocked and someone is waiting.
+    uint32 lockwaiters;
+} ShareFile;
+
+typedef struct ShareOpen
+{
+    uint32 file;  // ShareFile (index + 1), 0 if this record is free.
+    uint32 next;  // next ShareOpen (index + 1) on the same file, or on the free list.
+    uint32 pid;
+    uint32 handles;  // DosDupHandle copies share the original's record.
+    uint32 access;  // SHARE_ACCESS_* this open may do.
+    uint32 deny;  // SHARE_ACCESS_* it denies everyone else.
+    uint32 numlocks;
+    uint32 locks;  // first ShareLock (index + 1) held through this open.
+} ShareOpen;
+
+typedef struct ShareLock
+{
+    uint32 next;  // index + 1, on the open's list or the free list.
+    uint32 shared;
+    uint64 offset;
+    uint64 length;
+} ShareLock;
+
+typedef struct ShareArena
+{
+    uint32 magic;  // set last, once the creating process finished initializing the arena.
+    pthread_mutex_t lock;  // process-shared, guards everything but the numlocks fast path.
+    uint32 freeopens;  // first unused ShareOpen (index + 1).
+    uint32 freelocks;  // first unused ShareLock (index + 1).
+    ShareFile files[SHARE_ARENA_FILES];
+    ShareOpen opens[SHARE_ARENA_OPENS];
+    ShareLock locks[SHARE_ARENA_LOCKS];
+} ShareArena;
+
+static ShareArena *GShareArena = NULL;
+
+
+// DosAllocMem() objects. OS/2 puts these on 64k boundaries and manages them a
+//  page at a time: each page is reserved or committed, with its own access
+//  flags. We reserve the whole object as PROT_NONE and only make pages
+//  accessible as they're committed, so memory an app reserves but never
+//  commits (or commits but never touches) doesn't count against it.
+typedef struct MemObject
+{
+    uint8 *addr;
+    uint32 numpages;
+    ULONG flags;  // the PAG_* access flags the object was allocated with.
+    uint8 *pages;  // PAG_* access flags and PAG_COMMIT for each page.
+} MemObject;
+
+static MemObject *GMemObjects = NULL;  // sorted by address.
+static uint32 GNumMemObjects = 0;
+static uint32 GMaxMemObjects = 0;
+
+// Extended attributes.
+//
+// A file's whole EA set is kept as one blob, in exactly the FEA2LIST layout
+//  apps see: cbList up front, then ULONG-aligned FEA2 entries with
+//  uppercased names. That makes FIL_QUERYEASIZE just the blob's size, so a
+//  directory listing needs one getxattr() per file, no matter how many EAs
+//  it has. The blob lives in the file's "user.os2.eas" xattr when the
+//  filesystem allows it. When it doesn't (no user xattrs, or no room for a
+//  set this big), the blob goes in a sidecar file in the same directory:
+//  a header, an index sorted by filename, then the blobs. A listing loads
+//  the sidecar once and binary-searches it. Writers rewrite the sidecar
+//  through a temp file and rename(), holding flock() on the directory so
+//  other processes don't lose updates.
+// !!! FIXME: there's no DosMove/DosDeleteDir yet. When there is, they need
+// !!! FIXME:  to carry or clean up sidecar records (xattrs follow the inode).
+#define EA_XATTR_NAME "user.os2.eas"
+#define EA_SIDECAR_NAME ".2ine-eas"
+#define EA_SIDECAR_MAGIC 0x41453249  // "I2EA"
+#define EA_MAX_LIST_SIZE (64 * 1024)  // OS/2's limit for a file's whole EA set.
+#define EA_EMPTY_LIST_SIZE ((ULONG) sizeof (ULONG))  // an FEA2LIST with just cbList.
+
+typedef struct
+{
+    uint32 nameoff;
+    uint32 namelen;
+    uint32 bloboff;
+    uint32 bloblen;
+} EaSidecarIndex;
+
+typedef struct
+{
+    uint8 *data;
+    uint32 count;
+    const EaSidecarIndex *index;  // points into (data).
+} EaSidecar;
 
+// DosFindFirst/DosFindNext read the directory with getdents64() directly,
+//  a big batch at a time, so one syscall usually covers a whole DosFindNext
+//  buffer's worth of entries. We also get to peek at an entry without
+//  consuming it, so one that doesn't fit in the app's buffer waits for the
+//  next call instead of being dropped.
+#define DIRFINDER_BATCH_SIZE (32 * 1024)
 
 typedef struct
 {
-    pthread_mutex_t mutex;
-    pthread_cond_t condition;
-    volatile int posted;
-    volatile int waiting;
-} EventSem;
+    uint64 d_ino;
+    sint64 d_off;
+    uint16 d_reclen;
+    uint8 d_type;
+    char d_name[];
+} LinuxDirent64;
+
+// DosFindFirst compiles its pattern once into one of these. Most searches
+//  are "*", "*.*", an exact name, or a literal prefix or suffix ("FOO*",
+//  "*.OBJ"), which just need a length check and one compare; anything else
+//  goes through wildcardMatch(). The pattern is case-folded up front.
+typedef enum
+{
+    WILDCARD_ANY,
+    WILDCARD_EXACT,
+    WILDCARD_PREFIX,
+    WILDCARD_SUFFIX,
+    WILDCARD_GENERAL
+} WildcardType;
 
+typedef struct
+{
+    WildcardType type;
+    uint32 literalpos;  // EXACT, PREFIX, SUFFIX: where the literal part starts in (pattern).
+    uint32 literallen;
+    uint32 prefixlen;  // GENERAL: literal chars every match starts with...
+    uint32 suffixlen;  // ...and ends with, for a quick rejection.
+    uint32 suffixpos;
+    char pattern[CCHMAXPATHCOMP];
+} WildcardMatcher;
 
 typedef struct
 {
-    DIR *dirp;
+    int isopen;
+    int fd;
     ULONG attr;
     ULONG level;
-    char pattern[CCHMAXPATHCOMP];
+    uint8 *batch;  // getdents64() results, DIRFINDER_BATCH_SIZE bytes.
+    uint32 batchlen;
+    uint32 batchpos;  // offset of the next unconsumed entry in (batch).
+    WildcardMatcher matcher;
+    char *dirpath;  // for EA lookups, if the info level reports them.
+    EaSidecar easidecar;  // loaded once per search, not once per file.
+    int easidecarloaded;
+    int noxattrs;  // this filesystem said it doesn't do xattrs, stop asking.
+    const GEA2LIST *gea2list;  // FIL_QUERYEASFROMLIST: the EAs the current call wants, from the app's EAOP2.
 } DirFinder;
 
 static DirFinder GHDir1;
@@ -122,18 +476,6 @@ static void ungrabLock(pthread_mutex_t *lock)
     pthread_mutex_unlock(lock);
 } // ungrabLock
 
-static void timespecNowPlusMilliseconds(struct timespec *waittime, const ULONG ulTimeout)
-{
-    clock_gettime(CLOCK_REALTIME, waittime);
-    waittime->tv_sec += ulTimeout / 1000;
-    waittime->tv_nsec += (ulTimeout % 1000) * 1000000;
-    if (waittime->tv_nsec >= 1000000000) {
-        waittime->tv_sec++;
-        waittime->tv_nsec -= 1000000000;
-        assert(waittime->tv_nsec < 1000000000);
-    } // if
-} // timespecNowPlusMilliseconds
-
 static void initHFileInfoFromUnixFd(const int fd, HFileInfo *info)
 {
     struct stat statbuf;
@@ -164,8 +506,125 @@ static void initHFileInfoFromUnixFd(const int fd, HFileInfo *info)
         info->attr = 0;
         info->flags = 0;
     } // else
+    info->npipe = NULL;
+    info->fbuf = NULL;
+    info->share = 0;
 } // initHFileInfoFromUnixFd
 
+static inline HFileSlot *getHFileSlot(const HFileTable *table, const HFILE h)
+{
+    return (h < table->count) ? &table->chunks[h / HFILE_CHUNK_SIZE][h % HFILE_CHUNK_SIZE] : NULL;
+} // getHFileSlot
+
+// Lock-free snapshot of a handle's state. Returns non-zero if the handle is open.
+static int readHFile(const HFILE h, HFileInfo *info)
+{
+    const HFileTable *table = __atomic_load_n(&GHFiles, __ATOMIC_ACQUIRE);
+    HFileSlot *slot = table ? getHFileSlot(table, h) : NULL;
+    if (!slot)
+        return 0;
+
+    uint32 generation;
+    do {
+        while ((generation = __atomic_load_n(&slot->generation, __ATOMIC_ACQUIRE)) & 1)
+            sched_yield();  // a writer is in the middle of updating this slot.
+        info->fd = __atomic_load_n(&slot->info.fd, __ATOMIC_RELAXED);
+        info->type = __atomic_load_n(&slot->info.type, __ATOMIC_RELAXED);
+        info->attr = __atomic_load_n(&slot->info.attr, __ATOMIC_RELAXED);
+        info->flags = __atomic_load_n(&slot->info.flags, __ATOMIC_RELAXED);
+        info->npipe = __atomic_load_n(&slot->info.npipe, __ATOMIC_RELAXED);
+        info->fbuf = __atomic_load_n(&slot->info.fbuf, __ATOMIC_RELAXED);
+        info->share = __atomic_load_n(&slot->info.share, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while (__atomic_load_n(&slot->generation, __ATOMIC_RELAXED) != generation);
+
+    return (info->fd >= 0);
+} // readHFile
+
+static void writeHFile(HFileSlot *slot, const HFileInfo *info)
+{
+    const uint32 generation = slot->generation;
+    __atomic_store_n(&slot->generation, generation + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    __atomic_store_n(&slot->info.fd, info->fd, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->info.type, info->type, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->info.attr, info->attr, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->info.flags, info->flags, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->info.npipe, info->npipe, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->info.fbuf, info->fbuf, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->info.share, info->share, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->generation, generation + 2, __ATOMIC_RELEASE);
+} // writeHFile
+
+static void setHFileFd(HFileSlot *slot, const int fd)
+{
+    HFileInfo info;
+    initHFileInfoFromUnixFd(-1, &info);
+    info.fd = fd;
+    writeHFile(slot, &info);
+} // setHFileFd
+
+// Caller must hold GMutexDosCalls. Readers keep working during this.
+static int growHFileTable(const uint32 count)
+{
+    HFileTable *oldtable = GHFiles;
+    const uint32 oldcount = oldtable ? oldtable->count : 0;
+    if (count <= oldcount)
+        return 1;
+
+    const uint32 oldchunks = (oldcount + (HFILE_CHUNK_SIZE - 1)) / HFILE_CHUNK_SIZE;
+    const uint32 numchunks = (count + (HFILE_CHUNK_SIZE - 1)) / HFILE_CHUNK_SIZE;
+    HFileTable *table = (HFileTable *) malloc(sizeof (HFileTable) + (sizeof (HFileSlot *) * numchunks));
+    if (!table)
+        return 0;
+
+    if (oldchunks)
+        memcpy(table->chunks, oldtable->chunks, sizeof (HFileSlot *) * oldchunks);
+
+    for (uint32 i = oldchunks; i < numchunks; i++) {
+        HFileSlot *chunk = (HFileSlot *) malloc(sizeof (HFileSlot) * HFILE_CHUNK_SIZE);
+        if (!chunk) {
+            while (i-- > oldchunks)
+                free(table->chunks[i]);
+            free(table);
+            return 0;
+        } // if
+
+        for (uint32 j = 0; j < HFILE_CHUNK_SIZE; j++) {
+            chunk[j].generation = 0;
+            initHFileInfoFromUnixFd(-1, &chunk[j].info);
+        } // for
+        table->chunks[i] = chunk;
+    } // for
+
+    table->count = count;
+    table->replaced = oldtable;
+    __atomic_store_n(&GHFiles, table, __ATOMIC_RELEASE);
+    return 1;
+} // growHFileTable
+
+// Claim an unused handle, so the caller can fill it in without holding the lock.
+static HFileSlot *reserveHFile(HFILE *ph)
+{
+    if (!grabLock(&GMutexDosCalls))
+        return NULL;
+
+    HFileSlot *retval = NULL;
+    const HFileTable *table = GHFiles;
+    for (uint32 i = 0; i < table->count; i++) {
+        HFileSlot *slot = getHFileSlot(table, i);
+        if (slot->info.fd == -1) {  // available?
+            setHFileFd(slot, -2);
+            *ph = i;
+            retval = slot;
+            break;
+        } // if
+    } // for
+
+    ungrabLock(&GMutexDosCalls);
+    return retval;
+} // reserveHFile
+
 
 APIRET DosGetInfoBlocks(PTIB *pptib, PPIB *pppib)
 {
@@ -291,24 +750,394 @@ APIRET DosScanEnv(PSZ name, PSZ *outval)
 } // DosScanEnv
 
 
+// call with fbuf->lock held.
+static void flushFileBuffer(const int fd, FileBuffer *fbuf)
+{
+    uint32 done = 0;
+    while (done < fbuf->dirty) {
+        const ssize_t rc = pwrite(fd, fbuf->data + done, fbuf->dirty - done, fbuf->start + done);
+        if ((rc == -1) && (errno == EINTR))
+            continue;
+        else if (rc <= 0) {
+            fbuf->error = (rc == 0) ? ENOSPC : errno;  // report it from the next DosWrite or DosClose.
+            break;
+        } // else if
+        done += (uint32) rc;
+    } // while
+
+    fbuf->dirty = 0;  // if it failed, we drop it, like the disk would have.
+} // flushFileBuffer
+
+// call with fbuf->lock held. Puts the kernel back in charge of the file offset.
+static void syncFileBufferLocked(const int fd, FileBuffer *fbuf)
+{
+    flushFileBuffer(fd, fbuf);
+    if (fbuf->active) {
+        lseek(fd, fbuf->pos, SEEK_SET);
+        fbuf->active = 0;
+    } // if
+    fbuf->avail = 0;
+    fbuf->sequential = 0;
+} // syncFileBufferLocked
+
+static void syncFileBuffer(const int fd, FileBuffer *fbuf)
+{
+    pthread_mutex_lock(&fbuf->lock);
+    syncFileBufferLocked(fd, fbuf);
+    pthread_mutex_unlock(&fbuf->lock);
+} // syncFileBuffer
+
+// call with fbuf->lock held. Returns zero if this handle should skip the buffer.
+static int activateFileBuffer(const int fd, FileBuffer *fbuf)
+{
+    if (fbuf->disabled)
+        return 0;
+    else if (!fbuf->active) {
+        const off_t pos = lseek(fd, 0, SEEK_CUR);
+        if (pos == -1)
+            return 0;
+        fbuf->pos = pos;
+        fbuf->lastend = -1;
+        fbuf->active = 1;
+    } // else if
+    return 1;
+} // activateFileBuffer
+
+static APIRET takeFileBufferError(FileBuffer *fbuf)
+{
+    const int err = fbuf->error;
+    fbuf->error = 0;
+    if (err == 0)
+        return NO_ERROR;
+    return (err == EBADF) ? ERROR_ACCESS_DENIED : ERROR_DISK_FULL;  // !!! FIXME: map these errors.
+} // takeFileBufferError
+
+// Returns zero if the caller should do a plain read() instead.
+static int readFileBuffer(const int fd, FileBuffer *fbuf, uint8 *buf, ULONG cb, PULONG actual, APIRET *err)
+{
+    pthread_mutex_lock(&fbuf->lock);
+    if (!activateFileBuffer(fd, fbuf)) {
+        pthread_mutex_unlock(&fbuf->lock);
+        return 0;
+    } // if
+
+    flushFileBuffer(fd, fbuf);  // in case we're switching from writing to reading.
+
+    if (fbuf->pos == fbuf->lastend)
+        fbuf->sequential++;
+    else
+        fbuf->sequential = 0;
+
+    ULONG total = 0;
+    if ((fbuf->avail > 0) && (fbuf->pos >= fbuf->start) && (fbuf->pos < (fbuf->start + fbuf->avail))) {
+        const ULONG avail = (ULONG) ((fbuf->start + fbuf->avail) - fbuf->pos);
+        const ULONG cpy = (cb < avail) ? cb : avail;
+        memcpy(buf, fbuf->data + (fbuf->pos - fbuf->start), cpy);
+        fbuf->pos += cpy;
+        total = cpy;
+    } // if
+
+    *err = NO_ERROR;
+    const ULONG remaining = cb - total;
+    if (remaining > 0) {
+        // Read ahead once it looks like the app is walking through the file
+        //  (or said it would), unless the read is big enough on its own.
+        //  Otherwise, go straight into the caller's buffer.
+        const int readahead = (remaining < FILEBUFFER_SIZE) && !fbuf->random && (fbuf->sequential || fbuf->hintsequential);
+        if (readahead && !fbuf->advised) {
+            posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);  // let the kernel read ahead of us, too.
+            fbuf->advised = 1;
+        } // if
+
+        ssize_t br;
+        do {
+            br = readahead ? pread(fd, fbuf->data, FILEBUFFER_SIZE, fbuf->pos) : pread(fd, buf + total, remaining, fbuf->pos);
+        } while ((br == -1) && (errno == EINTR));
+
+        if (br == -1) {
+            if (total == 0)
+                *err = ERROR_INVALID_FUNCTION;  // !!! FIXME: ?
+        } else if (readahead) {
+            fbuf->start = fbuf->pos;
+            fbuf->avail = (uint32) br;
+            const ULONG cpy = (remaining < ((ULONG) br)) ? remaining : (ULONG) br;
+            memcpy(buf + total, fbuf->data, cpy);
+            fbuf->pos += cpy;
+            total += cpy;
+        } else {
+            fbuf->pos += br;
+            total += (ULONG) br;
+        } // else
+    } // if
+
+    fbuf->lastend = fbuf->pos;
+    pthread_mutex_unlock(&fbuf->lock);
+
+    *actual = total;
+    return 1;
+} // readFileBuffer
+
+// call with fbuf->lock held.
+static APIRET writeFileBufferLocked(const int fd, FileBuffer *fbuf, const uint8 *buf, ULONG cb, PULONG actual)
+{
+    APIRET err = takeFileBufferError(fbuf);  // an earlier coalesced write failed? Tell them now.
+    if (err != NO_ERROR)
+        return err;
+    else if (!fbuf->writable)
+        return ERROR_ACCESS_DENIED;
+
+    fbuf->avail = 0;  // read-ahead might be stale now.
+    fbuf->sequential = 0;
+
+    // only coalesce with what's already there if this picks up right where it left off.
+    if (fbuf->dirty && (((fbuf->start + fbuf->dirty) != fbuf->pos) || ((fbuf->dirty + cb) > FILEBUFFER_SIZE))) {
+        flushFileBuffer(fd, fbuf);
+        if ((err = takeFileBufferError(fbuf)) != NO_ERROR)
+            return err;
+    } // if
+
+    if (cb >= FILEBUFFER_SIZE) {  // big enough to be worth a syscall on its own.
+        ssize_t bw;
+        do {
+            bw = pwrite(fd, buf, cb, fbuf->pos);
+        } while ((bw == -1) && (errno == EINTR));
+
+        if (bw == -1)
+            return ERROR_DISK_FULL;  // !!! FIXME: map these errors.
+
+        fbuf->pos += bw;
+        *actual = (ULONG) bw;
+        return NO_ERROR;
+    } // if
+
+    if (!fbuf->dirty)
+        fbuf->start = fbuf->pos;
+    memcpy(fbuf->data + fbuf->dirty, buf, cb);
+    fbuf->dirty += cb;
+    fbuf->pos += cb;
+    *actual = cb;
+    if (fbuf->dirty == FILEBUFFER_SIZE)
+        flushFileBuffer(fd, fbuf);  // errors get reported next time.
+    return NO_ERROR;
+} // writeFileBufferLocked
+
+// Returns zero if the caller should do a plain write() instead.
+static int writeFileBuffer(const int fd, FileBuffer *fbuf, const uint8 *buf, ULONG cb, PULONG actual, APIRET *err)
+{
+    pthread_mutex_lock(&fbuf->lock);
+    const int handled = activateFileBuffer(fd, fbuf);
+    if (handled) {
+        *actual = 0;
+        *err = writeFileBufferLocked(fd, fbuf, buf, cb, actual);
+    } // if
+    pthread_mutex_unlock(&fbuf->lock);
+    return handled;
+} // writeFileBuffer
+
+static FileBuffer *createFileBuffer(const ULONG fsOpenMode)
+{
+    FileBuffer *fbuf = (FileBuffer *) calloc(1, sizeof (FileBuffer));
+    if (!fbuf)
+        return NULL;
+
+    fbuf->data = (uint8 *) malloc(FILEBUFFER_SIZE);
+    if (!fbuf->data || (pthread_mutex_init(&fbuf->lock, NULL) != 0)) {
+        free(fbuf->data);
+        free(fbuf);
+        return NULL;
+    } // if
+
+    const ULONG locality = fsOpenMode & OPEN_FLAGS_RANDOMSEQUENTIAL;
+    fbuf->writable = ((fsOpenMode & (OPEN_ACCESS_WRITEONLY | OPEN_ACCESS_READWRITE)) != 0);
+    fbuf->hintsequential = (locality == OPEN_FLAGS_SEQUENTIAL);
+    fbuf->random = (locality == OPEN_FLAGS_RANDOM);
+    return fbuf;
+} // createFileBuffer
+
+static void freeFileBuffer(FileBuffer *fbuf)
+{
+    if (fbuf) {
+        pthread_mutex_destroy(&fbuf->lock);
+        free(fbuf->data);
+        free(fbuf);
+    } // if
+} // freeFileBuffer
+
+// Anything that uses the fd directly, instead of going through DosRead or
+//  DosWrite, gets pending writes flushed and the kernel's file offset put
+//  back where the app thinks it is.
 static int getHFileUnixDescriptor(HFILE h)
 {
-    grabLock(&GMutexDosCalls);
-    const int fd = (h < MaxHFiles) ? HFiles[h].fd : -1;
-    ungrabLock(&GMutexDosCalls);
-    return fd;
+    HFileInfo info;
+    if (!readHFile(h, &info))
+        return -1;
+    else if (info.fbuf)
+        syncFileBuffer(info.fd, info.fbuf);
+    return info.fd;
 } // getHFileUnixDescriptor
 
+static APIRET checkShareLocksForIo(const HFileInfo *info, const ULONG cb, const int writing);
+
+// Does anyone but this handle have a byte-range lock on its file? Lock-free,
+//  so i/o on files nobody locked never touches the share arena's lock.
+static inline int hasForeignShareLocks(const uint32 share)
+{
+    const ShareOpen *open = &GShareArena->opens[share - 1];
+    const ShareFile *file = &GShareArena->files[open->file - 1];
+    return __atomic_load_n(&file->numlocks, __ATOMIC_ACQUIRE) > __atomic_load_n(&open->numlocks, __ATOMIC_RELAXED);
+} // hasForeignShareLocks
+
+// before fork()ing a child that inherits our fds.
+static void syncAllFileBuffers(void)
+{
+    const HFileTable *table = __atomic_load_n(&GHFiles, __ATOMIC_ACQUIRE);
+    for (uint32 i = 0; i < table->count; i++) {
+        HFileInfo info;
+        if (readHFile(i, &info) && info.fbuf)
+            syncFileBuffer(info.fd, info.fbuf);
+    } // for
+} // syncAllFileBuffers
+
+static APIRET mapNPipeErrno(const int err)
+{
+    switch (err) {
+        case EAGAIN: return ERROR_NO_DATA;
+        case ENOTCONN: return ERROR_PIPE_NOT_CONNECTED;
+        case EINVAL: return ERROR_PIPE_NOT_CONNECTED;  // i/o on the listening socket.
+        case EMSGSIZE: return ERROR_NOT_ENOUGH_MEMORY;
+        case ENOMEM: return ERROR_NOT_ENOUGH_MEMORY;
+        case ENOBUFS: return ERROR_NOT_ENOUGH_MEMORY;
+        default: return ERROR_BROKEN_PIPE;  // EPIPE, ECONNRESET, etc.
+    } // switch
+} // mapNPipeErrno
+
+// Read one byte from every page of (buf). Call this before handing an app's
+//  buffer to a syscall: if it points into a demand-paged module object that
+//  hasn't been touched yet, this faults it in, where the kernel would just
+//  fail the syscall with EFAULT.
+static void touchAppBuffer(const void *buf, const ULONG buflen)
+{
+    const volatile uint8 *ptr = (const volatile uint8 *) buf;
+    if (GLoaderState.lazy_load && ptr && buflen) {
+        for (ULONG i = 0; i < buflen; i += 4096)
+            (void) ptr[i];
+        (void) ptr[buflen - 1];
+    } // if
+} // touchAppBuffer
+
+static APIRET writeNPipe(const HFileInfo *info, const void *buf, ULONG buflen, PULONG actual)
+{
+    // every send() on a SOCK_SEQPACKET socket is one message, so there's no framing to do here.
+    const int flags = MSG_NOSIGNAL | ((info->npipe->pipemode & NP_NOWAIT) ? MSG_DONTWAIT : 0);
+    touchAppBuffer(buf, buflen);
+    const ssize_t rc = send(info->fd, buf, buflen, flags);
+    if (rc < 0) {
+        *actual = 0;
+        return mapNPipeErrno(errno);
+    } // if
+
+    *actual = (ULONG) rc;
+    return NO_ERROR;
+} // writeNPipe
+
+static APIRET readNPipe(const HFileInfo *info, void *buf, ULONG buflen, PULONG actual, const int msgread)
+{
+    NamedPipe *npipe = info->npipe;
+    const int flags = (npipe->pipemode & NP_NOWAIT) ? MSG_DONTWAIT : 0;
+    ssize_t rc;
+
+    *actual = 0;
+    touchAppBuffer(buf, buflen);
+
+    if (npipe->pending) {  // finish off a message we already pulled off the socket.
+        const ULONG avail = npipe->pendinglen - npipe->pendingpos;
+        const ULONG cpy = (buflen < avail) ? buflen : avail;
+        memcpy(buf, npipe->pending + npipe->pendingpos, cpy);
+        npipe->pendingpos += cpy;
+        *actual = cpy;
+        if (cpy < avail)
+            return msgread ? ERROR_MORE_DATA : NO_ERROR;
+        free(npipe->pending);
+        npipe->pending = NULL;
+        npipe->pendinglen = npipe->pendingpos = 0;
+        return NO_ERROR;
+    } // if
+
+    if (!(npipe->pipemode & NP_TYPE_MESSAGE)) {
+        rc = recv(info->fd, buf, buflen, flags);
+        if (rc < 0)
+            return mapNPipeErrno(errno);
+        *actual = (ULONG) rc;
+        return NO_ERROR;
+    } // if
+
+    // Reading part of a SOCK_SEQPACKET message throws the rest away, so see
+    //  how big the next one is first. If it fits, it goes straight into the
+    //  caller's buffer; otherwise, we hold on to what doesn't fit.
+    // !!! FIXME: in byte read mode, OS/2 fills the buffer across message boundaries; we return one message at a time.
+    rc = recv(info->fd, NULL, 0, flags | MSG_PEEK | MSG_TRUNC);
+    if (rc < 0)
+        return mapNPipeErrno(errno);
+    else if (((size_t) rc) <= buflen) {
+        rc = recv(info->fd, buf, buflen, flags);
+        if (rc < 0)
+            return mapNPipeErrno(errno);
+        *actual = (ULONG) rc;
+        return NO_ERROR;
+    } // else if
+
+    uint8 *msg = (uint8 *) malloc(rc);
+    if (!msg)
+        return ERROR_NOT_ENOUGH_MEMORY;
+
+    rc = recv(info->fd, msg, rc, flags);
+    if (rc < 0) {
+        free(msg);
+        return mapNPipeErrno(errno);
+    } // if
+
+    const ULONG cpy = (buflen < ((ULONG) rc)) ? buflen : (ULONG) rc;
+    memcpy(buf, msg, cpy);
+    *actual = cpy;
+    if (cpy == (ULONG) rc) {  // the message shrank?! Shouldn't happen, but whatever.
+        free(msg);
+        return NO_ERROR;
+    } // if
+
+    npipe->pending = msg;
+    npipe->pendinglen = (ULONG) rc;
+    npipe->pendingpos = cpy;
+    return msgread ? ERROR_MORE_DATA : NO_ERROR;
+} // readNPipe
+
 static APIRET DosWrite_implementation(HFILE h, PVOID buf, ULONG buflen, PULONG actual)
 {
-    const int fd = getHFileUnixDescriptor(h);
-    if (fd == -1)
+    touchAppBuffer(buf, buflen);
+
+    HFileInfo info;
+    if (!readHFile(h, &info))
         return ERROR_INVALID_HANDLE;
+    else if (info.npipe)
+        return writeNPipe(&info, buf, buflen, actual);
+
+    APIRET err = NO_ERROR;
+    if (info.share && hasForeignShareLocks(info.share)) {
+        if ((err = checkShareLocksForIo(&info, buflen, 1)) != NO_ERROR) {
+            *actual = 0;
+            return err;
+        } // if
+        info.fbuf = NULL;  // go straight to the fd while someone else has locks.
+    } // if
+
+    if (info.fbuf && writeFileBuffer(info.fd, info.fbuf, (const uint8 *) buf, buflen, actual, &err))
+        return err;
 
     // !!! FIXME: writing to a terminal should probably convert CR/LF to LF.
-    const int rc = write(fd, buf, buflen);
+    const int rc = write(info.fd, buf, buflen);
     if (rc < 0) {
         *actual = 0;
+        if (errno == EPIPE)
+            return ERROR_BROKEN_PIPE;
         return ERROR_DISK_FULL;  // !!! FIXME: map these errors.
     } // if
 
@@ -420,292 +1249,3079 @@ APIRET DosExitList(ULONG ordercode, PFNEXITLIST fn)
     return NO_ERROR;
 } // DosExitList
 
-APIRET DosCreateEventSem(PSZ name, PHEV phev, ULONG attr, BOOL32 state)
+// The pthread mutex knows who owns it, but we need to know too, for
+//  recursive requests. A mutex's owner is the kernel thread id plus a stamp
+//  that's different for every OS/2 thread, since a dead owner's id can be
+//  handed to a new thread. When a pooled pthread's OS/2 thread ends, the
+//  kernel doesn't know about it, so we release the mutexes it still owns,
+//  flagged so the next owner gets ERROR_SEM_OWNER_DIED.
+typedef struct Sem32ThreadState
+{
+    uint32 id;  // 0 until first needed.
+    uint32 stamp;
+    int pooled;  // only pooled pthreads have to track what they own.
+    uint32 numowned;
+    uint32 maxowned;
+    Sem32 **owned;
+} Sem32ThreadState;
+
+static __thread Sem32ThreadState GSem32Thread;
+
+static uint32 getSem32ThreadId(void)
+{
+    if (!GSem32Thread.id) {
+        static uint32 counter = 0;
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        GSem32Thread.id = (uint32) syscall(SYS_gettid);
+        GSem32Thread.stamp = ((uint32) ts.tv_nsec ^ (uint32) (ts.tv_sec << 20) ^ ((uint32) getpid() << 8)) + __atomic_add_fetch(&counter, 1, __ATOMIC_RELAXED);
+    } // if
+    return GSem32Thread.id;
+} // getSem32ThreadId
+
+// /proc has an entry for every live thread id, not just the ones that lead a process.
+static int isSem32ThreadAlive(const uint32 tid)
 {
-    TRACE_NATIVE("DosCreateEventSem('%s', %p, %u, %u)", name, phev, (uint) attr, (uint) state);
+    char path[32];
+    snprintf(path, sizeof (path), "/proc/%u", (uint) tid);
+    return (access(path, F_OK) == 0) || (errno != ENOENT);
+} // isSem32ThreadAlive
 
-    if (name != NULL) {
-        FIXME("implement named semaphores");
-        return ERROR_NOT_ENOUGH_MEMORY;
+static int futexWait(uint32 *addr, const uint32 val, const struct timespec *deadline, const int shared)
+{
+    // FUTEX_WAIT_BITSET takes an absolute CLOCK_MONOTONIC deadline, so retrying after EINTR doesn't extend the wait.
+    const int op = FUTEX_WAIT_BITSET | (shared ? 0 : FUTEX_PRIVATE_FLAG);
+    if (syscall(SYS_futex, addr, op, val, deadline, NULL, FUTEX_BITSET_MATCH_ANY) == -1)
+        return errno;
+    return 0;
+} // futexWait
+
+static void futexWake(uint32 *addr, const int count, const int shared)
+{
+    syscall(SYS_futex, addr, FUTEX_WAKE | (shared ? 0 : FUTEX_PRIVATE_FLAG), count, NULL, NULL, 0);
+} // futexWake
+
+static void trackSem32Mutex(Sem32 *sem)
+{
+    if (!GSem32Thread.pooled)
+        return;  // the kernel cleans up after a plain pthread when it ends.
+    else if (GSem32Thread.numowned == GSem32Thread.maxowned) {
+        const uint32 newmax = GSem32Thread.maxowned ? (GSem32Thread.maxowned * 2) : 8;
+        Sem32 **owned = (Sem32 **) realloc(GSem32Thread.owned, newmax * sizeof (Sem32 *));
+        if (!owned) {
+            FIXME("out of memory tracking owned mutexes; this one won't be released when the thread ends");
+            return;
+        } // if
+        GSem32Thread.owned = owned;
+        GSem32Thread.maxowned = newmax;
+    } // else if
+
+    GSem32Thread.owned[GSem32Thread.numowned++] = sem;
+} // trackSem32Mutex
+
+static void untrackSem32Mutex(Sem32 *sem)
+{
+    for (uint32 i = GSem32Thread.numowned; i > 0; i--) {
+        if (GSem32Thread.owned[i - 1] == sem) {
+            GSem32Thread.numowned--;
+            GSem32Thread.owned[i - 1] = GSem32Thread.owned[GSem32Thread.numowned];
+            return;
+        } // if
+    } // for
+} // untrackSem32Mutex
+
+static void sem32Deadline(struct timespec *deadline, const ULONG ms)
+{
+    clock_gettime(CLOCK_MONOTONIC, deadline);
+    deadline->tv_sec += (time_t) (ms / 1000);
+    deadline->tv_nsec += (long) ((ms % 1000) * 1000000);
+    if (deadline->tv_nsec >= 1000000000) {
+        deadline->tv_sec++;
+        deadline->tv_nsec -= 1000000000;
+    } // if
+} // sem32Deadline
+
+// Maps a per-user shared memory object that every 2ine process shares.
+//  (*created) says if we made it, in which case the caller has to initialize
+//  it; otherwise the caller waits for the creator to finish doing so.
+static void *mapSharedArena(const char *name, const char *what, const size_t size, int *created)
+{
+    *created = 1;
+    int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if ((fd == -1) && (errno == EEXIST)) {
+        *created = 0;
+        fd = shm_open(name, O_RDWR, 0600);
     } // if
 
-    if (attr & DC_SEM_SHARED) {
-        FIXME("implement shared semaphores");
+    if (fd == -1) {
+        fprintf(stderr, "2INE: couldn't open shared %s '%s': %s\n", what, name, strerror(errno));
+        return NULL;
     } // if
 
-    assert(sizeof (HEV) == sizeof (EventSem *));
-    EventSem *sem = (EventSem *) malloc(sizeof (EventSem));
-    if (sem == NULL)
-        return ERROR_NOT_ENOUGH_MEMORY;
+    if (*created) {
+        if (ftruncate(fd, size) == -1) {
+            close(fd);
+            shm_unlink(name);
+            return NULL;
+        } // if
+    } else {
+        // the creator might not have sized it yet; give it a moment.
+        struct stat statbuf;
+        for (int i = 0; (fstat(fd, &statbuf) == 0) && (statbuf.st_size == 0) && (i < 100000); i++)
+            sched_yield();
+        if (statbuf.st_size != size) {
+            fprintf(stderr, "2INE: shared %s '%s' is the wrong size. Incompatible 2ine version running?\n", what, name);
+            close(fd);
+            return NULL;
+        } // if
+    } // else
 
-    if (pthread_mutex_init(&sem->mutex, NULL) == -1) {
-        free(sem);
-        return ERROR_NOT_ENOUGH_MEMORY;
+    void *arena = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    return (arena == MAP_FAILED) ? NULL : arena;
+} // mapSharedArena
+
+static Sem32Arena *attachSem32Arena(void)
+{
+    char name[64];
+    snprintf(name, sizeof (name), "/2ine-sem32-%u", (uint) getuid());
+
+    int created = 0;
+    Sem32Arena *arena = (Sem32Arena *) mapSharedArena(name, "semaphore arena", sizeof (Sem32Arena), &created);
+    if (!arena)
+        return NULL;
+
+    GSem32Opens = (uint16 *) calloc(SEM32_ARENA_SLOTS, sizeof (uint16));
+    if (!GSem32Opens) {
+        munmap(arena, sizeof (Sem32Arena));
+        return NULL;
     } // if
 
-    if (pthread_cond_init(&sem->condition, NULL) == -1) {
-        pthread_mutex_destroy(&sem->mutex);
-        free(sem);
-        return ERROR_NOT_ENOUGH_MEMORY;
+    if (created) {
+        // robust, so a process dying while allocating a slot doesn't wedge everyone else.
+        pthread_mutexattr_t attr;
+        pthread_mutexattr_init(&attr);
+        pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+        pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+        pthread_mutex_init(&arena->lock, &attr);
+        pthread_mutexattr_destroy(&attr);
+        for (uint32 i = 0; i < SEM32_ARENA_MUXLINKS; i++) {
+            arena->muxlinks[i].next = (i + 1 < SEM32_ARENA_MUXLINKS) ? (i + 2) : 0;
+            arena->muxlinks[i].waiter = SEM32_MUXLINK_FREE;
+        } // for
+        arena->freelinks = 1;
+        __atomic_store_n(&arena->magic, SEM32_ARENA_MAGIC, __ATOMIC_RELEASE);
+    } else {
+        for (int i = 0; (__atomic_load_n(&arena->magic, __ATOMIC_ACQUIRE) != SEM32_ARENA_MAGIC) && (i < 100000); i++)
+            sched_yield();
+        if (arena->magic != SEM32_ARENA_MAGIC) {
+            fprintf(stderr, "2INE: shared semaphore arena '%s' was never initialized.\n", name);
+            free(GSem32Opens);
+            GSem32Opens = NULL;
+            munmap(arena, sizeof (Sem32Arena));
+            return NULL;
+        } // if
+    } // else
+
+    return arena;
+} // attachSem32Arena
+
+static Sem32Arena *getSem32Arena(void)
+{
+    Sem32Arena *arena = __atomic_load_n(&GSem32Arena, __ATOMIC_ACQUIRE);
+    if (!arena) {
+        grabLock(&GMutexDosCalls);
+        arena = GSem32Arena;
+        if (!arena) {
+            arena = attachSem32Arena();
+            __atomic_store_n(&GSem32Arena, arena, __ATOMIC_RELEASE);
+        } // if
+        ungrabLock(&GMutexDosCalls);
     } // if
+    return arena;
+} // getSem32Arena
 
-    sem->posted = state ? 1 : 0;
+static void lockSem32Arena(Sem32Arena *arena)
+{
+    if (pthread_mutex_lock(&arena->lock) == EOWNERDEAD)
+        pthread_mutex_consistent(&arena->lock);  // slot updates are done in an order that leaves the arena usable.
+} // lockSem32Arena
+
+static void unlockSem32Arena(Sem32Arena *arena)
+{
+    pthread_mutex_unlock(&arena->lock);
+} // unlockSem32Arena
+
+static APIRET normalizeSem32Name(const char *name, char *normalized)
+{
+    static const char prefix[] = "\\SEM32\\";
+    const size_t len = strlen(name);
+    if ((len <= (sizeof (prefix) - 1)) || (len >= CCHMAXPATH) || (strncasecmp(name, prefix, sizeof (prefix) - 1) != 0))
+        return ERROR_INVALID_NAME;
 
-    *phev = (HEV) sem;
+    for (size_t i = 0; i <= len; i++)
+        normalized[i] = toupper((unsigned char) name[i]);
 
     return NO_ERROR;
-} // DosCreateEventSem
+} // normalizeSem32Name
 
-APIRET DosCreateMutexSem(PSZ name, PHMTX phmtx, ULONG attr, BOOL32 state)
+static Sem32 *getSem32(const LHANDLE h, const uint32 kind, int *shared)
 {
-    TRACE_NATIVE("DosCreateMutexSem('%s', %p, %u, %u)", name, phmtx, (uint) attr, (uint) state);
+    Sem32 *sem = NULL;
+    if (h == 0) {
+        return NULL;
+    } else if (h & 1) {
+        const uint32 idx = h >> 1;
+        Sem32Arena *arena = getSem32Arena();
+        if (!arena || (idx >= SEM32_ARENA_SLOTS))
+            return NULL;
+        sem = &arena->slots[idx].sem;
+        *shared = 1;
+    } else {
+        sem = (Sem32 *) (size_t) h;
+        *shared = 0;
+    } // else
 
-    if (name != NULL) {
-        FIXME("implement named mutexes");
-        return ERROR_NOT_ENOUGH_MEMORY;
+    return (__atomic_load_n(&sem->kind, __ATOMIC_ACQUIRE) == kind) ? sem : NULL;
+} // getSem32
+
+// (owned) mutexes start out owned once by the calling thread.
+static void initSem32Mutex(Sem32 *sem, const int shared, const int owned)
+{
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_setpshared(&attr, shared ? PTHREAD_PROCESS_SHARED : PTHREAD_PROCESS_PRIVATE);
+    pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+    pthread_mutex_init(&sem->mutex, &attr);
+    pthread_mutexattr_destroy(&attr);
+
+    sem->ownerdied = 0;
+    sem->value = 0;
+    sem->ownerstamp = 0;
+    sem->recursion = 0;
+    if (owned) {
+        pthread_mutex_lock(&sem->mutex);  // brand new, so this can't block.
+        sem->value = getSem32ThreadId();
+        sem->ownerstamp = GSem32Thread.stamp;
+        sem->recursion = 1;
     } // if
+} // initSem32Mutex
+
+// For mutexes, (value) is nonzero to create it owned by the calling thread.
+static APIRET createSem32(PSZ name, const ULONG attr, const uint32 kind, const uint32 value, LHANDLE *ph)
+{
+    char normalized[CCHMAXPATH];
 
-    if (attr & DC_SEM_SHARED) {
-        FIXME("implement shared mutexes");
+    if (!ph || (attr & ~DC_SEM_SHARED))
+        return ERROR_INVALID_PARAMETER;
+    else if (name) {  // named semaphores are always shared.
+        const APIRET rc = normalizeSem32Name(name, normalized);
+        if (rc != NO_ERROR)
+            return rc;
+    } // else if
+
+    if (!name && !(attr & DC_SEM_SHARED)) {
+        Sem32 *sem = (Sem32 *) calloc(1, sizeof (Sem32));
+        if (!sem)
+            return ERROR_NOT_ENOUGH_MEMORY;
+        sem->opens = 1;
+        if (kind == SEM32KIND_MUTEX)
+            initSem32Mutex(sem, 0, value != 0);
+        else
+            sem->value = value;
+        sem->kind = kind;
+        *ph = (LHANDLE) (size_t) sem;
+        return NO_ERROR;
     } // if
 
-    assert(sizeof (HMTX) == sizeof (pthread_mutex_t *));
-    pthread_mutex_t *mtx = (pthread_mutex_t *) malloc(sizeof (pthread_mutex_t));
-    if (mtx == NULL)
+    Sem32Arena *arena = getSem32Arena();
+    if (!arena)
         return ERROR_NOT_ENOUGH_MEMORY;
 
-    // OS/2 mutexes are recursive.
-    pthread_mutexattr_t muxattr;
-    pthread_mutexattr_init(&muxattr);
-    pthread_mutexattr_settype(&muxattr, PTHREAD_MUTEX_RECURSIVE);
-    pthread_mutexattr_setrobust(&muxattr, PTHREAD_MUTEX_ROBUST);
+    APIRET retval = NO_ERROR;
+    Sem32Slot *avail = NULL;
+
+    lockSem32Arena(arena);
+    for (uint32 i = 0; i < SEM32_ARENA_SLOTS; i++) {
+        Sem32Slot *slot = &arena->slots[i];
+        if (slot->sem.kind == SEM32KIND_FREE) {
+            if (!avail)
+                avail = slot;
+            if (!name)
+                break;
+        } else if (name && (strcmp(slot->name, normalized) == 0)) {
+            retval = ERROR_DUPLICATE_NAME;
+            break;
+        } // else if
+    } // for
 
-    const int rc = pthread_mutex_init(mtx, &muxattr);
-    pthread_mutexattr_destroy(&muxattr);
+    if ((retval == NO_ERROR) && !avail)
+        retval = ERROR_TOO_MANY_SEMAPHORES;
 
-    if (rc == -1) {
-        free(mtx);
-        return ERROR_NOT_ENOUGH_MEMORY;
+    if (retval == NO_ERROR) {
+        const uint32 idx = (uint32) (avail - arena->slots);
+        strcpy(avail->name, name ? normalized : "");
+        avail->sem.opens = 1;
+        avail->sem.waiters = 0;
+        if (kind == SEM32KIND_MUTEX)
+            initSem32Mutex(&avail->sem, 1, value != 0);
+        else {
+            avail->sem.value = value;
+            avail->sem.recursion = 0;
+        } // else
+        __atomic_store_n(&avail->sem.kind, kind, __ATOMIC_RELEASE);
+        GSem32Opens[idx]++;
+        *ph = (LHANDLE) ((idx << 1) | 1);
     } // if
+    unlockSem32Arena(arena);
 
-    if (state)
-        pthread_mutex_lock(mtx);
+    return retval;
+} // createSem32
 
-    *phmtx = (HMTX) mtx;
+static APIRET openSem32(PSZ name, const uint32 kind, LHANDLE *ph)
+{
+    if (!ph)
+        return ERROR_INVALID_PARAMETER;
 
-    return NO_ERROR;
-} // DosCreateMutexSem
+    if (!name) {  // open by handle.
+        int shared = 0;
+        Sem32 *sem = getSem32(*ph, kind, &shared);
+        if (!sem)
+            return ERROR_INVALID_HANDLE;
+        else if (!shared) {
+            grabLock(&GMutexDosCalls);
+            const APIRET retval = (sem->opens >= SEM32_MAX_COUNT) ? ERROR_TOO_MANY_OPENS : NO_ERROR;
+            if (retval == NO_ERROR)
+                sem->opens++;
+            ungrabLock(&GMutexDosCalls);
+            return retval;
+        } // else if
+    } // if
 
-// !!! FIXME: this is obviously not correct.
-APIRET DosSetExceptionHandler(PEXCEPTIONREGISTRATIONRECORD rec)
-{
-    TRACE_NATIVE("DosSetExceptionHandler(%p)", rec);
-    return NO_ERROR;
-} // DosSetExceptionHandler
+    char normalized[CCHMAXPATH];
+    if (name) {
+        const APIRET rc = normalizeSem32Name(name, normalized);
+        if (rc != NO_ERROR)
+            return rc;
+    } // if
 
-// !!! FIXME: this is obviously not correct.
+    Sem32Arena *arena = getSem32Arena();
+    if (!arena)
+        return ERROR_NOT_ENOUGH_MEMORY;
+
+    APIRET retval = ERROR_SEM_NOT_FOUND;
+    lockSem32Arena(arena);
+    for (uint32 i = 0; i < SEM32_ARENA_SLOTS; i++) {
+        Sem32Slot *slot = &arena->slots[i];
+        if (name ? (strcmp(slot->name, normalized) != 0) : (*ph != ((i << 1) | 1)))
+            continue;
+        else if (slot->sem.kind != kind)
+            retval = ERROR_INVALID_HANDLE;
+        else if ((slot->sem.opens >= SEM32_MAX_COUNT) || (GSem32Opens[i] >= SEM32_MAX_COUNT))
+            retval = ERROR_TOO_MANY_OPENS;
+        else {
+            slot->sem.opens++;
+            GSem32Opens[i]++;
+            *ph = (LHANDLE) ((i << 1) | 1);
+            retval = NO_ERROR;
+        } // else
+        break;
+    } // for
+    unlockSem32Arena(arena);
+
+    return retval;
+} // openSem32
+
+static int isSem32Busy(const Sem32 *sem)
+{
+    if (__atomic_load_n(&sem->muxlinks, __ATOMIC_SEQ_CST) != 0)
+        return 1;  // a muxwait is blocked on it.
+    else if (sem->kind != SEM32KIND_MUTEX)
+        return (__atomic_load_n(&sem->waiters, __ATOMIC_SEQ_CST) != 0);
+    return (__atomic_load_n(&sem->value, __ATOMIC_SEQ_CST) != 0);  // mutexes can't be closed while owned.
+} // isSem32Busy
+
+static void reapDeadMuxWaiters(Sem32Arena *arena);
+
+static APIRET closeSem32(const LHANDLE h, const uint32 kind)
+{
+    int shared = 0;
+    Sem32 *sem = getSem32(h, kind, &shared);
+    if (!sem)
+        return ERROR_INVALID_HANDLE;
+
+    APIRET retval = NO_ERROR;
+
+    if (!shared) {
+        int destroy = 0;
+        grabLock(&GMutexDosCalls);
+        if ((sem->opens == 1) && isSem32Busy(sem))
+            retval = ERROR_SEM_BUSY;
+        else if (--sem->opens == 0) {
+            sem->kind = SEM32KIND_FREE;
+            destroy = 1;
+        } // else if
+        ungrabLock(&GMutexDosCalls);
+        if (destroy) {
+            if (kind == SEM32KIND_MUTEX)
+                pthread_mutex_destroy(&sem->mutex);
+            free(sem);
+        } // if
+        return retval;
+    } // if
+
+    Sem32Arena *arena = GSem32Arena;
+    const uint32 idx = h >> 1;
+    Sem32Slot *slot = &arena->slots[idx];
+    lockSem32Arena(arena);
+    if ((GSem32Opens[idx] != 0) && (sem->opens == 1) && (sem->muxlinks != 0))
+        reapDeadMuxWaiters(arena);  // might only be linked to a muxwait whose process died.
+
+    if (GSem32Opens[idx] == 0)
+        retval = ERROR_INVALID_HANDLE;  // this process never opened it.
+    else if ((sem->opens == 1) && isSem32Busy(sem))
+        retval = ERROR_SEM_BUSY;
+    else {
+        GSem32Opens[idx]--;
+        if (--sem->opens == 0) {
+            slot->name[0] = '\0';
+            __atomic_store_n(&sem->kind, SEM32KIND_FREE, __ATOMIC_RELEASE);
+        } // if
+    } // else
+    unlockSem32Arena(arena);
+
+    return retval;
+} // closeSem32
+
+static void notifyMuxWaiters(Sem32 *sem);
+
+static APIRET postEventSem32(Sem32 *sem, const int shared)
+{
+    uint32 count = __atomic_load_n(&sem->value, __ATOMIC_SEQ_CST);
+    do {
+        if (count >= SEM32_MAX_COUNT)
+            return ERROR_TOO_MANY_POSTS;
+    } while (!__atomic_compare_exchange_n(&sem->value, &count, count + 1, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST));
+
+    if (count != 0)
+        return ERROR_ALREADY_POSTED;  // OS/2 bumps the post count anyhow.
+
+    // waiters bump their count before checking the post count, so this can't miss anyone.
+    if (__atomic_load_n(&sem->waiters, __ATOMIC_SEQ_CST) != 0)
+        futexWake(&sem->value, INT_MAX, shared);
+    if (__atomic_load_n(&sem->muxlinks, __ATOMIC_SEQ_CST) != 0)
+        notifyMuxWaiters(sem);
+
+    return NO_ERROR;
+} // postEventSem32
+
+static APIRET waitEventSem32(Sem32 *sem, const ULONG ulTimeout, const int shared)
+{
+    if (__atomic_load_n(&sem->value, __ATOMIC_SEQ_CST) != 0)
+        return NO_ERROR;
+    else if (ulTimeout == SEM_IMMEDIATE_RETURN)
+        return ERROR_TIMEOUT;
+
+    struct timespec deadline;
+    const int timed = (ulTimeout != SEM_INDEFINITE_WAIT);
+    if (timed)
+        sem32Deadline(&deadline, ulTimeout);
+
+    APIRET retval = NO_ERROR;
+    __atomic_add_fetch(&sem->waiters, 1, __ATOMIC_SEQ_CST);
+    while (__atomic_load_n(&sem->value, __ATOMIC_SEQ_CST) == 0) {
+        if (futexWait(&sem->value, 0, timed ? &deadline : NULL, shared) == ETIMEDOUT) {
+            if (__atomic_load_n(&sem->value, __ATOMIC_SEQ_CST) == 0)
+                retval = ERROR_TIMEOUT;
+            break;
+        } // if
+    } // while
+    __atomic_sub_fetch(&sem->waiters, 1, __ATOMIC_SEQ_CST);
+
+    return retval;
+} // waitEventSem32
+
+// we just got (sem)'s pthread mutex; (rc) is what locking it returned.
+static APIRET tookMutexSem32(Sem32 *sem, const int rc, const uint32 tid)
+{
+    APIRET retval = NO_ERROR;
+    if (rc == EOWNERDEAD) {  // the owner's thread ended without releasing it; the kernel noticed.
+        pthread_mutex_consistent(&sem->mutex);
+        retval = ERROR_SEM_OWNER_DIED;
+    } else if (sem->ownerdied) {  // the owner's OS/2 thread ended; abandonSem32Mutexes() noticed.
+        retval = ERROR_SEM_OWNER_DIED;
+    } // else if
+
+    sem->ownerdied = 0;
+    sem->recursion = 1;
+    sem->ownerstamp = GSem32Thread.stamp;
+    __atomic_store_n(&sem->value, tid, __ATOMIC_RELEASE);
+    trackSem32Mutex(sem);
+    return retval;
+} // tookMutexSem32
+
+// (tid) is getSem32ThreadId().
+static int ownsMutexSem32(const Sem32 *sem, const uint32 tid)
+{
+    // only the owner stores its id and stamp, so if they're both ours, we own it.
+    return (__atomic_load_n(&sem->value, __ATOMIC_ACQUIRE) == tid) &&
+           (__atomic_load_n(&sem->ownerstamp, __ATOMIC_ACQUIRE) == GSem32Thread.stamp);
+} // ownsMutexSem32
+
+static APIRET requestMutexSem32(Sem32 *sem, const ULONG ulTimeout)
+{
+    const uint32 tid = getSem32ThreadId();
+    if (ownsMutexSem32(sem, tid)) {
+        if (sem->recursion >= SEM32_MAX_COUNT)
+            return ERROR_TOO_MANY_SEM_REQUESTS;
+        sem->recursion++;
+        return NO_ERROR;
+    } // if
+
+    int rc;
+    if (ulTimeout == SEM_IMMEDIATE_RETURN)
+        rc = pthread_mutex_trylock(&sem->mutex);  // this reports a dead owner, too.
+    else if (ulTimeout == SEM_INDEFINITE_WAIT)
+        rc = pthread_mutex_lock(&sem->mutex);
+    else {
+        struct timespec deadline;
+        sem32Deadline(&deadline, ulTimeout);
+        rc = pthread_mutex_clocklock(&sem->mutex, CLOCK_MONOTONIC, &deadline);
+    } // else
+
+    switch (rc) {
+        case 0:
+        case EOWNERDEAD:
+            return tookMutexSem32(sem, rc, tid);
+        case EBUSY:
+        case ETIMEDOUT:
+            return ERROR_TIMEOUT;
+        default: break;
+    } // switch
+
+    return ERROR_INVALID_HANDLE;  // shouldn't hit this.
+} // requestMutexSem32
+
+// drop our last claim on (sem); (ownerdied) if our OS/2 thread is going away without releasing it.
+static void unlockMutexSem32(Sem32 *sem, const int ownerdied)
+{
+    sem->recursion = 0;
+    sem->ownerdied = ownerdied;
+    sem->ownerstamp = 0;
+    __atomic_store_n(&sem->value, 0, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&sem->mutex);
+    if (__atomic_load_n(&sem->muxlinks, __ATOMIC_SEQ_CST) != 0)
+        notifyMuxWaiters(sem);
+} // unlockMutexSem32
+
+static APIRET releaseMutexSem32(Sem32 *sem)
+{
+    if (!ownsMutexSem32(sem, getSem32ThreadId()))
+        return ERROR_NOT_OWNER;
+    else if (--sem->recursion > 0)
+        return NO_ERROR;
+
+    untrackSem32Mutex(sem);
+    unlockMutexSem32(sem, 0);
+    return NO_ERROR;
+} // releaseMutexSem32
+
+// a pooled pthread's OS/2 thread ended; don't let the next one inherit its mutexes or its id.
+static void abandonSem32Mutexes(void)
+{
+    const uint32 tid = getSem32ThreadId();
+    for (uint32 i = 0; i < GSem32Thread.numowned; i++) {
+        Sem32 *sem = GSem32Thread.owned[i];
+        if (ownsMutexSem32(sem, tid))  // shouldn't fail, but don't touch it if it's not ours.
+            unlockMutexSem32(sem, 1);
+    } // for
+
+    GSem32Thread.numowned = 0;
+    GSem32Thread.id = 0;  // the next OS/2 thread gets a new stamp.
+} // abandonSem32Mutexes
+
+static void freeSem32ThreadState(void)
+{
+    free(GSem32Thread.owned);
+    memset(&GSem32Thread, '\0', sizeof (GSem32Thread));
+} // freeSem32ThreadState
+
+APIRET DosCreateEventSem(PSZ name, PHEV phev, ULONG attr, BOOL32 state)
+{
+    TRACE_NATIVE("DosCreateEventSem('%s', %p, %u, %u)", name, phev, (uint) attr, (uint) state);
+    return createSem32(name, attr, SEM32KIND_EVENT, state ? 1 : 0, phev);
+} // DosCreateEventSem
+
+APIRET DosOpenEventSem(PSZ name, PHEV phev)
+{
+    TRACE_NATIVE("DosOpenEventSem('%s', %p)", name, phev);
+    return openSem32(name, SEM32KIND_EVENT, phev);
+} // DosOpenEventSem
+
+APIRET DosCreateMutexSem(PSZ name, PHMTX phmtx, ULONG attr, BOOL32 state)
+{
+    TRACE_NATIVE("DosCreateMutexSem('%s', %p, %u, %u)", name, phmtx, (uint) attr, (uint) state);
+    // OS/2 mutexes are recursive; if created owned, it's owned once by this thread.
+    const APIRET rc = createSem32(name, attr, SEM32KIND_MUTEX, state ? 1 : 0, phmtx);
+    if ((rc == NO_ERROR) && state) {
+        int shared = 0;
+        trackSem32Mutex(getSem32(*phmtx, SEM32KIND_MUTEX, &shared));
+    } // if
+    return rc;
+} // DosCreateMutexSem
+
+APIRET DosOpenMutexSem(PSZ name, PHMTX phmtx)
+{
+    TRACE_NATIVE("DosOpenMutexSem('%s', %p)", name, phmtx);
+    return openSem32(name, SEM32KIND_MUTEX, phmtx);
+} // DosOpenMutexSem
+
+// Muxwait semaphores. A waiting thread takes a MuxWaiter from the shared
+//  arena and links it into every member semaphore once. Posting an event or
+//  releasing a mutex that has links sets that member's bit in each linked
+//  waiter and wakes it through the waiter's own futex word, so the waiter
+//  only rechecks the members that actually changed. The waiter and link
+//  records live in the arena so members shared with other processes can
+//  reach them.
+// !!! FIXME: muxwait semaphores themselves are process-private for now.
+typedef struct MuxSem32
+{
+    Sem32 sem;  // must be first. sem.waiters counts threads in DosWaitMuxWaitSem.
+    ULONG flags;  // DCMW_WAIT_ANY or DCMW_WAIT_ALL
+    uint32 memberkind;  // SEM32KIND_EVENT or SEM32KIND_MUTEX, SEM32KIND_FREE while empty.
+    ULONG count;
+    SEMRECORD records[DCMW_MAX_SEMRECORDS];
+} MuxSem32;
+
+#define MUXBIT_WORDS (DCMW_MAX_SEMRECORDS / 32)
+
+// caller holds the arena lock.
+static void freeMuxLink(Sem32Arena *arena, const uint32 l)
+{
+    MuxLink *link = &arena->muxlinks[l - 1];
+    link->waiter = SEM32_MUXLINK_FREE;
+    link->next = arena->freelinks;
+    arena->freelinks = l;
+} // freeMuxLink
+
+// A process that dies in DosWaitMuxWaitSem leaves its waiter and links in
+//  the arena, which keeps its shared members busy and makes every post on
+//  them take the arena lock. Caller holds the arena lock.
+static void reapDeadMuxWaiters(Sem32Arena *arena)
+{
+    const uint32 mypid = (uint32) getpid();
+    int dead[SEM32_ARENA_MUXWAITERS];
+    int found = 0;
+    for (uint32 w = 0; w < SEM32_ARENA_MUXWAITERS; w++) {
+        const MuxWaiter *waiter = &arena->muxwaiters[w];
+        dead[w] = waiter->inuse && (waiter->pid != mypid) && !isSem32ThreadAlive(waiter->pid);
+        found |= dead[w];
+    } // for
+
+    if (!found)
+        return;
+
+    // unhook the dead waiters from every shared semaphore...
+    for (uint32 i = 0; i < SEM32_ARENA_SLOTS; i++) {
+        uint32 *prev = &arena->slots[i].sem.muxlinks;
+        while (*prev != 0) {
+            const MuxLink *link = &arena->muxlinks[*prev - 1];
+            if (dead[link->waiter])
+                __atomic_store_n(prev, link->next, __ATOMIC_SEQ_CST);
+            else
+                prev = &arena->muxlinks[*prev - 1].next;
+        } // while
+    } // for
+
+    // ...then take back all their links, including ones that hung off the dead process's private semaphores.
+    for (uint32 l = 1; l <= SEM32_ARENA_MUXLINKS; l++) {
+        const uint32 w = arena->muxlinks[l - 1].waiter;
+        if ((w != SEM32_MUXLINK_FREE) && dead[w])
+            freeMuxLink(arena, l);
+    } // for
+
+    for (uint32 w = 0; w < SEM32_ARENA_MUXWAITERS; w++) {
+        if (dead[w])
+            arena->muxwaiters[w].inuse = 0;
+    } // for
+} // reapDeadMuxWaiters
+
+static void notifyMuxWaiters(Sem32 *sem)
+{
+    Sem32Arena *arena = GSem32Arena;  // must exist, or nothing could have linked to this semaphore.
+    int stale = 0;
+    lockSem32Arena(arena);
+    for (uint32 l = sem->muxlinks; l != 0; l = arena->muxlinks[l - 1].next) {
+        const MuxLink *link = &arena->muxlinks[l - 1];
+        MuxWaiter *waiter = &arena->muxwaiters[link->waiter];
+        const uint32 bit = 1u << (link->member % 32);
+        if (__atomic_fetch_or(&waiter->ready[link->member / 32], bit, __ATOMIC_SEQ_CST) & bit)
+            stale = 1;  // the last post was never picked up; maybe nobody is waiting anymore.
+        __atomic_add_fetch(&waiter->seq, 1, __ATOMIC_SEQ_CST);
+        futexWake(&waiter->seq, INT_MAX, 1);
+    } // for
+    if (stale)
+        reapDeadMuxWaiters(arena);
+    unlockSem32Arena(arena);
+} // notifyMuxWaiters
+
+// caller holds the arena lock.
+static void unlinkMuxWaiter(Sem32Arena *arena, Sem32 **members, const ULONG count, const uint32 waiterid)
+{
+    for (ULONG i = 0; i < count; i++) {
+        uint32 *prev = &members[i]->muxlinks;
+        while (*prev != 0) {
+            const uint32 l = *prev;
+            MuxLink *link = &arena->muxlinks[l - 1];
+            if (link->waiter == waiterid) {
+                __atomic_store_n(prev, link->next, __ATOMIC_SEQ_CST);
+                freeMuxLink(arena, l);
+                break;
+            } // if
+            prev = &link->next;
+        } // while
+    } // for
+} // unlinkMuxWaiter
+
+static MuxWaiter *registerMuxWaiter(Sem32 **members, const ULONG count, uint32 *pwaiterid, APIRET *err)
+{
+    Sem32Arena *arena = getSem32Arena();
+    if (!arena) {
+        *err = ERROR_NOT_ENOUGH_MEMORY;
+        return NULL;
+    } // if
+
+    MuxWaiter *retval = NULL;
+    *err = ERROR_TOO_MANY_MUXWAITERS;
+
+    lockSem32Arena(arena);
+    for (uint32 w = 0, reaped = 0; w < SEM32_ARENA_MUXWAITERS; w++) {
+        MuxWaiter *waiter = &arena->muxwaiters[w];
+        if ((w == SEM32_ARENA_MUXWAITERS - 1) && waiter->inuse && !reaped) {
+            reapDeadMuxWaiters(arena);  // out of waiters; see if a dead process left some behind.
+            reaped = 1;
+            w = (uint32) -1;
+            continue;
+        } else if (waiter->inuse) {
+            continue;
+        } // else if
+
+        ULONG i;
+        for (i = 0; i < count; i++) {
+            const uint32 l = arena->freelinks;
+            if (l == 0)
+                break;
+            MuxLink *link = &arena->muxlinks[l - 1];
+            arena->freelinks = link->next;
+            link->next = members[i]->muxlinks;
+            link->waiter = w;
+            link->member = (uint32) i;
+            __atomic_store_n(&members[i]->muxlinks, l, __ATOMIC_SEQ_CST);
+        } // for
+
+        if (i < count) {  // out of links; back out.
+            unlinkMuxWaiter(arena, members, i, w);
+            if (reaped)
+                break;
+            reapDeadMuxWaiters(arena);  // see if a dead process left some behind.
+            reaped = 1;
+            w--;
+            continue;
+        } // if
+
+        waiter->inuse = 1;
+        waiter->pid = (uint32) getpid();
+        waiter->seq = 0;
+        memset(waiter->ready, '\0', sizeof (waiter->ready));
+        *pwaiterid = w;
+        *err = NO_ERROR;
+        retval = waiter;
+        break;
+    } // for
+    unlockSem32Arena(arena);
+
+    return retval;
+} // registerMuxWaiter
+
+static void unregisterMuxWaiter(Sem32 **members, const ULONG count, const uint32 waiterid)
+{
+    Sem32Arena *arena = GSem32Arena;
+    lockSem32Arena(arena);
+    unlinkMuxWaiter(arena, members, count, waiterid);
+    arena->muxwaiters[waiterid].inuse = 0;
+    unlockSem32Arena(arena);
+} // unregisterMuxWaiter
+
+static inline int anyMuxBits(const uint32 *bits)
+{
+    for (int i = 0; i < MUXBIT_WORDS; i++) {
+        if (bits[i])
+            return 1;
+    } // for
+    return 0;
+} // anyMuxBits
+
+static inline int nextMuxBit(uint32 *bits)
+{
+    for (int i = 0; i < MUXBIT_WORDS; i++) {
+        if (bits[i]) {
+            const int bit = __builtin_ctz(bits[i]);
+            bits[i] &= ~(1u << bit);
+            return (i * 32) + bit;
+        } // if
+    } // for
+    return -1;
+} // nextMuxBit
+
+// Check the members flagged in (pending). Returns ERROR_TIMEOUT if the muxwait isn't satisfied yet.
+//  For DCMW_WAIT_ALL on mutexes, (*blocker) is the member that kept us from getting all of them.
+static APIRET pollMuxSem32(Sem32 **members, const int *shared, const SEMRECORD *records, const ULONG count, const ULONG flags,
+                           const uint32 kind, uint32 *pending, uint32 *posted, int *blocker, PULONG pulUser)
+{
+    int i;
+
+    if (flags & DCMW_WAIT_ANY) {
+        while ((i = nextMuxBit(pending)) >= 0) {
+            APIRET rc = NO_ERROR;
+            if (kind == SEM32KIND_EVENT)
+                rc = __atomic_load_n(&members[i]->value, __ATOMIC_SEQ_CST) ? NO_ERROR : ERROR_TIMEOUT;
+            else
+                rc = requestMutexSem32(members[i], SEM_IMMEDIATE_RETURN);
+
+            if (rc != ERROR_TIMEOUT) {
+                if ((rc == NO_ERROR) || (rc == ERROR_SEM_OWNER_DIED))
+                    *pulUser = records[i].ulUser;
+                return rc;
+            } // if
+        } // while
+        return ERROR_TIMEOUT;
+    } // if
+
+    if (kind == SEM32KIND_EVENT) {
+        // remember which events we've seen posted, so a wakeup only rechecks the ones that changed.
+        while ((i = nextMuxBit(pending)) >= 0) {
+            if (__atomic_load_n(&members[i]->value, __ATOMIC_SEQ_CST))
+                posted[i / 32] |= 1u << (i % 32);
+            else
+                posted[i / 32] &= ~(1u << (i % 32));
+        } // while
+
+        for (i = 0; i < (int) count; i++) {
+            if ((posted[i / 32] & (1u << (i % 32))) == 0)
+                return ERROR_TIMEOUT;
+        } // for
+
+        // resets don't notify us, so make sure they're really all still posted.
+        for (i = 0; i < (int) count; i++) {
+            if (!__atomic_load_n(&members[i]->value, __ATOMIC_SEQ_CST)) {
+                posted[i / 32] &= ~(1u << (i % 32));
+                return ERROR_TIMEOUT;
+            } // if
+        } // for
+
+        *pulUser = records[count - 1].ulUser;
+        return NO_ERROR;
+    } // if
+
+    // DCMW_WAIT_ALL on mutexes: we have to own all of them at once, so grab
+    //  them in order and back out if one is taken.
+    if (nextMuxBit(pending) < 0)
+        return ERROR_TIMEOUT;
+    memset(pending, '\0', sizeof (uint32) * MUXBIT_WORDS);
+
+    APIRET retval = NO_ERROR;
+    for (i = 0; i < (int) count; i++) {
+        const APIRET rc = requestMutexSem32(members[i], SEM_IMMEDIATE_RETURN);
+        if (rc == ERROR_SEM_OWNER_DIED) {
+            retval = rc;
+        } else if (rc != NO_ERROR) {
+            *blocker = i;
+            while (i--)
+                releaseMutexSem32(members[i]);
+            return rc;
+        } // else if
+    } // for
+
+    *pulUser = records[count - 1].ulUser;
+    return retval;
+} // pollMuxSem32
+
+static APIRET waitMuxSem32(MuxSem32 *mux, const ULONG ulTimeout, PULONG pulUser)
+{
+    SEMRECORD records[DCMW_MAX_SEMRECORDS];
+    Sem32 *members[DCMW_MAX_SEMRECORDS];
+    int shared[DCMW_MAX_SEMRECORDS];
+
+    grabLock(&GMutexDosCalls);
+    const ULONG count = mux->count;
+    const ULONG flags = mux->flags;
+    const uint32 kind = mux->memberkind;
+    memcpy(records, mux->records, sizeof (SEMRECORD) * count);
+    ungrabLock(&GMutexDosCalls);
+
+    if (count == 0)
+        return ERROR_EMPTY_MUXWAIT;
+
+    for (ULONG i = 0; i < count; i++) {
+        members[i] = getSem32(records[i].hsemCur, kind, &shared[i]);
+        if (!members[i])
+            return ERROR_INVALID_HANDLE;
+    } // for
+
+    uint32 pending[MUXBIT_WORDS];
+    uint32 posted[MUXBIT_WORDS];
+    memset(pending, '\0', sizeof (pending));
+    memset(posted, '\0', sizeof (posted));
+    for (ULONG i = 0; i < count; i++)
+        pending[i / 32] |= 1u << (i % 32);
+
+    struct timespec deadline;
+    const int timed = (ulTimeout != SEM_INDEFINITE_WAIT);
+    if (timed)
+        sem32Deadline(&deadline, ulTimeout);
+
+    MuxWaiter *waiter = NULL;
+    uint32 waiterid = 0;
+    APIRET retval = NO_ERROR;
+
+    __atomic_add_fetch(&mux->sem.waiters, 1, __ATOMIC_SEQ_CST);
+
+    while (1) {
+        uint32 seq = 0;
+        if (waiter) {
+            seq = __atomic_load_n(&waiter->seq, __ATOMIC_SEQ_CST);
+            for (int i = 0; i < MUXBIT_WORDS; i++)
+                pending[i] |= __atomic_exchange_n(&waiter->ready[i], 0, __ATOMIC_SEQ_CST);
+        } // if
+
+        int blocker = -1;
+        retval = pollMuxSem32(members, shared, records, count, flags, kind, pending, posted, &blocker, pulUser);
+        if ((retval != ERROR_TIMEOUT) || (ulTimeout == SEM_IMMEDIATE_RETURN))
+            break;
+
+        if (!waiter) {
+            // not ready; hook into every member, then look at all of them again in case something changed meanwhile.
+            waiter = registerMuxWaiter(members, count, &waiterid, &retval);
+            if (!waiter)
+                break;
+            for (ULONG i = 0; i < count; i++)
+                pending[i / 32] |= 1u << (i % 32);
+            continue;
+        } // if
+
+        if (blocker >= 0) {
+            // we just released the mutexes we got; only the one that blocked us matters now.
+            for (int i = 0; i < MUXBIT_WORDS; i++)
+                __atomic_and_fetch(&waiter->ready[i], (i == (blocker / 32)) ? (1u << (blocker % 32)) : 0, __ATOMIC_SEQ_CST);
+        } else if (anyMuxBits(pending)) {
+            continue;
+        } // else if
+
+        if (futexWait(&waiter->seq, seq, timed ? &deadline : NULL, 1) == ETIMEDOUT) {
+            retval = ERROR_TIMEOUT;
+            break;
+        } // if
+    } // while
+
+    if (waiter)
+        unregisterMuxWaiter(members, count, waiterid);
+
+    __atomic_sub_fetch(&mux->sem.waiters, 1, __ATOMIC_SEQ_CST);
+
+    return retval;
+} // waitMuxSem32
+
+static Sem32 *getMuxMember(const HSEM hsem, uint32 *kind)
+{
+    int shared = 0;
+    Sem32 *sem = getSem32(hsem, SEM32KIND_EVENT, &shared);
+    if (sem) {
+        *kind = SEM32KIND_EVENT;
+    } else if ((sem = getSem32(hsem, SEM32KIND_MUTEX, &shared)) != NULL) {
+        *kind = SEM32KIND_MUTEX;
+    } // else if
+    return sem;
+} // getMuxMember
+
+// caller holds GMutexDosCalls.
+static APIRET addMuxMember(MuxSem32 *mux, const SEMRECORD *rec, const uint32 kind)
+{
+    if ((mux->memberkind != SEM32KIND_FREE) && (mux->memberkind != kind))
+        return ERROR_WRONG_TYPE;
+    else if (mux->count >= DCMW_MAX_SEMRECORDS)
+        return ERROR_TOO_MANY_SEMAPHORES;
+
+    for (ULONG i = 0; i < mux->count; i++) {
+        if (mux->records[i].hsemCur == rec->hsemCur)
+            return ERROR_DUPLICATE_HANDLE;
+    } // for
+
+    mux->records[mux->count++] = *rec;
+    mux->memberkind = kind;
+    return NO_ERROR;
+} // addMuxMember
+
+APIRET DosCreateMuxWaitSem(PSZ pszName, PHMUX phmux, ULONG cSemRec, PSEMRECORD pSemRec, ULONG flAttr)
+{
+    TRACE_NATIVE("DosCreateMuxWaitSem('%s', %p, %u, %p, %u)", pszName, phmux, (uint) cSemRec, pSemRec, (uint) flAttr);
+
+    const ULONG waitflags = flAttr & (DCMW_WAIT_ANY | DCMW_WAIT_ALL);
+    if (!phmux || (flAttr & ~(DC_SEM_SHARED | DCMW_WAIT_ANY | DCMW_WAIT_ALL)))
+        return ERROR_INVALID_PARAMETER;
+    else if ((waitflags != DCMW_WAIT_ANY) && (waitflags != DCMW_WAIT_ALL))
+        return ERROR_INVALID_PARAMETER;
+    else if (cSemRec > DCMW_MAX_SEMRECORDS)
+        return ERROR_TOO_MANY_SEMAPHORES;
+    else if (cSemRec && !pSemRec)
+        return ERROR_INVALID_PARAMETER;
+    else if (pszName || (flAttr & DC_SEM_SHARED)) {
+        FIXME("implement shared and named muxwait semaphores");
+        return ERROR_NOT_SUPPORTED;
+    } // else if
+
+    uint32 kinds[DCMW_MAX_SEMRECORDS];
+    for (ULONG i = 0; i < cSemRec; i++) {
+        if (!getMuxMember(pSemRec[i].hsemCur, &kinds[i]))
+            return ERROR_INVALID_HANDLE;
+    } // for
+
+    MuxSem32 *mux = (MuxSem32 *) calloc(1, sizeof (MuxSem32));
+    if (!mux)
+        return ERROR_NOT_ENOUGH_MEMORY;
+
+    mux->flags = waitflags;
+    mux->memberkind = SEM32KIND_FREE;
+    for (ULONG i = 0; i < cSemRec; i++) {
+        const APIRET rc = addMuxMember(mux, &pSemRec[i], kinds[i]);  // (mux isn't visible to anyone else yet.)
+        if (rc != NO_ERROR) {
+            free(mux);
+            return rc;
+        } // if
+    } // for
+
+    mux->sem.opens = 1;
+    mux->sem.kind = SEM32KIND_MUXWAIT;
+    *phmux = (HMUX) (size_t) mux;
+    return NO_ERROR;
+} // DosCreateMuxWaitSem
+
+APIRET DosOpenMuxWaitSem(PSZ pszName, PHMUX phmux)
+{
+    TRACE_NATIVE("DosOpenMuxWaitSem('%s', %p)", pszName, phmux);
+    return openSem32(pszName, SEM32KIND_MUXWAIT, phmux);
+} // DosOpenMuxWaitSem
+
+APIRET DosCloseMuxWaitSem(HMUX hmux)
+{
+    TRACE_NATIVE("DosCloseMuxWaitSem(%u)", (uint) hmux);
+    return closeSem32(hmux, SEM32KIND_MUXWAIT);
+} // DosCloseMuxWaitSem
+
+APIRET DosWaitMuxWaitSem(HMUX hmux, ULONG ulTimeout, PULONG pulUser)
+{
+    TRACE_NATIVE("DosWaitMuxWaitSem(%u, %u, %p)", (uint) hmux, (uint) ulTimeout, pulUser);
+
+    int shared = 0;
+    MuxSem32 *mux = (MuxSem32 *) getSem32(hmux, SEM32KIND_MUXWAIT, &shared);
+    if (!mux)
+        return ERROR_INVALID_HANDLE;
+
+    ULONG user = 0;
+    const APIRET retval = waitMuxSem32(mux, ulTimeout, &user);
+    if (pulUser)
+        *pulUser = user;
+    return retval;
+} // DosWaitMuxWaitSem
+
+APIRET DosAddMuxWaitSem(HMUX hmux, PSEMRECORD pSemRec)
+{
+    TRACE_NATIVE("DosAddMuxWaitSem(%u, %p)", (uint) hmux, pSemRec);
+
+    int shared = 0;
+    MuxSem32 *mux = (MuxSem32 *) getSem32(hmux, SEM32KIND_MUXWAIT, &shared);
+    uint32 kind = 0;
+    if (!mux || !pSemRec || !getMuxMember(pSemRec->hsemCur, &kind))
+        return ERROR_INVALID_HANDLE;
+
+    grabLock(&GMutexDosCalls);
+    const APIRET retval = addMuxMember(mux, pSemRec, kind);
+    ungrabLock(&GMutexDosCalls);
+    return retval;
+} // DosAddMuxWaitSem
+
+APIRET DosDeleteMuxWaitSem(HMUX hmux, HSEM hSem)
+{
+    TRACE_NATIVE("DosDeleteMuxWaitSem(%u, %u)", (uint) hmux, (uint) hSem);
+
+    int shared = 0;
+    MuxSem32 *mux = (MuxSem32 *) getSem32(hmux, SEM32KIND_MUXWAIT, &shared);
+    if (!mux)
+        return ERROR_INVALID_HANDLE;
+
+    APIRET retval = ERROR_INVALID_HANDLE;
+    grabLock(&GMutexDosCalls);
+    for (ULONG i = 0; i < mux->count; i++) {
+        if (mux->records[i].hsemCur == hSem) {
+            mux->count--;
+            memmove(&mux->records[i], &mux->records[i + 1], sizeof (SEMRECORD) * (mux->count - i));
+            if (mux->count == 0)
+                mux->memberkind = SEM32KIND_FREE;
+            retval = NO_ERROR;
+            break;
+        } // if
+    } // for
+    ungrabLock(&GMutexDosCalls);
+
+    return retval;
+} // DosDeleteMuxWaitSem
+
+APIRET DosQueryMuxWaitSem(HMUX hmux, PULONG pcSemRec, PSEMRECORD pSemRec, PULONG pflAttr)
+{
+    TRACE_NATIVE("DosQueryMuxWaitSem(%u, %p, %p, %p)", (uint) hmux, pcSemRec, pSemRec, pflAttr);
+
+    int shared = 0;
+    MuxSem32 *mux = (MuxSem32 *) getSem32(hmux, SEM32KIND_MUXWAIT, &shared);
+    if (!mux)
+        return ERROR_INVALID_HANDLE;
+    else if (!pcSemRec)
+        return ERROR_INVALID_PARAMETER;
+
+    APIRET retval = NO_ERROR;
+    grabLock(&GMutexDosCalls);
+    if (*pcSemRec < mux->count)
+        retval = ERROR_PARAM_TOO_SMALL;
+    else if (mux->count && !pSemRec)
+        retval = ERROR_INVALID_PARAMETER;
+    else {
+        memcpy(pSemRec, mux->records, sizeof (SEMRECORD) * mux->count);
+        if (pflAttr)
+            *pflAttr = mux->flags;
+    } // else
+    *pcSemRec = mux->count;
+    ungrabLock(&GMutexDosCalls);
+
+    return retval;
+} // DosQueryMuxWaitSem
+
+// !!! FIXME: this is obviously not correct.
+APIRET DosSetExceptionHandler(PEXCEPTIONREGISTRATIONRECORD rec)
+{
+    TRACE_NATIVE("DosSetExceptionHandler(%p)", rec);
+    return NO_ERROR;
+} // DosSetExceptionHandler
+
+// !!! FIXME: this is obviously not correct.
 APIRET DosUnsetExceptionHandler(PEXCEPTIONREGISTRATIONRECORD rec)
 {
-    TRACE_NATIVE("DosUnsetExceptionHandler(%p)", rec);
+    TRACE_NATIVE("DosUnsetExceptionHandler(%p)", rec);
+    return NO_ERROR;
+} // DosSetExceptionHandler
+
+#if !LX_LEGACY
+ULONG DosFlatToSel(VOID) { return 0; }
+#else
+ULONG _DosFlatToSel(PVOID ptr)
+{
+    TRACE_NATIVE("DosFlatToSel(%p)", ptr);
+    return GLoaderState.convert32to1616(ptr);
+} // _DosFlatToSel
+
+// DosFlatToSel() passes its argument in %eax, so a little asm to bridge that...
+// Note that this isn't syscall calling conventions at all; CSet/2 generates
+//  thunking code that expects this function to preserve %ecx, so we'll just
+//  go ahead and save a bunch of stuff, just in case.
+__asm__ (
+    ".globl DosFlatToSel  \n\t"
+    ".type	DosFlatToSel, @function \n\t"
+    "DosFlatToSel:  \n\t"
+    "    pushl %ebx  \n\t"  // save off a bunch of stuff. Better safe than sorry.
+    "    pushl %ecx  \n\t"
+    "    pushl %edx  \n\t"
+    "    pushl %edi  \n\t"
+    "    pushl %esi  \n\t"
+    "    pushl %eax  \n\t"  // the actual argument to DosFlatToSel.
+    "    call _DosFlatToSel  \n\t"
+    "    addl $4, %esp  \n\t"  // clear argument to DosFlatToSel.
+    "    popl %esi  \n\t"
+    "    popl %edi  \n\t"
+    "    popl %edx  \n\t"  // save off a bunch of stuff.
+    "    popl %ecx  \n\t"
+    "    popl %ebx  \n\t"
+    "    ret  \n\t"
+	".size	_DosFlatToSel, .-_DosFlatToSel  \n\t"
+);
+#endif
+
+APIRET DosSetSignalExceptionFocus(BOOL32 flag, PULONG pulTimes)
+{
+    TRACE_NATIVE("DosSetSignalExceptionFocus(%u, %p)", (uint) flag, pulTimes);
+
+    if (flag == 0) {
+        if (GLoaderState.main_module->signal_exception_focus_count == 0)
+            return ERROR_ALREADY_RESET;
+        GLoaderState.main_module->signal_exception_focus_count--;
+    } else if (flag == 1) {
+        if (GLoaderState.main_module->signal_exception_focus_count == 0xFFFFFFFF)
+            return ERROR_NESTING_TOO_DEEP;
+        GLoaderState.main_module->signal_exception_focus_count++;
+    } else {
+        // !!! FIXME: does OS/2 do something if flag != 0 or 1?
+    } // else
+
+    if (pulTimes)
+        *pulTimes = GLoaderState.main_module->signal_exception_focus_count;
+
+    // !!! FIXME: I guess enable/disable SIGINT handler here?
+
+    return NO_ERROR;
+} // DosSetSignalExceptionFocus
+
+APIRET DosSetRelMaxFH(PLONG pincr, PULONG pcurrent)
+{
+    TRACE_NATIVE("DosSetRelMaxFH(%p, %p)", pincr, pcurrent);
+
+    #if 0
+    struct rlimit rlim;
+    int rc = getrlimit(RLIMIT_NOFILE, &rlim);
+    assert(rc == 0);  // this shouldn't fail...right?
+    if (pcurrent)
+        *pcurrent = (ULONG) rlim.rlim_cur;
+
+    if (pincr) {
+        rlim.rlim_cur = (rlim_t) (((LONG) rlim.rlim_cur) + *pincr);
+        if (setrlimit(RLIMIT_NOFILE, &rlim) == 0) {
+            if (pcurrent)
+                *pcurrent = (ULONG) rlim.rlim_cur;
+        } // if
+    } // if
+    #endif
+
+    if (pincr != NULL) {
+        const LONG incr = *pincr;
+        // OS/2 API docs say reductions in file handles are advisory, so we
+        //  ignore them outright. Fight me.
+        if (incr > 0) {
+            grabLock(&GMutexDosCalls);
+            growHFileTable(GHFiles->count + incr);
+            ungrabLock(&GMutexDosCalls);
+        } // if
+    } // if
+
+    if (pcurrent != NULL)
+        *pcurrent = __atomic_load_n(&GHFiles, __ATOMIC_ACQUIRE)->count;
+
+    return NO_ERROR;  // always returns NO_ERROR even if it fails.
+} // DosSetRelMaxFH
+
+
+#define MEMOBJ_PAGESIZE 4096
+#define MEMOBJ_ALIGNMENT 0x10000
+#define MEMOBJ_TILED_LIMIT (512 * 1024 * 1024)
+
+#ifndef MAP_FIXED_NOREPLACE
+#define MAP_FIXED_NOREPLACE 0x100000
+#endif
+
+static int memObjectProtection(const ULONG flags)
+{
+    // x86 can't have write-only or execute-only pages, so these all imply read.
+    int prot = 0;
+    if (flags & (PAG_READ | PAG_WRITE | PAG_EXECUTE)) prot |= PROT_READ;
+    if (flags & PAG_WRITE) prot |= PROT_WRITE;
+    if (flags & PAG_EXECUTE) prot |= PROT_EXEC;
+    if (flags & PAG_GUARD)
+        FIXME("PAG_GUARD pages should raise a guard page exception on first touch");
+    return prot;
+} // memObjectProtection
+
+// Reserve (len) bytes at exactly (addr), or fail without disturbing anything there.
+static uint8 *reserveMemObjectAt(const uintptr_t addr, const size_t len)
+{
+    if ((addr + len) > MEMOBJ_TILED_LIMIT)
+        return NULL;
+
+    void *ptr = mmap((void *) addr, len, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED_NOREPLACE, -1, 0);
+    if (ptr == MAP_FAILED)
+        return NULL;
+    else if (ptr != (void *) addr) {  // older kernels treat MAP_FIXED_NOREPLACE as a hint.
+        munmap(ptr, len);
+        return NULL;
+    } // else if
+    return (uint8 *) ptr;
+} // reserveMemObjectAt
+
+// Find a 64k-aligned spot for a new object under 512 megabytes, so 16-bit
+//  code can tile it. Caller holds GMutexMemObjects.
+static uint8 *reserveTiledMemObject(const size_t len)
+{
+    // the spot right after the last object almost always works. Start well
+    //  above where .exe files and lx_loader's 16-bit segments usually live.
+    static uintptr_t hint = 256 * 1024 * 1024;
+    uint8 *retval = reserveMemObjectAt(hint, len);
+
+    if (!retval) {  // look for a hole in the address space, lowest first.
+        FILE *maps = fopen("/proc/self/maps", "r");
+        if (maps) {
+            uintptr_t prevend = MEMOBJ_ALIGNMENT;  // never hand out the first 64k.
+            char line[512];
+            while (!retval && (prevend < MEMOBJ_TILED_LIMIT) && fgets(line, sizeof (line), maps)) {
+                unsigned long start = 0, end = 0;
+                if (sscanf(line, "%lx-%lx", &start, &end) != 2)
+                    continue;
+                const uintptr_t gap = (prevend + (MEMOBJ_ALIGNMENT - 1)) & ~((uintptr_t) (MEMOBJ_ALIGNMENT - 1));
+                if ((gap < start) && ((start - gap) >= len))
+                    retval = reserveMemObjectAt(gap, len);
+                if (end > prevend)
+                    prevend = (uintptr_t) end;
+            } // while
+
+            if (!retval && (prevend < MEMOBJ_TILED_LIMIT)) {  // the space after the last mapping.
+                const uintptr_t gap = (prevend + (MEMOBJ_ALIGNMENT - 1)) & ~((uintptr_t) (MEMOBJ_ALIGNMENT - 1));
+                retval = reserveMemObjectAt(gap, len);
+            } // if
+            fclose(maps);
+        } // if
+    } // if
+
+    if (retval)
+        hint = (((uintptr_t) retval) + len + (MEMOBJ_ALIGNMENT - 1)) & ~((uintptr_t) (MEMOBJ_ALIGNMENT - 1));
+
+    return retval;
+} // reserveTiledMemObject
+
+// Reserve anywhere at all, but still on a 64k boundary.
+static uint8 *reserveAnyMemObject(const size_t len)
+{
+    const size_t padded = len + MEMOBJ_ALIGNMENT;
+    uint8 *ptr = (uint8 *) mmap(NULL, padded, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (ptr == MAP_FAILED)
+        return NULL;
+
+    uint8 *retval = (uint8 *) ((((uintptr_t) ptr) + (MEMOBJ_ALIGNMENT - 1)) & ~((uintptr_t) (MEMOBJ_ALIGNMENT - 1)));
+    if (retval > ptr)
+        munmap(ptr, (size_t) (retval - ptr));
+    munmap(retval + len, (size_t) ((ptr + padded) - (retval + len)));
+    return retval;
+} // reserveAnyMemObject
+
+// Caller holds GMutexMemObjects.
+static MemObject *findMemObject(const void *ptr)
+{
+    const uint8 *addr = (const uint8 *) ptr;
+    uint32 lo = 0;
+    uint32 hi = GNumMemObjects;
+    while (lo < hi) {
+        const uint32 mid = lo + ((hi - lo) / 2);
+        MemObject *obj = &GMemObjects[mid];
+        if (addr < obj->addr)
+            hi = mid;
+        else if (addr >= (obj->addr + (obj->numpages * MEMOBJ_PAGESIZE)))
+            lo = mid + 1;
+        else
+            return obj;
+    } // while
+    return NULL;
+} // findMemObject
+
+static APIRET DosAllocMem_implementation(PPVOID ppb, ULONG cb, ULONG flag)
+{
+    const ULONG access = flag & (PAG_READ | PAG_WRITE | PAG_EXECUTE | PAG_GUARD);
+
+    if (!ppb || (cb == 0))
+        return ERROR_INVALID_PARAMETER;
+    else if ((access & (PAG_READ | PAG_WRITE | PAG_EXECUTE)) == 0)
+        return ERROR_INVALID_PARAMETER;  // have to ask for _some_ kind of access.
+
+    const uint32 numpages = (uint32) ((((uint64) cb) + (MEMOBJ_PAGESIZE - 1)) / MEMOBJ_PAGESIZE);
+    const size_t len = ((size_t) numpages) * MEMOBJ_PAGESIZE;
+    uint8 *pages = (uint8 *) malloc(numpages);
+    if (!pages)
+        return ERROR_NOT_ENOUGH_MEMORY;
+
+    APIRET retval = NO_ERROR;
+    grabLock(&GMutexMemObjects);
+
+    // we put everything in tiled memory if we can, OBJ_TILE or not, since
+    //  16-bit code might end up touching it anyhow.
+    uint8 *addr = NULL;
+    if (GNumMemObjects == GMaxMemObjects) {
+        const uint32 newmax = GMaxMemObjects ? (GMaxMemObjects * 2) : 64;
+        void *ptr = realloc(GMemObjects, sizeof (MemObject) * newmax);
+        if (!ptr)
+            retval = ERROR_NOT_ENOUGH_MEMORY;
+        else {
+            GMemObjects = (MemObject *) ptr;
+            GMaxMemObjects = newmax;
+        } // else
+    } // if
+
+    if (retval == NO_ERROR) {
+        addr = reserveTiledMemObject(len);
+        if (!addr && (flag & OBJ_ANY))
+            addr = reserveAnyMemObject(len);
+        if (!addr)
+            retval = ERROR_NOT_ENOUGH_MEMORY;
+    } // if
+
+    if ((retval == NO_ERROR) && (flag & PAG_COMMIT)) {
+        if (mprotect(addr, len, memObjectProtection(access)) == -1) {
+            munmap(addr, len);
+            retval = ERROR_NOT_ENOUGH_MEMORY;
+        } // if
+    } // if
+
+    if (retval == NO_ERROR) {
+        memset(pages, (int) (access | (flag & PAG_COMMIT)), numpages);
+
+        uint32 idx = 0;
+        while ((idx < GNumMemObjects) && (GMemObjects[idx].addr < addr))
+            idx++;
+        memmove(&GMemObjects[idx + 1], &GMemObjects[idx], sizeof (MemObject) * (GNumMemObjects - idx));
+        GMemObjects[idx].addr = addr;
+        GMemObjects[idx].numpages = numpages;
+        GMemObjects[idx].flags = access;
+        GMemObjects[idx].pages = pages;
+        GNumMemObjects++;
+        *ppb = addr;
+    } // if
+
+    ungrabLock(&GMutexMemObjects);
+
+    if (retval != NO_ERROR)
+        free(pages);
+
+    return retval;
+} // DosAllocMem_implementation
+
+APIRET DosAllocMem(PPVOID ppb, ULONG cb, ULONG flag)
+{
+    TRACE_NATIVE("DosAllocMem(%p, %u, %u)", ppb, (uint) cb, (uint) flag);
+    return DosAllocMem_implementation(ppb, cb, flag);
+} // DosAllocMem
+
+
+static APIRET DosQueryHType_implementation(HFILE hFile, PULONG pType, PULONG pAttr)
+{
+    HFileInfo info;
+    if (!readHFile(hFile, &info))
+        return ERROR_INVALID_HANDLE;
+
+    // OS/2 will dereference a NULL pointer here, but I can't do it...!!!
+    if (pType) *pType = info.type;
+    if (pAttr) *pAttr = info.attr;
+    return NO_ERROR;
+} // DosQueryHType_implementation
+
+APIRET DosQueryHType(HFILE hFile, PULONG pType, PULONG pAttr)
+{
+    TRACE_NATIVE("DosQueryHType(%u, %p, %p)", (uint) hFile, pType, pAttr);
+    return DosQueryHType_implementation(hFile, pType, pAttr);
+} // DosQueryHType
+
+static APIRET DosSetMem_implementation(PVOID pb, ULONG cb, ULONG flag)
+{
+    const int commit = (flag & PAG_COMMIT) ? 1 : 0;
+    const int decommit = (flag & PAG_DECOMMIT) ? 1 : 0;
+    APIRET retval = NO_ERROR;
+
+    if ((cb == 0) || (commit && decommit))
+        return ERROR_INVALID_PARAMETER;
+
+    grabLock(&GMutexMemObjects);
+
+    MemObject *obj = findMemObject(pb);
+    if (!obj) {
+        ungrabLock(&GMutexMemObjects);
+        return ERROR_INVALID_ADDRESS;
+    } // if
+
+    const uint32 first = (uint32) ((((uint8 *) pb) - obj->addr) / MEMOBJ_PAGESIZE);
+    const uint64 last = ((uint64) ((((uint8 *) pb) - obj->addr) + (cb - 1))) / MEMOBJ_PAGESIZE;
+    ULONG access = flag & (PAG_READ | PAG_WRITE | PAG_EXECUTE | PAG_GUARD);
+    if (flag & PAG_DEFAULT)
+        access = obj->flags;
+
+    if (last >= obj->numpages) {
+        retval = ERROR_INVALID_ADDRESS;  // runs off the end of the object.
+    } else if (!decommit && !(access & (PAG_READ | PAG_WRITE | PAG_EXECUTE))) {
+        retval = ERROR_INVALID_PARAMETER;
+    } else {
+        // committing needs every page reserved; everything else needs every page committed.
+        for (uint32 i = first; i <= (uint32) last; i++) {
+            if (((obj->pages[i] & PAG_COMMIT) ? 1 : 0) == commit) {
+                retval = ERROR_ACCESS_DENIED;
+                break;
+            } // if
+        } // for
+    } // else
+
+    if (retval == NO_ERROR) {
+        uint8 *addr = obj->addr + (((size_t) first) * MEMOBJ_PAGESIZE);
+        const size_t len = ((size_t) (((uint32) last) - first) + 1) * MEMOBJ_PAGESIZE;
+        uint8 newstate;
+        if (decommit) {
+            // drop the pages entirely; they're zero-filled if recommitted.
+            madvise(addr, len, MADV_DONTNEED);
+            if (mprotect(addr, len, PROT_NONE) == -1)
+                retval = ERROR_ACCESS_DENIED;
+            newstate = (uint8) obj->flags;
+        } else {
+            if (mprotect(addr, len, memObjectProtection(access)) == -1)
+                retval = ERROR_NOT_ENOUGH_MEMORY;
+            newstate = (uint8) (access | PAG_COMMIT);
+        } // else
+
+        if (retval == NO_ERROR)
+            memset(obj->pages + first, newstate, len / MEMOBJ_PAGESIZE);
+    } // if
+
+    ungrabLock(&GMutexMemObjects);
+    return retval;
+} // DosSetMem_implementation
+
+APIRET DosSetMem(PVOID pb, ULONG cb, ULONG flag)
+{
+    TRACE_NATIVE("DosSetMem(%p, %u, %u)", pb, (uint) cb, (uint) flag);
+    return DosSetMem_implementation(pb, cb, flag);
+} // DosSetMem
+
+// DosSub*Mem pools keep all their bookkeeping inside the caller's memory
+//  block, since the pool can be shared between processes. The header lives
+//  at pbBase, followed by the blocks. Freed blocks of up to 256 bytes go on
+//  exact-size free lists so the common small alloc/free is a list push/pop;
+//  bigger ones go on an address-sorted list that coalesces neighbors.
+//  Everything is stored as offsets from pbBase, never as pointers.
+#define SUBHEAP_MAGIC 0x42555332  // '2SUB'
+#define SUBHEAP_GRANULARITY 8
+#define SUBHEAP_NUM_CLASSES 32
+#define SUBHEAP_MAX_SMALL (SUBHEAP_NUM_CLASSES * SUBHEAP_GRANULARITY)
+
+typedef struct SubHeap
+{
+    uint32 magic;
+    uint32 flags;  // DOSSUB_*
+    uint32 size;  // total pool size, header included.
+    uint32 top;  // offset of the never-allocated space at the end of the pool.
+    uint32 committed;  // for DOSSUB_SPARSE_OBJ: offset we've committed pages up to.
+    volatile uint32 lock;  // only used with DOSSUB_SERIALIZE.
+    uint32 large;  // first free block bigger than SUBHEAP_MAX_SMALL (or a small one, after coalescing), 0 if none.
+    uint32 classes[SUBHEAP_NUM_CLASSES];  // first free block of each small size, 0 if none.
+} SubHeap;
+
+typedef struct SubHeapBlock
+{
+    uint32 next;
+    uint32 size;
+} SubHeapBlock;
+
+#define SUBHEAP_HEADER_SIZE ((uint32) ((sizeof (SubHeap) + (SUBHEAP_GRANULARITY - 1)) & ~(SUBHEAP_GRANULARITY - 1)))
+#define SUBHEAP_BLOCK(heap, off) ((SubHeapBlock *) (((uint8 *) (heap)) + (off)))
+
+// Blocks on the small free lists don't need their size field, so we put
+//  this (xor'd with the block's offset) there instead. Freeing a block that
+//  has it is probably a double free, so only then do we walk the free lists
+//  to be sure; app data that happens to match just costs us that walk.
+#define SUBHEAP_FREE_MARK 0x45455246  // 'FREE'
+
+static inline uint32 subHeapRoundSize(const ULONG cb)
+{
+    return (uint32) ((cb + (SUBHEAP_GRANULARITY - 1)) & ~(SUBHEAP_GRANULARITY - 1));
+} // subHeapRoundSize
+
+static SubHeap *getSubHeap(PVOID pbBase)
+{
+    SubHeap *heap = (SubHeap *) pbBase;
+    if (!heap || (heap->magic != SUBHEAP_MAGIC))
+        return NULL;
+    return heap;
+} // getSubHeap
+
+static inline void lockSubHeap(SubHeap *heap)
+{
+    if (heap->flags & DOSSUB_SERIALIZE) {
+        // these critical sections are a few dozen instructions, so spin instead of a kernel object.
+        while (__sync_lock_test_and_set(&heap->lock, 1)) {
+            while (heap->lock)
+                sched_yield();
+        } // while
+    } // if
+} // lockSubHeap
+
+static inline void unlockSubHeap(SubHeap *heap)
+{
+    if (heap->flags & DOSSUB_SERIALIZE)
+        __sync_lock_release(&heap->lock);
+} // unlockSubHeap
+
+// Make sure [base, base+cb) is inside one DosAllocMem object and, unless
+//  this is a sparse pool (we commit those pages as we go), committed.
+static int isSubHeapRangeUsable(const uint8 *base, const uint32 cb, const int sparse)
+{
+    const uintptr_t firstpage = ((uintptr_t) base) & ~((uintptr_t) (MEMOBJ_PAGESIZE - 1));
+    const uintptr_t end = ((uintptr_t) base) + cb;
+    int retval = 1;
+
+    grabLock(&GMutexMemObjects);
+    const MemObject *obj = findMemObject(base);
+    if (obj) {
+        const uintptr_t objend = ((uintptr_t) obj->addr) + (((uintptr_t) obj->numpages) * MEMOBJ_PAGESIZE);
+        if ((end < (uintptr_t) base) || (end > objend)) {
+            retval = 0;
+        } else if (!sparse) {
+            for (uintptr_t page = firstpage; retval && (page < end); page += MEMOBJ_PAGESIZE)
+                retval = ((obj->pages[(page - ((uintptr_t) obj->addr)) / MEMOBJ_PAGESIZE] & PAG_COMMIT) != 0);
+        } // else if
+    } // if
+    ungrabLock(&GMutexMemObjects);
+
+    if (!obj) {
+        // !!! FIXME: we don't track memory we didn't allocate here (module
+        // !!! FIXME:  objects, etc), so all we can check is that it's mapped.
+        for (uintptr_t page = firstpage; retval && (page < end); page += MEMOBJ_PAGESIZE)
+            retval = (madvise((void *) page, MEMOBJ_PAGESIZE, MADV_NORMAL) == 0);
+    } // if
+
+    return retval;
+} // isSubHeapRangeUsable
+
+// Make sure pages are committed in [start, end) of a sparse pool.
+static int commitSubHeapPages(uint8 *start, uint8 *end)
+{
+    uint8 *page = (uint8 *) (((uintptr_t) start) & ~((uintptr_t) (MEMOBJ_PAGESIZE - 1)));
+    for (; page < end; page += MEMOBJ_PAGESIZE) {
+        const APIRET rc = DosSetMem_implementation(page, MEMOBJ_PAGESIZE, PAG_COMMIT | PAG_DEFAULT);
+        // ACCESS_DENIED means it was already committed, INVALID_ADDRESS means it's not from DosAllocMem at all.
+        if ((rc != NO_ERROR) && (rc != ERROR_ACCESS_DENIED) && (rc != ERROR_INVALID_ADDRESS))
+            return 0;
+    } // for
+    return 1;
+} // commitSubHeapPages
+
+// Put a block on the address-sorted list, merging it with its neighbors,
+//  or give it back to the unallocated space if it sits right below top.
+static APIRET insertSubHeapLarge(SubHeap *heap, uint32 off, uint32 size)
+{
+    uint32 prev = 0;
+    uint32 next = heap->large;
+    while (next && (next < off)) {
+        prev = next;
+        next = SUBHEAP_BLOCK(heap, next)->next;
+    } // while
+
+    if (next && ((off + size) > next))
+        return ERROR_DOSSUB_OVERLAP;
+    else if (prev && ((prev + SUBHEAP_BLOCK(heap, prev)->size) > off))
+        return ERROR_DOSSUB_OVERLAP;
+
+    if (prev && ((prev + SUBHEAP_BLOCK(heap, prev)->size) == off)) {
+        off = prev;   // merge into the previous block.
+        size += SUBHEAP_BLOCK(heap, prev)->size;
+    } else {
+        SubHeapBlock *blk = SUBHEAP_BLOCK(heap, off);
+        blk->next = next;
+        blk->size = size;
+        if (prev)
+            SUBHEAP_BLOCK(heap, prev)->next = off;
+        else
+            heap->large = off;
+    } // else
+
+    if (next && ((off + size) == next)) {  // merge the following block, too.
+        size += SUBHEAP_BLOCK(heap, next)->size;
+        next = SUBHEAP_BLOCK(heap, next)->next;
+        SUBHEAP_BLOCK(heap, off)->next = next;
+    } // if
+
+    SUBHEAP_BLOCK(heap, off)->size = size;
+
+    if ((off + size) == heap->top) {  // last block of the pool? Drop it back to the unallocated space.
+        uint32 before = 0;
+        for (uint32 i = heap->large; i != off; i = SUBHEAP_BLOCK(heap, i)->next)
+            before = i;
+        if (before)
+            SUBHEAP_BLOCK(heap, before)->next = 0;
+        else
+            heap->large = 0;
+        heap->top = off;
+    } // if
+
+    return NO_ERROR;
+} // insertSubHeapLarge
+
+// Move every small free block onto the large list so neighbors can merge.
+static int coalesceSubHeap(SubHeap *heap)
+{
+    int moved = 0;
+    for (uint32 i = 0; i < SUBHEAP_NUM_CLASSES; i++) {
+        uint32 off = heap->classes[i];
+        heap->classes[i] = 0;
+        while (off) {
+            const uint32 next = SUBHEAP_BLOCK(heap, off)->next;
+            insertSubHeapLarge(heap, off, (i + 1) * SUBHEAP_GRANULARITY);
+            off = next;
+            moved = 1;
+        } // while
+    } // for
+    return moved;
+} // coalesceSubHeap
+
+// first fit, carving the allocation off the end of the free block so the list links don't change.
+static uint32 allocSubHeapLarge(SubHeap *heap, const uint32 size)
+{
+    uint32 prev = 0;
+    for (uint32 off = heap->large; off; off = SUBHEAP_BLOCK(heap, off)->next) {
+        SubHeapBlock *blk = SUBHEAP_BLOCK(heap, off);
+        if (blk->size == size) {
+            if (prev)
+                SUBHEAP_BLOCK(heap, prev)->next = blk->next;
+            else
+                heap->large = blk->next;
+            return off;
+        } else if (blk->size > size) {
+            blk->size -= size;
+            return off + blk->size;
+        } // else if
+        prev = off;
+    } // for
+    return 0;
+} // allocSubHeapLarge
+
+static uint32 allocSubHeap(SubHeap *heap, const uint32 size)
+{
+    uint32 off;
+
+    if (size <= SUBHEAP_MAX_SMALL) {
+        uint32 *list = &heap->classes[(size / SUBHEAP_GRANULARITY) - 1];
+        if (*list) {
+            off = *list;
+            *list = SUBHEAP_BLOCK(heap, off)->next;
+            SUBHEAP_BLOCK(heap, off)->size = 0;  // clear SUBHEAP_FREE_MARK.
+            return off;
+        } // if
+    } // if
+
+    if ((off = allocSubHeapLarge(heap, size)) != 0)
+        return off;
+
+    if (size <= (heap->size - heap->top)) {
+        off = heap->top;
+        if ((heap->flags & DOSSUB_SPARSE_OBJ) && ((off + size) > heap->committed)) {
+            uint8 *base = (uint8 *) heap;
+            if (!commitSubHeapPages(base + heap->committed, base + off + size))
+                return 0;
+            heap->committed = off + size;
+        } // if
+        heap->top += size;
+        return off;
+    } // if
+
+    // out of space; merge up the free lists and try once more.
+    if (coalesceSubHeap(heap))
+        return allocSubHeap(heap, size);
+
+    return 0;
+} // allocSubHeap
+
+APIRET DosSubSetMem(PVOID pbBase, ULONG flag, ULONG cb)
+{
+    TRACE_NATIVE("DosSubSetMem(%p, %u, %u)", pbBase, (uint) flag, (uint) cb);
+
+    if (flag & ~(DOSSUB_INIT | DOSSUB_GROW | DOSSUB_SPARSE_OBJ | DOSSUB_SERIALIZE))
+        return ERROR_DOSSUB_BADFLAG;
+    else if ((flag & DOSSUB_INIT) && (flag & DOSSUB_GROW))
+        return ERROR_DOSSUB_BADFLAG;
+    else if (pbBase == NULL)
+        return ERROR_INVALID_PARAMETER;
+
+    cb &= ~(SUBHEAP_GRANULARITY - 1);
+
+    if (flag & DOSSUB_GROW) {
+        SubHeap *heap = getSubHeap(pbBase);
+        if (!heap)
+            return ERROR_DOSSUB_CORRUPTED;
+        APIRET retval = NO_ERROR;
+        lockSubHeap(heap);
+        if (cb < heap->size)
+            retval = ERROR_DOSSUB_SHRINK;
+        else if (!isSubHeapRangeUsable((const uint8 *) pbBase, cb, (heap->flags & DOSSUB_SPARSE_OBJ) != 0))
+            retval = ERROR_DOSSUB_BADSIZE;  // bigger than the memory object, or not committed.
+        else
+            heap->size = cb;
+        unlockSubHeap(heap);
+        return retval;
+    } // if
+
+    if (cb < (SUBHEAP_HEADER_SIZE + SUBHEAP_GRANULARITY))
+        return ERROR_DOSSUB_BADSIZE;
+    else if (!isSubHeapRangeUsable((const uint8 *) pbBase, cb, (flag & DOSSUB_SPARSE_OBJ) != 0))
+        return ERROR_DOSSUB_BADSIZE;
+
+    if (flag & DOSSUB_SPARSE_OBJ) {
+        if (!commitSubHeapPages((uint8 *) pbBase, ((uint8 *) pbBase) + SUBHEAP_HEADER_SIZE))
+            return ERROR_DOSSUB_NOMEM;
+    } // if
+
+    if (!(flag & DOSSUB_INIT)) {
+        // the memory was already set up as a pool (by another process, presumably); just attach to it.
+        return getSubHeap(pbBase) ? NO_ERROR : ERROR_DOSSUB_CORRUPTED;
+    } // if
+
+    SubHeap *heap = (SubHeap *) pbBase;
+    memset(heap, '\0', sizeof (*heap));
+    heap->flags = (uint32) flag & (DOSSUB_SPARSE_OBJ | DOSSUB_SERIALIZE);
+    heap->size = cb;
+    heap->top = SUBHEAP_HEADER_SIZE;
+    heap->committed = (flag & DOSSUB_SPARSE_OBJ) ? SUBHEAP_HEADER_SIZE : cb;
+    heap->magic = SUBHEAP_MAGIC;
     return NO_ERROR;
-} // DosSetExceptionHandler
+} // DosSubSetMem
 
-#if !LX_LEGACY
-ULONG DosFlatToSel(VOID) { return 0; }
-#else
-ULONG _DosFlatToSel(PVOID ptr)
+APIRET DosSubUnsetMem(PVOID pbBase)
 {
-    TRACE_NATIVE("DosFlatToSel(%p)", ptr);
-    return GLoaderState.convert32to1616(ptr);
-} // _DosFlatToSel
+    TRACE_NATIVE("DosSubUnsetMem(%p)", pbBase);
+    SubHeap *heap = getSubHeap(pbBase);
+    if (!heap)
+        return ERROR_DOSSUB_CORRUPTED;
+    heap->magic = 0;
+    return NO_ERROR;
+} // DosSubUnsetMem
 
-// DosFlatToSel() passes its argument in %eax, so a little asm to bridge that...
-// Note that this isn't syscall calling conventions at all; CSet/2 generates
-//  thunking code that expects this function to preserve %ecx, so we'll just
-//  go ahead and save a bunch of stuff, just in case.
-__asm__ (
-    ".globl DosFlatToSel  \n\t"
-    ".type	DosFlatToSel, @function \n\t"
-    "DosFlatToSel:  \n\t"
-    "    pushl %ebx  \n\t"  // save off a bunch of stuff. Better safe than sorry.
-    "    pushl %ecx  \n\t"
-    "    pushl %edx  \n\t"
-    "    pushl %edi  \n\t"
-    "    pushl %esi  \n\t"
-    "    pushl %eax  \n\t"  // the actual argument to DosFlatToSel.
-    "    call _DosFlatToSel  \n\t"
-    "    addl $4, %esp  \n\t"  // clear argument to DosFlatToSel.
-    "    popl %esi  \n\t"
-    "    popl %edi  \n\t"
-    "    popl %edx  \n\t"  // save off a bunch of stuff.
-    "    popl %ecx  \n\t"
-    "    popl %ebx  \n\t"
-    "    ret  \n\t"
-	".size	_DosFlatToSel, .-_DosFlatToSel  \n\t"
-);
-#endif
+APIRET DosSubAllocMem(PVOID pbBase, PPVOID ppb, ULONG cb)
+{
+    TRACE_NATIVE("DosSubAllocMem(%p, %p, %u)", pbBase, ppb, (uint) cb);
 
-APIRET DosSetSignalExceptionFocus(BOOL32 flag, PULONG pulTimes)
+    SubHeap *heap = getSubHeap(pbBase);
+    if (!heap)
+        return ERROR_DOSSUB_CORRUPTED;
+    else if (!ppb)
+        return ERROR_INVALID_PARAMETER;
+    else if ((cb == 0) || (cb > heap->size))
+        return ERROR_DOSSUB_BADSIZE;
+
+    lockSubHeap(heap);
+    const uint32 off = allocSubHeap(heap, subHeapRoundSize(cb));
+    unlockSubHeap(heap);
+
+    if (!off)
+        return ERROR_DOSSUB_NOMEM;
+
+    *ppb = ((uint8 *) heap) + off;
+    return NO_ERROR;
+} // DosSubAllocMem
+
+APIRET DosGetDateTime(PDATETIME pdt)
 {
-    TRACE_NATIVE("DosSetSignalExceptionFocus(%u, %p)", (uint) flag, pulTimes);
+    TRACE_NATIVE("DosGetDateTime(%p)", pdt);
 
-    if (flag == 0) {
-        if (GLoaderState.main_module->signal_exception_focus_count == 0)
-            return ERROR_ALREADY_RESET;
-        GLoaderState.main_module->signal_exception_focus_count--;
-    } else if (flag == 1) {
-        if (GLoaderState.main_module->signal_exception_focus_count == 0xFFFFFFFF)
-            return ERROR_NESTING_TOO_DEEP;
-        GLoaderState.main_module->signal_exception_focus_count++;
+    // we can't use time() for this, since we need sub-second resolution.
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+
+    struct tm ltm;
+    localtime_r(&tv.tv_sec, &ltm);
+
+    pdt->hours = ltm.tm_hour;
+    pdt->minutes = ltm.tm_min;
+    pdt->seconds = (ltm.tm_sec == 60) ? 59 : ltm.tm_sec;  // !!! FIXME: I assume OS/2 doesn't support leap seconds...
+    pdt->hundredths = tv.tv_usec / 10000000;  // microseconds to hundreths.
+    pdt->day = ltm.tm_mday;
+    pdt->month = ltm.tm_mon + 1;
+    pdt->year = ltm.tm_year + 1900;
+    pdt->timezone = -(ltm.tm_gmtoff / 60);  // OS/2 is minutes west of GMT, Unix is seconds east. Convert and flip!
+    pdt->weekday = ltm.tm_wday;
+    
+    return NO_ERROR;  // never returns failure.
+} // DosGetDateTime
+
+static char *makeUnixPath(const char *os2path, APIRET *err)
+{
+    return GLoaderState.makeUnixPath(os2path, (uint32 *) err);
+} // makeUnixPath
+
+static int isNPipeName(const char *name)
+{
+    static const char prefix[] = "\\PIPE\\";
+    return (strlen(name) > (sizeof (prefix) - 1)) && (strncasecmp(name, prefix, sizeof (prefix) - 1) == 0);
+} // isNPipeName
+
+static APIRET makeNPipeSockName(const char *name, NamedPipe *npipe)
+{
+    if (!isNPipeName(name))
+        return ERROR_PATH_NOT_FOUND;
+
+    // abstract namespace (leading null byte), with the uid in there so other users' pipes don't collide with ours.
+    char *sockname = npipe->sockname;
+    const size_t len = strlen(name);
+    size_t pos = 1 + snprintf(sockname + 1, sizeof (npipe->sockname) - 1, "2ine-%u", (uint) getuid());
+    if ((pos + len) > sizeof (npipe->sockname))
+        return ERROR_FILENAME_EXCED_RANGE;
+
+    sockname[0] = '\0';
+    for (size_t i = 0; i < len; i++) {
+        const char ch = name[i];
+        sockname[pos++] = (ch == '/') ? '\\' : toupper((unsigned char) ch);  // OS/2 pipe names are case-insensitive.
+    } // for
+
+    npipe->socknamelen = (socklen_t) pos;
+    return NO_ERROR;
+} // makeNPipeSockName
+
+static socklen_t getNPipeAddr(const NamedPipe *npipe, struct sockaddr_un *addr)
+{
+    memset(addr, '\0', sizeof (*addr));
+    addr->sun_family = AF_UNIX;
+    memcpy(addr->sun_path, npipe->sockname, npipe->socknamelen);
+    return (socklen_t) (offsetof(struct sockaddr_un, sun_path) + npipe->socknamelen);
+} // getNPipeAddr
+
+static void growNPipeBuffer(const int fd, const int opt, const ULONG size)
+{
+    // only ever grow these; OS/2 apps ask for tiny buffers, which would throttle bulk transfers.
+    int cur = 0;
+    socklen_t len = sizeof (cur);
+    if ((getsockopt(fd, SOL_SOCKET, opt, &cur, &len) == 0) && (((ULONG) cur) < size)) {
+        const int val = (int) size;
+        setsockopt(fd, SOL_SOCKET, opt, &val, sizeof (val));
+    } // if
+} // growNPipeBuffer
+
+static APIRET listenNPipe(NamedPipe *npipe, const ULONG cbInbuf, const ULONG cbOutbuf)
+{
+    const int type = (npipe->pipemode & NP_TYPE_MESSAGE) ? SOCK_SEQPACKET : SOCK_STREAM;
+    const int cloexec = (npipe->openmode & NP_NOINHERIT) ? SOCK_CLOEXEC : 0;
+
+    // nonblocking, since instances share this socket, and another one might accept() a client we were told about.
+    const int fd = socket(AF_UNIX, type | SOCK_NONBLOCK | cloexec, 0);
+    if (fd == -1)
+        return ERROR_TOO_MANY_OPEN_FILES;
+
+    // accepted sockets inherit these.
+    growNPipeBuffer(fd, SO_RCVBUF, cbInbuf);
+    growNPipeBuffer(fd, SO_SNDBUF, cbOutbuf);
+
+    struct sockaddr_un addr;
+    const socklen_t addrlen = getNPipeAddr(npipe, &addr);
+    if (bind(fd, (struct sockaddr *) &addr, addrlen) == -1) {
+        const int err = errno;
+        close(fd);
+        return (err == EADDRINUSE) ? ERROR_PIPE_BUSY : ERROR_PATH_NOT_FOUND;  // EADDRINUSE: another process is serving this pipe.
+    } else if (listen(fd, SOMAXCONN) == -1) {
+        close(fd);
+        return ERROR_PIPE_BUSY;
+    } // else if
+
+    npipe->listenfd = fd;
+    return NO_ERROR;
+} // listenNPipe
+
+static APIRET connectNPipe(const char *name, const int cloexec, int *pfd, NamedPipe **pnpipe)
+{
+    NamedPipe *npipe = (NamedPipe *) calloc(1, sizeof (NamedPipe));
+    if (!npipe)
+        return ERROR_NOT_ENOUGH_MEMORY;
+
+    const APIRET rc = makeNPipeSockName(name, npipe);
+    if (rc != NO_ERROR) {
+        free(npipe);
+        return rc;
+    } // if
+
+    npipe->listenfd = -1;
+
+    struct sockaddr_un addr;
+    const socklen_t addrlen = getNPipeAddr(npipe, &addr);
+
+    // we don't know if the server made a message or byte pipe, but connect()
+    //  fails on a mismatch (EPROTOTYPE, or ECONNREFUSED for abstract names).
+    static const int types[] = { SOCK_SEQPACKET, SOCK_STREAM };
+    int fd = -1;
+    int err = 0;
+    for (size_t i = 0; i < (sizeof (types) / sizeof (types[0])); i++) {
+        fd = socket(AF_UNIX, types[i] | (cloexec ? SOCK_CLOEXEC : 0), 0);
+        if (fd == -1) {
+            err = errno;
+            break;
+        } else if (connect(fd, (struct sockaddr *) &addr, addrlen) == 0) {
+            if (types[i] == SOCK_SEQPACKET)
+                npipe->pipemode = NP_TYPE_MESSAGE;  // clients start out in byte read mode, though.
+            break;
+        } // else if
+
+        err = errno;
+        close(fd);
+        fd = -1;
+        if ((err != EPROTOTYPE) && (err != ECONNREFUSED))
+            break;
+    } // for
+
+    if (fd == -1) {
+        free(npipe);
+        switch (err) {
+            case EAGAIN: return ERROR_PIPE_BUSY;
+            case EMFILE: return ERROR_TOO_MANY_OPEN_FILES;
+            case ENFILE: return ERROR_TOO_MANY_OPEN_FILES;
+            default: return ERROR_PATH_NOT_FOUND;  // ECONNREFUSED: nobody is serving this pipe.
+        } // switch
+    } // if
+
+    *pfd = fd;
+    *pnpipe = npipe;
+    return NO_ERROR;
+} // connectNPipe
+
+// DosOpen() on a \PIPE\ name lands here.
+static APIRET openNPipe(PSZ pszName, PHFILE pHf, PULONG pulAction, ULONG fsOpenMode)
+{
+    HFILE hf = 0;
+    HFileSlot *slot = reserveHFile(&hf);
+    if (!slot)
+        return ERROR_TOO_MANY_OPEN_FILES;
+
+    int fd = -1;
+    NamedPipe *npipe = NULL;
+    const APIRET rc = connectNPipe(pszName, (fsOpenMode & OPEN_FLAGS_NOINHERIT) != 0, &fd, &npipe);
+    if (rc != NO_ERROR) {
+        setHFileFd(slot, -1);
+        return rc;
+    } // if
+
+    FIXME("we don't enforce OPEN_ACCESS_* on the client end of named pipes");
+
+    HFileInfo info;
+    initHFileInfoFromUnixFd(fd, &info);
+    info.npipe = npipe;
+    writeHFile(slot, &info);
+
+    *pulAction = FILE_EXISTED;
+    *pHf = hf;
+    return NO_ERROR;
+} // openNPipe
+
+// Extended attributes. See EaSidecar for how they're stored.
+
+static inline uint32 alignEaEntry(const uint32 len)
+{
+    return (len + 3) & ~3;
+} // alignEaEntry
+
+static inline uint32 fea2EntrySize(const uint32 namelen, const uint32 valuelen)
+{
+    return (uint32) (offsetof(FEA2, szName) + namelen + 1 + valuelen);
+} // fea2EntrySize
+
+// "/proc/self/fd/N" works for the xattr calls, but the sidecar needs the
+//  real directory.
+static char *resolveEaPath(const char *path)
+{
+    if (strncmp(path, "/proc/self/fd/", 14) == 0)
+        return realpath(path, NULL);
+    return strdup(path);
+} // resolveEaPath
+
+// splits (path) in place; returns the filename part.
+static char *splitEaPath(char *path, const char **pdir)
+{
+    char *ptr = strrchr(path, '/');
+    if (!ptr) {
+        *pdir = ".";
+        return path;
+    } else if (ptr == path) {
+        *pdir = "/";
+        return ptr + 1;
+    } // else if
+    *ptr = '\0';
+    *pdir = path;
+    return ptr + 1;
+} // splitEaPath
+
+static void freeEaSidecar(EaSidecar *sidecar)
+{
+    free(sidecar->data);
+    memset(sidecar, '\0', sizeof (*sidecar));
+} // freeEaSidecar
+
+// returns 0 if there's no (usable) sidecar, which is the same as an empty one.
+static int loadEaSidecar(const char *dir, EaSidecar *sidecar)
+{
+    memset(sidecar, '\0', sizeof (*sidecar));
+
+    char path[PATH_MAX];
+    if (snprintf(path, sizeof (path), "%s/%s", dir, EA_SIDECAR_NAME) >= sizeof (path))
+        return 0;
+
+    const int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+        return 0;
+
+    struct stat statbuf;
+    uint8 *data = NULL;
+    if ((fstat(fd, &statbuf) == 0) && (statbuf.st_size >= 8) && (statbuf.st_size <= 0x7FFFFFFF))
+        data = (uint8 *) malloc((size_t) statbuf.st_size);
+
+    const uint32 len = data ? (uint32) statbuf.st_size : 0;
+    const int okay = data && (pread(fd, data, len, 0) == (ssize_t) len);
+    close(fd);
+
+    const uint32 *header = (const uint32 *) data;
+    const uint32 count = okay ? header[1] : 0;
+    if (!okay || (header[0] != EA_SIDECAR_MAGIC) || (count > ((len - 8) / sizeof (EaSidecarIndex)))) {
+        free(data);  // !!! FIXME: ERROR_EA_FILE_CORRUPT? For now, corrupt == empty.
+        return 0;
+    } // if
+
+    const EaSidecarIndex *index = (const EaSidecarIndex *) (data + 8);
+    for (uint32 i = 0; i < count; i++) {
+        const EaSidecarIndex *idx = &index[i];
+        if ((idx->nameoff > len) || (idx->namelen > (len - idx->nameoff)) || (idx->bloboff > len) || (idx->bloblen > (len - idx->bloboff))) {
+            free(data);
+            return 0;
+        } // if
+    } // for
+
+    sidecar->data = data;
+    sidecar->count = count;
+    sidecar->index = index;
+    return 1;
+} // loadEaSidecar
+
+static int compareEaSidecarName(const EaSidecar *sidecar, const EaSidecarIndex *idx, const char *name, const size_t namelen)
+{
+    const int rc = memcmp(sidecar->data + idx->nameoff, name, (idx->namelen < namelen) ? idx->namelen : namelen);
+    if (rc != 0)
+        return rc;
+    return (idx->namelen < namelen) ? -1 : (idx->namelen > namelen) ? 1 : 0;
+} // compareEaSidecarName
+
+// returns the index slot (name) is in, or should be inserted at.
+static uint32 findEaSidecarSlot(const EaSidecar *sidecar, const char *name, int *found)
+{
+    const size_t namelen = strlen(name);
+    uint32 lo = 0;
+    uint32 hi = sidecar->count;
+    *found = 0;
+    while (lo < hi) {
+        const uint32 mid = lo + ((hi - lo) / 2);
+        const int rc = compareEaSidecarName(sidecar, &sidecar->index[mid], name, namelen);
+        if (rc == 0) {
+            *found = 1;
+            return mid;
+        } else if (rc < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        } // else
+    } // while
+    return lo;
+} // findEaSidecarSlot
+
+static const uint8 *findEaSidecarBlob(const EaSidecar *sidecar, const char *name, uint32 *len)
+{
+    int found = 0;
+    const uint32 slot = findEaSidecarSlot(sidecar, name, &found);
+    if (!found)
+        return NULL;
+    *len = sidecar->index[slot].bloblen;
+    return sidecar->data + sidecar->index[slot].bloboff;
+} // findEaSidecarBlob
+
+// Replace (name)'s blob in (dir)'s sidecar. A NULL (blob) removes it.
+static APIRET writeEaSidecar(const char *dir, const char *name, const uint8 *blob, const uint32 bloblen)
+{
+    const int dirfd = open(dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dirfd == -1)
+        return ERROR_PATH_NOT_FOUND;
+    flock(dirfd, LOCK_EX);  // keep other processes from losing our update (or us, theirs).
+
+    EaSidecar sidecar;
+    loadEaSidecar(dir, &sidecar);
+
+    int found = 0;
+    const uint32 slot = findEaSidecarSlot(&sidecar, name, &found);
+    const uint32 namelen = (uint32) strlen(name);
+    const uint32 count = sidecar.count + (blob ? 1 : 0) - (found ? 1 : 0);
+
+    APIRET retval = NO_ERROR;
+    char path[PATH_MAX];
+    char tmppath[PATH_MAX];
+    snprintf(path, sizeof (path), "%s/%s", dir, EA_SIDECAR_NAME);
+    snprintf(tmppath, sizeof (tmppath), "%s/%s.%d", dir, EA_SIDECAR_NAME, (int) getpid());
+
+    if (!found && !blob) {
+        // nothing to remove, nothing to do.
+    } else if (count == 0) {
+        unlink(path);
+    } else {
+        size_t total = 8 + (count * sizeof (EaSidecarIndex));
+        for (uint32 i = 0; i < sidecar.count; i++) {
+            if (!found || (i != slot))
+                total += sidecar.index[i].namelen + sidecar.index[i].bloblen;
+        } // for
+        if (blob)
+            total += namelen + bloblen;
+
+        uint8 *data = (uint8 *) malloc(total);
+        if (!data) {
+            retval = ERROR_NOT_ENOUGH_MEMORY;
+        } else {
+            uint32 *header = (uint32 *) data;
+            EaSidecarIndex *index = (EaSidecarIndex *) (data + 8);
+            uint32 pos = 8 + (count * sizeof (EaSidecarIndex));
+            uint32 out = 0;
+            header[0] = EA_SIDECAR_MAGIC;
+            header[1] = count;
+            for (uint32 i = 0; i <= sidecar.count; i++) {
+                if ((i == slot) && blob) {  // the new (or replacement) record goes here.
+                    index[out].nameoff = pos;
+                    index[out].namelen = namelen;
+                    memcpy(data + pos, name, namelen);
+                    pos += namelen;
+                    index[out].bloboff = pos;
+                    index[out].bloblen = bloblen;
+                    memcpy(data + pos, blob, bloblen);
+                    pos += bloblen;
+                    out++;
+                } // if
+
+                if ((i == sidecar.count) || (found && (i == slot)))
+                    continue;
+
+                const EaSidecarIndex *idx = &sidecar.index[i];
+                index[out].nameoff = pos;
+                index[out].namelen = idx->namelen;
+                memcpy(data + pos, sidecar.data + idx->nameoff, idx->namelen);
+                pos += idx->namelen;
+                index[out].bloboff = pos;
+                index[out].bloblen = idx->bloblen;
+                memcpy(data + pos, sidecar.data + idx->bloboff, idx->bloblen);
+                pos += idx->bloblen;
+                out++;
+            } // for
+            assert(out == count);
+            assert(pos == total);
+
+            const int fd = open(tmppath, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+            if (fd == -1) {
+                retval = ERROR_CANNOT_OPEN_EA_FILE;
+            } else {
+                const int okay = (write(fd, data, total) == (ssize_t) total);
+                close(fd);
+                if (!okay || (rename(tmppath, path) == -1)) {
+                    unlink(tmppath);
+                    retval = ERROR_EA_TABLE_FULL;  // !!! FIXME: probably ERROR_DISK_FULL, really.
+                } // if
+            } // else
+            free(data);
+        } // else
+    } // else
+
+    freeEaSidecar(&sidecar);
+    flock(dirfd, LOCK_UN);
+    close(dirfd);
+    return retval;
+} // writeEaSidecar
+
+static APIRET validateEaList(const uint8 *list, const int isgea, ULONG *oError);
+
+// Everything that walks a stored blob trusts its offsets, so make sure
+//  something else didn't scribble on the xattr or sidecar first.
+static APIRET checkEaBlob(uint8 *blob, const uint32 len, uint8 **pblob, uint32 *plen)
+{
+    ULONG oError = 0;
+    if ((len < EA_EMPTY_LIST_SIZE) || (*((const ULONG *) blob) != len) || (validateEaList(blob, 0, &oError) != NO_ERROR)) {
+        free(blob);
+        return ERROR_EA_FILE_CORRUPT;
+    } // if
+
+    *pblob = blob;
+    *plen = len;
+    return NO_ERROR;
+} // checkEaBlob
+
+// Get a file's EA blob. *pblob is NULL and *plen is 0 if it has no EAs.
+static APIRET loadEAs(const char *path, uint8 **pblob, uint32 *plen)
+{
+    *pblob = NULL;
+    *plen = 0;
+
+    ssize_t len = getxattr(path, EA_XATTR_NAME, NULL, 0);
+    while (len > 0) {
+        uint8 *blob = (uint8 *) malloc((size_t) len);
+        if (!blob)
+            return ERROR_NOT_ENOUGH_MEMORY;
+        const ssize_t br = getxattr(path, EA_XATTR_NAME, blob, (size_t) len);
+        if (br == len)
+            return checkEaBlob(blob, (uint32) len, pblob, plen);
+        free(blob);
+        if ((br != -1) || (errno != ERANGE))
+            break;
+        len = getxattr(path, EA_XATTR_NAME, NULL, 0);  // it grew under us, try again.
+    } // while
+
+    if ((len == -1) && (errno == ENOENT))
+        return ERROR_FILE_NOT_FOUND;
+
+    // no xattr (or no xattrs on this filesystem). Check the sidecar.
+    char *resolved = resolveEaPath(path);
+    if (!resolved)
+        return NO_ERROR;
+
+    const char *dir = NULL;
+    const char *name = splitEaPath(resolved, &dir);
+    EaSidecar sidecar;
+    APIRET retval = NO_ERROR;
+    if (loadEaSidecar(dir, &sidecar)) {
+        uint32 bloblen = 0;
+        const uint8 *blob = findEaSidecarBlob(&sidecar, name, &bloblen);
+        if (blob) {
+            uint8 *copy = (uint8 *) malloc(bloblen ? bloblen : 1);
+            if (!copy) {
+                retval = ERROR_NOT_ENOUGH_MEMORY;
+            } else {
+                memcpy(copy, blob, bloblen);
+                retval = checkEaBlob(copy, bloblen, pblob, plen);
+            } // else
+        } // if
+        freeEaSidecar(&sidecar);
+    } // if
+    free(resolved);
+    return retval;
+} // loadEAs
+
+// Replace a file's EA blob. A NULL (blob) removes all its EAs.
+static APIRET saveEAs(const char *path, const uint8 *blob, const uint32 len)
+{
+    int usesidecar = 0;
+    if (!blob) {
+        if ((removexattr(path, EA_XATTR_NAME) == -1) && (errno == ENOENT))
+            return ERROR_FILE_NOT_FOUND;
+    } else if (setxattr(path, EA_XATTR_NAME, blob, len, 0) == -1) {
+        switch (errno) {
+            case ENOENT: return ERROR_FILE_NOT_FOUND;
+            case EACCES: return ERROR_ACCESS_DENIED;
+            case EROFS: return ERROR_ACCESS_DENIED;
+            case ENOTSUP: case E2BIG: case ENOSPC: case ERANGE: case EPERM:
+                usesidecar = 1;  // no xattrs here, or no room for this many EAs.
+                removexattr(path, EA_XATTR_NAME);  // don't leave a stale copy behind.
+                break;
+            default: return ERROR_EAS_NOT_SUPPORTED;
+        } // switch
+    } // else if
+
+    char *resolved = resolveEaPath(path);
+    if (!resolved)
+        return usesidecar ? ERROR_EAS_NOT_SUPPORTED : NO_ERROR;
+
+    const char *dir = NULL;
+    const char *name = splitEaPath(resolved, &dir);
+    APIRET retval = NO_ERROR;
+    if (usesidecar) {
+        retval = writeEaSidecar(dir, name, blob, len);
     } else {
-        // !!! FIXME: does OS/2 do something if flag != 0 or 1?
+        // the EAs might have been in the sidecar before; drop that copy.
+        char sidecarpath[PATH_MAX];
+        snprintf(sidecarpath, sizeof (sidecarpath), "%s/%s", dir, EA_SIDECAR_NAME);
+        if (access(sidecarpath, F_OK) == 0)
+            retval = writeEaSidecar(dir, name, NULL, 0);
     } // else
+    free(resolved);
+    return retval;
+} // saveEAs
 
-    if (pulTimes)
-        *pulTimes = GLoaderState.main_module->signal_exception_focus_count;
+// size of a file's FEA2LIST, for FIL_QUERYEASIZE.
+static ULONG queryEaListSize(const char *path)
+{
+    const ssize_t len = getxattr(path, EA_XATTR_NAME, NULL, 0);
+    if (len > 0)
+        return (ULONG) len;
 
-    // !!! FIXME: I guess enable/disable SIGINT handler here?
+    uint8 *blob = NULL;
+    uint32 bloblen = 0;
+    if ((loadEAs(path, &blob, &bloblen) != NO_ERROR) || !blob)
+        return EA_EMPTY_LIST_SIZE;
+    free(blob);
+    return (ULONG) bloblen;
+} // queryEaListSize
 
-    return NO_ERROR;
-} // DosSetSignalExceptionFocus
+static int compareEaName(const char *a, const uint32 alen, const char *b, const uint32 blen)
+{
+    if (alen != blen)
+        return 0;
+    for (uint32 i = 0; i < alen; i++) {
+        if (toupper((unsigned char) a[i]) != toupper((unsigned char) b[i]))
+            return 0;
+    } // for
+    return 1;
+} // compareEaName
 
-APIRET DosSetRelMaxFH(PLONG pincr, PULONG pcurrent)
+// returns the blob's entry for (name), or NULL.
+static const FEA2 *findEa(const uint8 *blob, const uint32 bloblen, const char *name, const uint32 namelen)
 {
-    TRACE_NATIVE("DosSetRelMaxFH(%p, %p)", pincr, pcurrent);
+    if (!blob || (bloblen <= EA_EMPTY_LIST_SIZE))
+        return NULL;
 
-    #if 0
-    struct rlimit rlim;
-    int rc = getrlimit(RLIMIT_NOFILE, &rlim);
-    assert(rc == 0);  // this shouldn't fail...right?
-    if (pcurrent)
-        *pcurrent = (ULONG) rlim.rlim_cur;
+    // loadEAs() already checked that the chain stays inside the blob.
+    uint32 pos = EA_EMPTY_LIST_SIZE;
+    while (1) {
+        const FEA2 *fea = (const FEA2 *) (blob + pos);
+        if (compareEaName(fea->szName, fea->cbName, name, namelen))
+            return fea;
+        else if (fea->oNextEntryOffset == 0)
+            return NULL;
+        pos += fea->oNextEntryOffset;
+    } // while
+} // findEa
 
-    if (pincr) {
-        rlim.rlim_cur = (rlim_t) (((LONG) rlim.rlim_cur) + *pincr);
-        if (setrlimit(RLIMIT_NOFILE, &rlim) == 0) {
-            if (pcurrent)
-                *pcurrent = (ULONG) rlim.rlim_cur;
+// Walk an app's FEA2LIST (or GEA2LIST, if (isgea)), making sure every entry
+//  is inside (cbList) and properly terminated. Sets *oError to the bad
+//  entry's offset on failure.
+static APIRET validateEaList(const uint8 *list, const int isgea, ULONG *oError)
+{
+    const ULONG cbList = *((const ULONG *) list);
+    const uint32 hdrlen = isgea ? (uint32) offsetof(GEA2, szName) : (uint32) offsetof(FEA2, szName);
+    uint32 pos = EA_EMPTY_LIST_SIZE;
+
+    *oError = 0;
+    if (cbList < EA_EMPTY_LIST_SIZE)
+        return ERROR_EA_LIST_INCONSISTENT;
+    else if (cbList > EA_MAX_LIST_SIZE)
+        return ERROR_EA_LIST_TOO_LONG;
+
+    while (pos < cbList) {
+        if ((cbList - pos) < hdrlen) {
+            *oError = pos;
+            return ERROR_EA_LIST_INCONSISTENT;
         } // if
+
+        const ULONG next = *((const ULONG *) (list + pos));
+        const uint32 namelen = isgea ? ((const GEA2 *) (list + pos))->cbName : ((const FEA2 *) (list + pos))->cbName;
+        const uint32 valuelen = isgea ? 0 : ((const FEA2 *) (list + pos))->cbValue;
+        const char *name = (const char *) (list + pos + hdrlen);
+        const uint32 entrylen = hdrlen + namelen + 1 + valuelen;
+        if ((entrylen > (cbList - pos)) || (next && ((next < entrylen) || (next >= (cbList - pos)))) || (namelen == 0) || (name[namelen] != '\0')) {
+            *oError = pos;
+            return ERROR_EA_LIST_INCONSISTENT;
+        } else if (memchr(name, '\0', namelen)) {
+            *oError = pos;
+            return ERROR_INVALID_EA_NAME;
+        } else if (next == 0) {
+            return NO_ERROR;
+        } // else if
+        pos += next;
+    } // while
+
+    return NO_ERROR;  // cbList == 4: an empty list.
+} // validateEaList
+
+// Merge an app's FEA2LIST into a file's EA set (or replace the whole set, if
+//  (replace)). An entry with no value deletes that EA. EA names aren't case
+//  sensitive, and are stored uppercased, like OS/2 does.
+static APIRET setEAs(const char *path, const FEA2LIST *fea2list, const int replace, ULONG *oError)
+{
+    const uint8 *list = (const uint8 *) fea2list;
+    APIRET rc = validateEaList(list, 0, oError);
+    if (rc != NO_ERROR)
+        return rc;
+
+    uint8 *oldblob = NULL;
+    uint32 oldlen = 0;
+    if (!replace && ((rc = loadEAs(path, &oldblob, &oldlen)) != NO_ERROR))
+        return rc;
+
+    // every entry is at least 10 bytes, so this is plenty.
+    const FEA2 **entries = (const FEA2 **) malloc((((oldlen + fea2list->cbList) / 10) + 1) * sizeof (FEA2 *));
+    uint8 *blob = (uint8 *) malloc(EA_MAX_LIST_SIZE);
+    if (!entries || !blob) {
+        free(entries);
+        free(blob);
+        free(oldblob);
+        return ERROR_NOT_ENOUGH_MEMORY;
     } // if
-    #endif
 
-    if (pincr != NULL) {
-        const LONG incr = *pincr;
-        // OS/2 API docs say reductions in file handles are advisory, so we
-        //  ignore them outright. Fight me.
-        if (incr > 0) {
-            grabLock(&GMutexDosCalls);
-            HFileInfo *info = (HFileInfo *) realloc(HFiles, sizeof (HFileInfo) * (MaxHFiles + incr));
-            if (info != NULL) {
-                HFiles = info;
-                FIXME("this needs to initialize the end of the array, not the front");
-                for (LONG i = 0; i < incr; i++, info++) {
-                    info->fd = -1;
-                    info->type = 0;
-                    info->attr = 0;
-                    info->flags = 0;
-                } // for
-                MaxHFiles += incr;
+    uint32 count = 0;
+    for (uint32 i = EA_EMPTY_LIST_SIZE; oldblob && (i < oldlen); ) {
+        const FEA2 *fea = (const FEA2 *) (oldblob + i);
+        entries[count++] = fea;
+        if (fea->oNextEntryOffset == 0)
+            break;
+        i += fea->oNextEntryOffset;
+    } // for
+
+    for (uint32 i = EA_EMPTY_LIST_SIZE; i < fea2list->cbList; ) {
+        const FEA2 *fea = (const FEA2 *) (list + i);
+        for (uint32 j = 0; j < count; j++) {
+            if (compareEaName(entries[j]->szName, entries[j]->cbName, fea->szName, fea->cbName)) {
+                memmove(&entries[j], &entries[j + 1], (count - (j + 1)) * sizeof (FEA2 *));
+                count--;
+                break;
             } // if
-            ungrabLock(&GMutexDosCalls);
+        } // for
+        if (fea->cbValue > 0)
+            entries[count++] = fea;
+        if (fea->oNextEntryOffset == 0)
+            break;
+        i += fea->oNextEntryOffset;
+    } // for
+
+    uint32 pos = EA_EMPTY_LIST_SIZE;
+    FEA2 *prev = NULL;
+    for (uint32 i = 0; i < count; i++) {
+        const FEA2 *fea = entries[i];
+        const uint32 len = fea2EntrySize(fea->cbName, fea->cbValue);
+        if ((pos + len) > EA_MAX_LIST_SIZE) {
+            rc = ERROR_EA_LIST_TOO_LONG;
+            break;
+        } // if
+
+        FEA2 *dst = (FEA2 *) (blob + pos);
+        memcpy(dst, fea, len);
+        dst->oNextEntryOffset = 0;
+        for (uint32 j = 0; j < dst->cbName; j++)
+            dst->szName[j] = (CHAR) toupper((unsigned char) dst->szName[j]);
+        if (prev)
+            prev->oNextEntryOffset = (ULONG) (((uint8 *) dst) - ((uint8 *) prev));
+        prev = dst;
+        pos += alignEaEntry(len);
+    } // for
+
+    if (rc == NO_ERROR) {
+        *((ULONG *) blob) = (ULONG) pos;
+        rc = saveEAs(path, count ? blob : NULL, pos);
+    } // if
+
+    free(entries);
+    free(oldblob);
+    free(blob);
+    return rc;
+} // setEAs
+
+// Build an FEA2LIST at (out), no more than (avail) bytes, holding the EAs
+//  named in an already-validated GEA2LIST, with an empty value for any that
+//  aren't in (blob). Sets the list's cbList if it all fit.
+static APIRET fillFea2ListFromBlob(const uint8 *blob, const uint32 bloblen, const GEA2LIST *gea2list, uint8 *out, const ULONG avail)
+{
+    const uint8 *list = (const uint8 *) gea2list;
+    APIRET rc = NO_ERROR;
+    uint32 pos = EA_EMPTY_LIST_SIZE;
+    FEA2 *prev = NULL;
+
+    if (avail < EA_EMPTY_LIST_SIZE)
+        return ERROR_BUFFER_OVERFLOW;
+
+    for (uint32 i = EA_EMPTY_LIST_SIZE; i < gea2list->cbList; ) {
+        const GEA2 *gea = (const GEA2 *) (list + i);
+        const FEA2 *fea = findEa(blob, bloblen, gea->szName, gea->cbName);
+        const uint32 valuelen = fea ? fea->cbValue : 0;
+        const uint32 len = fea2EntrySize(gea->cbName, valuelen);
+        if ((pos + len) > avail) {
+            rc = ERROR_BUFFER_OVERFLOW;
+            break;
         } // if
+
+        FEA2 *dst = (FEA2 *) (out + pos);
+        dst->oNextEntryOffset = 0;
+        dst->fEA = fea ? fea->fEA : 0;
+        dst->cbName = gea->cbName;
+        dst->cbValue = (USHORT) valuelen;
+        if (fea) {
+            memcpy(dst->szName, fea->szName, gea->cbName + 1);
+            memcpy(dst->szName + gea->cbName + 1, fea->szName + fea->cbName + 1, valuelen);
+        } else {  // not there: report it with no value, named the way we'd store it.
+            for (uint32 j = 0; j < gea->cbName; j++)
+                dst->szName[j] = (CHAR) toupper((unsigned char) gea->szName[j]);
+            dst->szName[gea->cbName] = '\0';
+        } // else
+        if (prev)
+            prev->oNextEntryOffset = (ULONG) (((uint8 *) dst) - ((uint8 *) prev));
+        prev = dst;
+        pos += alignEaEntry(len);
+
+        if (gea->oNextEntryOffset == 0)
+            break;
+        i += gea->oNextEntryOffset;
+    } // for
+
+    if (rc == NO_ERROR)
+        ((FEA2LIST *) out)->cbList = (ULONG) pos;
+    return rc;
+} // fillFea2ListFromBlob
+
+// Fill in an app's EAOP2: the EAs named in its GEA2LIST go in its FEA2LIST,
+//  with an empty value for any the file doesn't have.
+static APIRET queryEAsFromList(const char *path, EAOP2 *eaop2)
+{
+    if (!eaop2->fpGEA2List || !eaop2->fpFEA2List)
+        return ERROR_INVALID_PARAMETER;
+
+    APIRET rc = validateEaList((const uint8 *) eaop2->fpGEA2List, 1, &eaop2->oError);
+    if (rc != NO_ERROR)
+        return rc;
+
+    uint8 *blob = NULL;
+    uint32 bloblen = 0;
+    if ((rc = loadEAs(path, &blob, &bloblen)) != NO_ERROR)
+        return rc;
+
+    rc = fillFea2ListFromBlob(blob, bloblen, eaop2->fpGEA2List, (uint8 *) eaop2->fpFEA2List, eaop2->fpFEA2List->cbList);
+    free(blob);
+    return rc;
+} // queryEAsFromList
+
+// remove a deleted file's record from its directory's sidecar, if there is one.
+static void forgetEAs(const char *path)
+{
+    char *resolved = strdup(path);
+    if (resolved) {
+        const char *dir = NULL;
+        const char *name = splitEaPath(resolved, &dir);
+        char sidecarpath[PATH_MAX];
+        snprintf(sidecarpath, sizeof (sidecarpath), "%s/%s", dir, EA_SIDECAR_NAME);
+        if (access(sidecarpath, F_OK) == 0)
+            writeEaSidecar(dir, name, NULL, 0);
+        free(resolved);
     } // if
+} // forgetEAs
+
+// the EA functions want paths, and this one works for any fd.
+static void getEaPathForFd(const int fd, char *buf, const size_t buflen)
+{
+    snprintf(buf, buflen, "/proc/self/fd/%d", fd);
+} // getEaPathForFd
+
+static ShareArena *attachShareArena(void)
+{
+    char name[64];
+    snprintf(name, sizeof (name), "/2ine-share-%u", (uint) getuid());
+
+    int created = 0;
+    ShareArena *arena = (ShareArena *) mapSharedArena(name, "file sharing arena", sizeof (ShareArena), &created);
+    if (!arena)
+        return NULL;
 
-    if (pcurrent != NULL) {
+    if (created) {
+        // robust, so a process dying mid-open doesn't wedge everyone else.
+        pthread_mutexattr_t attr;
+        pthread_mutexattr_init(&attr);
+        pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+        pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+        pthread_mutex_init(&arena->lock, &attr);
+        pthread_mutexattr_destroy(&attr);
+        for (uint32 i = 0; i < SHARE_ARENA_OPENS; i++)
+            arena->opens[i].next = (i + 1 < SHARE_ARENA_OPENS) ? (i + 2) : 0;
+        for (uint32 i = 0; i < SHARE_ARENA_LOCKS; i++)
+            arena->locks[i].next = (i + 1 < SHARE_ARENA_LOCKS) ? (i + 2) : 0;
+        arena->freeopens = 1;
+        arena->freelocks = 1;
+        __atomic_store_n(&arena->magic, SHARE_ARENA_MAGIC, __ATOMIC_RELEASE);
+    } else {
+        for (int i = 0; (__atomic_load_n(&arena->magic, __ATOMIC_ACQUIRE) != SHARE_ARENA_MAGIC) && (i < 100000); i++)
+            sched_yield();
+        if (arena->magic != SHARE_ARENA_MAGIC) {
+            fprintf(stderr, "2INE: file sharing arena '%s' was never initialized.\n", name);
+            munmap(arena, sizeof (ShareArena));
+            return NULL;
+        } // if
+    } // else
+
+    return arena;
+} // attachShareArena
+
+static ShareArena *getShareArena(void)
+{
+    ShareArena *arena = __atomic_load_n(&GShareArena, __ATOMIC_ACQUIRE);
+    if (!arena) {
         grabLock(&GMutexDosCalls);
-        *pcurrent = MaxHFiles;
+        arena = GShareArena;
+        if (!arena) {
+            arena = attachShareArena();
+            __atomic_store_n(&GShareArena, arena, __ATOMIC_RELEASE);
+        } // if
         ungrabLock(&GMutexDosCalls);
     } // if
+    return arena;
+} // getShareArena
 
-    return NO_ERROR;  // always returns NO_ERROR even if it fails.
-} // DosSetRelMaxFH
+static void lockShareArena(ShareArena *arena)
+{
+    if (pthread_mutex_lock(&arena->lock) == EOWNERDEAD)
+        pthread_mutex_consistent(&arena->lock);  // list updates are ordered so the worst a dead holder does is leak a record.
+} // lockShareArena
 
+static void unlockShareArena(ShareArena *arena)
+{
+    pthread_mutex_unlock(&arena->lock);
+} // unlockShareArena
 
-APIRET DosAllocMem(PPVOID ppb, ULONG cb, ULONG flag)
+// call with the arena locked.
+static ShareFile *findShareFile(ShareArena *arena, const uint64 dev, const uint64 ino, const int create)
 {
-    TRACE_NATIVE("DosAllocMem(%p, %u, %u)", ppb, (uint) cb, (uint) flag);
+    uint64 hash = (dev * 0x9E3779B97F4A7C15ULL) ^ ino;
+    hash ^= hash >> 29;
 
-    // !!! FIXME: this API is actually much more complicated than this.
-    *ppb = calloc(1, cb);
-    if (!*ppb)
-        return ERROR_NOT_ENOUGH_MEMORY;
-    return NO_ERROR;
-} // DosAllocMem
+    ShareFile *reuse = NULL;
+    for (uint32 i = 0; i < SHARE_ARENA_FILES; i++) {
+        ShareFile *file = &arena->files[(hash + i) & (SHARE_ARENA_FILES - 1)];
+        if (file->state == SHAREFILE_UNUSED) {
+            if (!reuse)
+                reuse = file;
+            break;
+        } else if (file->state == SHAREFILE_DELETED) {
+            if (!reuse)
+                reuse = file;
+        } else if ((file->dev == dev) && (file->ino == ino)) {
+            return file;
+        } // else if
+    } // for
+
+    if (!create || !reuse)
+        return NULL;
 
+    reuse->dev = dev;
+    reuse->ino = ino;
+    reuse->opens = 0;
+    reuse->numlocks = 0;
+    reuse->lockwaiters = 0;
+    reuse->state = SHAREFILE_INUSE;
+    return reuse;
+} // findShareFile
+
+// call with the arena locked.
+static void wakeShareLockWaiters(ShareFile *file)
+{
+    if (file->lockwaiters) {
+        __atomic_add_fetch(&file->lockseq, 1, __ATOMIC_RELEASE);
+        futexWake(&file->lockseq, INT_MAX, 1);
+    } // if
+} // wakeShareLockWaiters
 
-APIRET DosSubSetMem(PVOID pbBase, ULONG flag, ULONG cb)
+// call with the arena locked.
+static void freeShareOpen(ShareArena *arena, ShareOpen *open)
 {
-    TRACE_NATIVE("DosSubSetMem(%p, %u, %u)", pbBase, (uint) flag, (uint) cb);
-    return NO_ERROR;  // !!! FIXME: obviously wrong
-} // DosSubSetMem
+    ShareFile *file = &arena->files[open->file - 1];
+    const uint32 idx = (uint32) (open - arena->opens) + 1;
+
+    while (open->locks) {
+        ShareLock *lock = &arena->locks[open->locks - 1];
+        open->locks = lock->next;
+        lock->next = arena->freelocks;
+        arena->freelocks = (uint32) (lock - arena->locks) + 1;
+    } // while
 
+    __atomic_store_n(&file->numlocks, file->numlocks - open->numlocks, __ATOMIC_RELEASE);
+    __atomic_store_n(&open->numlocks, 0, __ATOMIC_RELAXED);
 
-APIRET DosSubAllocMem(PVOID pbBase, PPVOID ppb, ULONG cb)
+    for (uint32 *link = &file->opens; *link; link = &arena->opens[*link - 1].next) {
+        if (*link == idx) {
+            *link = open->next;
+            break;
+        } // if
+    } // for
+
+    if (!file->opens)
+        file->state = SHAREFILE_DELETED;
+
+    wakeShareLockWaiters(file);
+
+    open->file = 0;
+    open->next = arena->freeopens;
+    arena->freeopens = idx;
+} // freeShareOpen
+
+// call with the arena locked. Drops records of processes that died without closing their files.
+static int reapDeadShareOpens(ShareArena *arena, ShareFile *file)
 {
-    TRACE_NATIVE("DosSubAllocMem(%p, %p, %u)", pbBase, ppb, (uint) cb);
-    *ppb = malloc(cb);  // !!! FIXME: obviously wrong
-    if (!*ppb)
-        return ERROR_NOT_ENOUGH_MEMORY;
-    return NO_ERROR;
-} // DosSubAllocMem
+    const uint32 pid = (uint32) getpid();
+    int reaped = 0;
+    uint32 next = 0;
+    for (uint32 i = file->opens; i; i = next) {
+        ShareOpen *open = &arena->opens[i - 1];
+        next = open->next;
+        if ((open->pid != pid) && !isSem32ThreadAlive(open->pid)) {
+            freeShareOpen(arena, open);
+            reaped = 1;
+        } // if
+    } // for
+    return reaped;
+} // reapDeadShareOpens
 
-static APIRET DosQueryHType_implementation(HFILE hFile, PULONG pType, PULONG pAttr)
+// call with the arena locked.
+static int shareModesConflict(const ShareArena *arena, const ShareFile *file, const uint32 access, const uint32 deny)
+{
+    for (uint32 i = file->opens; i; i = arena->opens[i - 1].next) {
+        const ShareOpen *other = &arena->opens[i - 1];
+        if ((other->deny & access) || (deny & other->access))
+            return 1;
+    } // for
+    return 0;
+} // shareModesConflict
+
+static inline int shareRangesOverlap(const ShareLock *lock, const uint64 offset, const uint64 len)
+{
+    return (offset < (lock->offset + lock->length)) && (lock->offset < (offset + len));
+} // shareRangesOverlap
+
+// call with the arena locked. Is part of the range locked by an open other
+//  than (self)? Shared locks only get in the way of (exclusive) requests.
+static int findShareLockConflict(const ShareArena *arena, const ShareFile *file, const ShareOpen *self, const uint64 offset, const uint64 len, const int exclusive)
 {
+    for (uint32 i = file->opens; i; i = arena->opens[i - 1].next) {
+        const ShareOpen *other = &arena->opens[i - 1];
+        if (other == self)
+            continue;
+        for (uint32 j = other->locks; j; j = arena->locks[j - 1].next) {
+            const ShareLock *lock = &arena->locks[j - 1];
+            if ((exclusive || !lock->shared) && shareRangesOverlap(lock, offset, len))
+                return 1;
+        } // for
+    } // for
+    return 0;
+} // findShareLockConflict
+
+// Registers a newly-opened disk file in the share arena, or fails with
+//  ERROR_SHARING_VIOLATION if its sharing mode clashes with someone else's.
+static APIRET openShareRecord(const int fd, const ULONG fsOpenMode, uint32 *pshare)
+{
+    *pshare = 0;
+
+    struct stat statbuf;
+    if ((fstat(fd, &statbuf) == -1) || !S_ISREG(statbuf.st_mode))
+        return NO_ERROR;  // only disk files get sharing modes and locks.
+
+    ShareArena *arena = getShareArena();
+    if (!arena)
+        return NO_ERROR;  // no arena, no enforcement. We complained about it already.
+
+    uint32 access = 0;
+    switch (fsOpenMode & (OPEN_ACCESS_READONLY | OPEN_ACCESS_WRITEONLY | OPEN_ACCESS_READWRITE)) {
+        case OPEN_ACCESS_READONLY: access = SHARE_ACCESS_READ; break;
+        case OPEN_ACCESS_WRITEONLY: access = SHARE_ACCESS_WRITE; break;
+        default: access = SHARE_ACCESS_READ | SHARE_ACCESS_WRITE; break;
+    } // switch
+
+    uint32 deny = 0;
+    switch (fsOpenMode & 0x70) {
+        case OPEN_SHARE_DENYREADWRITE: deny = SHARE_ACCESS_READ | SHARE_ACCESS_WRITE; break;
+        case OPEN_SHARE_DENYWRITE: deny = SHARE_ACCESS_WRITE; break;
+        case OPEN_SHARE_DENYREAD: deny = SHARE_ACCESS_READ; break;
+        default: break;  // OPEN_SHARE_DENYNONE, or zero, which OS/2 would reject, but we've always let slide.
+    } // switch
+
+    lockShareArena(arena);
+
     APIRET retval = NO_ERROR;
+    ShareFile *file = findShareFile(arena, (uint64) statbuf.st_dev, (uint64) statbuf.st_ino, 1);
+    if (!file || !arena->freeopens)
+        retval = ERROR_SHARING_BUFFER_EXCEEDED;
+    else if (shareModesConflict(arena, file, access, deny) && (!reapDeadShareOpens(arena, file) || shareModesConflict(arena, file, access, deny)))
+        retval = ERROR_SHARING_VIOLATION;
 
-    grabLock(&GMutexDosCalls);
-    if ((hFile >= MaxHFiles) || (HFiles[hFile].fd == -1))
-        retval = ERROR_INVALID_HANDLE;
-    else {
-        // OS/2 will dereference a NULL pointer here, but I can't do it...!!!
-        if (pType) *pType = HFiles[hFile].type;
-        if (pAttr) *pAttr = HFiles[hFile].attr;
-    } // else
-    ungrabLock(&GMutexDosCalls);
+    if (retval == NO_ERROR) {
+        const uint32 idx = arena->freeopens;
+        ShareOpen *open = &arena->opens[idx - 1];
+        arena->freeopens = open->next;
+        open->pid = (uint32) getpid();
+        open->handles = 1;
+        open->access = access;
+        open->deny = deny;
+        open->numlocks = 0;
+        open->locks = 0;
+        open->file = (uint32) (file - arena->files) + 1;
+        open->next = file->opens;
+        file->opens = idx;
+        file->state = SHAREFILE_INUSE;  // in case reaping emptied it.
+        *pshare = idx;
+    } else if (file && !file->opens) {
+        file->state = SHAREFILE_DELETED;  // we only made it to look.
+    } // else if
 
+    unlockShareArena(arena);
     return retval;
-} // DosQueryHType_implementation
+} // openShareRecord
 
-APIRET DosQueryHType(HFILE hFile, PULONG pType, PULONG pAttr)
+static void dupShareRecord(const uint32 share)
 {
-    TRACE_NATIVE("DosQueryHType(%u, %p, %p)", (uint) hFile, pType, pAttr);
-    return DosQueryHType_implementation(hFile, pType, pAttr);
-} // DosQueryHType
+    ShareArena *arena = GShareArena;
+    if (share && arena) {
+        lockShareArena(arena);
+        arena->opens[share - 1].handles++;
+        unlockShareArena(arena);
+    } // if
+} // dupShareRecord
+
+// The last handle on a record takes its locks with it. Close the fd first,
+//  so its OFD locks are gone by the time waiters wake up.
+static void closeShareRecord(const uint32 share)
+{
+    ShareArena *arena = GShareArena;
+    if (share && arena) {
+        lockShareArena(arena);
+        ShareOpen *open = &arena->opens[share - 1];
+        if (open->handles && (--open->handles == 0))
+            freeShareOpen(arena, open);
+        unlockShareArena(arena);
+    } // if
+} // closeShareRecord
 
-APIRET DosSetMem(PVOID pb, ULONG cb, ULONG flag)
+// OS/2 byte-range locks are mandatory: a read fails if someone else has an
+//  exclusive lock on any of it, a write fails if someone else has any lock
+//  on it. Only called when hasForeignShareLocks() says there's something to
+//  check. Leaves the kernel in charge of the file offset.
+static APIRET checkShareLocksForIo(const HFileInfo *info, const ULONG cb, const int writing)
 {
-    TRACE_NATIVE("DosSetMem(%p, %u, %u)", pb, (uint) cb, (uint) flag);
-    return NO_ERROR;  // !!! FIXME: obviously wrong.
-} // DosSetMem
+    if (info->fbuf)
+        syncFileBuffer(info->fd, info->fbuf);  // also drops read-ahead that might be older than their lock.
 
-APIRET DosGetDateTime(PDATETIME pdt)
-{
-    TRACE_NATIVE("DosGetDateTime(%p)", pdt);
+    const off_t pos = lseek(info->fd, 0, SEEK_CUR);
+    if ((pos == -1) || (cb == 0))
+        return NO_ERROR;
 
-    // we can't use time() for this, since we need sub-second resolution.
-    struct timeval tv;
-    gettimeofday(&tv, NULL);
+    ShareArena *arena = GShareArena;
+    lockShareArena(arena);
+    const ShareOpen *self = &arena->opens[info->share - 1];
+    ShareFile *file = &arena->files[self->file - 1];
+    APIRET retval = NO_ERROR;
+    if (findShareLockConflict(arena, file, self, (uint64) pos, cb, writing) && (!reapDeadShareOpens(arena, file) || findShareLockConflict(arena, file, self, (uint64) pos, cb, writing)))
+        retval = ERROR_LOCK_VIOLATION;
+    unlockShareArena(arena);
+    return retval;
+} // checkShareLocksForIo
+
+// The kernel won't take a write lock through a read-only fd, or a read lock
+//  through a write-only one (it fails with EBADF). OS/2 lets you lock either
+//  way through any handle, and the share arena is what enforces that between
+//  2ine processes; the kernel lock only keeps other programs out. So take
+//  whatever lock type this fd can hold, or none at all (-1) if the only one
+//  it allows would block other 2ine processes' shared locks.
+static int shareKernelLockType(const int fd, const int shared)
+{
+    const int flags = fcntl(fd, F_GETFL);
+    const int accmode = (flags == -1) ? O_RDWR : (flags & O_ACCMODE);
+    if (accmode == O_RDONLY)
+        return F_RDLCK;
+    else if (accmode == O_WRONLY)
+        return shared ? -1 : F_WRLCK;
+    return shared ? F_RDLCK : F_WRLCK;
+} // shareKernelLockType
+
+static APIRET lockShareRange(const int fd, const uint32 share, const uint64 offset, const uint64 len, const int shared, const ULONG timeout)
+{
+    const int locktype = shareKernelLockType(fd, shared);
+
+    ShareArena *arena = GShareArena;
+    ShareOpen *self = &arena->opens[share - 1];
+    ShareFile *file = &arena->files[self->file - 1];
+
+    struct timespec deadline;
+    const int timed = (timeout != SEM_INDEFINITE_WAIT);
+    if (timed)
+        sem32Deadline(&deadline, timeout);
 
-    struct tm ltm;
-    localtime_r(&tv.tv_sec, &ltm);
+    APIRET retval = NO_ERROR;
+    lockShareArena(arena);
+    while (1) {
+        // OS/2 won't let a handle lock bytes it already has locked.
+        int overlapsown = 0;
+        for (uint32 i = self->locks; i && !overlapsown; i = arena->locks[i - 1].next)
+            overlapsown = shareRangesOverlap(&arena->locks[i - 1], offset, len);
 
-    pdt->hours = ltm.tm_hour;
-    pdt->minutes = ltm.tm_min;
-    pdt->seconds = (ltm.tm_sec == 60) ? 59 : ltm.tm_sec;  // !!! FIXME: I assume OS/2 doesn't support leap seconds...
-    pdt->hundredths = tv.tv_usec / 10000000;  // microseconds to hundreths.
-    pdt->day = ltm.tm_mday;
-    pdt->month = ltm.tm_mon + 1;
-    pdt->year = ltm.tm_year + 1900;
-    pdt->timezone = -(ltm.tm_gmtoff / 60);  // OS/2 is minutes west of GMT, Unix is seconds east. Convert and flip!
-    pdt->weekday = ltm.tm_wday;
-    
-    return NO_ERROR;  // never returns failure.
-} // DosGetDateTime
+        if (overlapsown) {
+            retval = ERROR_LOCK_VIOLATION;
+            break;
+        } else if (!findShareLockConflict(arena, file, self, offset, len, !shared)) {
+            if (!arena->freelocks) {
+                retval = ERROR_SHARING_BUFFER_EXCEEDED;
+                break;
+            } // if
 
-static char *makeUnixPath(const char *os2path, APIRET *err)
-{
-    return GLoaderState.makeUnixPath(os2path, (uint32 *) err);
-} // makeUnixPath
+            struct flock fl;
+            memset(&fl, '\0', sizeof (fl));
+            fl.l_type = (short) locktype;
+            fl.l_whence = SEEK_SET;
+            fl.l_start = (off_t) offset;
+            fl.l_len = (off_t) len;
+            if ((locktype == -1) || (fcntl(fd, F_OFD_SETLK, &fl) == 0)) {
+                const uint32 idx = arena->freelocks;
+                ShareLock *lock = &arena->locks[idx - 1];
+                arena->freelocks = lock->next;
+                lock->shared = shared;
+                lock->offset = offset;
+                lock->length = len;
+                lock->next = self->locks;
+                self->locks = idx;
+                __atomic_store_n(&self->numlocks, self->numlocks + 1, __ATOMIC_RELAXED);
+                __atomic_store_n(&file->numlocks, file->numlocks + 1, __ATOMIC_RELEASE);
+                break;
+            } else if ((errno != EAGAIN) && (errno != EACCES)) {
+                retval = (errno == ENOLCK) ? ERROR_SHARING_BUFFER_EXCEEDED : ERROR_LOCK_VIOLATION;
+                break;
+            } // else if
+            // otherwise, a non-2ine process has a fcntl() lock in the way, and we have to poll for it.
+        } // else if
+
+        if (timeout == SEM_IMMEDIATE_RETURN) {
+            retval = ERROR_LOCK_VIOLATION;
+            break;
+        } // if
+
+        const uint32 seq = __atomic_load_n(&file->lockseq, __ATOMIC_ACQUIRE);
+        file->lockwaiters++;
+        unlockShareArena(arena);
+
+        // sleep in slices, so we notice holders that died, and locks that aren't in the table.
+        struct timespec slice;
+        sem32Deadline(&slice, SHARE_LOCK_POLL_MS);
+        const int lastslice = timed && ((deadline.tv_sec < slice.tv_sec) || ((deadline.tv_sec == slice.tv_sec) && (deadline.tv_nsec <= slice.tv_nsec)));
+        const int rc = futexWait(&file->lockseq, seq, lastslice ? &deadline : &slice, 1);
+
+        lockShareArena(arena);
+        file->lockwaiters--;
+        if (rc == ETIMEDOUT) {
+            if (lastslice) {
+                retval = ERROR_LOCK_VIOLATION;
+                break;
+            } // if
+            reapDeadShareOpens(arena, file);
+        } // if
+    } // while
+    unlockShareArena(arena);
+
+    return retval;
+} // lockShareRange
+
+// OS/2 only unlocks a range exactly as it was locked.
+static APIRET unlockShareRange(const int fd, const uint32 share, const uint64 offset, const uint64 len)
+{
+    ShareArena *arena = GShareArena;
+    ShareOpen *self = &arena->opens[share - 1];
+    ShareFile *file = &arena->files[self->file - 1];
+
+    APIRET retval = ERROR_LOCK_VIOLATION;
+    lockShareArena(arena);
+    for (uint32 *link = &self->locks; *link; link = &arena->locks[*link - 1].next) {
+        ShareLock *lock = &arena->locks[*link - 1];
+        if ((lock->offset == offset) && (lock->length == len)) {
+            struct flock fl;
+            memset(&fl, '\0', sizeof (fl));
+            fl.l_type = F_UNLCK;
+            fl.l_whence = SEEK_SET;
+            fl.l_start = (off_t) offset;
+            fl.l_len = (off_t) len;
+            fcntl(fd, F_OFD_SETLK, &fl);  // our own ranges never overlap, so this can't split another one.
+
+            const uint32 idx = *link;
+            *link = lock->next;
+            lock->next = arena->freelocks;
+            arena->freelocks = idx;
+            __atomic_store_n(&self->numlocks, self->numlocks - 1, __ATOMIC_RELAXED);
+            __atomic_store_n(&file->numlocks, file->numlocks - 1, __ATOMIC_RELEASE);
+            wakeShareLockWaiters(file);
+            retval = NO_ERROR;
+            break;
+        } // if
+    } // for
+    unlockShareArena(arena);
+
+    return retval;
+} // unlockShareRange
 
 static APIRET doDosOpen(PSZ pszFileName, PHFILE pHf, PULONG pulAction, LONGLONG cbFile, ULONG ulAttribute, ULONG fsOpenFlags, ULONG fsOpenMode, PEAOP2 peaop2)
 {
@@ -733,11 +4349,17 @@ static APIRET doDosOpen(PSZ pszFileName, PHFILE pHf, PULONG pulAction, LONGLONG
         return ERROR_OPEN_FAILED;
     else if (fsOpenMode & 0xffff0000)  // bits (1<<16) through (1<<31) are reserved, must be zero.
         return ERROR_INVALID_PARAMETER;
+    else if ((fsOpenMode & 0x70) > OPEN_SHARE_DENYNONE)
+        return ERROR_INVALID_PARAMETER;
 
-    if (peaop2 != NULL) {
-        FIXME("EAs not yet implemented");
-        return ERROR_OPEN_FAILED;
-    }
+    if (peaop2 && peaop2->fpFEA2List) {  // catch a bad list before we create anything.
+        const APIRET rc = validateEaList((const uint8 *) peaop2->fpFEA2List, 0, &peaop2->oError);
+        if (rc != NO_ERROR)
+            return rc;
+    } // if
+
+    if (isNPipeName(pszFileName))
+        return openNPipe(pszFileName, pHf, pulAction, fsOpenMode);
 
     switch (fsOpenFlags & 0xF0) {
         case OPEN_ACTION_FAIL_IF_NEW:
@@ -766,8 +4388,7 @@ static APIRET doDosOpen(PSZ pszFileName, PHFILE pHf, PULONG pulAction, LONGLONG
             break;  // nothing to do here.
 
         case OPEN_ACTION_REPLACE_IF_EXISTS:  // right now, we already failed above if readonly.
-            isReplacing = 1;
-            flags |= O_TRUNC;  // have the open call nuke it, and then we'll ftruncate to grow it if necessary.
+            isReplacing = 1;  // we ftruncate() it once we know the sharing mode lets us; O_TRUNC would do it first.
             break;
     } // switch
 
@@ -787,36 +4408,20 @@ static APIRET doDosOpen(PSZ pszFileName, PHFILE pHf, PULONG pulAction, LONGLONG
     //if (fsOpenMode & OPEN_FLAGS_NO_CACHE)
     //    flags |= O_DIRECT;
 
-    FIXME("There are fsOpenMode flags we currently ignore (like sharing support)");
+    FIXME("There are fsOpenMode flags we currently ignore (like OPEN_FLAGS_FAIL_ON_ERROR)");
 
     const mode_t mode = S_IRUSR | ((ulAttribute & FILE_READONLY) ? 0 : S_IWUSR);
     FIXME("Most of the file attributes don't make sense on Unix, but we could stuff them in EAs");
 
-    HFileInfo *info = HFiles;
-    uint32 i;
-
-    if (!grabLock(&GMutexDosCalls))
-        return ERROR_SYS_INTERNAL;
-
-    for (i = 0; i < MaxHFiles; i++, info++) {
-        if (info->fd == -1) {  // available?
-            info->fd = -2;
-            break;
-        } // if
-    } // for
-
-    ungrabLock(&GMutexDosCalls);
-
-    if (i == MaxHFiles) {
+    HFILE hf = 0;
+    HFileSlot *slot = reserveHFile(&hf);
+    if (!slot)
         return ERROR_TOO_MANY_OPEN_FILES;
-    }
-
-    const HFILE hf = i;
 
     APIRET err = NO_ERROR;
     char *unixpath = makeUnixPath(pszFileName, &err);
     if (!unixpath) {
-        info->fd = -1;
+        setHFileFd(slot, -1);
         return err;
     } // if
 
@@ -832,32 +4437,70 @@ static APIRET doDosOpen(PSZ pszFileName, PHFILE pHf, PULONG pulAction, LONGLONG
     if ((fd == -1) && (flags & (O_CREAT|O_EXCL)) && (errno == EEXIST) && !isExclusive) {
         existed = 1;
         fd = open(unixpath, flags & ~O_EXCL, mode);
-    } else if (fd != -1) {
-        existed = 1;
+    } else if ((fd != -1) && !(flags & O_CREAT)) {
+        existed = 1;  // (if we used O_CREAT and it worked, O_EXCL says we made it.)
     } // else if
-    free(unixpath);
 
+    uint32 share = 0;
     if (fd != -1) {
         if (mustNotExist) {
             close(fd);
-            info->fd = -1;
+            setHFileFd(slot, -1);
+            free(unixpath);
             return ERROR_OPEN_FAILED;  // !!! FIXME: what error does OS/2 return for this?
-        } else if ( (!existed || isReplacing) && (cbFile > 0) ) {
-            if (ftruncate(info->fd, cbFile) == -1) {
-                const int e = errno;
-                close(fd);
-                info->fd = -1;
-                errno = e;  // let the switch below sort out the OS/2 error code.
-            } // if
-        } // else if
+        } // if
+
+        const APIRET rc = openShareRecord(fd, fsOpenMode, &share);
+        if (rc != NO_ERROR) {
+            close(fd);
+            if (!existed)
+                unlink(unixpath);
+            setHFileFd(slot, -1);
+            free(unixpath);
+            return rc;
+        } // if
+
+        int truncrc = 0;
+        if (isReplacing && existed)
+            truncrc = ftruncate(fd, 0);
+        if ((truncrc == 0) && (!existed || isReplacing) && (cbFile > 0))
+            truncrc = ftruncate(fd, cbFile);
+        if (truncrc == -1) {
+            const int e = errno;
+            close(fd);
+            closeShareRecord(share);
+            share = 0;
+            fd = -1;
+            errno = e;  // let the switch below sort out the OS/2 error code.
+        } // if
     } // if
 
-    if (fd != -1) {
-        if (isReplacing)
-            FIXME("Replacing a file should delete all its EAs, too");
+    // a new or replaced file gets exactly the EAs the app handed us (if any).
+    if ((fd != -1) && (!existed || isReplacing)) {
+        APIRET rc = NO_ERROR;
+        if (peaop2 && peaop2->fpFEA2List)
+            rc = setEAs(unixpath, peaop2->fpFEA2List, 1, &peaop2->oError);
+        else if (existed)
+            rc = saveEAs(unixpath, NULL, 0);
+        if (rc != NO_ERROR) {
+            close(fd);
+            closeShareRecord(share);
+            if (!existed)
+                unlink(unixpath);
+            setHFileFd(slot, -1);
+            free(unixpath);
+            return rc;
+        } // if
     } // if
+    free(unixpath);
 
-    initHFileInfoFromUnixFd(fd, info);
+    HFileInfo info;
+    initHFileInfoFromUnixFd(fd, &info);
+    info.flags = fsOpenFlags;
+    info.share = share;
+    if ((fd != -1) && GLoaderState.file_buffering && (info.type == 0) && !(fsOpenMode & (OPEN_FLAGS_NO_CACHE | OPEN_FLAGS_WRITE_THROUGH)))
+        info.fbuf = createFileBuffer(fsOpenMode);  // if this fails, we just don't buffer this handle.
+    writeHFile(slot, &info);
 
     if (fd == -1) {
         switch (errno) {
@@ -880,8 +4523,6 @@ static APIRET doDosOpen(PSZ pszFileName, PHFILE pHf, PULONG pulAction, LONGLONG
         __builtin_unreachable();
     } // if
 
-    info->flags = fsOpenFlags;
-
     if (isReplacing)
         *pulAction = FILE_TRUNCATED;
     else if (existed)
@@ -903,48 +4544,24 @@ APIRET DosRequestMutexSem(HMTX hmtx, ULONG ulTimeout)
 {
     TRACE_NATIVE("DosRequestMutexSem(%u, %u)", (uint) hmtx, (uint) ulTimeout);
 
-    if (!hmtx)
+    int shared = 0;
+    Sem32 *sem = getSem32(hmtx, SEM32KIND_MUTEX, &shared);
+    if (!sem)
         return ERROR_INVALID_HANDLE;
 
-    pthread_mutex_t *mutex = (pthread_mutex_t *) hmtx;
-    int rc;
-
-    if (ulTimeout == SEM_IMMEDIATE_RETURN) {
-        rc = pthread_mutex_trylock(mutex);
-    } else if (ulTimeout == SEM_INDEFINITE_WAIT) {
-        rc = pthread_mutex_lock(mutex);
-    } else {
-        struct timespec waittime;
-        timespecNowPlusMilliseconds(&waittime, ulTimeout);
-        rc = pthread_mutex_timedlock(mutex, &waittime);
-    } // else
-
-    switch (rc) {
-        case 0: return NO_ERROR;
-        case EAGAIN: return ERROR_TOO_MANY_SEM_REQUESTS;
-        case EOWNERDEAD: return ERROR_SEM_OWNER_DIED;
-        case ETIMEDOUT: return ERROR_TIMEOUT;
-        default: break;
-    } // switch
-
-    return ERROR_INVALID_HANDLE;  // oh well.
+    return requestMutexSem32(sem, ulTimeout);
 } // DosRequestMutexSem
 
 APIRET DosReleaseMutexSem(HMTX hmtx)
 {
     TRACE_NATIVE("DosReleaseMutexSem(%u)", (uint) hmtx);
 
-    if (!hmtx)
+    int shared = 0;
+    Sem32 *sem = getSem32(hmtx, SEM32KIND_MUTEX, &shared);
+    if (!sem)
         return ERROR_INVALID_HANDLE;
 
-    pthread_mutex_t *mutex = (pthread_mutex_t *) hmtx;
-    const int rc = pthread_mutex_unlock(mutex);
-    if (rc == 0)
-        return NO_ERROR;
-    else if (rc == EPERM)
-        return ERROR_NOT_OWNER;
-
-    return ERROR_INVALID_HANDLE;
+    return releaseMutexSem32(sem);
 } // DosReleaseMutexSem
 
 static APIRET DosSetFilePtr_implementation(HFILE hFile, LONG ib, ULONG method, PULONG ibActual)
@@ -982,11 +4599,40 @@ APIRET DosSetFilePtr(HFILE hFile, LONG ib, ULONG method, PULONG ibActual)
 
 static APIRET DosRead_implementation(HFILE hFile, PVOID pBuffer, ULONG cbRead, PULONG pcbActual)
 {
-    const int fd = getHFileUnixDescriptor(hFile);
-    if (fd == -1)
+    touchAppBuffer(pBuffer, cbRead);
+
+    HFileInfo info;
+    if (!readHFile(hFile, &info))
         return ERROR_INVALID_HANDLE;
+    else if (info.npipe) {
+        ULONG br = 0;
+        const APIRET rc = readNPipe(&info, pBuffer, cbRead, &br, (info.npipe->pipemode & NP_READMODE_MESSAGE) != 0);
+        if (pcbActual)
+            *pcbActual = br;
+        return rc;
+    } // else if
+
+    if (info.share && hasForeignShareLocks(info.share)) {
+        const APIRET rc = checkShareLocksForIo(&info, cbRead, 0);
+        if (rc != NO_ERROR) {
+            if (pcbActual)
+                *pcbActual = 0;
+            return rc;
+        } // if
+        info.fbuf = NULL;  // go straight to the fd while someone else has locks.
+    } // if
+
+    if (info.fbuf) {
+        ULONG br = 0;
+        APIRET rc = NO_ERROR;
+        if (readFileBuffer(info.fd, info.fbuf, (uint8 *) pBuffer, cbRead, &br, &rc)) {
+            if (pcbActual)
+                *pcbActual = br;
+            return rc;
+        } // if
+    } // if
 
-    const ssize_t br = read(fd, pBuffer, cbRead);
+    const ssize_t br = read(info.fd, pBuffer, cbRead);
     if (br == -1)
         return ERROR_INVALID_FUNCTION;  // !!! FIXME: ?
 
@@ -1002,25 +4648,61 @@ APIRET DosRead(HFILE hFile, PVOID pBuffer, ULONG cbRead, PULONG pcbActual)
     return DosRead_implementation(hFile, pBuffer, cbRead, pcbActual);
 } // DosRead
 
+// call with GMutexDosCalls held. (fd) is what the handle was using, which we already closed.
+static void freeNPipe(NamedPipe *npipe, const int fd)
+{
+    if (npipe->listenfd != -1) {
+        if (npipe->listenfd != fd)
+            close(npipe->listenfd);
+
+        NamedPipe *prev = NULL;
+        for (NamedPipe *i = GNamedPipes; i; i = i->next) {
+            if (i == npipe) {
+                if (prev)
+                    prev->next = i->next;
+                else
+                    GNamedPipes = i->next;
+                break;
+            } // if
+            prev = i;
+        } // for
+    } // if
+
+    free(npipe->pending);
+    free(npipe);
+} // freeNPipe
+
 static APIRET DosClose_implementation(HFILE hFile)
 {
-    const int fd = getHFileUnixDescriptor(hFile);
-    if (fd == -1)
+    HFileInfo info;
+    if (!readHFile(hFile, &info))
         return ERROR_INVALID_HANDLE;
 
+    const int fd = info.fd;
     if (fd <= 2) { FIXME("remove me"); return NO_ERROR; } // for debugging purposes, remove me later.
 
+    APIRET retval = NO_ERROR;
+    if (info.fbuf) {  // get any coalesced writes onto the disk first.
+        pthread_mutex_lock(&info.fbuf->lock);
+        syncFileBufferLocked(fd, info.fbuf);
+        retval = takeFileBufferError(info.fbuf);
+        pthread_mutex_unlock(&info.fbuf->lock);
+    } // if
+
     const int rc = close(fd);
     if (rc == -1)
         return ERROR_ACCESS_DENIED;  // !!! FIXME: ?
 
+    closeShareRecord(info.share);
+
     grabLock(&GMutexDosCalls);
-    HFiles[hFile].fd = -1;
-    HFiles[hFile].type = 0;
-    HFiles[hFile].attr = 0;
+    setHFileFd(getHFileSlot(GHFiles, hFile), -1);
+    if (info.npipe)
+        freeNPipe(info.npipe, fd);
+    freeFileBuffer(info.fbuf);
     ungrabLock(&GMutexDosCalls);
 
-    return NO_ERROR;
+    return retval;
 } // DosClose_implementation
 
 APIRET DosClose(HFILE hFile)
@@ -1029,6 +4711,347 @@ APIRET DosClose(HFILE hFile)
     return DosClose_implementation(hFile);
 } // DosClose
 
+static APIRET DosSetFileLocks_implementation(HFILE hFile, const FILELOCKL *pflUnlock, const FILELOCKL *pflLock, ULONG timeout, ULONG flags)
+{
+    HFileInfo info;
+    if (!readHFile(hFile, &info))
+        return ERROR_INVALID_HANDLE;
+    else if (flags & ~(FILELOCK_SHARED | FILELOCK_ATOMIC))
+        return ERROR_INVALID_PARAMETER;
+    else if (flags & FILELOCK_ATOMIC)
+        return ERROR_ATOMIC_LOCK_NOT_SUPPORTED;  // !!! FIXME: OFD locks could convert an identical range atomically.
+    else if (!info.share)
+        return ERROR_INVALID_FUNCTION;  // pipes and devices, or we couldn't get at the share arena.
+
+    const LONGLONG unlockofs = pflUnlock ? pflUnlock->lOffset : 0;
+    const LONGLONG unlocklen = pflUnlock ? pflUnlock->lRange : 0;
+    const LONGLONG lockofs = pflLock ? pflLock->lOffset : 0;
+    const LONGLONG locklen = pflLock ? pflLock->lRange : 0;
+    if ((unlockofs < 0) || (unlocklen < 0) || (lockofs < 0) || (locklen < 0))
+        return ERROR_INVALID_PARAMETER;
+
+    // coalesced writes have to land before we unlock, and read-ahead from before we locked is stale.
+    if (info.fbuf)
+        syncFileBuffer(info.fd, info.fbuf);
+
+    if (unlocklen > 0) {
+        const APIRET rc = unlockShareRange(info.fd, info.share, (uint64) unlockofs, (uint64) unlocklen);
+        if (rc != NO_ERROR)
+            return rc;
+    } // if
+
+    if (locklen > 0)
+        return lockShareRange(info.fd, info.share, (uint64) lockofs, (uint64) locklen, (flags & FILELOCK_SHARED) != 0, timeout);
+
+    return NO_ERROR;
+} // DosSetFileLocks_implementation
+
+APIRET DosSetFileLocks(HFILE hFile, PFILELOCK pflUnlock, PFILELOCK pflLock, ULONG timeout, ULONG flags)
+{
+    TRACE_NATIVE("DosSetFileLocks(%u, %p, %p, %u, %u)", (uint) hFile, pflUnlock, pflLock, (uint) timeout, (uint) flags);
+
+    FILELOCKL unlockl, lockl;
+    if (pflUnlock) {
+        unlockl.lOffset = pflUnlock->lOffset;
+        unlockl.lRange = pflUnlock->lRange;
+    } // if
+    if (pflLock) {
+        lockl.lOffset = pflLock->lOffset;
+        lockl.lRange = pflLock->lRange;
+    } // if
+
+    return DosSetFileLocks_implementation(hFile, pflUnlock ? &unlockl : NULL, pflLock ? &lockl : NULL, timeout, flags);
+} // DosSetFileLocks
+
+APIRET DosSetFileLocksL(HFILE hFile, PFILELOCKL pflUnlock, PFILELOCKL pflLock, ULONG timeout, ULONG flags)
+{
+    TRACE_NATIVE("DosSetFileLocksL(%u, %p, %p, %u, %u)", (uint) hFile, pflUnlock, pflLock, (uint) timeout, (uint) flags);
+    return DosSetFileLocks_implementation(hFile, pflUnlock, pflLock, timeout, flags);
+} // DosSetFileLocksL
+
+APIRET DosCreatePipe(PHFILE phfRead, PHFILE phfWrite, ULONG cb)
+{
+    TRACE_NATIVE("DosCreatePipe(%p, %p, %u)", phfRead, phfWrite, (uint) cb);
+
+    if (!phfRead || !phfWrite)
+        return ERROR_INVALID_PARAMETER;
+
+    int fds[2];
+    if (pipe(fds) == -1)
+        return ERROR_TOO_MANY_OPEN_FILES;
+
+    // OS/2 apps tend to ask for tiny pipes. Only ever grow the kernel's
+    //  buffer, since shrinking it just means more wakeups for bulk transfers.
+    //  This can fail past /proc/sys/fs/pipe-max-size, which is fine.
+    const int cursize = fcntl(fds[1], F_GETPIPE_SZ);
+    if ((cursize > 0) && (cb > (ULONG) cursize))
+        fcntl(fds[1], F_SETPIPE_SZ, (int) cb);
+
+    HFILE hfRead = 0;
+    HFILE hfWrite = 0;
+    HFileSlot *readslot = reserveHFile(&hfRead);
+    HFileSlot *writeslot = readslot ? reserveHFile(&hfWrite) : NULL;
+    if (!writeslot) {
+        if (readslot) {
+            grabLock(&GMutexDosCalls);
+            setHFileFd(readslot, -1);
+            ungrabLock(&GMutexDosCalls);
+        } // if
+        close(fds[0]);
+        close(fds[1]);
+        return ERROR_TOO_MANY_OPEN_FILES;
+    } // if
+
+    HFileInfo info;
+    initHFileInfoFromUnixFd(fds[0], &info);
+    writeHFile(readslot, &info);
+    initHFileInfoFromUnixFd(fds[1], &info);
+    writeHFile(writeslot, &info);
+
+    *phfRead = hfRead;
+    *phfWrite = hfWrite;
+    return NO_ERROR;
+} // DosCreatePipe
+
+APIRET DosCreateNPipe(PSZ pszName, PHPIPE pHpipe, ULONG openmode, ULONG pipemode, ULONG cbInbuf, ULONG cbOutbuf, ULONG msec)
+{
+    TRACE_NATIVE("DosCreateNPipe('%s', %p, %u, %u, %u, %u, %u)", pszName, pHpipe, (uint) openmode, (uint) pipemode, (uint) cbInbuf, (uint) cbOutbuf, (uint) msec);
+
+    const ULONG instances = pipemode & NP_UNLIMITED_INSTANCES;
+    if (!pszName || !pHpipe)
+        return ERROR_INVALID_PARAMETER;
+    else if ((openmode & 0x3) > NP_ACCESS_DUPLEX)
+        return ERROR_INVALID_PARAMETER;
+    else if (instances == 0)
+        return ERROR_INVALID_PARAMETER;
+    else if ((pipemode & NP_READMODE_MESSAGE) && !(pipemode & NP_TYPE_MESSAGE))
+        return ERROR_INVALID_PARAMETER;
+
+    FIXME("we don't enforce NP_ACCESS_* on named pipes");
+    // msec is the default timeout for DosWaitNPipe(), which we don't have; connect() just queues clients on the socket.
+
+    NamedPipe *npipe = (NamedPipe *) calloc(1, sizeof (NamedPipe));
+    if (!npipe)
+        return ERROR_NOT_ENOUGH_MEMORY;
+
+    APIRET rc = makeNPipeSockName(pszName, npipe);
+    if (rc != NO_ERROR) {
+        free(npipe);
+        return rc;
+    } // if
+
+    npipe->listenfd = -1;
+    npipe->openmode = openmode;
+    npipe->pipemode = pipemode & (NP_NOWAIT | NP_TYPE_MESSAGE | NP_READMODE_MESSAGE | NP_UNLIMITED_INSTANCES);
+
+    HFILE hf = 0;
+    HFileSlot *slot = reserveHFile(&hf);
+    if (!slot) {
+        free(npipe);
+        return ERROR_TOO_MANY_OPEN_FILES;
+    } // if
+
+    grabLock(&GMutexDosCalls);
+
+    // more instances of a pipe we're already serving share its listening socket.
+    NamedPipe *other = NULL;
+    ULONG count = 0;
+    for (NamedPipe *i = GNamedPipes; i; i = i->next) {
+        if ((i->socknamelen == npipe->socknamelen) && (memcmp(i->sockname, npipe->sockname, npipe->socknamelen) == 0)) {
+            other = i;
+            count++;
+        } // if
+    } // for
+
+    if (!other)
+        rc = listenNPipe(npipe, cbInbuf, cbOutbuf);
+    else if ((instances != (other->pipemode & NP_UNLIMITED_INSTANCES)) || ((instances != NP_UNLIMITED_INSTANCES) && (count >= instances)))
+        rc = ERROR_PIPE_BUSY;
+    else if ((npipe->listenfd = fcntl(other->listenfd, (openmode & NP_NOINHERIT) ? F_DUPFD_CLOEXEC : F_DUPFD, 0)) == -1)
+        rc = ERROR_TOO_MANY_OPEN_FILES;
+
+    if (rc == NO_ERROR) {
+        HFileInfo info;
+        initHFileInfoFromUnixFd(npipe->listenfd, &info);
+        info.npipe = npipe;
+        writeHFile(slot, &info);
+        npipe->next = GNamedPipes;
+        GNamedPipes = npipe;
+    } else {
+        setHFileFd(slot, -1);
+        free(npipe);
+    } // else
+
+    ungrabLock(&GMutexDosCalls);
+
+    if (rc == NO_ERROR)
+        *pHpipe = hf;
+
+    return rc;
+} // DosCreateNPipe
+
+static APIRET getNPipe(HPIPE hpipe, HFileInfo *info, const int serveronly)
+{
+    if (!readHFile(hpipe, info))
+        return ERROR_INVALID_HANDLE;
+    else if (!info->npipe || (serveronly && (info->npipe->listenfd == -1)))
+        return ERROR_BAD_PIPE;
+    return NO_ERROR;
+} // getNPipe
+
+APIRET DosConnectNPipe(HPIPE hpipe)
+{
+    TRACE_NATIVE("DosConnectNPipe(%u)", (uint) hpipe);
+
+    HFileInfo info;
+    const APIRET rc = getNPipe(hpipe, &info, 1);
+    if (rc != NO_ERROR)
+        return rc;
+
+    NamedPipe *npipe = info.npipe;
+    if (info.fd != npipe->listenfd)
+        return NO_ERROR;  // already connected.
+
+    const int cloexec = (npipe->openmode & NP_NOINHERIT) ? SOCK_CLOEXEC : 0;
+    int fd;
+    while ((fd = accept4(npipe->listenfd, NULL, NULL, cloexec)) == -1) {
+        if (errno == EINTR)
+            continue;
+        else if ((errno != EAGAIN) && (errno != EWOULDBLOCK))
+            return ERROR_BAD_PIPE;
+        else if (npipe->pipemode & NP_NOWAIT)
+            return ERROR_PIPE_NOT_CONNECTED;
+
+        struct pollfd pfd = { npipe->listenfd, POLLIN, 0 };
+        poll(&pfd, 1, -1);
+    } // while
+
+    info.fd = fd;
+    grabLock(&GMutexDosCalls);
+    writeHFile(getHFileSlot(GHFiles, hpipe), &info);
+    ungrabLock(&GMutexDosCalls);
+
+    return NO_ERROR;
+} // DosConnectNPipe
+
+APIRET DosDisConnectNPipe(HPIPE hpipe)
+{
+    TRACE_NATIVE("DosDisConnectNPipe(%u)", (uint) hpipe);
+
+    HFileInfo info;
+    const APIRET rc = getNPipe(hpipe, &info, 1);
+    if (rc != NO_ERROR)
+        return rc;
+
+    NamedPipe *npipe = info.npipe;
+    const int fd = info.fd;
+    if (fd == npipe->listenfd)
+        return NO_ERROR;  // not connected.
+
+    // point the handle back at the listening socket before the client's fd goes away.
+    info.fd = npipe->listenfd;
+    grabLock(&GMutexDosCalls);
+    writeHFile(getHFileSlot(GHFiles, hpipe), &info);
+    free(npipe->pending);
+    npipe->pending = NULL;
+    npipe->pendinglen = npipe->pendingpos = 0;
+    ungrabLock(&GMutexDosCalls);
+
+    close(fd);
+    return NO_ERROR;
+} // DosDisConnectNPipe
+
+APIRET DosQueryNPHState(HPIPE hpipe, PULONG pState)
+{
+    TRACE_NATIVE("DosQueryNPHState(%u, %p)", (uint) hpipe, pState);
+
+    HFileInfo info;
+    const APIRET rc = getNPipe(hpipe, &info, 0);
+    if (rc != NO_ERROR)
+        return rc;
+    else if (!pState)
+        return ERROR_INVALID_PARAMETER;
+
+    *pState = info.npipe->pipemode | ((info.npipe->listenfd != -1) ? NP_END_SERVER : NP_END_CLIENT);
+    return NO_ERROR;
+} // DosQueryNPHState
+
+APIRET DosSetNPHState(HPIPE hpipe, ULONG state)
+{
+    TRACE_NATIVE("DosSetNPHState(%u, %u)", (uint) hpipe, (uint) state);
+
+    HFileInfo info;
+    const APIRET rc = getNPipe(hpipe, &info, 0);
+    if (rc != NO_ERROR)
+        return rc;
+
+    NamedPipe *npipe = info.npipe;
+    if (state & ~(NP_NOWAIT | NP_READMODE_MESSAGE))
+        return ERROR_INVALID_PARAMETER;
+    else if ((state & NP_READMODE_MESSAGE) && !(npipe->pipemode & NP_TYPE_MESSAGE))
+        return ERROR_INVALID_PARAMETER;
+
+    grabLock(&GMutexDosCalls);
+    npipe->pipemode = (npipe->pipemode & ~(NP_NOWAIT | NP_READMODE_MESSAGE)) | state;
+    ungrabLock(&GMutexDosCalls);
+
+    return NO_ERROR;
+} // DosSetNPHState
+
+static APIRET transactNPipe(const HFileInfo *info, PVOID pOutbuf, ULONG cbOut, PVOID pInbuf, ULONG cbIn, PULONG pcbRead)
+{
+    if (!(info->npipe->pipemode & NP_TYPE_MESSAGE))
+        return ERROR_BAD_FORMAT;
+    else if (info->npipe->pending)
+        return ERROR_PIPE_BUSY;  // there's still an unread message.
+
+    ULONG br = 0;
+    APIRET rc = writeNPipe(info, pOutbuf, cbOut, &br);
+    if (rc == NO_ERROR) {
+        br = 0;
+        rc = readNPipe(info, pInbuf, cbIn, &br, 1);
+    } // if
+
+    if (pcbRead)
+        *pcbRead = br;
+
+    return rc;
+} // transactNPipe
+
+APIRET DosTransactNPipe(HPIPE hpipe, PVOID pOutbuf, ULONG cbOut, PVOID pInbuf, ULONG cbIn, PULONG pcbRead)
+{
+    TRACE_NATIVE("DosTransactNPipe(%u, %p, %u, %p, %u, %p)", (uint) hpipe, pOutbuf, (uint) cbOut, pInbuf, (uint) cbIn, pcbRead);
+
+    HFileInfo info;
+    const APIRET rc = getNPipe(hpipe, &info, 0);
+    if (rc != NO_ERROR)
+        return rc;
+
+    return transactNPipe(&info, pOutbuf, cbOut, pInbuf, cbIn, pcbRead);
+} // DosTransactNPipe
+
+APIRET DosCallNPipe(PSZ pszName, PVOID pInbuf, ULONG cbIn, PVOID pOutbuf, ULONG cbOut, PULONG pcbActual, ULONG msec)
+{
+    TRACE_NATIVE("DosCallNPipe('%s', %p, %u, %p, %u, %p, %u)", pszName, pInbuf, (uint) cbIn, pOutbuf, (uint) cbOut, pcbActual, (uint) msec);
+
+    // !!! FIXME: connect() queues us on the listening socket instead of waiting up to (msec) for a free instance.
+    int fd = -1;
+    NamedPipe *npipe = NULL;
+    APIRET rc = connectNPipe(pszName, 1, &fd, &npipe);
+    if (rc != NO_ERROR)
+        return rc;
+
+    HFileInfo info;
+    initHFileInfoFromUnixFd(fd, &info);
+    info.npipe = npipe;
+    rc = transactNPipe(&info, pInbuf, cbIn, pOutbuf, cbOut, pcbActual);
+
+    close(fd);
+    free(npipe->pending);
+    free(npipe);
+    return rc;
+} // DosCallNPipe
+
 
 APIRET DosEnterMustComplete(PULONG pulNesting)
 {
@@ -1141,8 +5164,7 @@ static APIRET queryPathInfoEaSize(PSZ unixPath, PVOID pInfoBuf, ULONG cbInfoBuf)
         return rc;
 
     FILESTATUS4 *st = (FILESTATUS4 *) pInfoBuf;
-    FIXME("write me");
-    st->cbList = 0;
+    st->cbList = queryEaListSize(unixPath);
     return NO_ERROR;
 } // queryPathInfoEaSize
 
@@ -1181,8 +5203,9 @@ static APIRET queryPathInfoFullName(PSZ unixPath, PVOID pInfoBuf, ULONG cbInfoBu
 
 static APIRET queryPathInfoEasFromList(PSZ unixPath, PVOID pInfoBuf, ULONG cbInfoBuf)
 {
-    FIXME("write me");
-    return ERROR_INVALID_LEVEL;
+    if (cbInfoBuf < sizeof (EAOP2))
+        return ERROR_BUFFER_OVERFLOW;
+    return queryEAsFromList(unixPath, (EAOP2 *) pInfoBuf);
 } // queryPathInfoEasFromList
 
 static APIRET queryPathInfo(PSZ unixPath, ULONG ulInfoLevel, PVOID pInfoBuf, ULONG cbInfoBuf)
@@ -1224,7 +5247,7 @@ static APIRET queryFileInfoStandard(const struct stat *statbuf, PVOID pInfoBuf,
     return queryFileInfoStandardFromStat(statbuf, pInfoBuf, cbInfoBuf);
 } // queryFileInfoStandard
 
-static APIRET queryFileInfoEaSize(const struct stat *statbuf, PVOID pInfoBuf, ULONG cbInfoBuf)
+static APIRET queryFileInfoEaSize(const int fd, const struct stat *statbuf, PVOID pInfoBuf, ULONG cbInfoBuf)
 {
     if (cbInfoBuf < sizeof (FILESTATUS4))
         return ERROR_BUFFER_OVERFLOW;
@@ -1232,16 +5255,20 @@ static APIRET queryFileInfoEaSize(const struct stat *statbuf, PVOID pInfoBuf, UL
     if (rc != NO_ERROR)
         return rc;
 
+    char path[64];
+    getEaPathForFd(fd, path, sizeof (path));
     FILESTATUS4 *st = (FILESTATUS4 *) pInfoBuf;
-    FIXME("write me");
-    st->cbList = 0;
+    st->cbList = queryEaListSize(path);
     return NO_ERROR;
 } // queryFileInfoEaSize
 
-static APIRET queryFileInfoEasFromList(const struct stat *statbuf, PVOID pInfoBuf, ULONG cbInfoBuf)
+static APIRET queryFileInfoEasFromList(const int fd, PVOID pInfoBuf, ULONG cbInfoBuf)
 {
-    FIXME("write me");
-    return ERROR_INVALID_LEVEL;
+    if (cbInfoBuf < sizeof (EAOP2))
+        return ERROR_BUFFER_OVERFLOW;
+    char path[64];
+    getEaPathForFd(fd, path, sizeof (path));
+    return queryEAsFromList(path, (EAOP2 *) pInfoBuf);
 } // queryFileInfoEasFromList
 
 
@@ -1259,51 +5286,182 @@ APIRET DosQueryFileInfo(HFILE hf, ULONG ulInfoLevel, PVOID pInfo, ULONG cbInfoBu
 
     switch (ulInfoLevel) {
         case FIL_STANDARD: return queryFileInfoStandard(&statbuf, pInfo, cbInfoBuf);
-        case FIL_QUERYEASIZE: return queryFileInfoEaSize(&statbuf, pInfo, cbInfoBuf);
-        case FIL_QUERYEASFROMLIST: return queryFileInfoEasFromList(&statbuf, pInfo, cbInfoBuf);
+        case FIL_QUERYEASIZE: return queryFileInfoEaSize(fd, &statbuf, pInfo, cbInfoBuf);
+        case FIL_QUERYEASFROMLIST: return queryFileInfoEasFromList(fd, pInfo, cbInfoBuf);
         default: break;
     } // switch
 
     return ERROR_INVALID_LEVEL;
 } // DosQueryFileInfo
 
+// call with GMutexDosCalls held.
+static void retireThread(Thread *thread)
+{
+    thread->finished = 1;
+    thread->prev = NULL;
+    thread->next = GDeadThreads;
+    if (GDeadThreads)
+        GDeadThreads->prev = thread;
+    GDeadThreads = thread;
+    pthread_cond_broadcast(&GCondDeadThreads);
+} // retireThread
+
+static void waitForThreadResume(Thread *thread)
+{
+    while (__atomic_load_n(&thread->suspended, __ATOMIC_ACQUIRE))
+        futexWait(&thread->suspended, 1, NULL, 0);  // DosResumeThread() wakes us.
+} // waitForThreadResume
+
 static void os2ThreadCleanup(void *arg)
 {
     Thread *thread = (Thread *) arg;
     GLoaderState.deinitOs2Tib(thread->selector);
     grabLock(&GMutexDosCalls);
-    thread->prev = NULL;
-    thread->next = GDeadThreads;
-    GDeadThreads = thread;
+    retireThread(thread);
     ungrabLock(&GMutexDosCalls);
 } // os2ThreadCleanup
 
-static void os2ThreadEntry2(uint8 *tibspace, Thread *thread)
-{
-    void *esp = NULL;  // close enough.
-    GLoaderState.initOs2Tib(tibspace, &esp, thread->stacklen, (TID) thread);
-    thread->selector = GLoaderState.setOs2Tib(tibspace);
-    pthread_cleanup_push(os2ThreadCleanup, thread);
-    thread->fn(thread->fnarg);
-    pthread_cleanup_pop(1);
-} // os2ThreadEntry2
+static void os2ThreadEntry2(uint8 *tibspace, Thread *thread)
+{
+    void *esp = NULL;  // close enough.
+    GLoaderState.initOs2Tib(tibspace, &esp, thread->stacklen, (TID) thread);
+    thread->selector = GLoaderState.setOs2Tib(tibspace);
+    pthread_cleanup_push(os2ThreadCleanup, thread);
+    waitForThreadResume(thread);
+    thread->fn(thread->fnarg);
+    pthread_cleanup_pop(1);
+} // os2ThreadEntry2
+
+static void *os2ThreadEntry(void *arg)
+{
+    // put our thread's TIB structs on the stack and call that the top of the stack.
+    uint8 tibspace[LXTIBSIZE];
+    memset(tibspace, '\0', LXTIBSIZE);  // make sure TLS slots are clear, etc.
+    os2ThreadEntry2(tibspace, (Thread *) arg);
+    return NULL;  // OS/2 threads don't return a value here.
+} // os2ThreadEntry
+
+static void threadWorkerCleanup(void *arg)
+{
+    // the OS/2 thread called DosExit(EXIT_THREAD), which takes its pooled pthread down, too.
+    ThreadWorker *worker = (ThreadWorker *) arg;
+    Thread *thread = worker->job;
+    GLoaderState.deinitOs2Tib(thread->selector);
+    freeSem32ThreadState();  // the kernel hands any mutexes we still own to their waiters as owner-died.
+    grabLock(&GMutexDosCalls);
+    retireThread(thread);
+    ungrabLock(&GMutexDosCalls);
+    pthread_detach(worker->pthread);
+    free(worker);
+} // threadWorkerCleanup
+
+static void threadWorkerLoop(uint8 *tibspace, ThreadWorker *worker)
+{
+    void *esp = NULL;  // close enough.
+    const uint16 selector = GLoaderState.setOs2Tib(tibspace);  // the selector sticks around for every OS/2 thread we run.
+    uint32 state;
+
+    GSem32Thread.pooled = 1;
+
+    while (1) {
+        while ((state = __atomic_load_n(&worker->state, __ATOMIC_ACQUIRE)) == THREADWORKER_IDLE)
+            futexWait(&worker->state, THREADWORKER_IDLE, NULL, 0);  // DosCreateThread() wakes us.
+
+        if (state == THREADWORKER_QUIT)
+            break;
+
+        Thread *thread = worker->job;
+        memset(tibspace, '\0', LXTIBSIZE);  // each OS/2 thread gets clear TLS slots, etc.
+        GLoaderState.initOs2Tib(tibspace, &esp, thread->stacklen, (TID) thread);
+        thread->selector = selector;
+
+        pthread_cleanup_push(threadWorkerCleanup, worker);
+        waitForThreadResume(thread);
+        thread->fn(thread->fnarg);
+        pthread_cleanup_pop(0);
+
+        abandonSem32Mutexes();
+
+        // park before reporting the thread as dead, so whoever was waiting on it can reuse us right away.
+        grabLock(&GMutexDosCalls);
+        const int park = (GNumIdleThreadWorkers < GLoaderState.thread_pool);
+        if (park) {
+            worker->job = NULL;
+            __atomic_store_n(&worker->state, THREADWORKER_IDLE, __ATOMIC_RELEASE);
+            worker->next = GIdleThreadWorkers;
+            GIdleThreadWorkers = worker;
+            GNumIdleThreadWorkers++;
+        } // if
+        retireThread(thread);
+        ungrabLock(&GMutexDosCalls);
+
+        if (!park)
+            break;
+    } // while
+
+    GLoaderState.deinitOs2Tib(selector);
+    freeSem32ThreadState();
+
+    if (state != THREADWORKER_QUIT) {  // nobody is going to join us.
+        pthread_detach(worker->pthread);
+        free(worker);
+    } // if
+} // threadWorkerLoop
+
+static void *threadWorkerEntry(void *arg)
+{
+    ThreadWorker *worker = (ThreadWorker *) arg;
+    uint8 tibspace[LXTIBSIZE];
+    worker->pthread = pthread_self();  // pthread_create() might not have filled this in yet.
+    threadWorkerLoop(tibspace, worker);
+    return NULL;
+} // threadWorkerEntry
+
+static int startPooledThread(Thread *thread)
+{
+    ThreadWorker *worker = NULL;
+
+    grabLock(&GMutexDosCalls);
+    if (GIdleThreadWorkers) {
+        worker = GIdleThreadWorkers;
+        GIdleThreadWorkers = worker->next;
+        GNumIdleThreadWorkers--;
+    } // if
+    ungrabLock(&GMutexDosCalls);
+
+    if (worker) {
+        worker->job = thread;
+        worker->next = NULL;
+        __atomic_store_n(&worker->state, THREADWORKER_ASSIGNED, __ATOMIC_RELEASE);
+        futexWake(&worker->state, 1, 0);
+        return 0;
+    } // if
+
+    // nothing parked, so start a new pooled pthread; it'll park when this OS/2 thread is done.
+    worker = (ThreadWorker *) calloc(1, sizeof (ThreadWorker));
+    if (!worker)
+        return ENOMEM;
+
+    worker->job = thread;
+    worker->state = THREADWORKER_ASSIGNED;
+
+    pthread_t pt;
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, THREAD_POOL_STACKLEN);
+    const int rc = pthread_create(&pt, &attr, threadWorkerEntry, worker);
+    pthread_attr_destroy(&attr);
+
+    if (rc != 0)
+        free(worker);
 
-static void *os2ThreadEntry(void *arg)
-{
-    // put our thread's TIB structs on the stack and call that the top of the stack.
-    uint8 tibspace[LXTIBSIZE];
-    memset(tibspace, '\0', LXTIBSIZE);  // make sure TLS slots are clear, etc.
-    os2ThreadEntry2(tibspace, (Thread *) arg);
-    return NULL;  // OS/2 threads don't return a value here.
-} // os2ThreadEntry
+    return rc;
+} // startPooledThread
 
 APIRET DosCreateThread(PTID ptid, PFNTHREAD pfn, ULONG param, ULONG flag, ULONG cbStack)
 {
     TRACE_NATIVE("DosCreateThread(%p, %p, %u, %u, %u)", ptid, pfn, (uint) param, (uint) flag, (uint) cbStack);
 
-    if (flag & CREATE_SUSPENDED)
-        FIXME("Can't start threads in suspended state");
-
     Thread *thread = (Thread *) malloc(sizeof (Thread));
     if (!thread)
         return ERROR_NOT_ENOUGH_MEMORY;
@@ -1318,24 +5476,48 @@ APIRET DosCreateThread(PTID ptid, PFNTHREAD pfn, ULONG param, ULONG flag, ULONG
     thread->stacklen = stacksize;
     thread->fn = pfn;
     thread->fnarg = param;
+    thread->suspended = (flag & CREATE_SUSPENDED) ? 1 : 0;
 
-    pthread_attr_t attr;
-    pthread_attr_init(&attr);
-    pthread_attr_setstacksize(&attr, stacksize);
-    const int rc = pthread_create(&thread->thread, &attr, os2ThreadEntry, thread);
-    pthread_attr_destroy(&attr);
+    // the thread might run (and finish!) before we return, so hand out the TID first.
+    if (ptid)
+        *ptid = (TID) thread;
+
+    int rc;
+    if ((GLoaderState.thread_pool > 0) && (stacksize <= THREAD_POOL_STACKLEN)) {
+        thread->pooled = 1;
+        thread->stacklen = THREAD_POOL_STACKLEN;
+        rc = startPooledThread(thread);
+    } else {
+        pthread_attr_t attr;
+        pthread_attr_init(&attr);
+        pthread_attr_setstacksize(&attr, stacksize);
+        rc = pthread_create(&thread->thread, &attr, os2ThreadEntry, thread);
+        pthread_attr_destroy(&attr);
+    } // else
 
     if (rc != 0) {
         free(thread);
         return ERROR_MAX_THRDS_REACHED;  // I guess...?
     } // if
 
-    if (ptid)
-        *ptid = (TID) thread;
-
     return NO_ERROR;
 } // DosCreateThread
 
+APIRET DosResumeThread(TID tid)
+{
+    TRACE_NATIVE("DosResumeThread(%u)", (uint) tid);
+
+    // !!! FIXME: we only know how to resume CREATE_SUSPENDED threads, since there's no DosSuspendThread() yet.
+    Thread *thread = (Thread *) tid;
+    if (!thread)
+        return ERROR_INVALID_THREADID;
+    else if (!__atomic_exchange_n(&thread->suspended, 0, __ATOMIC_ACQ_REL))
+        return ERROR_NOT_FROZEN;
+
+    futexWake(&thread->suspended, 1, 0);
+    return NO_ERROR;
+} // DosResumeThread
+
 
 static void __attribute__((noreturn)) execOs2Child(const char *exe, char * const *argv, char * const *envp)
 {
@@ -1500,6 +5682,106 @@ static char **calcArgv(const char *os2args, APIRET *err)
     return retval;
 } // calcArgv
 
+// Processes lx_loader's zygote started for us with EXEC_ASYNCRESULT. They
+//  aren't our children, so waitpid() can't see them; the zygote sends their
+//  waitpid() status down (fd) when they end. Guarded by GMutexDosCalls.
+typedef struct ZygoteChild
+{
+    uint32 pid;
+    int fd;
+    struct ZygoteChild *next;
+} ZygoteChild;
+
+static ZygoteChild *GZygoteChildren = NULL;
+
+static int readZygoteStatus(const int fd, int *status)
+{
+    uint8 *ptr = (uint8 *) status;
+    size_t remain = sizeof (*status);
+    while (remain > 0) {
+        const ssize_t rc = read(fd, ptr, remain);
+        if ((rc == -1) && (errno == EINTR))
+            continue;
+        else if (rc <= 0)
+            return 0;  // the zygote died before it could tell us.
+        ptr += rc;
+        remain -= (size_t) rc;
+    } // while
+    return 1;
+} // readZygoteStatus
+
+// Wait up to (timeout) milliseconds, as poll() would, for one of the zygote's
+//  processes (all of them, or just (pid) if it isn't -1) to end. Returns -1
+//  if there aren't any such processes, 0 if none ended, 1 if one did: it's
+//  off the list, and (*childpid) and (*status) say which and how. (*known)
+//  is zero if the zygote died before it could tell us the status.
+static int pollZygoteChildren(const pid_t pid, const int timeout, PID *childpid, int *status, int *known)
+{
+    struct pollfd *pfds = NULL;
+    nfds_t total = 0;
+
+    grabLock(&GMutexDosCalls);
+    for (const ZygoteChild *child = GZygoteChildren; child; child = child->next) {
+        if ((pid == -1) || (child->pid == (uint32) pid))
+            total++;
+    } // for
+
+    if (total > 0) {
+        pfds = (struct pollfd *) malloc(sizeof (struct pollfd) * total);
+        nfds_t i = 0;
+        for (const ZygoteChild *child = GZygoteChildren; pfds && child; child = child->next) {
+            if ((pid == -1) || (child->pid == (uint32) pid)) {
+                pfds[i].fd = child->fd;
+                pfds[i].events = POLLIN;
+                pfds[i].revents = 0;
+                i++;
+            } // if
+        } // for
+    } // if
+    ungrabLock(&GMutexDosCalls);
+
+    if (total == 0)
+        return -1;
+
+    // if we're out of memory, just sleep and let the caller check again.
+    if (poll(pfds, pfds ? total : 0, timeout) <= 0) {
+        free(pfds);
+        return 0;
+    } // if
+
+    ZygoteChild *claimed = NULL;
+    for (nfds_t i = 0; (i < total) && !claimed; i++) {
+        if (!pfds[i].revents)
+            continue;
+
+        // another thread in DosWaitChild might have beat us to it.
+        grabLock(&GMutexDosCalls);
+        ZygoteChild *prev = NULL;
+        for (ZygoteChild *child = GZygoteChildren; child; prev = child, child = child->next) {
+            if ((child->fd == pfds[i].fd) && ((pid == -1) || (child->pid == (uint32) pid))) {
+                if (prev)
+                    prev->next = child->next;
+                else
+                    GZygoteChildren = child->next;
+                claimed = child;
+                break;
+            } // if
+        } // for
+        ungrabLock(&GMutexDosCalls);
+    } // for
+
+    free(pfds);
+
+    if (!claimed)
+        return 0;
+
+    *childpid = (PID) claimed->pid;
+    *known = readZygoteStatus(claimed->fd, status);
+    close(claimed->fd);
+    free(claimed);
+    return 1;
+} // pollZygoteChildren
+
 static void setProcessResultCode(PRESULTCODES pRes, const int status)
 {
     if (!pRes)
@@ -1580,6 +5862,47 @@ static APIRET DosExecPgm_implementation(PCHAR pObjname, LONG cbObjname, ULONG ex
 
     const int doubleFork = (execFlag == EXEC_ASYNC) || (execFlag == EXEC_BACKGROUND);
     int status = 0;
+
+    syncAllFileBuffers();  // the child should see everything we wrote, and inherited handles need the right file offsets.
+
+    // If lx_loader has a zygote running, let it fork a pre-initialized
+    //  process instead of exec'ing a fresh one. The new process isn't our
+    //  child, so the zygote reports its status to us instead of waitpid(),
+    //  which means we can't use it for EXEC_ASYNC and EXEC_BACKGROUND, since
+    //  those are detached from us anyhow.
+    if ((execFlag == EXEC_SYNC) || (execFlag == EXEC_ASYNCRESULT)) {
+        ZygoteChild *child = (execFlag == EXEC_SYNC) ? NULL : (ZygoteChild *) malloc(sizeof (ZygoteChild));
+        uint32 childpid = 0;
+        int statusfd = -1;
+        if (((execFlag == EXEC_SYNC) || child) && GLoaderState.execViaZygote(argv, envp, &childpid, &statusfd)) {
+            if (child) {
+                child->pid = childpid;
+                child->fd = statusfd;
+                grabLock(&GMutexDosCalls);
+                child->next = GZygoteChildren;
+                GZygoteChildren = child;
+                ungrabLock(&GMutexDosCalls);
+                if (pRes) {
+                    pRes->codeResult = 0;
+                    pRes->codeTerminate = (ULONG) childpid;
+                } // if
+            } else {
+                if (readZygoteStatus(statusfd, &status)) {
+                    setProcessResultCode(pRes, status);
+                } else if (pRes) {  // zygote died on us; we don't know how the child went.
+                    pRes->codeTerminate = TC_HARDERROR;
+                    pRes->codeResult = 0;
+                } // else if
+                close(statusfd);
+            } // else
+            free(envp);
+            free(argv);
+            free(exe);
+            return retval;
+        } // if
+        free(child);
+    } // if
+
     pid_t pid = fork();
     if (pid == -1)  // failed?
         retval = ERROR_NO_PROC_SLOTS;
@@ -1646,126 +5969,53 @@ APIRET DosResetEventSem(HEV hev, PULONG pulPostCt)
 {
     TRACE_NATIVE("DosResetEventSem(%u, %p)", (uint) hev, pulPostCt);
 
-    if (!hev)
+    int shared = 0;
+    Sem32 *sem = getSem32(hev, SEM32KIND_EVENT, &shared);
+    if (!sem)
         return ERROR_INVALID_HANDLE;
 
-    APIRET retval = NO_ERROR;
-    ULONG count = 0;
-    EventSem *sem = (EventSem *) hev;
-
-    pthread_mutex_lock(&sem->mutex);
-    count = sem->posted;
-    if (!sem->posted)
-        retval = ERROR_ALREADY_RESET;
-    else
-        sem->posted = 0;
-    pthread_mutex_unlock(&sem->mutex);
-
+    const ULONG count = (ULONG) __atomic_exchange_n(&sem->value, 0, __ATOMIC_SEQ_CST);
     if (pulPostCt)
         *pulPostCt = count;
 
-    return retval;
+    return count ? NO_ERROR : ERROR_ALREADY_RESET;
 } // DosResetEventSem
 
 APIRET DosPostEventSem(HEV hev)
 {
     TRACE_NATIVE("DosPostEventSem(%u)", (uint) hev);
 
-    if (!hev)
+    int shared = 0;
+    Sem32 *sem = getSem32(hev, SEM32KIND_EVENT, &shared);
+    if (!sem)
         return ERROR_INVALID_HANDLE;
 
-    APIRET retval = NO_ERROR;
-    EventSem *sem = (EventSem *) hev;
-
-    pthread_mutex_lock(&sem->mutex);
-    if (sem->posted)
-        retval = ERROR_ALREADY_POSTED;
-    else {
-        sem->posted = 1;
-        pthread_cond_broadcast(&sem->condition);
-    } // else
-    pthread_mutex_unlock(&sem->mutex);
-
-    return retval;
+    return postEventSem32(sem, shared);
 } // DosPostEventSem
 
 APIRET DosWaitEventSem(HEV hev, ULONG ulTimeout)
 {
     TRACE_NATIVE("DosWaitEventSem(%u, %u)", (uint) hev, (uint) ulTimeout);
 
-    if (!hev)
+    int shared = 0;
+    Sem32 *sem = getSem32(hev, SEM32KIND_EVENT, &shared);
+    if (!sem)
         return ERROR_INVALID_HANDLE;
 
-    EventSem *sem = (EventSem *) hev;
-    int posted = 0;
-
-    if (ulTimeout == SEM_IMMEDIATE_RETURN) {
-        pthread_mutex_lock(&sem->mutex);
-        posted = sem->posted;
-        pthread_mutex_unlock(&sem->mutex);
-        return posted ? NO_ERROR : ERROR_TIMEOUT;
-    } else if (ulTimeout == SEM_INDEFINITE_WAIT) {
-        pthread_mutex_lock(&sem->mutex);
-        sem->waiting++;
-        while (1) {
-            posted = sem->posted;
-            if (!posted) {
-                pthread_cond_wait(&sem->condition, &sem->mutex);
-                posted = sem->posted;
-            } // if
-
-            if (posted) {
-                sem->waiting--;
-                pthread_mutex_unlock(&sem->mutex);
-                return NO_ERROR;
-            } // if
-
-            // spurious wakeup? Block again.
-        } // while
-    } else {  // wait for X milliseconds.
-        struct timespec waittime;
-        timespecNowPlusMilliseconds(&waittime, ulTimeout);
-
-        pthread_mutex_lock(&sem->mutex);
-        sem->waiting++;
-        while (1) {
-            int rc = 0;
-            posted = sem->posted;
-            if (!posted) {
-                rc = pthread_cond_timedwait(&sem->condition, &sem->mutex, &waittime);
-                posted = sem->posted;
-            } // if
-
-            if ((posted) || (rc == ETIMEDOUT)) {
-                sem->waiting--;
-                pthread_mutex_unlock(&sem->mutex);
-                if (posted)
-                    return NO_ERROR;  // we're good.
-                else
-                    return ERROR_TIMEOUT;
-            } // if
-
-            // otherwise, try again...spurious wakeup?
-        } // while
-    } // else
-
-    return NO_ERROR;
+    return waitEventSem32(sem, ulTimeout, shared);
 } // DosWaitEventSem
 
 APIRET DosQueryEventSem(HEV hev, PULONG pulPostCt)
 {
     TRACE_NATIVE("DosQueryEventSem(%u, %p)", (uint) hev, pulPostCt);
 
-    if (!hev)
+    int shared = 0;
+    Sem32 *sem = getSem32(hev, SEM32KIND_EVENT, &shared);
+    if (!sem)
         return ERROR_INVALID_HANDLE;
 
-    EventSem *sem = (EventSem *) hev;
-    pthread_mutex_lock(&sem->mutex);
-    const ULONG count = (ULONG) sem->posted;
-    pthread_mutex_unlock(&sem->mutex);
-
     if (pulPostCt)
-        *pulPostCt = count;
+        *pulPostCt = (ULONG) __atomic_load_n(&sem->value, __ATOMIC_SEQ_CST);
 
     return NO_ERROR;
 } // DosQueryEventSem
@@ -1773,34 +6023,75 @@ APIRET DosQueryEventSem(HEV hev, PULONG pulPostCt)
 APIRET DosCloseEventSem(HEV hev)
 {
     TRACE_NATIVE("DosCloseEventSem(%u)", (uint) hev);
+    return closeSem32(hev, SEM32KIND_EVENT);
+} // DosCloseEventSem
 
-    if (!hev)
-        return ERROR_INVALID_HANDLE;
-
-    EventSem *sem = (EventSem *) hev;
-
-    pthread_mutex_lock(&sem->mutex);
-    const int waiting = sem->waiting;
-    pthread_mutex_unlock(&sem->mutex);
-
-    if (waiting > 0)
-        return ERROR_SEM_BUSY;
+static APIRET DosFreeMem_implementation(PVOID pb)
+{
+    APIRET retval = NO_ERROR;
 
-    pthread_mutex_destroy(&sem->mutex);
-    pthread_cond_destroy(&sem->condition);
-    free(sem);
+    grabLock(&GMutexMemObjects);
+    MemObject *obj = findMemObject(pb);
+    if (!obj || (obj->addr != (uint8 *) pb)) {
+        retval = ERROR_INVALID_ADDRESS;  // has to be the base of an object.
+    } else {
+        munmap(obj->addr, ((size_t) obj->numpages) * MEMOBJ_PAGESIZE);
+        free(obj->pages);
+        const uint32 idx = (uint32) (obj - GMemObjects);
+        GNumMemObjects--;
+        memmove(obj, obj + 1, sizeof (MemObject) * (GNumMemObjects - idx));
+    } // else
+    ungrabLock(&GMutexMemObjects);
 
-    return NO_ERROR;
-} // DosCloseEventSem
+    return retval;
+} // DosFreeMem_implementation
 
 APIRET DosFreeMem(PVOID pb)
 {
     TRACE_NATIVE("DosFreeMem(%p)", pb);
+    return DosFreeMem_implementation(pb);
+} // DosFreeMem
+
+static APIRET DosQueryMem_implementation(PVOID pb, PULONG pcb, PULONG pFlag)
+{
+    if (!pcb || !pFlag || (*pcb == 0))
+        return ERROR_INVALID_PARAMETER;
+
+    const uint8 *addr = (const uint8 *) pb;
+    const uint64 wanted = ((uint64) (((uintptr_t) addr) & (MEMOBJ_PAGESIZE - 1))) + *pcb;
+    const uint32 wantedpages = (uint32) ((wanted + (MEMOBJ_PAGESIZE - 1)) / MEMOBJ_PAGESIZE);
+
+    grabLock(&GMutexMemObjects);
+    const MemObject *obj = findMemObject(pb);
+    if (obj) {
+        const uint32 first = (uint32) ((addr - obj->addr) / MEMOBJ_PAGESIZE);
+        const uint8 state = obj->pages[first];
+        uint32 count = 1;
+        while ((count < wantedpages) && ((first + count) < obj->numpages) && (obj->pages[first + count] == state))
+            count++;
+        *pcb = count * MEMOBJ_PAGESIZE;
+        *pFlag = ((ULONG) state) | ((first == 0) ? PAG_BASE : 0);
+    } // if
+    ungrabLock(&GMutexMemObjects);
+
+    if (!obj) {
+        // !!! FIXME: we don't track memory we didn't allocate here (module
+        // !!! FIXME:  objects, stacks, etc), so all we can say is if the
+        // !!! FIXME:  page is mapped at all.
+        const uintptr_t page = ((uintptr_t) addr) & ~((uintptr_t) (MEMOBJ_PAGESIZE - 1));
+        const int mapped = (madvise((void *) page, MEMOBJ_PAGESIZE, MADV_NORMAL) == 0);
+        *pcb = MEMOBJ_PAGESIZE;
+        *pFlag = mapped ? (PAG_COMMIT | PAG_READ | PAG_WRITE) : PAG_FREE;
+    } // if
 
-    // !!! FIXME: this API is actually much more complicated than this.
-    free(pb);
     return NO_ERROR;
-} // DosFreeMem
+} // DosQueryMem_implementation
+
+APIRET DosQueryMem(PVOID pb, PULONG pcb, PULONG pFlag)
+{
+    TRACE_NATIVE("DosQueryMem(%p, %p, %p)", pb, pcb, pFlag);
+    return DosQueryMem_implementation(pb, pcb, pFlag);
+} // DosQueryMem
 
 APIRET DosWaitChild(ULONG action, ULONG option, PRESULTCODES pres, PPID ppid, PID pid)
 {
@@ -1814,43 +6105,64 @@ APIRET DosWaitChild(ULONG action, ULONG option, PRESULTCODES pres, PPID ppid, PI
         return ERROR_INVALID_PARAMETER;
     } // if
 
-    pid_t unixpid;
-    if (action == DCWA_PROCESS)
-        unixpid = (pid == 0) ? (pid_t) -1 : (pid_t) pid;
-
-    int waitoptions;
-    if (option == DCWW_WAIT) {
-        waitoptions = 0;
-    } else if (option == DCWW_NOWAIT) {
-        waitoptions = WNOHANG;
-    } else {
+    if ((option != DCWW_WAIT) && (option != DCWW_NOWAIT))
         return ERROR_INVALID_PARAMETER;
-    } // else
 
+    const pid_t unixpid = (pid == 0) ? (pid_t) -1 : (pid_t) pid;
+    PID childpid = 0;
     int status = 0;
-    pid_t rc;
+    int known = 1;
+
     while (1) {
-        rc = waitpid(unixpid, &status, waitoptions);
-        if (rc == 0) {  // WNOHANG and no children were done.
-            assert(option == DCWW_NOWAIT);
-            return ERROR_CHILD_NOT_COMPLETE;
-        } else if (rc == -1) {
-            if (errno == EINTR)
+        // processes lx_loader's zygote started for us aren't our children,
+        //  so waitpid() won't find them. Check on those first.
+        const int zygoterc = pollZygoteChildren(unixpid, 0, &childpid, &status, &known);
+        if (zygoterc > 0)
+            break;
+
+        // if (pid) is one of the zygote's, don't bother with waitpid().
+        int haveunixchildren = 0;
+        if ((zygoterc < 0) || (pid == 0)) {
+            const pid_t rc = waitpid(unixpid, &status, WNOHANG);
+            if (rc > 0) {
+                childpid = (PID) rc;
+                break;  // we're good.
+            } else if (rc == 0) {
+                haveunixchildren = 1;
+            } else if (errno == EINTR) {
                 continue;  // try again, I guess.
-            else if (errno == ECHILD)
-                return (pid == 0) ? ERROR_WAIT_NO_CHILDREN : ERROR_INVALID_PROCID;
-        } else {
-            break;  // we're good.
-        } // else
+            } // else if
+        } // if
+
+        if ((zygoterc < 0) && !haveunixchildren)
+            return (pid == 0) ? ERROR_WAIT_NO_CHILDREN : ERROR_INVALID_PROCID;
+        else if (option == DCWW_NOWAIT)
+            return ERROR_CHILD_NOT_COMPLETE;
 
-        assert(!"Shouldn't hit this code");
-        return ERROR_CHILD_NOT_COMPLETE;
+        if (zygoterc < 0) {  // only real children, so block in waitpid().
+            const pid_t rc = waitpid(unixpid, &status, 0);
+            if (rc > 0) {
+                childpid = (PID) rc;
+                break;
+            } // if
+            continue;  // interrupted, or it's gone now. Check everything again.
+        } // if
+
+        // We can't block on poll() and waitpid() at the same time, so if
+        //  there are real children too, wake up now and then to check them.
+        if (pollZygoteChildren(unixpid, haveunixchildren ? 100 : -1, &childpid, &status, &known) > 0)
+            break;
     } // while
 
     if (ppid)
-        *ppid = (PID) rc;
+        *ppid = childpid;
 
-    setProcessResultCode(pres, status);
+    if (known) {
+        setProcessResultCode(pres, status);
+    } else if (pres) {  // zygote died on us; we don't know how the child went.
+        pres->codeTerminate = TC_HARDERROR;
+        pres->codeResult = 0;
+    } // else if
 
     return NO_ERROR;
 } // DosWaitChild
@@ -1866,37 +6178,38 @@ APIRET DosWaitThread(PTID ptid, ULONG option)
         return ERROR_INVALID_PARAMETER;
 
     if (thread == NULL) {   // check our dead thread list for anything.
-        while (1) {
-            grabLock(&GMutexDosCalls);
-            if (GDeadThreads) {
-                thread = GDeadThreads;
-                GDeadThreads = thread->next;
-                if (GDeadThreads)
-                    GDeadThreads->prev = NULL;
-                assert(!thread->prev);
-            } // if
-            ungrabLock(&GMutexDosCalls);
-
-            if (thread) {
-                pthread_join(thread->thread, &exitcode);  // reap it.
-                *ptid = (TID) thread;
-                free(thread);
-                return NO_ERROR;
-            } // if
-
-            if (option == DCWW_NOWAIT)
-                return ERROR_THREAD_NOT_TERMINATED;
+        grabLock(&GMutexDosCalls);
+        while (!GDeadThreads && (option == DCWW_WAIT))
+            pthread_cond_wait(&GCondDeadThreads, &GMutexDosCalls);  // os2ThreadCleanup() wakes us.
+
+        thread = GDeadThreads;
+        if (thread) {
+            GDeadThreads = thread->next;
+            if (GDeadThreads)
+                GDeadThreads->prev = NULL;
+            assert(!thread->prev);
+        } // if
+        ungrabLock(&GMutexDosCalls);
 
-            usleep(10000);  // sleep then try again, for DCWW_WAIT.
-        } // while
+        if (!thread)
+            return ERROR_THREAD_NOT_TERMINATED;
 
-        assert(!"shouldn't hit this code");
-        return ERROR_THREAD_NOT_TERMINATED; // !!! FIXME
+        if (!thread->pooled)
+            pthread_join(thread->thread, &exitcode);  // reap it.
+        *ptid = (TID) thread;
+        free(thread);
+        return NO_ERROR;
     } // if
 
     // codepath if we were waiting for a specific thread.
     int rc;
-    if (option == DCWW_NOWAIT) {
+    if (thread->pooled) {  // pooled pthreads don't exit, so wait for the OS/2 thread to land on GDeadThreads.
+        grabLock(&GMutexDosCalls);
+        while (!thread->finished && (option == DCWW_WAIT))
+            pthread_cond_wait(&GCondDeadThreads, &GMutexDosCalls);  // threadWorkerLoop() wakes us.
+        rc = thread->finished ? 0 : EBUSY;
+        ungrabLock(&GMutexDosCalls);
+    } else if (option == DCWW_NOWAIT) {
         rc = pthread_tryjoin_np(thread->thread, &exitcode);
     } else {  //if (option == DCWW_WAIT)
         rc = pthread_join(thread->thread, &exitcode);
@@ -1932,12 +6245,62 @@ APIRET DosSleep(ULONG msec)
     return NO_ERROR;
 } // DosSleep
 
+// Does [off, off+size) overlap anything on the free lists? This walks all of
+//  them, so only call it when SUBHEAP_FREE_MARK says it's worth checking.
+static int isSubHeapBlockFree(const SubHeap *heap, const uint32 off, const uint32 size)
+{
+    for (uint32 i = 0; i < SUBHEAP_NUM_CLASSES; i++) {
+        const uint32 blksize = (i + 1) * SUBHEAP_GRANULARITY;
+        for (uint32 blk = heap->classes[i]; blk; blk = SUBHEAP_BLOCK(heap, blk)->next) {
+            if ((blk < (off + size)) && (off < (blk + blksize)))
+                return 1;
+        } // for
+    } // for
+
+    for (uint32 blk = heap->large; blk && (blk < (off + size)); blk = SUBHEAP_BLOCK(heap, blk)->next) {
+        if (off < (blk + SUBHEAP_BLOCK(heap, blk)->size))
+            return 1;
+    } // for
+
+    return 0;
+} // isSubHeapBlockFree
+
 APIRET DosSubFreeMem(PVOID pbBase, PVOID pb, ULONG cb)
 {
     TRACE_NATIVE("DosSubFreeMem(%p, %p, %u)", pbBase, pb, (uint) cb);
-    free(pb);  // !!! FIXME: obviously wrong
-    return NO_ERROR;
-} // DosSubAllocMem
+
+    SubHeap *heap = getSubHeap(pbBase);
+    if (!heap)
+        return ERROR_DOSSUB_CORRUPTED;
+    else if (cb == 0)
+        return ERROR_DOSSUB_BADSIZE;
+
+    const uint32 size = subHeapRoundSize(cb);
+    const uintptr_t off = (uintptr_t) (((uint8 *) pb) - ((uint8 *) heap));
+    if (((uint8 *) pb) < ((uint8 *) heap) || (off < SUBHEAP_HEADER_SIZE) || (off & (SUBHEAP_GRANULARITY - 1)))
+        return ERROR_DOSSUB_OVERLAP;
+
+    APIRET retval = NO_ERROR;
+    lockSubHeap(heap);
+    if (((off + size) > heap->top) || ((off + size) < off)) {
+        retval = ERROR_DOSSUB_OVERLAP;  // not inside the allocated part of the pool.
+    } else if (size <= SUBHEAP_MAX_SMALL) {
+        SubHeapBlock *blk = SUBHEAP_BLOCK(heap, off);
+        if ((blk->size == (SUBHEAP_FREE_MARK ^ (uint32) off)) && isSubHeapBlockFree(heap, (uint32) off, size)) {
+            retval = ERROR_DOSSUB_OVERLAP;  // double free.
+        } else {
+            uint32 *list = &heap->classes[(size / SUBHEAP_GRANULARITY) - 1];
+            blk->next = *list;
+            blk->size = SUBHEAP_FREE_MARK ^ (uint32) off;
+            *list = (uint32) off;
+        } // else
+    } else {
+        retval = insertSubHeapLarge(heap, (uint32) off, size);
+    } // else
+    unlockSubHeap(heap);
+
+    return retval;
+} // DosSubFreeMem
 
 static APIRET DosDelete_implementation(PSZ pszFile)
 {
@@ -1948,39 +6311,159 @@ static APIRET DosDelete_implementation(PSZ pszFile)
     if (!unixpath)
         return err;
 
-    const int rc = unlink(unixpath);
-    free(unixpath);
-    if (rc == -1) {
-        switch (errno) {
-            case EACCES: return ERROR_ACCESS_DENIED;
-            case EBUSY: return ERROR_ACCESS_DENIED;
-            case EISDIR: return ERROR_ACCESS_DENIED;
-            case ENAMETOOLONG: return ERROR_FILENAME_EXCED_RANGE;
-            case ENOENT: return ERROR_FILE_NOT_FOUND;  // !!! FIXME: could be PATH_NOT_FOUND too, depending on circumstances.
-            case ENOTDIR: return ERROR_PATH_NOT_FOUND;
-            case EPERM: return ERROR_ACCESS_DENIED;
-            case EROFS: return ERROR_ACCESS_DENIED;
-            case ETXTBSY: return ERROR_ACCESS_DENIED;
-            default: return ERROR_INVALID_PARAMETER;  // !!! FIXME: debug logging about missin errno case.
-        } // switch
-        __builtin_unreachable();
-    } // if
+    const int rc = unlink(unixpath);
+    if (rc == 0)
+        forgetEAs(unixpath);  // xattrs go away with the file, but a sidecar record wouldn't.
+    free(unixpath);
+    if (rc == -1) {
+        switch (errno) {
+            case EACCES: return ERROR_ACCESS_DENIED;
+            case EBUSY: return ERROR_ACCESS_DENIED;
+            case EISDIR: return ERROR_ACCESS_DENIED;
+            case ENAMETOOLONG: return ERROR_FILENAME_EXCED_RANGE;
+            case ENOENT: return ERROR_FILE_NOT_FOUND;  // !!! FIXME: could be PATH_NOT_FOUND too, depending on circumstances.
+            case ENOTDIR: return ERROR_PATH_NOT_FOUND;
+            case EPERM: return ERROR_ACCESS_DENIED;
+            case EROFS: return ERROR_ACCESS_DENIED;
+            case ETXTBSY: return ERROR_ACCESS_DENIED;
+            default: return ERROR_INVALID_PARAMETER;  // !!! FIXME: debug logging about missin errno case.
+        } // switch
+        __builtin_unreachable();
+    } // if
+
+    return NO_ERROR;
+} // DosDelete_implementation
+
+APIRET DosDelete(PSZ pszFile)
+{
+    TRACE_NATIVE("DosDelete('%s')", pszFile);
+    return DosDelete_implementation(pszFile);
+} // DosDelete
+
+APIRET DosSetPathInfo(PSZ pszPathName, ULONG ulInfoLevel, PVOID pInfoBuf, ULONG cbInfoBuf, ULONG flOptions)
+{
+    TRACE_NATIVE("DosSetPathInfo('%s', %u, %p, %u, %u)", pszPathName, (uint) ulInfoLevel, pInfoBuf, (uint) cbInfoBuf, (uint) flOptions);
+
+    if (ulInfoLevel == FIL_STANDARD) {
+        FIXME("write me");
+        return NO_ERROR;
+    } else if (ulInfoLevel != FIL_QUERYEASIZE) {
+        return ERROR_INVALID_LEVEL;
+    } else if (!pInfoBuf || (cbInfoBuf < sizeof (EAOP2))) {
+        return ERROR_INVALID_PARAMETER;
+    } // else if
+
+    EAOP2 *eaop2 = (EAOP2 *) pInfoBuf;
+    if (!eaop2->fpFEA2List)
+        return ERROR_INVALID_PARAMETER;
+
+    APIRET err = NO_ERROR;
+    char *unixPath = makeUnixPath(pszPathName, &err);
+    if (!unixPath)
+        return err;
+    err = setEAs(unixPath, eaop2->fpFEA2List, 0, &eaop2->oError);
+    free(unixPath);
+    return err;
+} // DosSetPathInfo
+
+APIRET DosSetFileInfo(HFILE hf, ULONG ulInfoLevel, PVOID pInfoBuf, ULONG cbInfoBuf)
+{
+    TRACE_NATIVE("DosSetFileInfo(%u, %u, %p, %u)", (uint) hf, (uint) ulInfoLevel, pInfoBuf, (uint) cbInfoBuf);
+
+    const int fd = getHFileUnixDescriptor(hf);
+    if (fd == -1)
+        return ERROR_INVALID_HANDLE;
+
+    if (ulInfoLevel == FIL_STANDARD) {
+        FIXME("write me");
+        return NO_ERROR;
+    } else if (ulInfoLevel != FIL_QUERYEASIZE) {
+        return ERROR_INVALID_LEVEL;
+    } else if (!pInfoBuf || (cbInfoBuf < sizeof (EAOP2))) {
+        return ERROR_INVALID_PARAMETER;
+    } // else if
+
+    EAOP2 *eaop2 = (EAOP2 *) pInfoBuf;
+    if (!eaop2->fpFEA2List)
+        return ERROR_INVALID_PARAMETER;
+
+    char path[64];
+    getEaPathForFd(fd, path, sizeof (path));
+    return setEAs(path, eaop2->fpFEA2List, 0, &eaop2->oError);
+} // DosSetFileInfo
+
+APIRET DosEnumAttribute(ULONG ulRefType, PVOID pvFile, ULONG ulEntry, PVOID pvBuf, ULONG cbBuf, PULONG pulCount, ULONG ulInfoLevel)
+{
+    TRACE_NATIVE("DosEnumAttribute(%u, %p, %u, %p, %u, %p, %u)", (uint) ulRefType, pvFile, (uint) ulEntry, pvBuf, (uint) cbBuf, pulCount, (uint) ulInfoLevel);
+
+    if (ulInfoLevel != ENUMEA_LEVEL_NO_VALUE)
+        return ERROR_INVALID_LEVEL;
+    else if (!pvFile || !pvBuf || !pulCount || (ulEntry == 0))
+        return ERROR_INVALID_PARAMETER;
+
+    APIRET err = NO_ERROR;
+    char fdpath[64];
+    char *unixPath = NULL;
+    const char *path = NULL;
+    if (ulRefType == ENUMEA_REFTYPE_FHANDLE) {
+        const int fd = getHFileUnixDescriptor(*((HFILE *) pvFile));
+        if (fd == -1)
+            return ERROR_INVALID_HANDLE;
+        getEaPathForFd(fd, fdpath, sizeof (fdpath));
+        path = fdpath;
+    } else if (ulRefType == ENUMEA_REFTYPE_PATH) {
+        unixPath = makeUnixPath((PSZ) pvFile, &err);
+        if (!unixPath)
+            return err;
+        path = unixPath;
+    } else {
+        return ERROR_INVALID_PARAMETER;
+    } // else
+
+    uint8 *blob = NULL;
+    uint32 bloblen = 0;
+    err = loadEAs(path, &blob, &bloblen);
+    free(unixPath);
+    if (err != NO_ERROR)
+        return err;
+
+    // skip to entry number (ulEntry), then copy out as many as fit and were asked for.
+    const ULONG maxcount = *pulCount;
+    const FEA2 *fea = (bloblen > EA_EMPTY_LIST_SIZE) ? (const FEA2 *) (blob + EA_EMPTY_LIST_SIZE) : NULL;
+    for (ULONG i = 1; fea && (i < ulEntry); i++)
+        fea = fea->oNextEntryOffset ? (const FEA2 *) (((const uint8 *) fea) + fea->oNextEntryOffset) : NULL;
 
-    return NO_ERROR;
-} // DosDelete_implementation
+    uint8 *out = (uint8 *) pvBuf;
+    uint32 pos = 0;
+    ULONG count = 0;
+    DENA2 *prev = NULL;
+    while (fea && (count < maxcount)) {
+        const uint32 len = fea2EntrySize(fea->cbName, 0);
+        if ((pos + len) > cbBuf) {
+            if (count == 0)
+                err = ERROR_BUFFER_OVERFLOW;
+            break;
+        } // if
 
-APIRET DosDelete(PSZ pszFile)
-{
-    TRACE_NATIVE("DosDelete('%s')", pszFile);
-    return DosDelete_implementation(pszFile);
-} // DosDelete
+        DENA2 *dena = (DENA2 *) (out + pos);
+        dena->oNextEntryOffset = 0;
+        dena->fEA = fea->fEA;
+        dena->cbName = fea->cbName;
+        dena->cbValue = fea->cbValue;
+        memcpy(dena->szName, fea->szName, fea->cbName + 1);
+        if (prev)
+            prev->oNextEntryOffset = (ULONG) (((uint8 *) dena) - ((uint8 *) prev));
+        prev = dena;
+        pos += alignEaEntry(len);
+        count++;
+
+        fea = fea->oNextEntryOffset ? (const FEA2 *) (((const uint8 *) fea) + fea->oNextEntryOffset) : NULL;
+    } // while
 
-APIRET DosSetPathInfo(PSZ pszPathName, ULONG ulInfoLevel, PVOID pInfoBuf, ULONG cbInfoBuf, ULONG flOptions)
-{
-    TRACE_NATIVE("DosSetPathInfo('%s', %u, %p, %u, %u)", pszPathName, (uint) ulInfoLevel, pInfoBuf, (uint) cbInfoBuf, (uint) flOptions);
-    FIXME("write me");
-    return NO_ERROR;
-} // DosSetPathInfo
+    free(blob);
+    *pulCount = count;
+    return err;
+} // DosEnumAttribute
 
 APIRET DosQueryModuleHandle(PSZ pszModname, PHMODULE phmod)
 {
@@ -2012,6 +6495,8 @@ APIRET DosQueryProcAddr(HMODULE hmod, ULONG ordinal, PSZ pszName, PFN* ppfn)
     } else if (ordinal != 0) {
         for (uint32 i = 0; i < num_exports; i++, exports++) {
             if (exports->ordinal == ordinal) {
+                if (!exports->addr)
+                    return ERROR_PROC_NOT_FOUND;  // forwarded to an entry point that doesn't exist.
                 if (ppfn)
                     *ppfn = (PFN) exports->addr;
                 return NO_ERROR;
@@ -2023,6 +6508,8 @@ APIRET DosQueryProcAddr(HMODULE hmod, ULONG ordinal, PSZ pszName, PFN* ppfn)
         //  the DOSCALLS module, but whatever, I allow it.
         for (uint32 i = 0; i < num_exports; i++, exports++) {
             if (exports->name && (strcmp(exports->name, pszName) == 0)) {
+                if (!exports->addr)
+                    return ERROR_PROC_NOT_FOUND;  // forwarded to an entry point that doesn't exist.
                 if (ppfn)
                     *ppfn = (PFN) exports->addr;
                 return NO_ERROR;
@@ -2065,48 +6552,297 @@ static inline ULONG findNextSizeNeeded(const ULONG ulInfoLevel, const ULONG pcFi
         case -1: return (sizeof (FILEFINDBUF) - CCHMAXPATHCOMP) * pcFileNames;
         case FIL_STANDARD: return (sizeof (FILEFINDBUF3) - CCHMAXPATHCOMP) * pcFileNames;
         case FIL_QUERYEASIZE: return (sizeof (FILEFINDBUF4) - CCHMAXPATHCOMP) * pcFileNames;
-        case FIL_QUERYEASFROMLIST: FIXME("write me"); return 0xFFFFFFFF;
+        case FIL_QUERYEASFROMLIST: return sizeof (EAOP2) + ((sizeof (FILEFINDBUF4) - CCHMAXPATHCOMP) * pcFileNames);
         default: assert(!"Shouldn't hit this."); return 0xFFFFFFFF;
     } // switch
     __builtin_unreachable();
 } // findNextSizeNeeded;
 
+static inline char foldWildcardChar(const char ch)
+{
+    return ((ch >= 'A') && (ch <= 'Z')) ? (ch - ('A' - 'a')) : ch;
+} // foldWildcardChar
+
+// OS/2 pattern rules: '*' matches any run of characters (dots included),
+//  '?' matches one character but matches nothing at a '.' or the end of the
+//  name, and the pattern's first '.' also matches the end of a name that has
+//  no '.' in it, so "FOO.*" finds "FOO", "*." finds names without an
+//  extension, and "*.*" finds everything.
+// (pattern) must already be case-folded. When something doesn't match, we
+//  back up to the most recent '*' and let it eat one more character.
+// !!! FIXME: the way OS/2 matches files is sort of complex, and I'm not sure this is 100% right.
 static int wildcardMatch(const char *str, const char *pattern)
 {
-    // !!! FIXME: the way OS/2 matches files is sort of complex, and I'm not sure this is 100% right.
+    const char *starpat = NULL;
+    const char *starstr = NULL;
+    int starext = 0;
     int ext = 0;
+    const int nodot = (strchr(str, '.') == NULL);
+
     while (1) {
-        const char pat = *(pattern++);
-        if (pat == '\0') {
-            return (*str == '\0') ? 1 : 0;
+        const char pat = *pattern;
+        if (pat == '*') {
+            starpat = ++pattern;
+            starstr = str;
+            starext = ext;
+            continue;
+        } else if (pat == '\0') {
+            if (*str == '\0')
+                return 1;
         } else if (pat == '?') {
-            if (*str)  // also matches end of string, but don't advance.
+            if (*str && (*str != '.'))
                 str++;
-        } else if ((pat == '.') && (!ext)) {
+            pattern++;
+            continue;
+        } else if ((pat == '.') && (!ext) && ((*str == '.') || ((*str == '\0') && nodot))) {
             ext = 1;
-            if (*str == '.')
-                str++;
-            else if (*str != '\0')
-                return 0;
-        } else if (pat == '*') {
-            const char next = *pattern;
-            while (*str && (*str != next))
-                str++;
-        } else {
-            const char ch = *str;
-            const char a = ((ch >= 'A') && (ch <= 'Z')) ? (ch - ('A' - 'a')) : ch;
-            const char b = ((pat >= 'A') && (pat <= 'Z')) ? (pat - ('A' - 'a')) : pat;
-            if (a == b)
+            if (*str)
                 str++;
-            else
-                return 0;
-        } // else
+            pattern++;
+            continue;
+        } else if (*str && (foldWildcardChar(*str) == pat)) {
+            str++;
+            pattern++;
+            continue;
+        } // else if
+
+        // mismatch. Backtrack, if there's a '*' that can take another char.
+        if (!starpat || !*starstr)
+            return 0;
+        str = ++starstr;
+        pattern = starpat;
+        ext = starext;
     } // while
 
     __builtin_unreachable();
 } // wildcardMatch
 
-static int findNextOne(DirFinder *dirf, PVOID *ppfindbuf, PULONG pcbBuf, int *err)
+static int wildcardLiteralMatch(const char *str, const char *literal, const uint32 len)
+{
+    for (uint32 i = 0; i < len; i++) {
+        if (foldWildcardChar(str[i]) != literal[i])
+            return 0;
+    } // for
+    return 1;
+} // wildcardLiteralMatch
+
+// (pattern) must be shorter than CCHMAXPATHCOMP.
+static void compileWildcard(WildcardMatcher *matcher, const char *pattern)
+{
+    const uint32 len = (uint32) strlen(pattern);
+    for (uint32 i = 0; i <= len; i++)
+        matcher->pattern[i] = foldWildcardChar(pattern[i]);
+
+    uint32 lead = 0;
+    while ((lead < len) && (pattern[lead] == '*'))
+        lead++;
+
+    uint32 trail = 0;
+    while ((trail < (len - lead)) && (pattern[len - trail - 1] == '*'))
+        trail++;
+
+    const char *literal = matcher->pattern + lead;
+    const uint32 literallen = len - lead - trail;
+    matcher->literalpos = lead;
+    matcher->literallen = literallen;
+    matcher->prefixlen = (uint32) strcspn(matcher->pattern, "*?");
+    matcher->suffixlen = 0;
+    while ((matcher->suffixlen < len) && !strchr("*?", matcher->pattern[len - matcher->suffixlen - 1]))
+        matcher->suffixlen++;
+
+    // a '.' next to a wildcard might match the end of the name instead.
+    if (matcher->prefixlen && (matcher->pattern[matcher->prefixlen - 1] == '.'))
+        matcher->prefixlen--;
+    if (matcher->suffixlen && (matcher->pattern[len - 1] == '.'))
+        matcher->suffixlen = 0;
+    matcher->suffixpos = len - matcher->suffixlen;
+
+    if (literallen == 0) {
+        matcher->type = WILDCARD_ANY;  // "*", "**", etc.
+    } else if ((literallen == 1) && (*literal == '.') && lead && trail) {
+        matcher->type = WILDCARD_ANY;  // "*.*"
+    } else if (memchr(literal, '*', literallen) || memchr(literal, '?', literallen) || (literal[literallen - 1] == '.')) {
+        matcher->type = WILDCARD_GENERAL;  // a trailing '.' can match the end of the name, too.
+    } else if (!lead && !trail) {
+        matcher->type = WILDCARD_EXACT;
+    } else if (!lead) {
+        matcher->type = WILDCARD_PREFIX;
+    } else if (!trail) {
+        matcher->type = WILDCARD_SUFFIX;
+    } else {
+        matcher->type = WILDCARD_GENERAL;
+    } // else
+} // compileWildcard
+
+static int matchWildcard(const WildcardMatcher *matcher, const char *name, const uint32 namelen)
+{
+    const char *literal = matcher->pattern + matcher->literalpos;
+    const uint32 literallen = matcher->literallen;
+    switch (matcher->type) {
+        case WILDCARD_ANY: return 1;
+        case WILDCARD_EXACT: return (namelen == literallen) && wildcardLiteralMatch(name, literal, literallen);
+        case WILDCARD_PREFIX: return (namelen >= literallen) && wildcardLiteralMatch(name, literal, literallen);
+        case WILDCARD_SUFFIX: return (namelen >= literallen) && wildcardLiteralMatch(name + (namelen - literallen), literal, literallen);
+        case WILDCARD_GENERAL:
+            if (namelen < (matcher->prefixlen + matcher->suffixlen))
+                return 0;
+            else if (!wildcardLiteralMatch(name, matcher->pattern, matcher->prefixlen))
+                return 0;
+            else if (!wildcardLiteralMatch(name + (namelen - matcher->suffixlen), matcher->pattern + matcher->suffixpos, matcher->suffixlen))
+                return 0;
+            return wildcardMatch(name, matcher->pattern);
+    } // switch
+    return 0;
+} // matchWildcard
+
+static void closeDirFinder(DirFinder *dirf)
+{
+    if (dirf->isopen)
+        close(dirf->fd);
+    free(dirf->batch);
+    free(dirf->dirpath);
+    freeEaSidecar(&dirf->easidecar);
+    dirf->batch = NULL;
+    dirf->dirpath = NULL;
+    dirf->batchlen = dirf->batchpos = 0;
+    dirf->easidecarloaded = dirf->noxattrs = 0;
+    dirf->isopen = 0;
+} // closeDirFinder
+
+// returns the next directory entry without consuming it, or NULL at the end.
+static const LinuxDirent64 *peekDirFinderEntry(DirFinder *dirf)
+{
+    if (dirf->batchpos >= dirf->batchlen) {
+        const long rc = syscall(SYS_getdents64, dirf->fd, dirf->batch, DIRFINDER_BATCH_SIZE);
+        if (rc <= 0)
+            return NULL;  // end of directory (or an error; either way, we're done).
+        dirf->batchlen = (uint32) rc;
+        dirf->batchpos = 0;
+    } // if
+    return (const LinuxDirent64 *) (dirf->batch + dirf->batchpos);
+} // peekDirFinderEntry
+
+// we only ask statx() for the fields a FILEFINDBUF reports, and tell it not
+//  to bother syncing with the server on network filesystems.
+static int statFindEntry(const int dirfd, const char *name, struct stat *statbuf)
+{
+    static int have_statx = 1;
+    if (have_statx) {
+        const unsigned int mask = STATX_TYPE | STATX_MODE | STATX_SIZE | STATX_BLOCKS | STATX_ATIME | STATX_MTIME;
+        struct statx stx;
+        if (statx(dirfd, name, AT_STATX_DONT_SYNC, mask, &stx) == 0) {
+            memset(statbuf, '\0', sizeof (*statbuf));
+            statbuf->st_mode = (mode_t) stx.stx_mode;
+            statbuf->st_size = (off_t) stx.stx_size;
+            statbuf->st_blocks = (blkcnt_t) stx.stx_blocks;
+            statbuf->st_atime = (time_t) stx.stx_atime.tv_sec;
+            statbuf->st_mtime = (time_t) stx.stx_mtime.tv_sec;
+            return 0;
+        } else if (errno != ENOSYS) {
+            return -1;
+        } // else if
+        have_statx = 0;  // old kernel, don't try again.
+    } // if
+
+    return fstatat(dirfd, name, statbuf, 0);
+} // statFindEntry
+
+// decide what we can from d_type before paying for a stat. Symlinks (and
+//  filesystems that don't fill in d_type) have to be stat()'d to know.
+static int findEntryTypeMayMatch(const uint8 d_type, const ULONG musthave, const ULONG mayhave)
+{
+    switch (d_type) {
+        case DT_DIR: return (mayhave & FILE_DIRECTORY) != 0;
+        case DT_REG: return (musthave & FILE_DIRECTORY) == 0;
+        case DT_LNK: return 1;
+        case DT_UNKNOWN: return 1;
+        default: break;
+    } // switch
+    return 0;  // OS/2 didn't have fifos, devs, sockets, etc.
+} // findEntryTypeMayMatch
+
+// bytes an entry takes in the app's buffer. Real OS/2 packs the entries,
+//  so we write each one's actual size (rounded up to keep the next one
+//  ULONG-aligned) and chain them together with oNextEntryOffset.
+//  FIL_QUERYEASFROMLIST entries are at least this big; their EAs go on top.
+static ULONG findEntrySize(const ULONG level, const size_t namelen)
+{
+    switch (level) {
+        case FIL_STANDARD: return (ULONG) ((offsetof(FILEFINDBUF3, achName) + namelen + 1 + 3) & ~3);
+        case FIL_QUERYEASIZE:
+        case FIL_QUERYEASFROMLIST: return (ULONG) ((offsetof(FILEFINDBUF4, achName) + namelen + 1 + 3) & ~3);
+        default: break;
+    } // switch
+    return (ULONG) (offsetof(FILEFINDBUF, achName) + namelen + 1);  // 16-bit, one at a time.
+} // findEntrySize
+
+// FIL_QUERYEASIZE for a search costs one getxattr() per file, however many
+//  EAs it has, and the directory's sidecar (if any) is only read once.
+static ULONG queryFindEntryEaSize(DirFinder *dirf, const char *name)
+{
+    if (!dirf->easidecarloaded) {
+        loadEaSidecar(dirf->dirpath ? dirf->dirpath : ".", &dirf->easidecar);
+        dirf->easidecarloaded = 1;
+    } // if
+
+    if (!dirf->noxattrs) {
+        char path[PATH_MAX];
+        snprintf(path, sizeof (path), "%s/%s", dirf->dirpath ? dirf->dirpath : ".", name);
+        const ssize_t len = getxattr(path, EA_XATTR_NAME, NULL, 0);
+        if (len > 0)
+            return (ULONG) len;
+        else if ((len == -1) && (errno == ENOTSUP))
+            dirf->noxattrs = 1;
+    } // if
+
+    uint32 bloblen = 0;
+    if (findEaSidecarBlob(&dirf->easidecar, name, &bloblen))
+        return (ULONG) bloblen;
+    return EA_EMPTY_LIST_SIZE;
+} // queryFindEntryEaSize
+
+// Same as loadEAs(), but the directory's sidecar (if any) is only read once per search.
+static APIRET loadFindEntryEAs(DirFinder *dirf, const char *name, uint8 **pblob, uint32 *plen)
+{
+    *pblob = NULL;
+    *plen = 0;
+
+    if (!dirf->easidecarloaded) {
+        loadEaSidecar(dirf->dirpath ? dirf->dirpath : ".", &dirf->easidecar);
+        dirf->easidecarloaded = 1;
+    } // if
+
+    if (!dirf->noxattrs) {
+        char path[PATH_MAX];
+        snprintf(path, sizeof (path), "%s/%s", dirf->dirpath ? dirf->dirpath : ".", name);
+        const ssize_t len = getxattr(path, EA_XATTR_NAME, NULL, 0);
+        if (len > 0) {
+            uint8 *blob = (uint8 *) malloc((size_t) len);
+            if (!blob)
+                return ERROR_NOT_ENOUGH_MEMORY;
+            else if (getxattr(path, EA_XATTR_NAME, blob, (size_t) len) == len)
+                return checkEaBlob(blob, (uint32) len, pblob, plen);
+            free(blob);
+            return loadEAs(path, pblob, plen);  // it changed under us, let the slow path sort it out.
+        } else if ((len == -1) && (errno == ENOTSUP)) {
+            dirf->noxattrs = 1;
+        } // else if
+    } // if
+
+    uint32 bloblen = 0;
+    const uint8 *blob = findEaSidecarBlob(&dirf->easidecar, name, &bloblen);
+    if (!blob)
+        return NO_ERROR;
+
+    uint8 *copy = (uint8 *) malloc(bloblen ? bloblen : 1);
+    if (!copy)
+        return ERROR_NOT_ENOUGH_MEMORY;
+    memcpy(copy, blob, bloblen);
+    return checkEaBlob(copy, bloblen, pblob, plen);
+} // loadFindEntryEAs
+
+// (first) is nonzero if this is the first entry of a DosFindFirst/DosFindNext call.
+static int findNextOne(DirFinder *dirf, PVOID *ppfindbuf, PULONG pcbBuf, const int first, int *err)
 {
     const ULONG attr = dirf->attr;
     const ULONG musthave = (attr & 0xFF00) >> 8;
@@ -2116,28 +6852,32 @@ static int findNextOne(DirFinder *dirf, PVOID *ppfindbuf, PULONG pcbBuf, int *er
     if (musthave & (FILE_HIDDEN | FILE_SYSTEM | FILE_ARCHIVED))
         return 0;
 
-    struct dirent *dent;
-    const int fd = dirfd(dirf->dirp);
-    const char *pattern = dirf->pattern;
+    const LinuxDirent64 *dent;
+    const WildcardMatcher *matcher = &dirf->matcher;
 
-    while ((dent = readdir(dirf->dirp)) != NULL) {
+    while ((dent = peekDirFinderEntry(dirf)) != NULL) {
         const char *name = dent->d_name;
         // !!! FIXME: OS/2 doesn't enumerate ".." for the drive root!
         //if (strcmp(name, "..") == 0) { if drive_root continue; }
 
         const size_t namelen = strlen(name);
-        if (namelen >= CCHMAXPATHCOMP) continue;
-        if (namelen + findNextSizeNeeded(dirf->level, 1) >= *pcbBuf) continue; // FIXME??
+        const int candidate = (namelen < CCHMAXPATHCOMP) && (strcmp(name, EA_SIDECAR_NAME) != 0) && matchWildcard(matcher, name, (uint32) namelen) && findEntryTypeMayMatch(dent->d_type, musthave, mayhave);
+        const ULONG entrysize = candidate ? findEntrySize(dirf->level, namelen) : 0;
+        if (entrysize > *pcbBuf) {
+            *err = ERROR_BUFFER_OVERFLOW;  // doesn't fit, leave it for the next call.
+            return 0;
+        } // if
 
-        if (!wildcardMatch(name, pattern)) continue;
+        dirf->batchpos += dent->d_reclen;  // consume it.
+        if (!candidate) continue;
 
         // we stat(), not lstat(), because OS/2 doesn't understand symlinks,
         //  so we pretend the real file/dir is there. This could cause
         //  problems with broken links and infinite loops, though.
-        //  For lstat-like behaviour, if we change our minds, the last arg
-        //  of fstatat() needs the AT_SYMLINK_NOFOLLOW flag.
+        //  For lstat-like behaviour, if we change our minds, the flags
+        //  to statx() need AT_SYMLINK_NOFOLLOW.
         struct stat statbuf;
-        if (fstatat(fd, name, &statbuf, 0) == -1) continue;
+        if (statFindEntry(dirf->fd, name, &statbuf) == -1) continue;
 
         const int isfile = S_ISREG(statbuf.st_mode);
         const int isdir = S_ISDIR(statbuf.st_mode);
@@ -2176,10 +6916,10 @@ static int findNextOne(DirFinder *dirf, PVOID *ppfindbuf, PULONG pcbBuf, int *er
 
             case FIL_STANDARD: {
                 PFILEFINDBUF3 st = (PFILEFINDBUF3) *ppfindbuf;
-                memset(st, '\0', sizeof (*st));
-                *ppfindbuf = st + 1;
-                *pcbBuf -= sizeof (*st);
-                st->oNextEntryOffset = sizeof (*st);
+                memset(st, '\0', entrysize);
+                *ppfindbuf = ((uint8 *) st) + entrysize;
+                *pcbBuf -= entrysize;
+                st->oNextEntryOffset = entrysize;
                 initFileCreationDateTime(&st->fdateCreation, &st->ftimeCreation);
                 unixTimeToOs2(statbuf.st_atime, &st->fdateLastAccess, &st->ftimeLastAccess);
                 unixTimeToOs2(statbuf.st_mtime, &st->fdateLastWrite, &st->ftimeLastWrite);
@@ -2194,10 +6934,10 @@ static int findNextOne(DirFinder *dirf, PVOID *ppfindbuf, PULONG pcbBuf, int *er
 
             case FIL_QUERYEASIZE: {
                 PFILEFINDBUF4 st = (PFILEFINDBUF4) *ppfindbuf;
-                memset(st, '\0', sizeof (*st));
-                *ppfindbuf = st + 1;
-                *pcbBuf -= sizeof (*st);
-                st->oNextEntryOffset = sizeof (*st);
+                memset(st, '\0', entrysize);
+                *ppfindbuf = ((uint8 *) st) + entrysize;
+                *pcbBuf -= entrysize;
+                st->oNextEntryOffset = entrysize;
                 initFileCreationDateTime(&st->fdateCreation, &st->ftimeCreation);
                 unixTimeToOs2(statbuf.st_atime, &st->fdateLastAccess, &st->ftimeLastAccess);
                 unixTimeToOs2(statbuf.st_mtime, &st->fdateLastWrite, &st->ftimeLastWrite);
@@ -2205,15 +6945,65 @@ static int findNextOne(DirFinder *dirf, PVOID *ppfindbuf, PULONG pcbBuf, int *er
                 st->cbFileAlloc = (ULONG) (statbuf.st_blocks * 512);
                 if (isdir) st->attrFile |= FILE_DIRECTORY;
                 if (readonly) st->attrFile |= FILE_READONLY;
-                st->cbList = 0;  FIXME("write me: EA support");
+                st->cbList = queryFindEntryEaSize(dirf, name);
                 st->cchName = (UCHAR) namelen;
                 strcpy(st->achName, name);
                 return 1;
             } // case
 
-            case FIL_QUERYEASFROMLIST:
-                FIXME("write me");
-                break;
+            // These are a FILEFINDBUF4 with the requested EAs' FEA2LIST where
+            //  cbList would be (cbList is the first thing in an FEA2LIST),
+            //  then the name. If the first entry's EAs don't fit, it goes out
+            //  as a FIL_QUERYEASIZE entry instead, with ERROR_EAS_DIDNT_FIT.
+            case FIL_QUERYEASFROMLIST: {
+                PFILEFINDBUF4 st = (PFILEFINDBUF4) *ppfindbuf;
+                const ULONG fixedlen = (ULONG) offsetof(FILEFINDBUF4, cbList);
+                const ULONG namesize = (ULONG) (namelen + 2);  // cchName, achName, null terminator.
+                uint8 *blob = NULL;
+                uint32 bloblen = 0;
+                APIRET rc = loadFindEntryEAs(dirf, name, &blob, &bloblen);
+                if (rc != NO_ERROR) {
+                    if (!first)  // leave it for the next call to report; don't get stuck on it forever, though.
+                        dirf->batchpos -= dent->d_reclen;
+                    *err = (int) rc;
+                    return 0;
+                } // if
+
+                memset(st, '\0', fixedlen);
+                uint8 *fealist = ((uint8 *) st) + fixedlen;
+                rc = fillFea2ListFromBlob(blob, bloblen, dirf->gea2list, fealist, *pcbBuf - fixedlen - namesize);
+                ULONG fullsize = (fixedlen + st->cbList + namesize + 3) & ~3;
+                ULONG fealen = st->cbList;
+                if ((rc != NO_ERROR) || (fullsize > *pcbBuf)) {
+                    if (!first) {
+                        free(blob);
+                        dirf->batchpos -= dent->d_reclen;  // doesn't fit, leave it for the next call.
+                        *err = ERROR_BUFFER_OVERFLOW;
+                        return 0;
+                    } // if
+                    fullsize = entrysize;
+                    fealen = EA_EMPTY_LIST_SIZE;
+                    memset(fealist, '\0', entrysize - fixedlen);
+                    st->cbList = bloblen ? (ULONG) bloblen : EA_EMPTY_LIST_SIZE;  // the size of all its EAs.
+                    *err = ERROR_EAS_DIDNT_FIT;
+                } // if
+                free(blob);
+
+                *ppfindbuf = ((uint8 *) st) + fullsize;
+                *pcbBuf -= fullsize;
+                st->oNextEntryOffset = fullsize;
+                initFileCreationDateTime(&st->fdateCreation, &st->ftimeCreation);
+                unixTimeToOs2(statbuf.st_atime, &st->fdateLastAccess, &st->ftimeLastAccess);
+                unixTimeToOs2(statbuf.st_mtime, &st->fdateLastWrite, &st->ftimeLastWrite);
+                st->cbFile = (ULONG) statbuf.st_size;  // !!! FIXME: > 2gig files?
+                st->cbFileAlloc = (ULONG) (statbuf.st_blocks * 512);
+                if (isdir) st->attrFile |= FILE_DIRECTORY;
+                if (readonly) st->attrFile |= FILE_READONLY;
+                uint8 *namedst = fealist + fealen;
+                namedst[0] = (UCHAR) namelen;
+                strcpy((char *) (namedst + 1), name);
+                return 1;
+            } // case
         } // switch
     } // while
 
@@ -2223,7 +7013,7 @@ static int findNextOne(DirFinder *dirf, PVOID *ppfindbuf, PULONG pcbBuf, int *er
 
 static APIRET findNext(DirFinder *dirf, PVOID pfindbuf, ULONG cbBuf, PULONG pcFileNames)
 {
-    if (!dirf->dirp) {
+    if (!dirf->isopen) {
         *pcFileNames = 0;
         return ERROR_NO_MORE_FILES;
     } // if
@@ -2231,19 +7021,50 @@ static APIRET findNext(DirFinder *dirf, PVOID pfindbuf, ULONG cbBuf, PULONG pcFi
     const ULONG maxents = *pcFileNames;
     ULONG i;
     int err = NO_ERROR;
+    PVOID lastentry = NULL;
+
+    // FIL_QUERYEASFROMLIST buffers start with an EAOP2 naming the EAs to
+    //  report, which we leave alone; the entries go after it.
+    if ((dirf->level == FIL_QUERYEASFROMLIST) && (maxents > 0)) {
+        EAOP2 *eaop2 = (EAOP2 *) pfindbuf;
+        if (!eaop2->fpGEA2List) {
+            *pcFileNames = 0;
+            return ERROR_INVALID_PARAMETER;
+        } // if
+        const APIRET rc = validateEaList((const uint8 *) eaop2->fpGEA2List, 1, &eaop2->oError);
+        if (rc != NO_ERROR) {
+            *pcFileNames = 0;
+            return rc;
+        } // if
+        dirf->gea2list = eaop2->fpGEA2List;
+        pfindbuf = ((uint8 *) pfindbuf) + sizeof (EAOP2);
+        cbBuf -= sizeof (EAOP2);
+    } // if
+
     memset(pfindbuf, 0, cbBuf);
     for (i = 0; i < maxents; i++) {
-        if (!findNextOne(dirf, &pfindbuf, &cbBuf, &err))
+        PVOID entry = pfindbuf;
+        if (!findNextOne(dirf, &pfindbuf, &cbBuf, i == 0, &err))
             break;
+        lastentry = entry;
+        if (err == ERROR_EAS_DIDNT_FIT) {
+            i++;  // that one goes back by itself.
+            break;
+        } // if
     } // for
 
     *pcFileNames = i;
 
-    if ((i == 0) && (maxents > 0)) {
-        closedir(dirf->dirp);
-        dirf->dirp = NULL;
+    if (lastentry && (dirf->level != -1))
+        ((PFILEFINDBUF3) lastentry)->oNextEntryOffset = 0;  // end of the chain. Same offset in FILEFINDBUF4.
+
+    if (i > 0) {
+        if (err != ERROR_EAS_DIDNT_FIT)
+            err = NO_ERROR;  // anything that didn't fit waits for the next call.
+    } else if ((maxents > 0) && (err == NO_ERROR)) {
+        closeDirFinder(dirf);
         err = ERROR_NO_MORE_FILES;
-    } // if
+    } // else if
 
     return err;
 } // findNext
@@ -2269,11 +7090,6 @@ APIRET DosFindFirst(PSZ pszFileSpec, PHDIR phdir, ULONG flAttribute, PVOID pfind
     else if (cbBuf < findNextSizeNeeded(ulInfoLevel, *pcFileNames))
         return ERROR_BUFFER_OVERFLOW;
 
-    if ((ulInfoLevel != FIL_STANDARD) && (ulInfoLevel != -1)) {
-        FIXME("implement extended attribute support");
-        return ERROR_INVALID_PARAMETER;
-    } // if
-
     if (flAttribute == FILE_NORMAL)
         flAttribute = FILE_READONLY | FILE_HIDDEN | FILE_SYSTEM | FILE_ARCHIVED;  // most of the "may-have" bits.
 
@@ -2307,9 +7123,12 @@ APIRET DosFindFirst(PSZ pszFileSpec, PHDIR phdir, ULONG flAttribute, PVOID pfind
         dirf = (DirFinder *) *phdir;
     } // else
 
-    DIR *dirp = opendir((path == pattern) ? "." : path);
-    if (!dirp) {
-        const int rc = errno;
+    const int fd = open((path == pattern) ? "." : path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    uint8 *batch = (fd == -1) ? NULL : (uint8 *) malloc(DIRFINDER_BATCH_SIZE);
+    if (!batch) {
+        const int rc = (fd == -1) ? errno : ENOMEM;
+        if (fd != -1)
+            close(fd);
         if (*phdir == HDIR_CREATE)
             free(dirf);
         free(path);
@@ -2325,14 +7144,18 @@ APIRET DosFindFirst(PSZ pszFileSpec, PHDIR phdir, ULONG flAttribute, PVOID pfind
         return ERROR_PATH_NOT_FOUND;  // oh well.
     } // if
 
-    if (dirf->dirp)
-        closedir(dirf->dirp);
+    closeDirFinder(dirf);
 
-    dirf->dirp = dirp;
+    dirf->isopen = 1;
+    dirf->fd = fd;
+    dirf->batch = batch;
     dirf->attr = flAttribute;
     dirf->level = ulInfoLevel;
-    strcpy(dirf->pattern, pattern);
-    free(path);
+    compileWildcard(&dirf->matcher, pattern);
+    if (path == pattern)
+        free(path);   // searching the current directory.
+    else
+        dirf->dirpath = path;  // keep it for EA lookups; closeDirFinder frees it.
 
     err = findNext(dirf, pfindbuf, cbBuf, pcFileNames);
 
@@ -2340,8 +7163,7 @@ APIRET DosFindFirst(PSZ pszFileSpec, PHDIR phdir, ULONG flAttribute, PVOID pfind
     //  "Any nonzero return code, except ERROR_EAS_DIDNT_FIT, indicates that no handle has been allocated. This includes such nonerror
     //  indicators as ERROR_NO_MORE_FILES."
     if ((err != NO_ERROR) && (err != ERROR_EAS_DIDNT_FIT)) {
-        closedir(dirf->dirp);
-        dirf->dirp = NULL;
+        closeDirFinder(dirf);
         if (*phdir == HDIR_CREATE)
             free(dirf);
         return err;
@@ -2378,8 +7200,7 @@ APIRET DosFindClose(HDIR hDir)
         return ERROR_INVALID_HANDLE;
 
     DirFinder *dirf = (DirFinder *) hDir;
-    if (dirf->dirp)
-        closedir(dirf->dirp);
+    closeDirFinder(dirf);
 
     if (dirf == &GHDir1)
         memset(dirf, '\0', sizeof (*dirf));
@@ -2450,18 +7271,16 @@ APIRET DosResetBuffer(HFILE hFile)
     TRACE_NATIVE("DosResetBuffer(%u)", (uint) hFile);
 
     if (hFile == 0xFFFFFFFF) {  // flush all files.
-        // !!! FIXME: this is holding the lock the whole time...
         APIRET err = NO_ERROR;
-        grabLock(&GMutexDosCalls);
-        for (uint32 i = 0; i < MaxHFiles; i++) {
-            const int fd = HFiles[hFile].fd;
+        const uint32 count = __atomic_load_n(&GHFiles, __ATOMIC_ACQUIRE)->count;
+        for (uint32 i = 0; i < count; i++) {
+            const int fd = getHFileUnixDescriptor(i);
             if (fd != -1) {
                 const APIRET thiserr = resetOneBuffer(fd);
                 if (err == NO_ERROR)
                     err = thiserr;
             } // if
         } // for
-        ungrabLock(&GMutexDosCalls);
         return err;
     } // if
 
@@ -2654,19 +7473,13 @@ APIRET DosQueryFHState(HFILE hFile, PULONG pMode)
 {
     TRACE_NATIVE("DosQueryFHState(%u, %p)", (uint) hFile, pMode);
 
-    APIRET retval = NO_ERROR;
-    ULONG tmp = 0;
-    if (!pMode)
-        pMode = &tmp;
-
-    grabLock(&GMutexDosCalls);
-    if ((hFile < MaxHFiles) && (HFiles[hFile].fd != -1))
-        *pMode = HFiles[hFile].flags;
-    else
-        retval = ERROR_INVALID_HANDLE;
-    ungrabLock(&GMutexDosCalls);
+    HFileInfo info;
+    if (!readHFile(hFile, &info))
+        return ERROR_INVALID_HANDLE;
 
-    return retval;
+    if (pMode)
+        *pMode = info.flags;
+    return NO_ERROR;
 } // DosQueryFHState
 
 APIRET DosQueryHeaderInfo(HMODULE hmod, ULONG ulIndex, PVOID pvBuffer, ULONG cbBuffer, ULONG ulSubFunction)
@@ -2718,34 +7531,16 @@ APIRET DosQueryExtLIBPATH(PSZ pszExtLIBPATH, ULONG flags)
 APIRET DosSetMaxFH(ULONG cFH)
 {
     TRACE_NATIVE("DosSetMaxFH(%u)", (uint) cFH);
-    grabLock(&GMutexDosCalls);
-
-    if (cFH < MaxHFiles) {
-        ungrabLock(&GMutexDosCalls);
-        return ERROR_INVALID_PARAMETER;  // strictly speaking, we could shrink, but I'm not doing it.
-    } // if
-
-    if (cFH == MaxHFiles) {
-        ungrabLock(&GMutexDosCalls);
-        return NO_ERROR;
-    } // if
-
-    HFileInfo *info = (HFileInfo *) realloc(HFiles, sizeof (HFileInfo) * (cFH));
-    if (info != NULL) {
-        HFiles = info;
-        info += MaxHFiles;
-        for (ULONG i = MaxHFiles; i < cFH; i++, info++) {
-            info->fd = -1;
-            info->type = 0;
-            info->attr = 0;
-            info->flags = 0;
-        } // for
-        MaxHFiles = cFH;
-    } // if
+    APIRET retval = NO_ERROR;
 
+    grabLock(&GMutexDosCalls);
+    if (cFH < GHFiles->count)
+        retval = ERROR_INVALID_PARAMETER;  // strictly speaking, we could shrink, but I'm not doing it.
+    else if (!growHFileTable(cFH))
+        retval = ERROR_NOT_ENOUGH_MEMORY;
     ungrabLock(&GMutexDosCalls);
 
-    return NO_ERROR;
+    return retval;
 } // DosSetMaxFH
 
 APIRET DosQuerySysState(ULONG func, ULONG arg1, ULONG pid, ULONG _res_, PVOID buf, ULONG bufsz)
@@ -2959,9 +7754,10 @@ APIRET DosSetCurrentDir(PSZ pszName)
 
 static APIRET DosCreateDir_implementation(PSZ pszDirName, PEAOP2 peaop2)
 {
-    if (peaop2 != NULL) {
-        FIXME("EAs not yet implemented");
-        return ERROR_EA_LIST_INCONSISTENT;
+    if (peaop2 && peaop2->fpFEA2List) {  // catch a bad list before we create anything.
+        const APIRET rc = validateEaList((const uint8 *) peaop2->fpFEA2List, 0, &peaop2->oError);
+        if (rc != NO_ERROR)
+            return rc;
     }
 
     uint32 err = 0;
@@ -2969,6 +7765,14 @@ static APIRET DosCreateDir_implementation(PSZ pszDirName, PEAOP2 peaop2)
     if (!path) return (APIRET) err;
 
     const int rc = mkdir(path, 0755);
+    if ((rc == 0) && peaop2 && peaop2->fpFEA2List) {
+        const APIRET earc = setEAs(path, peaop2->fpFEA2List, 1, &peaop2->oError);
+        if (earc != NO_ERROR) {
+            rmdir(path);
+            free(path);
+            return earc;
+        }
+    }
     free(path);
     if (rc == -1) {
         switch (errno) {
@@ -3021,99 +7825,94 @@ __asm__ (
 );
 #endif
 
-static inline int trySpinLock(int *lock)
+// 16-bit RAM semaphores are a word in the app's memory (possibly shared
+//  with other processes), nonzero while set. We can't stash a waiter flag in
+//  it, since apps look at it directly, and a waiter count kept anywhere else
+//  wouldn't be seen by other processes sharing the word, so DosSemClear
+//  wakes the futex whenever it actually clears a set semaphore.
+
+// is the semaphore clear? If (request), atomically set it, too. (*val) gets what we saw.
+static inline int trySem16(uint32 *word, uint32 *val, const int request)
 {
-    return (__sync_lock_test_and_set(lock, 1) == 0);
-} // trySpinLock
+    *val = 0;
+    if (request)
+        return __atomic_compare_exchange_n(word, val, 1, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+    return ((*val = __atomic_load_n(word, __ATOMIC_SEQ_CST)) == 0);
+} // trySem16
 
-APIRET16 DosSemRequest(PHSEM16 sem, LONG ms)
+// wait for the semaphore to be clear; if (request), also set it atomically.
+static APIRET16 waitSem16(PHSEM16 sem, const LONG ms, const int request)
 {
-    TRACE_NATIVE("DosSemRequest(%p, %u)", sem, (uint) ms);
-    if (ms == 0) {
-        return !trySpinLock(sem) ? ERROR_TIMEOUT : NO_ERROR;
-    } else if (ms < 0) {
-        while (!trySpinLock(sem))
-            usleep(1000);
-        return NO_ERROR;
-    }
+    uint32 *word = (uint32 *) sem;
+    uint32 val = 0;
 
-    struct timespec ts;
+    if (trySem16(word, &val, request))
+        return NO_ERROR;
+    else if (ms == 0)
+        return ERROR_TIMEOUT;
 
-    clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
-    const uint64 end = (((uint64) ts.tv_sec) * 1000) + (((uint64) ts.tv_nsec) / 1000000) + ms;
+    struct timespec deadline;
+    if (ms > 0)
+        sem32Deadline(&deadline, (ULONG) ms);
 
+    APIRET16 retval = NO_ERROR;
     while (1) {
-        if (trySpinLock(sem))
-            return NO_ERROR;
-        clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
-        const uint64 now = (((uint64) ts.tv_sec) * 1000) + (((uint64) ts.tv_nsec) / 1000000);
-        if (now >= end)
-            return ERROR_TIMEOUT;
-        usleep(1000);
+        if (trySem16(word, &val, request))
+            break;
+
+        // shared futex ops, since RAM semaphores can live in shared segments.
+        const int rc = futexWait(word, val, (ms > 0) ? &deadline : NULL, 1);
+        if (rc == ETIMEDOUT) {
+            retval = ERROR_TIMEOUT;
+            break;
+        } else if (rc == EINVAL) {
+            usleep(1000);  // misaligned semaphore; the kernel won't futex it, so fall back to polling.
+            if (ms > 0) {
+                struct timespec now;
+                clock_gettime(CLOCK_MONOTONIC, &now);
+                if ((now.tv_sec > deadline.tv_sec) || ((now.tv_sec == deadline.tv_sec) && (now.tv_nsec >= deadline.tv_nsec))) {
+                    retval = trySem16(word, &val, request) ? NO_ERROR : ERROR_TIMEOUT;
+                    break;
+                } // if
+            } // if
+        } // else if
     } // while
 
-    return NO_ERROR;
+    return retval;
+} // waitSem16
+
+APIRET16 DosSemRequest(PHSEM16 sem, LONG ms)
+{
+    TRACE_NATIVE("DosSemRequest(%p, %u)", sem, (uint) ms);
+    return waitSem16(sem, ms, 1);
 } // DosSemRequest
 
 APIRET16 DosSemClear(PHSEM16 sem)
 {
     TRACE_NATIVE("DosSemClear(%p)", sem);
-    __sync_lock_release(sem);
+    // if it was already clear, anyone sleeping on it got woken when it was cleared before.
+    if (__atomic_exchange_n((uint32 *) sem, 0, __ATOMIC_SEQ_CST) != 0)
+        futexWake((uint32 *) sem, INT_MAX, 1);
     return NO_ERROR;
 } // DosSemClear
 
 APIRET16 DosSemWait(PHSEM16 sem, LONG ms)
 {
     TRACE_NATIVE("DosSemWait(%p, %u)", sem, (uint) ms);
-    if (ms == 0) {
-        return __sync_bool_compare_and_swap(sem, 0, 1) ? NO_ERROR : ERROR_TIMEOUT;
-    } else if (ms < 0) {
-        while (!__sync_bool_compare_and_swap(sem, 0, 1))
-            usleep(1000);
-        return NO_ERROR;
-    }
-
-    struct timespec ts;
-
-    clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
-    const uint64 end = (((uint64) ts.tv_sec) * 1000) + (((uint64) ts.tv_nsec) / 1000000) + ms;
-
-    while (1) {
-        if (__sync_bool_compare_and_swap(sem, 0, 1))
-            return NO_ERROR;
-        clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
-        const uint64 now = (((uint64) ts.tv_sec) * 1000) + (((uint64) ts.tv_nsec) / 1000000);
-        if (now >= end)
-            return ERROR_TIMEOUT;
-        usleep(1000);
-    } // while
-
-    return NO_ERROR;
+    return waitSem16(sem, ms, 0);
 } // DosSemWait
 
 APIRET16 DosSemSet(PHSEM16 sem)
 {
     TRACE_NATIVE("DosSemSet(%p)", sem);
-    __sync_bool_compare_and_swap(sem, 1, 0);
+    __atomic_store_n((uint32 *) sem, 1, __ATOMIC_SEQ_CST);
     return NO_ERROR;
 } // DosSemSet
 
 APIRET DosCloseMutexSem(HMTX hmtx)
 {
     TRACE_NATIVE("DosCloseMutexSem(%u)", (uint) hmtx);
-
-    if (hmtx) {
-        pthread_mutex_t *mutex = (pthread_mutex_t *) hmtx;
-        const int rc = pthread_mutex_destroy(mutex);
-        if (rc == EBUSY) {
-            return ERROR_SEM_BUSY;
-        } else if (rc == 0) {
-            free(mutex);
-            return NO_ERROR;
-        } // else if
-    } // if
-
-    return ERROR_INVALID_HANDLE;
+    return closeSem32(hmtx, SEM32KIND_MUTEX);
 } // DosCloseMutexSem
 
 APIRET DosSetProcessCp(ULONG cp)
@@ -3148,34 +7947,50 @@ APIRET DosSetFileSize(HFILE h, ULONG len)
 
 static APIRET DosDupHandle_implementation(HFILE hFile, PHFILE pHfile)
 {
-    if (*pHfile == -1) {
-        HFileInfo *info = HFiles;
-        uint32 i;
+    HFileInfo info;
+    if (!readHFile(hFile, &info))
+        return ERROR_INVALID_HANDLE;
 
-        if (!grabLock(&GMutexDosCalls))
-            return ERROR_SYS_INTERNAL;
+    if (info.fbuf) {  // the two handles will share a file offset, so stop buffering the original.
+        pthread_mutex_lock(&info.fbuf->lock);
+        syncFileBufferLocked(info.fd, info.fbuf);
+        info.fbuf->disabled = 1;
+        pthread_mutex_unlock(&info.fbuf->lock);
+        info.fbuf = NULL;
+    } // if
 
-        for (i = 0; i < MaxHFiles; i++, info++) {
-            if (info->fd == -1) {  // available?
-                    info->fd = -2;
-                    break;
-            } // if
-        } // for
+    info.fd = dup(info.fd);
+    if (info.fd == -1)
+        return ERROR_TOO_MANY_OPEN_FILES;
 
-        ungrabLock(&GMutexDosCalls);
+    // !!! FIXME: the copy of a named pipe handle is just a plain socket, since the pipe state belongs to the original.
+    info.npipe = NULL;
 
-        if (i == MaxHFiles) {
-            return ERROR_TOO_MANY_OPEN_FILES;
-        }
-        memcpy(&HFiles[i], &HFiles[hFile], sizeof(HFileInfo));
-        HFiles[i].fd = dup(HFiles[hFile].fd);
-        *pHfile = i;
+    dupShareRecord(info.share);  // same open file, so same sharing mode and locks.
+
+    APIRET retval = NO_ERROR;
+    HFileSlot *slot = NULL;
+    if (*pHfile == 0xFFFFFFFF) {
+        slot = reserveHFile(pHfile);
+        if (!slot)
+            retval = ERROR_TOO_MANY_OPEN_FILES;
     } else {
-        if (HFiles[*pHfile].fd != -1)
-            return ERROR_INVALID_TARGET_HANDLE;
-        memcpy(&HFiles[*pHfile], &HFiles[hFile], sizeof(HFileInfo));
-        HFiles[*pHfile].fd = dup(HFiles[hFile].fd);
-    }
+        grabLock(&GMutexDosCalls);
+        slot = getHFileSlot(GHFiles, *pHfile);
+        if (!slot || (slot->info.fd != -1))
+            retval = ERROR_INVALID_TARGET_HANDLE;
+        else
+            setHFileFd(slot, -2);  // reserve it.
+        ungrabLock(&GMutexDosCalls);
+    } // else
+
+    if (retval != NO_ERROR) {
+        close(info.fd);
+        closeShareRecord(info.share);
+        return retval;
+    } // if
+
+    writeHFile(slot, &info);
     return NO_ERROR;
 } // DosDupHandle_implementation
 
@@ -3551,7 +8366,9 @@ APIRET16 Dos16Open(PSZ pszFileName, PUSHORT pHf, PULONG pulAction, ULONG cbFile,
 {
     TRACE_NATIVE("Dos16Open('%s', %p, %p, %u, %u, %u, %u, %p)", pszFileName, pHf, pulAction, (uint) cbFile, (uint) ulAttribute, (uint) fsOpenFlags, (uint) fsOpenMode, peaop2);
     HFILE hf;
-    APIRET ret = doDosOpen(pszFileName, &hf, pulAction, (LONGLONG) cbFile, ulAttribute, fsOpenFlags, fsOpenMode, peaop2);
+    if (peaop2)
+        FIXME("16-bit EAOP (16:16 pointers, FEALIST) isn't supported; ignoring the EAs");
+    APIRET ret = doDosOpen(pszFileName, &hf, pulAction, (LONGLONG) cbFile, ulAttribute, fsOpenFlags, fsOpenMode, NULL);
     *pHf = hf;
     return ret;
 } // DosOpen
@@ -3674,19 +8491,42 @@ APIRET16 Dos16Beep(USHORT freq, USHORT duration)
 APIRET16 Dos16MkDir(PSZ pszDirName, PEAOP2 peaop2)
 {
     TRACE_NATIVE("Dos16MkDir('%s', %p)", pszDirName, peaop2);
-    return DosCreateDir_implementation(pszDirName, peaop2);
+    if (peaop2)
+        FIXME("16-bit EAOP (16:16 pointers, FEALIST) isn't supported; ignoring the EAs");
+    return DosCreateDir_implementation(pszDirName, NULL);
 }
 
 APIRET16 Dos16MkDir2(PSZ pszDirName, PEAOP2 peaop2)  // !!! FIXME: check this.
 {
     TRACE_NATIVE("Dos16MkDir('%s', %p)", pszDirName, peaop2);
-    return DosCreateDir_implementation(pszDirName, peaop2);
+    if (peaop2)
+        FIXME("16-bit EAOP (16:16 pointers, FEALIST) isn't supported; ignoring the EAs");
+    return DosCreateDir_implementation(pszDirName, NULL);
 }
 
 
+// lx_loader's zygote forks new OS/2 processes from a copy of itself that
+//  already has us initialized, so anything we set up from the process's
+//  stdio, pid or parent has to be redone once the new process has its own.
+static void dosReinitProcess(void)
+{
+    for (int i = 0; i <= 2; i++) {
+        HFileInfo info;
+        initHFileInfoFromUnixFd(i, &info);
+        writeHFile(getHFileSlot(GHFiles, i), &info);
+    } // for
+
+    ginfo->pidForeground = GLoaderState.pib.pib_ulpid;
+    linfo->pidCurrent = GLoaderState.pib.pib_ulpid;
+    linfo->pidParent = GLoaderState.pib.pib_ulppid;
+
+    GSem32Thread.id = 0;  // we're a new thread in a new process now.
+} // dosReinitProcess
+
 LX_NATIVE_CONSTRUCTOR(doscalls)
 {
     GLoaderState.dosExit = DosExit;
+    GLoaderState.dosReinitProcess = dosReinitProcess;
 
     if (pthread_mutex_init(&GMutexDosCalls, NULL) == -1) {
         fprintf(stderr, "pthread_mutex_init failed!\n");
@@ -3699,22 +8539,29 @@ LX_NATIVE_CONSTRUCTOR(doscalls)
         abort();
     } // if
 
-    MaxHFiles = 20;  // seems to be OS/2's default.
-    HFiles = (HFileInfo *) malloc(sizeof (HFileInfo) * MaxHFiles);
-    if (!HFiles) {
+    if (pthread_mutex_init(&GMutexMemObjects, NULL) == -1) {
         pthread_mutex_destroy(&GMutexDosCalls);
         pthread_mutex_destroy(&GMutexDosBeep);
-        fprintf(stderr, "Out of memory!\n");
+        fprintf(stderr, "pthread_mutex_init failed!\n");
         abort();
     } // if
 
-    HFileInfo *info = HFiles;
-    for (uint32 i = 0; i < MaxHFiles; i++, info++) {
-        info->fd = -1;
-        info->type = 0;
-        info->attr = 0;
-        info->flags = 0;
-    } // for
+    if (pthread_cond_init(&GCondDeadThreads, NULL) != 0) {
+        pthread_mutex_destroy(&GMutexDosCalls);
+        pthread_mutex_destroy(&GMutexDosBeep);
+        pthread_mutex_destroy(&GMutexMemObjects);
+        fprintf(stderr, "pthread_cond_init failed!\n");
+        abort();
+    } // if
+
+    if (!growHFileTable(20)) {  // 20 seems to be OS/2's default.
+        pthread_mutex_destroy(&GMutexDosCalls);
+        pthread_mutex_destroy(&GMutexDosBeep);
+        pthread_mutex_destroy(&GMutexMemObjects);
+        pthread_cond_destroy(&GCondDeadThreads);
+        fprintf(stderr, "Out of memory!\n");
+        abort();
+    } // if
 
     // launching a Hello World program from CMD.EXE seems to inherit several
     //  file handles. 0, 1, 2 seem to map to stdin, stdout, stderr (and will
@@ -3728,16 +8575,30 @@ LX_NATIVE_CONSTRUCTOR(doscalls)
 
     FIXME("We can iterate /proc/self/fd to get all currently-open files");
     for (int i = 0; i <= 2; i++) {
-        initHFileInfoFromUnixFd(i, &HFiles[i]);
+        HFileInfo info;
+        initHFileInfoFromUnixFd(i, &info);
+        writeHFile(getHFileSlot(GHFiles, i), &info);
     } // for
 
     FIXME("Maybe set this up in lx_loader and make it NULL in lib2ine");
     FIXME("ginfo's time fields update in a timer interrupt!  :O");
     ginfo = (GINFOSEG *) GLoaderState.allocSegment(&ginfosel, 0);
     linfo = (LINFOSEG *) GLoaderState.allocSegment(&linfosel, 0);
+
+    // Native apps (no lx_loader) don't have segments, but they still use
+    //  these through DosGetInfoBlocks() and friends, so give them plain memory.
+    if (!ginfo && !linfo && (ginfosel == 0xFFFF) && (linfosel == 0xFFFF)) {
+        static GINFOSEG native_ginfo;
+        static LINFOSEG native_linfo;
+        ginfo = &native_ginfo;
+        linfo = &native_linfo;
+    } // if
+
     if ((!ginfo) || (!linfo)) {
         pthread_mutex_destroy(&GMutexDosCalls);
         pthread_mutex_destroy(&GMutexDosBeep);
+        pthread_mutex_destroy(&GMutexMemObjects);
+        pthread_cond_destroy(&GCondDeadThreads);
         fprintf(stderr, "Failed to allocate info segments!\n");
         abort();
     }
@@ -3775,6 +8636,23 @@ LX_NATIVE_CONSTRUCTOR(doscalls)
 LX_NATIVE_DESTRUCTOR(doscalls)
 {
     GLoaderState.dosExit = NULL;
+    GLoaderState.dosReinitProcess = NULL;
+
+    // shut down parked pool threads; they're running our code, so they have to be gone before we unload.
+    grabLock(&GMutexDosCalls);
+    ThreadWorker *worker = GIdleThreadWorkers;
+    GIdleThreadWorkers = NULL;
+    GNumIdleThreadWorkers = 0;
+    ungrabLock(&GMutexDosCalls);
+
+    while (worker) {
+        ThreadWorker *nextworker = worker->next;
+        __atomic_store_n(&worker->state, THREADWORKER_QUIT, __ATOMIC_RELEASE);
+        futexWake(&worker->state, 1, 0);
+        pthread_join(worker->pthread, NULL);
+        free(worker);
+        worker = nextworker;
+    } // while
 
     ExitListItem *next = GExitList;
     GExitList = NULL;
@@ -3784,18 +8662,69 @@ LX_NATIVE_DESTRUCTOR(doscalls)
         free(item);
     } // for
 
-    for (uint32 i = 0; i < MaxHFiles; i++) {
-        if (HFiles[i].fd > 2)  // don't close -1, or any stdio handles.
-            close(HFiles[i].fd);
-    } // for
-    free(HFiles);
-    HFiles = NULL;
-    MaxHFiles = 0;
+    HFileTable *table = GHFiles;
+    if (table) {
+        for (uint32 i = 0; i < table->count; i++) {
+            const HFileInfo *info = &getHFileSlot(table, i)->info;
+            if (info->fbuf) {
+                syncFileBuffer(info->fd, info->fbuf);  // don't lose coalesced writes.
+                freeFileBuffer(info->fbuf);
+            } // if
+            if (info->fd > 2)  // don't close -1, or any stdio handles.
+                close(info->fd);
+            closeShareRecord(info->share);
+        } // for
+
+        const uint32 numchunks = (table->count + (HFILE_CHUNK_SIZE - 1)) / HFILE_CHUNK_SIZE;
+        for (uint32 i = 0; i < numchunks; i++)
+            free(table->chunks[i]);
+
+        while (table) {
+            HFileTable *next = table->replaced;
+            free(table);
+            table = next;
+        } // while
+        GHFiles = NULL;
+    } // if
+
+    // drop anything we still have open in the shared semaphore arena, so named semaphores don't outlive us.
+    if (GSem32Arena) {
+        lockSem32Arena(GSem32Arena);
+        for (uint32 i = 0; i < SEM32_ARENA_SLOTS; i++) {
+            Sem32Slot *slot = &GSem32Arena->slots[i];
+            if (GSem32Opens[i] && (slot->sem.kind != SEM32KIND_FREE)) {
+                slot->sem.opens -= (slot->sem.opens < GSem32Opens[i]) ? slot->sem.opens : GSem32Opens[i];
+                if (slot->sem.opens == 0) {
+                    slot->name[0] = '\0';
+                    slot->sem.kind = SEM32KIND_FREE;
+                } // if
+            } // if
+        } // for
+        unlockSem32Arena(GSem32Arena);
+        munmap(GSem32Arena, sizeof (Sem32Arena));
+        GSem32Arena = NULL;
+        free(GSem32Opens);
+        GSem32Opens = NULL;
+    } // if
+
+    if (GShareArena) {
+        munmap(GShareArena, sizeof (ShareArena));
+        GShareArena = NULL;
+    } // if
+
+    // we don't unmap DosAllocMem objects here, in case something still uses them on the way out.
+    for (uint32 i = 0; i < GNumMemObjects; i++)
+        free(GMemObjects[i].pages);
+    free(GMemObjects);
+    GMemObjects = NULL;
+    GNumMemObjects = GMaxMemObjects = 0;
 
     GLoaderState.freeSelector(ginfosel);
     GLoaderState.freeSelector(linfosel);
     pthread_mutex_destroy(&GMutexDosCalls);
     pthread_mutex_destroy(&GMutexDosBeep);
+    pthread_mutex_destroy(&GMutexMemObjects);
+    pthread_cond_destroy(&GCondDeadThreads);
 }
 
 // end of doscalls.c ...
@@ -120,7 +120,58 @@ typedef struct
 } DATETIME, *PDATETIME;
 
 
-typedef void *PEAOP2; //  !!! FIXME
+typedef struct
+{
+    ULONG oNextEntryOffset;
+    BYTE fEA;
+    BYTE cbName;
+    USHORT cbValue;
+    CHAR szName[1];
+} FEA2, *PFEA2;
+
+typedef struct
+{
+    ULONG cbList;
+    FEA2 list[1];
+} FEA2LIST, *PFEA2LIST;
+
+typedef struct
+{
+    ULONG oNextEntryOffset;
+    BYTE cbName;
+    CHAR szName[1];
+} GEA2, *PGEA2;
+
+typedef struct
+{
+    ULONG cbList;
+    GEA2 list[1];
+} GEA2LIST, *PGEA2LIST;
+
+typedef struct
+{
+    PGEA2LIST fpGEA2List;
+    PFEA2LIST fpFEA2List;
+    ULONG oError;
+} EAOP2, *PEAOP2;
+
+typedef FEA2 DENA2, *PDENA2;  // DosEnumAttribute's entries; cbValue is the value's size, which isn't returned.
+
+enum
+{
+    FEA_NEEDEA = 0x80
+};
+
+enum
+{
+    ENUMEA_LEVEL_NO_VALUE = 1
+};
+
+enum
+{
+    ENUMEA_REFTYPE_FHANDLE = 0,
+    ENUMEA_REFTYPE_PATH = 1
+};
 
 enum
 {
@@ -285,6 +336,14 @@ enum
     DCMW_WAIT_ALL = (1<<2)
 };
 
+#define DCMW_MAX_SEMRECORDS 64
+
+typedef struct SEMRECORD
+{
+    HSEM hsemCur;
+    ULONG ulUser;
+} SEMRECORD, *PSEMRECORD;
+
 enum
 {
     SEM_INDEFINITE_WAIT = -1,
@@ -297,6 +356,30 @@ enum
     DCWW_NOWAIT
 };
 
+enum
+{
+    NP_ACCESS_INBOUND = 0x0000,
+    NP_ACCESS_OUTBOUND = 0x0001,
+    NP_ACCESS_DUPLEX = 0x0002,
+    NP_INHERIT = 0x0000,
+    NP_NOINHERIT = 0x0080,
+    NP_WRITEBEHIND = 0x0000,
+    NP_NOWRITEBEHIND = 0x4000
+};
+
+enum
+{
+    NP_READMODE_BYTE = 0x0000,
+    NP_READMODE_MESSAGE = 0x0100,
+    NP_TYPE_BYTE = 0x0000,
+    NP_TYPE_MESSAGE = 0x0400,
+    NP_END_CLIENT = 0x0000,
+    NP_END_SERVER = 0x4000,
+    NP_WAIT = 0x0000,
+    NP_NOWAIT = 0x8000,
+    NP_UNLIMITED_INSTANCES = 0x00FF
+};
+
 enum
 {
     DCWA_PROCESS,
@@ -371,6 +454,24 @@ typedef struct
     CHAR achName[CCHMAXPATHCOMP];
 } FILEFINDBUF4, *PFILEFINDBUF4;
 
+typedef struct
+{
+    LONG lOffset;
+    LONG lRange;
+} FILELOCK, *PFILELOCK;
+
+typedef struct
+{
+    LONGLONG lOffset;
+    LONGLONG lRange;
+} FILELOCKL, *PFILELOCKL;
+
+enum
+{
+    FILELOCK_SHARED = 0x01,  // DosSetFileLocks flags. Other handles may still read the range.
+    FILELOCK_ATOMIC = 0x02
+};
+
 typedef struct
 {
     USHORT iType;
@@ -470,6 +571,33 @@ enum
     END_LIBPATH = 2
 };
 
+enum
+{
+    PAG_READ = 0x0001,
+    PAG_WRITE = 0x0002,
+    PAG_EXECUTE = 0x0004,
+    PAG_GUARD = 0x0008,
+    PAG_COMMIT = 0x0010,
+    PAG_DECOMMIT = 0x0020,
+    OBJ_TILE = 0x0040,
+    OBJ_PROTECTED = 0x0080,
+    OBJ_GETTABLE = 0x0100,
+    OBJ_GIVEABLE = 0x0200,
+    PAG_DEFAULT = 0x0400,  // DosSetMem()
+    OBJ_ANY = 0x0400,  // DosAllocMem()
+    PAG_SHARED = 0x2000,
+    PAG_FREE = 0x4000,
+    PAG_BASE = 0x10000
+};
+
+enum
+{
+    DOSSUB_INIT = 0x01,
+    DOSSUB_GROW = 0x02,
+    DOSSUB_SPARSE_OBJ = 0x04,
+    DOSSUB_SERIALIZE = 0x08
+};
+
 typedef void *PCONTEXTRECORD;  // !!! FIXME
 
 
@@ -562,6 +690,15 @@ OS2EXPORT VOID OS2API DosExit(ULONG action, ULONG result) OS2APIINFO(234);
 OS2EXPORT APIRET OS2API DosExitList(ULONG ordercode, PFNEXITLIST pfn) OS2APIINFO(296);
 OS2EXPORT APIRET OS2API DosCreateEventSem(PSZ pszName, PHEV phev, ULONG flAttr, BOOL32 fState) OS2APIINFO(324);
 OS2EXPORT APIRET OS2API DosCreateMutexSem(PSZ pszName, PHMTX phmtx, ULONG flAttr, BOOL32 fState) OS2APIINFO(331);
+OS2EXPORT APIRET OS2API DosOpenEventSem(PSZ pszName, PHEV phev) OS2APIINFO(325);
+OS2EXPORT APIRET OS2API DosOpenMutexSem(PSZ pszName, PHMTX phmtx) OS2APIINFO(332);
+OS2EXPORT APIRET OS2API DosCreateMuxWaitSem(PSZ pszName, PHMUX phmux, ULONG cSemRec, PSEMRECORD pSemRec, ULONG flAttr) OS2APIINFO(337);
+OS2EXPORT APIRET OS2API DosOpenMuxWaitSem(PSZ pszName, PHMUX phmux) OS2APIINFO(338);
+OS2EXPORT APIRET OS2API DosCloseMuxWaitSem(HMUX hmux) OS2APIINFO(339);
+OS2EXPORT APIRET OS2API DosWaitMuxWaitSem(HMUX hmux, ULONG ulTimeout, PULONG pulUser) OS2APIINFO(340);
+OS2EXPORT APIRET OS2API DosAddMuxWaitSem(HMUX hmux, PSEMRECORD pSemRec) OS2APIINFO(341);
+OS2EXPORT APIRET OS2API DosDeleteMuxWaitSem(HMUX hmux, HSEM hSem) OS2APIINFO(342);
+OS2EXPORT APIRET OS2API DosQueryMuxWaitSem(HMUX hmux, PULONG pcSemRec, PSEMRECORD pSemRec, PULONG pflAttr) OS2APIINFO(343);
 OS2EXPORT APIRET OS2API DosSetExceptionHandler(PEXCEPTIONREGISTRATIONRECORD pERegRec) OS2APIINFO(354);
 OS2EXPORT APIRET OS2API DosUnsetExceptionHandler(PEXCEPTIONREGISTRATIONRECORD pERegRec) OS2APIINFO(355);
 OS2EXPORT ULONG OS2API DosFlatToSel(VOID) OS2APIINFO(425);
@@ -591,10 +728,21 @@ OS2EXPORT APIRET OS2API DosCloseEventSem(HEV hev) OS2APIINFO(326);
 OS2EXPORT APIRET OS2API DosWaitEventSem(HEV hev, ULONG ulTimeout) OS2APIINFO(329);
 OS2EXPORT APIRET OS2API DosQueryEventSem(HEV hev, PULONG pulPostCt) OS2APIINFO(330);
 OS2EXPORT APIRET OS2API DosFreeMem(PVOID pb) OS2APIINFO(304);
+OS2EXPORT APIRET OS2API DosQueryMem(PVOID pb, PULONG pcb, PULONG pFlag) OS2APIINFO(306);
 OS2EXPORT APIRET OS2API DosWaitChild(ULONG action, ULONG option, PRESULTCODES pres, PPID ppid, PID pid) OS2APIINFO(280);
 OS2EXPORT APIRET OS2API DosWaitThread(PTID ptid, ULONG option) OS2APIINFO(349);
+OS2EXPORT APIRET OS2API DosResumeThread(TID tid) OS2APIINFO(237);
+OS2EXPORT APIRET OS2API DosCreatePipe(PHFILE phfRead, PHFILE phfWrite, ULONG cb) OS2APIINFO(239);
+OS2EXPORT APIRET OS2API DosCallNPipe(PSZ pszName, PVOID pInbuf, ULONG cbIn, PVOID pOutbuf, ULONG cbOut, PULONG pcbActual, ULONG msec) OS2APIINFO(240);
+OS2EXPORT APIRET OS2API DosConnectNPipe(HPIPE hpipe) OS2APIINFO(241);
+OS2EXPORT APIRET OS2API DosDisConnectNPipe(HPIPE hpipe) OS2APIINFO(242);
+OS2EXPORT APIRET OS2API DosCreateNPipe(PSZ pszName, PHPIPE pHpipe, ULONG openmode, ULONG pipemode, ULONG cbInbuf, ULONG cbOutbuf, ULONG msec) OS2APIINFO(243);
+OS2EXPORT APIRET OS2API DosQueryNPHState(HPIPE hpipe, PULONG pState) OS2APIINFO(245);
+OS2EXPORT APIRET OS2API DosSetNPHState(HPIPE hpipe, ULONG state) OS2APIINFO(250);
+OS2EXPORT APIRET OS2API DosTransactNPipe(HPIPE hpipe, PVOID pOutbuf, ULONG cbOut, PVOID pInbuf, ULONG cbIn, PULONG pcbRead) OS2APIINFO(252);
 OS2EXPORT APIRET OS2API DosSleep(ULONG msec) OS2APIINFO(229);
 OS2EXPORT APIRET OS2API DosSubFreeMem(PVOID pbBase, PVOID pb, ULONG cb) OS2APIINFO(346);
+OS2EXPORT APIRET OS2API DosSubUnsetMem(PVOID pbBase) OS2APIINFO(347);
 OS2EXPORT APIRET OS2API DosDelete(PSZ pszFile) OS2APIINFO(259);
 OS2EXPORT APIRET OS2API DosQueryCurrentDir(ULONG disknum, PBYTE pBuf, PULONG pcbBuf) OS2APIINFO(274);
 OS2EXPORT APIRET OS2API DosSetPathInfo(PSZ pszPathName, ULONG ulInfoLevel, PVOID pInfoBuf, ULONG cbInfoBuf, ULONG flOptions) OS2APIINFO(219);
@@ -624,6 +772,10 @@ OS2EXPORT APIRET OS2API DosSetFileSize(HFILE hFile, ULONG cbSize) OS2APIINFO(272
 OS2EXPORT APIRET OS2API DosSetCurrentDir(PSZ pszName) OS2APIINFO(255);
 OS2EXPORT APIRET OS2API DosBeep(ULONG freq, ULONG dur) OS2APIINFO(286);
 OS2EXPORT APIRET OS2API DosCreateDir(PSZ pszDirName, PEAOP2 peaop2) OS2APIINFO(270);
+OS2EXPORT APIRET OS2API DosSetFileInfo(HFILE hf, ULONG ulInfoLevel, PVOID pInfoBuf, ULONG cbInfoBuf) OS2APIINFO(218);
+OS2EXPORT APIRET OS2API DosEnumAttribute(ULONG ulRefType, PVOID pvFile, ULONG ulEntry, PVOID pvBuf, ULONG cbBuf, PULONG pulCount, ULONG ulInfoLevel) OS2APIINFO(372);
+OS2EXPORT APIRET OS2API DosSetFileLocks(HFILE hFile, PFILELOCK pflUnlock, PFILELOCK pflLock, ULONG timeout, ULONG flags) OS2APIINFO(428);
+OS2EXPORT APIRET OS2API DosSetFileLocksL(HFILE hFile, PFILELOCKL pflUnlock, PFILELOCKL pflLock, ULONG timeout, ULONG flags) OS2APIINFO(986);
 
 #ifdef __cplusplus
 }
@@ -75,9 +75,12 @@ typedef uint32_t LHANDLE, *PLHANDLE;
 typedef LHANDLE HANDLE, *PHANDLE;
 typedef HANDLE HMODULE, *PHMODULE;
 typedef HANDLE HFILE, *PHFILE;
+typedef HANDLE HPIPE, *PHPIPE;
 typedef HANDLE HDIR, *PHDIR;
 typedef HANDLE HEV, *PHEV;
 typedef HANDLE HMTX, *PHMTX;
+typedef HANDLE HMUX, *PHMUX;
+typedef HANDLE HSEM, *PHSEM;
 typedef HANDLE HQUEUE, *PHQUEUE;
 typedef HANDLE HPS, *PHPS;
 typedef HANDLE PID, *PPID;
@@ -8,65 +8,643 @@
 
 #include "os2native.h"
 #include "quecalls.h"
+#include "doscalls.h"
+
+#include <unistd.h>
+#include <limits.h>
+#include <stddef.h>
+#include <fcntl.h>
+#include <ctype.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
 
 #include "quecalls-lx.h"
 
+// OS/2 queues only pass around a few words per element (the data itself
+//  stays wherever the writer put it, usually in shared memory), so each
+//  queue is one shared memory object with a fixed array of elements in it.
+//  Elements are linked by index, so LIFO and priority queues can insert
+//  anywhere and DosReadQueue() can pull an element out of the middle, and
+//  unused elements sit on a free list. Any 2ine process that opens the
+//  queue maps the same object, so writing an element is just a few stores
+//  under a futex lock; nobody enters the kernel unless the lock is
+//  contended or the owner is asleep waiting for something to read. The lock
+//  word holds the pid of the process that has it, so if that process dies
+//  while holding it, whoever is waiting takes it over.
+// !!! FIXME: a process that died holding the lock might have left the element lists half-updated.
+#define QUEUE_MAGIC 0x45555132  // "2QUE"
+#define QUEUE_LOCK_WAITERS 0x80000000
+#define QUEUE_LOCK_CHECK_MS 500
+#define QUEUE_MAX_ELEMENTS 8192
+#define QUEUE_MAX_HANDLES 256
+
+typedef struct QueueElement
+{
+    uint32 prev;  // index + 1, 0 == none.
+    uint32 next;  // index + 1, 0 == none.
+    uint32 serial;  // bumped every time this element is reused, so stale element codes fail.
+    uint32 pid;
+    uint32 request;
+    uint32 cbData;
+    PVOID pbData;
+    uint32 priority;
+} QueueElement;
+
+typedef struct Queue
+{
+    uint32 magic;  // zero once the owner closes it.
+    uint32 lock;  // futex: pid of the process holding it (0 == unlocked), plus QUEUE_LOCK_WAITERS.
+    uint32 writes;  // futex: bumped on every write, so the owner can sleep until one happens.
+    uint32 waiters;  // number of threads sleeping on (writes).
+    uint32 ordering;  // QUE_FIFO, QUE_LIFO, QUE_PRIORITY.
+    uint32 owner;  // pid of the process that created the queue.
+    HEV hsem;  // posted on every write, from DosReadQueue/DosPeekQueue with DCWW_NOWAIT.
+    uint32 hsempid;  // process that handed us (hsem); other processes can only post it if it's shared.
+    uint32 count;
+    uint32 head;
+    uint32 tail;
+    uint32 freelist;
+    QueueElement elements[QUEUE_MAX_ELEMENTS];
+} Queue;
+
+// Every API call holds a reference to the handle it's using, so closing it
+//  on another thread can't unmap the queue out from under the call.
+typedef struct QueueHandle
+{
+    Queue *queue;
+    int owner;
+    uint32 refcount;  // one for being in GQueueHandles, plus one per call in progress. Guarded by GMutexQueues.
+    char shmname[NAME_MAX];
+} QueueHandle;
+
+static pthread_mutex_t GMutexQueues = PTHREAD_MUTEX_INITIALIZER;
+static QueueHandle *GQueueHandles[QUEUE_MAX_HANDLES];  // HQUEUE is index + 1.
+
+static int futexWait(uint32 *addr, const uint32 val, const struct timespec *timeout)
+{
+    // spurious wakeups and EINTR are fine, callers loop.
+    if (syscall(SYS_futex, addr, FUTEX_WAIT, val, timeout, NULL, 0) == -1)
+        return errno;
+    return 0;
+} // futexWait
+
+static void futexWake(uint32 *addr, const int count)
+{
+    syscall(SYS_futex, addr, FUTEX_WAKE, count, NULL, NULL, 0);
+} // futexWake
+
+static void lockQueue(Queue *queue)
+{
+    const uint32 pid = (uint32) getpid();
+    uint32 c = 0;
+    if (__atomic_compare_exchange_n(&queue->lock, &c, pid, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+        return;  // uncontended, no syscall.
+
+    // Once we're contended, whoever gets the lock marks it as having
+    //  waiters, since it can't know if anyone else is still sleeping.
+    while (1) {
+        if (c == 0) {
+            if (__atomic_compare_exchange_n(&queue->lock, &c, pid | QUEUE_LOCK_WAITERS, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+                return;
+            continue;
+        } else if (!(c & QUEUE_LOCK_WAITERS)) {
+            if (!__atomic_compare_exchange_n(&queue->lock, &c, c | QUEUE_LOCK_WAITERS, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+                continue;
+            c |= QUEUE_LOCK_WAITERS;
+        } // else if
+
+        // sleep in slices, so we notice a holder that died without unlocking.
+        const struct timespec slice = { 0, QUEUE_LOCK_CHECK_MS * 1000000 };
+        if (futexWait(&queue->lock, c, &slice) == ETIMEDOUT) {
+            const pid_t holder = (pid_t) (c & ~QUEUE_LOCK_WAITERS);
+            if ((kill(holder, 0) == -1) && (errno == ESRCH)) {
+                if (__atomic_compare_exchange_n(&queue->lock, &c, pid | QUEUE_LOCK_WAITERS, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+                    return;
+                continue;
+            } // if
+        } // if
+
+        c = __atomic_load_n(&queue->lock, __ATOMIC_RELAXED);
+    } // while
+} // lockQueue
+
+static void unlockQueue(Queue *queue)
+{
+    if (__atomic_exchange_n(&queue->lock, 0, __ATOMIC_RELEASE) & QUEUE_LOCK_WAITERS)
+        futexWake(&queue->lock, 1);
+} // unlockQueue
+
+// call with GMutexQueues held.
+static QueueHandle *getQueueHandle(const HQUEUE hq)
+{
+    if ((hq == 0) || (hq > QUEUE_MAX_HANDLES))
+        return NULL;
+    return GQueueHandles[hq - 1];
+} // getQueueHandle
+
+static void releaseQueueHandle(QueueHandle *handle)
+{
+    pthread_mutex_lock(&GMutexQueues);
+    const uint32 refcount = --handle->refcount;
+    pthread_mutex_unlock(&GMutexQueues);
+
+    if (refcount == 0) {
+        munmap(handle->queue, sizeof (Queue));
+        free(handle);
+    } // if
+} // releaseQueueHandle
+
+// On success, the caller owns a reference to (*_handle) and must call
+//  releaseQueueHandle() when done with the queue.
+static Queue *getQueue(const HQUEUE hq, const int owneronly, QueueHandle **_handle, APIRET *err)
+{
+    pthread_mutex_lock(&GMutexQueues);
+    QueueHandle *handle = getQueueHandle(hq);
+    if (handle)
+        handle->refcount++;
+    pthread_mutex_unlock(&GMutexQueues);
+
+    if (!handle) {
+        *err = ERROR_QUE_INVALID_HANDLE;
+        return NULL;
+    } else if (__atomic_load_n(&handle->queue->magic, __ATOMIC_ACQUIRE) != QUEUE_MAGIC) {
+        releaseQueueHandle(handle);
+        *err = ERROR_QUE_INVALID_HANDLE;
+        return NULL;
+    } else if (owneronly && !handle->owner) {
+        releaseQueueHandle(handle);
+        *err = ERROR_QUE_PROC_NOT_OWNED;
+        return NULL;
+    } // else if
+
+    *_handle = handle;
+    return handle->queue;
+} // getQueue
+
+static APIRET makeQueueShmName(const char *name, char *shmname)
+{
+    static const char prefix[] = "\\QUEUES\\";
+    const size_t len = name ? strlen(name) : 0;
+    if ((len <= (sizeof (prefix) - 1)) || (strncasecmp(name, prefix, sizeof (prefix) - 1) != 0))
+        return ERROR_QUE_INVALID_NAME;
+
+    // queue names are case-insensitive, and '/' can't be in a shm_open() name.
+    size_t pos = snprintf(shmname, NAME_MAX, "/2ine-queue-%u-", (uint) getuid());
+    if ((pos + len) >= NAME_MAX)
+        return ERROR_QUE_INVALID_NAME;
+
+    for (size_t i = 0; i < len; i++) {
+        const char ch = name[i];
+        shmname[pos++] = (ch == '/') ? '\\' : toupper((unsigned char) ch);
+    } // for
+    shmname[pos] = '\0';
+    return NO_ERROR;
+} // makeQueueShmName
+
+static APIRET addQueueHandle(Queue *queue, const int owner, const char *shmname, PHQUEUE phq)
+{
+    QueueHandle *handle = (QueueHandle *) malloc(sizeof (QueueHandle));
+    if (!handle)
+        return ERROR_QUE_NO_MEMORY;
+
+    handle->queue = queue;
+    handle->owner = owner;
+    handle->refcount = 1;
+    strcpy(handle->shmname, shmname);
+
+    pthread_mutex_lock(&GMutexQueues);
+    for (uint32 i = 0; i < QUEUE_MAX_HANDLES; i++) {
+        if (!GQueueHandles[i]) {
+            GQueueHandles[i] = handle;
+            pthread_mutex_unlock(&GMutexQueues);
+            *phq = (HQUEUE) (i + 1);
+            return NO_ERROR;
+        } // if
+    } // for
+    pthread_mutex_unlock(&GMutexQueues);
+
+    free(handle);
+    return ERROR_QUE_NO_MEMORY;
+} // addQueueHandle
+
+// call this once the handle is out of GQueueHandles.
+static void closeQueueHandle(QueueHandle *handle)
+{
+    Queue *queue = handle->queue;
+    if (handle->owner) {
+        // the queue dies with its owner; anyone else with it open just gets ERROR_QUE_INVALID_HANDLE from now on.
+        //  Bump (writes) so anyone sleeping in DosReadQueue/DosPeekQueue wakes up and notices.
+        lockQueue(queue);
+        __atomic_store_n(&queue->magic, 0, __ATOMIC_RELEASE);
+        __atomic_store_n(&queue->writes, queue->writes + 1, __ATOMIC_RELEASE);
+        unlockQueue(queue);
+        futexWake(&queue->writes, INT_MAX);
+        shm_unlink(handle->shmname);
+    } // if
+
+    releaseQueueHandle(handle);  // unmaps once any calls still using it are done.
+} // closeQueueHandle
+
+// call with the queue locked.
+static uint32 findQueueElement(Queue *queue, const ULONG element)
+{
+    if (element == 0)
+        return queue->head;
+
+    const uint32 idx = element & 0xFFFF;
+    if ((idx == 0) || (idx > QUEUE_MAX_ELEMENTS))
+        return 0;
+
+    const QueueElement *elem = &queue->elements[idx - 1];
+    if ((elem->serial & 0xFFFF) != (element >> 16))
+        return 0;
+    else if (!elem->prev && (queue->head != idx))
+        return 0;  // not in the queue (on the free list, probably).
+
+    return idx;
+} // findQueueElement
+
+// call with the queue locked.
+static void unlinkQueueElement(Queue *queue, const uint32 idx)
+{
+    QueueElement *elem = &queue->elements[idx - 1];
+    if (elem->prev)
+        queue->elements[elem->prev - 1].next = elem->next;
+    else
+        queue->head = elem->next;
+
+    if (elem->next)
+        queue->elements[elem->next - 1].prev = elem->prev;
+    else
+        queue->tail = elem->prev;
+
+    elem->serial++;
+    elem->prev = 0;
+    elem->next = queue->freelist;
+    queue->freelist = idx;
+    queue->count--;
+} // unlinkQueueElement
+
+static void fillQueueRequest(const QueueElement *elem, PREQUESTDATA pRequest, PULONG pcbData, PPVOID ppbuf, PBYTE ppriority)
+{
+    if (pRequest) {
+        pRequest->pid = (PID) elem->pid;
+        pRequest->ulData = elem->request;
+    } // if
+    if (pcbData)
+        *pcbData = elem->cbData;
+    if (ppbuf)
+        *ppbuf = elem->pbData;
+    if (ppriority)
+        *ppriority = (BYTE) elem->priority;
+} // fillQueueRequest
+
+// Finds the element DosReadQueue/DosPeekQueue want, sleeping until a write
+//  if there isn't one yet and the caller wants to wait. Returns with the
+//  queue locked if it found something.
+static APIRET waitForQueueElement(Queue *queue, const ULONG element, const int peeking, const int wait, const HEV hsem, uint32 *pidx)
+{
+    lockQueue(queue);
+
+    while (1) {
+        uint32 idx = findQueueElement(queue, element);
+        if (element && !idx) {
+            unlockQueue(queue);
+            return ERROR_QUE_ELEMENT_NOT_EXIST;
+        } else if (peeking && element) {
+            idx = queue->elements[idx - 1].next;  // peeking walks to the element after the one we were given.
+        } // else if
+
+        if (idx) {
+            *pidx = idx;
+            return NO_ERROR;
+        } else if (!wait) {
+            if (hsem) {
+                queue->hsem = hsem;  // writes post this from now on.
+                queue->hsempid = (uint32) getpid();
+            } // if
+            unlockQueue(queue);
+            return ERROR_QUE_EMPTY;
+        } // else if
+
+        const uint32 writes = queue->writes;
+        queue->waiters++;
+        unlockQueue(queue);
+        futexWait(&queue->writes, writes, NULL);
+        lockQueue(queue);
+        queue->waiters--;
+
+        if (queue->magic != QUEUE_MAGIC) {
+            unlockQueue(queue);
+            return ERROR_QUE_INVALID_HANDLE;
+        } // if
+    } // while
+} // waitForQueueElement
+
 
 APIRET DosCreateQueue(PHQUEUE phq, ULONG priority, PSZ pszName)
 {
     TRACE_NATIVE("DosCreateQueue(%p, %u, '%s')", phq, priority, pszName);
-    FIXME("write me");
-    return ERROR_QUE_NO_MEMORY;
+
+    if (!phq)
+        return ERROR_INVALID_PARAMETER;
+    else if ((priority & ~QUE_CONVERT_ADDRESS) > QUE_PRIORITY)
+        return ERROR_QUE_INVALID_PRIORITY;
+
+    if (priority & QUE_CONVERT_ADDRESS)
+        FIXME("QUE_CONVERT_ADDRESS is for 16-bit writers, which we don't convert for");
+
+    char shmname[NAME_MAX];
+    APIRET rc = makeQueueShmName(pszName, shmname);
+    if (rc != NO_ERROR)
+        return rc;
+
+    int fd = shm_open(shmname, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, S_IRUSR | S_IWUSR);
+    if ((fd == -1) && (errno == EEXIST)) {
+        // maybe left behind by a process that crashed? If the owner is gone, take it over.
+        const int oldfd = shm_open(shmname, O_RDONLY | O_CLOEXEC, 0);
+        if (oldfd != -1) {
+            uint32 owner = 0;
+            if (pread(oldfd, &owner, sizeof (owner), offsetof(Queue, owner)) != sizeof (owner))
+                owner = 0;  // half-created, or not ours? Assume it's abandoned.
+            close(oldfd);
+            if ((owner == 0) || ((kill((pid_t) owner, 0) == -1) && (errno == ESRCH))) {
+                shm_unlink(shmname);
+                fd = shm_open(shmname, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, S_IRUSR | S_IWUSR);
+            } // if
+        } // if
+
+        if (fd == -1)
+            return ERROR_QUE_DUPLICATE;
+    } // if
+
+    if (fd == -1)
+        return ERROR_QUE_NO_MEMORY;
+
+    Queue *queue = NULL;
+    if (ftruncate(fd, sizeof (Queue)) == 0) {
+        queue = (Queue *) mmap(NULL, sizeof (Queue), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (queue == MAP_FAILED)
+            queue = NULL;
+    } // if
+    close(fd);
+
+    if (!queue) {
+        shm_unlink(shmname);
+        return ERROR_QUE_NO_MEMORY;
+    } // if
+
+    // ftruncate() zero-filled everything, so we only have to chain up the free list.
+    queue->ordering = priority & ~QUE_CONVERT_ADDRESS;
+    queue->owner = (uint32) getpid();
+    for (uint32 i = 0; i < QUEUE_MAX_ELEMENTS - 1; i++)
+        queue->elements[i].next = i + 2;
+    queue->freelist = 1;
+    __atomic_store_n(&queue->magic, QUEUE_MAGIC, __ATOMIC_RELEASE);
+
+    rc = addQueueHandle(queue, 1, shmname, phq);
+    if (rc != NO_ERROR) {
+        munmap(queue, sizeof (Queue));
+        shm_unlink(shmname);
+    } // if
+
+    return rc;
 } // DosCreateQueue
 
 APIRET DosCloseQueue(HQUEUE hq)
 {
     TRACE_NATIVE("DosCloseQueue(%u)", (uint) hq);
-    FIXME("write me");
-    return ERROR_QUE_INVALID_HANDLE;
+
+    pthread_mutex_lock(&GMutexQueues);
+    QueueHandle *handle = getQueueHandle(hq);
+    if (handle)
+        GQueueHandles[hq - 1] = NULL;
+    pthread_mutex_unlock(&GMutexQueues);
+
+    if (!handle)
+        return ERROR_QUE_INVALID_HANDLE;
+
+    closeQueueHandle(handle);
+    return NO_ERROR;
 } // DosCloseQueue
 
 APIRET DosOpenQueue(PPID ppid, PHQUEUE phq, PSZ pszName)
 {
     TRACE_NATIVE("DosOpenQueue(%p, %p, '%s')", ppid, phq, pszName);
-    FIXME("write me");
-    return ERROR_QUE_NO_MEMORY;
+
+    if (!ppid || !phq)
+        return ERROR_INVALID_PARAMETER;
+
+    char shmname[NAME_MAX];
+    APIRET rc = makeQueueShmName(pszName, shmname);
+    if (rc != NO_ERROR)
+        return rc;
+
+    const int fd = shm_open(shmname, O_RDWR | O_CLOEXEC, 0);
+    if (fd == -1)
+        return ERROR_QUE_NAME_NOT_EXIST;
+
+    struct stat statbuf;
+    Queue *queue = NULL;
+    if ((fstat(fd, &statbuf) == 0) && (statbuf.st_size == sizeof (Queue))) {
+        queue = (Queue *) mmap(NULL, sizeof (Queue), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (queue == MAP_FAILED)
+            queue = NULL;
+    } // if
+    close(fd);
+
+    if (!queue)
+        return ERROR_QUE_NAME_NOT_EXIST;
+    else if (__atomic_load_n(&queue->magic, __ATOMIC_ACQUIRE) != QUEUE_MAGIC) {
+        munmap(queue, sizeof (Queue));
+        return ERROR_QUE_NAME_NOT_EXIST;
+    } // else if
+
+    rc = addQueueHandle(queue, 0, shmname, phq);
+    if (rc != NO_ERROR) {
+        munmap(queue, sizeof (Queue));
+        return rc;
+    } // if
+
+    *ppid = (PID) queue->owner;
+    return NO_ERROR;
 } // DosOpenQueue
 
 APIRET DosPeekQueue(HQUEUE hq, PREQUESTDATA pRequest, PULONG pcbData, PPVOID ppbuf, PULONG element, BOOL32 nowait, PBYTE ppriority, HEV hsem)
 {
     TRACE_NATIVE("DosPeekQueue(%u, %p, %p, %p, %p, %u, %p, %u)", (uint) hq, pRequest, pcbData, ppbuf, element, (uint) nowait, ppriority, (uint) hsem);
-    FIXME("write me");
-    return ERROR_QUE_INVALID_HANDLE;
+
+    APIRET rc = NO_ERROR;
+    QueueHandle *handle = NULL;
+    Queue *queue = getQueue(hq, 1, &handle, &rc);
+    if (!queue)
+        return rc;
+    else if (!element)
+        rc = ERROR_INVALID_PARAMETER;
+    else if ((nowait != DCWW_WAIT) && (nowait != DCWW_NOWAIT))
+        rc = ERROR_QUE_INVALID_WAIT;
+    else {
+        uint32 idx = 0;
+        rc = waitForQueueElement(queue, *element, 1, nowait == DCWW_WAIT, hsem, &idx);
+        if (rc == NO_ERROR) {
+            const QueueElement *elem = &queue->elements[idx - 1];
+            fillQueueRequest(elem, pRequest, pcbData, ppbuf, ppriority);
+            *element = ((elem->serial & 0xFFFF) << 16) | idx;
+            unlockQueue(queue);
+        } // if
+    } // else
+
+    releaseQueueHandle(handle);
+    return rc;
 } // DosPeekQueue
 
 APIRET DosPurgeQueue(HQUEUE hq)
 {
     TRACE_NATIVE("DosPurgeQueue(%u)", (uint) hq);
-    FIXME("write me");
-    return ERROR_QUE_INVALID_HANDLE;
-} // DosCloseQueue
+
+    APIRET rc = NO_ERROR;
+    QueueHandle *handle = NULL;
+    Queue *queue = getQueue(hq, 1, &handle, &rc);
+    if (!queue)
+        return rc;
+
+    lockQueue(queue);
+    while (queue->head)
+        unlinkQueueElement(queue, queue->head);
+    unlockQueue(queue);
+
+    releaseQueueHandle(handle);
+    return NO_ERROR;
+} // DosPurgeQueue
 
 APIRET DosQueryQueue(HQUEUE hq, PULONG pcbEntries)
 {
     TRACE_NATIVE("DosQueryQueue(%u, %p)", (uint) hq, pcbEntries);
-    FIXME("write me");
-    return ERROR_QUE_INVALID_HANDLE;
+
+    APIRET rc = NO_ERROR;
+    QueueHandle *handle = NULL;
+    Queue *queue = getQueue(hq, 0, &handle, &rc);
+    if (!queue)
+        return rc;
+    else if (!pcbEntries)
+        rc = ERROR_INVALID_PARAMETER;
+    else
+        *pcbEntries = __atomic_load_n(&queue->count, __ATOMIC_RELAXED);
+
+    releaseQueueHandle(handle);
+    return rc;
 } // DosQueryQueue
 
 APIRET DosReadQueue(HQUEUE hq, PREQUESTDATA pRequest, PULONG pcbData, PPVOID ppbuf, ULONG element, BOOL32 wait, PBYTE ppriority, HEV hsem)
 {
     TRACE_NATIVE("DosReadQueue(%u, %p, %p, %p, %u, %u, %p, %u)", (uint) hq, pRequest, pcbData, ppbuf, (uint) element, (uint) wait, ppriority, (uint) hsem);
-    FIXME("write me");
-    return ERROR_QUE_INVALID_HANDLE;
+
+    APIRET rc = NO_ERROR;
+    QueueHandle *handle = NULL;
+    Queue *queue = getQueue(hq, 1, &handle, &rc);
+    if (!queue)
+        return rc;
+    else if ((wait != DCWW_WAIT) && (wait != DCWW_NOWAIT))
+        rc = ERROR_QUE_INVALID_WAIT;
+    else {
+        uint32 idx = 0;
+        rc = waitForQueueElement(queue, element, 0, wait == DCWW_WAIT, hsem, &idx);
+        if (rc == NO_ERROR) {
+            QueueElement *elem = &queue->elements[idx - 1];
+            fillQueueRequest(elem, pRequest, pcbData, ppbuf, ppriority);
+            unlinkQueueElement(queue, idx);
+            unlockQueue(queue);
+        } // if
+    } // else
+
+    releaseQueueHandle(handle);
+    return rc;
 } // DosReadQueue
 
 APIRET DosWriteQueue(HQUEUE hq, ULONG request, ULONG cbData, PVOID pbData, ULONG priority)
 {
-    TRACE_NATIVE("DosWriteQueue(%u)", (uint) hq);
-    FIXME("write me");
-    return ERROR_QUE_INVALID_HANDLE;
+    TRACE_NATIVE("DosWriteQueue(%u, %u, %u, %p, %u)", (uint) hq, (uint) request, (uint) cbData, pbData, (uint) priority);
+
+    APIRET rc = NO_ERROR;
+    QueueHandle *handle = NULL;
+    Queue *queue = getQueue(hq, 0, &handle, &rc);
+    if (!queue)
+        return rc;
+    else if (priority > 15) {
+        releaseQueueHandle(handle);
+        return ERROR_QUE_INVALID_PRIORITY;
+    } // else if
+
+    lockQueue(queue);
+
+    const uint32 idx = queue->freelist;
+    if (!idx) {
+        unlockQueue(queue);
+        releaseQueueHandle(handle);
+        return ERROR_QUE_NO_MEMORY;
+    } // if
+
+    QueueElement *elem = &queue->elements[idx - 1];
+    queue->freelist = elem->next;
+    elem->pid = (uint32) getpid();
+    elem->request = request;
+    elem->cbData = cbData;
+    elem->pbData = pbData;
+    elem->priority = priority;
+
+    // find the element we go after (0 == we're the new head).
+    uint32 after = queue->tail;
+    if (queue->ordering == QUE_LIFO) {
+        after = 0;
+    } else if (queue->ordering == QUE_PRIORITY) {  // highest priority first, FIFO within a priority.
+        while (after && (queue->elements[after - 1].priority < priority))
+            after = queue->elements[after - 1].prev;
+    } // else if
+
+    elem->prev = after;
+    elem->next = after ? queue->elements[after - 1].next : queue->head;
+    if (elem->next)
+        queue->elements[elem->next - 1].prev = idx;
+    else
+        queue->tail = idx;
+    if (after)
+        queue->elements[after - 1].next = idx;
+    else
+        queue->head = idx;
+
+    queue->count++;
+    __atomic_store_n(&queue->writes, queue->writes + 1, __ATOMIC_RELEASE);
+    const uint32 waiters = queue->waiters;
+    const HEV hsem = queue->hsem;
+    const uint32 hsempid = queue->hsempid;
+    unlockQueue(queue);
+
+    if (waiters)
+        futexWake(&queue->writes, INT_MAX);
+
+    releaseQueueHandle(handle);
+
+    // a private semaphore's handle is a pointer into the reader's process,
+    //  so writers elsewhere can only post it if it's shared (OS/2 requires
+    //  that, too, if other processes write to the queue).
+    if (hsem && ((hsem & 1) || (hsempid == (uint32) getpid())))
+        DosPostEventSem(hsem);
+
+    return NO_ERROR;
 } // DosWriteQueue
 
+LX_NATIVE_DESTRUCTOR(quecalls)
+{
+    for (uint32 i = 0; i < QUEUE_MAX_HANDLES; i++) {
+        QueueHandle *handle = GQueueHandles[i];
+        if (handle) {
+            GQueueHandles[i] = NULL;
+            closeQueueHandle(handle);
+        } // if
+    } // for
+}
+
 // end of quecalls.c ...
 
@@ -0,0 +1,187 @@
+// Native benchmark for DosSub* pools: it runs a random mix of mostly small
+//  allocations and frees through DosSubAllocMem/DosSubFreeMem, checking as
+//  it goes that no two live blocks overlap and that every block is inside
+//  the pool, then times the same kind of mix against malloc()/free().
+
+#define INCL_DOS
+#define INCL_DOSERRORS
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <os2.h>
+
+#define POOL_SIZE (4 * 1024 * 1024)
+#define LIVE_SLOTS 4096
+#define CHECK_ROUNDS 200000
+#define TIMED_ROUNDS 5000000
+
+typedef struct
+{
+    PVOID ptr;
+    ULONG size;
+} Allocation;
+
+static Allocation live[LIVE_SLOTS];
+static unsigned char owner[POOL_SIZE];  // which live slot (+1) owns each byte of the pool, 0 for none.
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((double) ts.tv_sec) + (((double) ts.tv_nsec) / 1000000000.0);
+} // now
+
+// mostly small blocks, like the apps that use these pools, with a few big ones.
+static ULONG randomSize(void)
+{
+    return (rand() % 16) ? (1 + (rand() % 256)) : (257 + (rand() % 8192));
+} // randomSize
+
+static int markOwner(const PVOID pool, const int slot, const int claim)
+{
+    const size_t off = (size_t) (((const unsigned char *) live[slot].ptr) - ((const unsigned char *) pool));
+    const size_t size = (size_t) live[slot].size;
+    const unsigned char id = (unsigned char) ((slot % 255) + 1);
+
+    if ((((const unsigned char *) live[slot].ptr) < ((const unsigned char *) pool)) || ((off + size) > POOL_SIZE)) {
+        fprintf(stderr, "Block %p (%u bytes) is outside the pool!\n", live[slot].ptr, (unsigned int) size);
+        return 0;
+    } // if
+
+    for (size_t i = off; i < (off + size); i++) {
+        if (claim && owner[i]) {
+            fprintf(stderr, "Block %p (%u bytes) overlaps another live block!\n", live[slot].ptr, (unsigned int) size);
+            return 0;
+        } // if
+        owner[i] = claim ? id : 0;
+    } // for
+
+    return 1;
+} // markOwner
+
+static int checkPool(const ULONG flags)
+{
+    PVOID pool = NULL;
+    APIRET rc;
+
+    if (DosAllocMem(&pool, POOL_SIZE, PAG_COMMIT | PAG_READ | PAG_WRITE) != NO_ERROR) {
+        fprintf(stderr, "DosAllocMem failed\n");
+        return 0;
+    } else if ((rc = DosSubSetMem(pool, DOSSUB_INIT | flags, POOL_SIZE)) != NO_ERROR) {
+        fprintf(stderr, "DosSubSetMem failed: %u\n", (unsigned int) rc);
+        return 0;
+    } // else if
+
+    memset(live, '\0', sizeof (live));
+    memset(owner, '\0', sizeof (owner));
+
+    for (int i = 0; i < CHECK_ROUNDS; i++) {
+        const int slot = rand() % LIVE_SLOTS;
+        if (live[slot].ptr) {
+            if (!markOwner(pool, slot, 0))
+                return 0;
+            if ((rc = DosSubFreeMem(pool, live[slot].ptr, live[slot].size)) != NO_ERROR) {
+                fprintf(stderr, "DosSubFreeMem failed: %u\n", (unsigned int) rc);
+                return 0;
+            } // if
+            live[slot].ptr = NULL;
+        } else {
+            live[slot].size = randomSize();
+            rc = DosSubAllocMem(pool, &live[slot].ptr, live[slot].size);
+            if (rc == ERROR_DOSSUB_NOMEM) {
+                live[slot].ptr = NULL;  // the pool is full right now, that's okay.
+                continue;
+            } else if (rc != NO_ERROR) {
+                fprintf(stderr, "DosSubAllocMem failed: %u\n", (unsigned int) rc);
+                return 0;
+            } else if (!markOwner(pool, slot, 1)) {
+                return 0;
+            } // else if
+        } // else
+    } // for
+
+    // freeing something twice should be caught, not corrupt the pool.
+    for (int i = 0; i < LIVE_SLOTS; i++) {
+        if (live[i].ptr) {
+            DosSubFreeMem(pool, live[i].ptr, live[i].size);
+            if ((rc = DosSubFreeMem(pool, live[i].ptr, live[i].size)) != ERROR_DOSSUB_OVERLAP) {
+                fprintf(stderr, "Double free: expected ERROR_DOSSUB_OVERLAP, got %u\n", (unsigned int) rc);
+                return 0;
+            } // if
+            live[i].ptr = NULL;
+        } // if
+    } // for
+
+    DosSubUnsetMem(pool);
+    DosFreeMem(pool);
+    return 1;
+} // checkPool
+
+static double timePool(const ULONG flags)
+{
+    PVOID pool = NULL;
+    DosAllocMem(&pool, POOL_SIZE, PAG_COMMIT | PAG_READ | PAG_WRITE);
+    DosSubSetMem(pool, DOSSUB_INIT | flags, POOL_SIZE);
+    memset(live, '\0', sizeof (live));
+
+    const double start = now();
+    for (int i = 0; i < TIMED_ROUNDS; i++) {
+        const int slot = i % LIVE_SLOTS;
+        if (live[slot].ptr) {
+            DosSubFreeMem(pool, live[slot].ptr, live[slot].size);
+            live[slot].ptr = NULL;
+        } else {
+            live[slot].size = randomSize();
+            if (DosSubAllocMem(pool, &live[slot].ptr, live[slot].size) != NO_ERROR)
+                live[slot].ptr = NULL;
+        } // else
+    } // for
+    const double elapsed = now() - start;
+
+    DosSubUnsetMem(pool);
+    DosFreeMem(pool);
+    return (elapsed * 1000000000.0) / TIMED_ROUNDS;
+} // timePool
+
+static double timeMalloc(void)
+{
+    memset(live, '\0', sizeof (live));
+
+    const double start = now();
+    for (int i = 0; i < TIMED_ROUNDS; i++) {
+        const int slot = i % LIVE_SLOTS;
+        if (live[slot].ptr) {
+            free(live[slot].ptr);
+            live[slot].ptr = NULL;
+        } else {
+            live[slot].size = randomSize();
+            live[slot].ptr = malloc(live[slot].size);
+        } // else
+    } // for
+    const double elapsed = now() - start;
+
+    for (int i = 0; i < LIVE_SLOTS; i++)
+        free(live[i].ptr);
+
+    return (elapsed * 1000000000.0) / TIMED_ROUNDS;
+} // timeMalloc
+
+int main(void)
+{
+    srand(12);
+    if (!checkPool(0) || !checkPool(DOSSUB_SERIALIZE))
+        return 1;
+    printf("%d random allocs/frees checked, no overlaps.\n", CHECK_ROUNDS * 2);
+
+    printf("%d allocs/frees, %d live slots:\n", TIMED_ROUNDS, LIVE_SLOTS);
+    srand(34);
+    printf("  DosSub pool:                   %6.1f ns per call\n", timePool(0));
+    srand(34);
+    printf("  DosSub pool, DOSSUB_SERIALIZE: %6.1f ns per call\n", timePool(DOSSUB_SERIALIZE));
+    srand(34);
+    printf("  malloc/free:                   %6.1f ns per call\n", timeMalloc());
+    return 0;
+} // main
+
+// end of benchdossub.c ...
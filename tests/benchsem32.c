@@ -0,0 +1,164 @@
+// Native benchmark for event and mutex semaphores: two threads ping-pong
+//  through a pair of event semaphores, then fight over a mutex, using both
+//  private and DC_SEM_SHARED semaphores. It also checks that a mutex whose
+//  owner's thread ends without releasing it reports ERROR_SEM_OWNER_DIED.
+
+#define INCL_DOS
+#define INCL_DOSERRORS
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <os2.h>
+
+#define PINGPONG_ROUNDS 100000
+#define MUTEX_ROUNDS 1000000
+
+static HEV GPing = 0;
+static HEV GPong = 0;
+static HMTX GMutex = 0;
+static volatile ULONG GCounter = 0;
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((double) ts.tv_sec) + (((double) ts.tv_nsec) / 1000000000.0);
+} // now
+
+static void APIENTRY pongThread(ULONG arg)
+{
+    ULONG posts = 0;
+    for (int i = 0; i < PINGPONG_ROUNDS; i++) {
+        DosWaitEventSem(GPing, SEM_INDEFINITE_WAIT);
+        DosResetEventSem(GPing, &posts);
+        DosPostEventSem(GPong);
+    } // for
+} // pongThread
+
+static void APIENTRY mutexThread(ULONG arg)
+{
+    for (int i = 0; i < MUTEX_ROUNDS; i++) {
+        DosRequestMutexSem(GMutex, SEM_INDEFINITE_WAIT);
+        GCounter++;
+        DosReleaseMutexSem(GMutex);
+    } // for
+} // mutexThread
+
+static void APIENTRY abandonThread(ULONG arg)
+{
+    DosRequestMutexSem(GMutex, SEM_INDEFINITE_WAIT);
+    DosPostEventSem(GPing);
+    // ...and end without releasing it.
+} // abandonThread
+
+static int pingPong(const ULONG attr)
+{
+    ULONG posts = 0;
+    TID tid = 0;
+
+    if ((DosCreateEventSem(NULL, &GPing, attr, FALSE) != NO_ERROR) || (DosCreateEventSem(NULL, &GPong, attr, FALSE) != NO_ERROR)) {
+        fprintf(stderr, "DosCreateEventSem failed\n");
+        return 0;
+    } else if (DosCreateThread(&tid, pongThread, 0, 0, 0xFFFF) != NO_ERROR) {
+        fprintf(stderr, "DosCreateThread failed\n");
+        return 0;
+    } // else if
+
+    const double start = now();
+    for (int i = 0; i < PINGPONG_ROUNDS; i++) {
+        DosPostEventSem(GPing);
+        DosWaitEventSem(GPong, SEM_INDEFINITE_WAIT);
+        DosResetEventSem(GPong, &posts);
+    } // for
+    const double elapsed = now() - start;
+
+    DosWaitThread(&tid, DCWW_WAIT);
+    DosCloseEventSem(GPing);
+    DosCloseEventSem(GPong);
+
+    printf("  event ping-pong: %6.2f us per round trip\n", (elapsed * 1000000.0) / PINGPONG_ROUNDS);
+    return 1;
+} // pingPong
+
+static int mutexes(const ULONG attr)
+{
+    TID tid = 0;
+
+    if (DosCreateMutexSem(NULL, &GMutex, attr, FALSE) != NO_ERROR) {
+        fprintf(stderr, "DosCreateMutexSem failed\n");
+        return 0;
+    } // if
+
+    double start = now();
+    for (int i = 0; i < MUTEX_ROUNDS; i++) {
+        DosRequestMutexSem(GMutex, SEM_INDEFINITE_WAIT);
+        DosReleaseMutexSem(GMutex);
+    } // for
+    double elapsed = now() - start;
+    printf("  uncontended mutex: %6.1f ns per request/release\n", (elapsed * 1000000000.0) / MUTEX_ROUNDS);
+
+    GCounter = 0;
+    if (DosCreateThread(&tid, mutexThread, 0, 0, 0xFFFF) != NO_ERROR) {
+        fprintf(stderr, "DosCreateThread failed\n");
+        return 0;
+    } // if
+
+    start = now();
+    mutexThread(0);
+    DosWaitThread(&tid, DCWW_WAIT);
+    elapsed = now() - start;
+    printf("  contended mutex, 2 threads: %6.1f ns per request/release\n", (elapsed * 1000000000.0) / (MUTEX_ROUNDS * 2));
+
+    if (GCounter != (MUTEX_ROUNDS * 2)) {
+        fprintf(stderr, "Mutex didn't exclude: counted %u, expected %u!\n", (unsigned int) GCounter, (unsigned int) (MUTEX_ROUNDS * 2));
+        return 0;
+    } // if
+
+    DosCloseMutexSem(GMutex);
+    return 1;
+} // mutexes
+
+static int ownerDied(const ULONG attr)
+{
+    ULONG posts = 0;
+    TID tid = 0;
+    APIRET rc;
+
+    DosCreateMutexSem(NULL, &GMutex, attr, FALSE);
+    DosCreateEventSem(NULL, &GPing, 0, FALSE);
+    DosCreateThread(&tid, abandonThread, 0, 0, 0xFFFF);
+    DosWaitEventSem(GPing, SEM_INDEFINITE_WAIT);
+    DosResetEventSem(GPing, &posts);
+    DosWaitThread(&tid, DCWW_WAIT);
+
+    const double start = now();
+    rc = DosRequestMutexSem(GMutex, SEM_IMMEDIATE_RETURN);
+    const double elapsed = now() - start;
+    if (rc != ERROR_SEM_OWNER_DIED) {
+        fprintf(stderr, "Abandoned mutex: expected ERROR_SEM_OWNER_DIED, got %u\n", (unsigned int) rc);
+        return 0;
+    } // if
+
+    printf("  owner died: reported in %.1f us\n", elapsed * 1000000.0);
+    DosReleaseMutexSem(GMutex);
+    DosCloseMutexSem(GMutex);
+    DosCloseEventSem(GPing);
+    return 1;
+} // ownerDied
+
+int main(void)
+{
+    static const struct { const char *name; ULONG attr; } kinds[] = {
+        { "private", 0 }, { "shared", DC_SEM_SHARED }
+    };
+
+    for (int i = 0; i < (int) (sizeof (kinds) / sizeof (kinds[0])); i++) {
+        printf("%s semaphores:\n", kinds[i].name);
+        if (!pingPong(kinds[i].attr) || !mutexes(kinds[i].attr) || !ownerDied(kinds[i].attr))
+            return 1;
+    } // for
+
+    return 0;
+} // main
+
+// end of benchsem32.c ...
@@ -0,0 +1,94 @@
+// Native benchmark for process launches: it times DosExecPgm() starting a
+//  copy of itself that exits right away, both with EXEC_SYNC and with
+//  EXEC_ASYNCRESULT followed by DosWaitChild(), and checks that the exit
+//  codes make it back.
+// Built natively, this measures the plain fork/exec path. lx_loader's zygote
+//  only serves OS/2 programs, so to measure that, build this as an OS/2 .exe
+//  and run it under lx_loader with system.zygote set to 1, then to 0.
+
+#define INCL_DOS
+#define INCL_DOSERRORS
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <os2.h>
+
+#define SPAWNS 500
+#define CHILD_EXIT_CODE 42
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((double) ts.tv_sec) + (((double) ts.tv_nsec) / 1000000000.0);
+} // now
+
+static int spawn(const char *exe, const ULONG execFlag)
+{
+    static const char args[] = "benchspawn\0child\0";  // the string constant adds the final null.
+    static const char env[] = "BENCHSPAWN=1\0";
+    char objname[CCHMAXPATH];
+    RESULTCODES res;
+    PID pid = 0;
+    APIRET rc;
+
+    rc = DosExecPgm(objname, sizeof (objname), execFlag, (PSZ) args, (PSZ) env, &res, (PSZ) exe);
+    if (rc != NO_ERROR) {
+        fprintf(stderr, "DosExecPgm failed: %u\n", (unsigned int) rc);
+        return 0;
+    } // if
+
+    if (execFlag == EXEC_ASYNCRESULT) {
+        const PID wanted = (PID) res.codeTerminate;
+        rc = DosWaitChild(DCWA_PROCESS, DCWW_WAIT, &res, &pid, wanted);
+        if (rc != NO_ERROR) {
+            fprintf(stderr, "DosWaitChild failed: %u\n", (unsigned int) rc);
+            return 0;
+        } else if (pid != wanted) {
+            fprintf(stderr, "DosWaitChild reported pid %u, expected %u\n", (unsigned int) pid, (unsigned int) wanted);
+            return 0;
+        } // else if
+    } // if
+
+    if ((res.codeTerminate != TC_EXIT) || (res.codeResult != CHILD_EXIT_CODE)) {
+        fprintf(stderr, "Child reported terminate=%u result=%u, expected %u/%u\n", (unsigned int) res.codeTerminate, (unsigned int) res.codeResult, (unsigned int) TC_EXIT, (unsigned int) CHILD_EXIT_CODE);
+        return 0;
+    } // if
+
+    return 1;
+} // spawn
+
+static int timeSpawns(const char *exe, const ULONG execFlag, const char *name)
+{
+    const double start = now();
+    for (int i = 0; i < SPAWNS; i++) {
+        if (!spawn(exe, execFlag))
+            return 0;
+    } // for
+    const double elapsed = now() - start;
+    printf("  %s: %8.1f us per launch\n", name, (elapsed * 1000000.0) / SPAWNS);
+    return 1;
+} // timeSpawns
+
+int main(int argc, char **argv)
+{
+    if ((argc > 1) && (strcmp(argv[1], "child") == 0))
+        return CHILD_EXIT_CODE;
+
+    printf("%d launches each:\n", SPAWNS);
+    if (!timeSpawns(argv[0], EXEC_SYNC, "EXEC_SYNC") || !timeSpawns(argv[0], EXEC_ASYNCRESULT, "EXEC_ASYNCRESULT + DosWaitChild"))
+        return 1;
+
+    // nothing should be left to wait for.
+    RESULTCODES res;
+    PID pid = 0;
+    const APIRET rc = DosWaitChild(DCWA_PROCESS, DCWW_NOWAIT, &res, &pid, 0);
+    if (rc != ERROR_WAIT_NO_CHILDREN) {
+        fprintf(stderr, "DosWaitChild with no children: expected ERROR_WAIT_NO_CHILDREN, got %u\n", (unsigned int) rc);
+        return 1;
+    } // if
+
+    return 0;
+} // main
+
+// end of benchspawn.c ...
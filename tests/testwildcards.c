@@ -0,0 +1,250 @@
+// Native test for DosFindFirst's wildcard matching. Run it on the host, not
+//  through lx_loader: it builds a scratch directory with POSIX calls and
+//  checks what DosFindFirst/DosFindNext report in it, first against a list
+//  of known answers, then against a simple (slow) reference matcher for a
+//  pile of random patterns.
+
+#define INCL_DOS
+#define INCL_DOSERRORS
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <os2.h>
+
+#define MAX_NAMES 512
+#define RANDOM_NAMES 200
+#define RANDOM_PATTERNS 5000
+
+static char scratchdir[64];
+static char *names[MAX_NAMES];
+static int total_names = 0;
+static int failures = 0;
+
+typedef struct
+{
+    const char *pattern;
+    const char *name;
+    int matches;
+} WildcardCase;
+
+static const WildcardCase cases[] = {
+    { "*", "foo", 1 }, { "*", ".", 1 }, { "*.*", "README", 1 }, { "*.*", "a.b.c", 1 }, { "*.*", "..", 1 },
+    { "FOO.*", "foo", 1 }, { "FOO.*", "foo.c", 1 }, { "FOO.*", "foobar", 0 },
+    { "*.OBJ", "x.obj", 1 }, { "*.OBJ", "x.obj.bak", 0 }, { "*.OBJ", "X.OBJ", 1 }, { "*.OBJ", "obj", 0 },
+    { "FOO", "Foo", 1 }, { "FOO", "foo2", 0 }, { "FOO*", "foobar", 1 }, { "FOO*", "fo", 0 },
+    { "*a*b.c", "xaybzb.c", 1 }, { "*a*b.c", "ab.c", 1 }, { "*a*b.c", "xaybzb.cd", 0 }, { "*a*b.c", "b.c", 0 },
+    { "*ab", "aab", 1 }, { "a*a", "aa", 1 }, { "a*a", "a", 0 }, { "*x*", "abc", 0 }, { "*x*", "abxc", 1 },
+    { "FOO?", "foo", 1 }, { "FOO?", "food", 1 }, { "FOO?", "foods", 0 }, { "FOO?.TXT", "foo.txt", 1 }, { "FOO?.TXT", "food.txt", 1 },
+    { "A?B", "a.b", 0 }, { "???", "ab", 1 }, { "???", "abcd", 0 },
+    { "FOO.", "foo", 1 }, { "FOO.", "foo.", 1 }, { "FOO.", "foo.c", 0 }, { "*.", "readme", 1 }, { "*.", "a.b.", 1 },
+    { "A.?", "a", 1 }, { "A.?", "a.b", 1 }, { "A.?", "ab", 0 }, { "FOO.B?", "foo.b", 1 }, { "?.B", ".b", 1 }, { "*.", "read.me", 0 },
+    { "A.B.C", "a.b.c", 1 }, { "*.C", "a.b.c", 1 }, { "A.*.C", "a.b.c", 1 }, { "*.*.*", "abc", 0 }, { "*.*.*", "a.b", 0 }, { "*.*.*", "a.b.c", 1 },
+    { "**", "x", 1 }, { "**.**", "x", 1 }, { "a**b", "ab", 1 }
+};
+
+static char foldChar(const char ch)
+{
+    return ((ch >= 'A') && (ch <= 'Z')) ? (ch - ('A' - 'a')) : ch;
+} // foldChar
+
+// The OS/2 rules, spelled out as plainly as possible, with brute-force
+//  backtracking: '*' matches any run of characters, '?' matches one
+//  character that isn't a '.' (or nothing, at a '.' or the end of the name),
+//  and the pattern's first '.' also matches the end of a name without one.
+static int referenceMatch(const char *str, const char *pattern, const int ext, const int nodot)
+{
+    const char pat = *pattern;
+    if (pat == '\0') {
+        return (*str == '\0');
+    } else if (pat == '*') {
+        for (size_t i = 0; i <= strlen(str); i++) {
+            if (referenceMatch(str + i, pattern + 1, ext, nodot))
+                return 1;
+        } // for
+        return 0;
+    } else if (pat == '?') {
+        return referenceMatch((*str && (*str != '.')) ? str + 1 : str, pattern + 1, ext, nodot);
+    } else if ((pat == '.') && !ext && ((*str == '.') || ((*str == '\0') && nodot))) {
+        return referenceMatch(*str ? str + 1 : str, pattern + 1, 1, nodot);
+    } // else if
+
+    return *str && (foldChar(*str) == foldChar(pat)) && referenceMatch(str + 1, pattern + 1, ext, nodot);
+} // referenceMatch
+
+static int addName(const char *name)
+{
+    for (int i = 0; i < total_names; i++) {
+        if (strcmp(names[i], name) == 0)
+            return 1;  // already have it.
+    } // for
+
+    if (total_names >= MAX_NAMES) {
+        fprintf(stderr, "Too many names!\n");
+        return 0;
+    } // if
+
+    // "." and ".." are already there, courtesy of the filesystem.
+    if ((strcmp(name, ".") != 0) && (strcmp(name, "..") != 0)) {
+        char path[128];
+        snprintf(path, sizeof (path), "%s/%s", scratchdir, name);
+        const int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd == -1) {
+            fprintf(stderr, "Couldn't create '%s'\n", path);
+            return 0;
+        } // if
+        close(fd);
+    } // if
+
+    names[total_names++] = strdup(name);
+    return 1;
+} // addName
+
+// flags each name DosFindFirst/DosFindNext report for (pattern) in (found).
+static int findMatches(const char *pattern, int *found)
+{
+    static UCHAR findbuf[0xFFFF];
+    char spec[128];
+    HDIR hdir = HDIR_CREATE;
+    ULONG count = 1000;
+    APIRET rc;
+
+    memset(found, '\0', sizeof (int) * total_names);
+    snprintf(spec, sizeof (spec), "%s/%s", scratchdir, pattern);
+    rc = DosFindFirst((PSZ) spec, &hdir, FILE_DIRECTORY | FILE_READONLY, findbuf, sizeof (findbuf), &count, FIL_STANDARD);
+    if (rc == ERROR_NO_MORE_FILES || rc == ERROR_FILE_NOT_FOUND)
+        return 1;  // no matches at all.
+    else if (rc != NO_ERROR) {
+        fprintf(stderr, "DosFindFirst('%s') failed: %u\n", spec, (unsigned int) rc);
+        return 0;
+    } // else if
+
+    while (rc == NO_ERROR) {
+        const UCHAR *ptr = findbuf;
+        for (ULONG i = 0; i < count; i++) {
+            const FILEFINDBUF3 *entry = (const FILEFINDBUF3 *) ptr;
+            for (int j = 0; j < total_names; j++) {
+                if (strcmp(names[j], entry->achName) == 0)
+                    found[j] = 1;
+            } // for
+            ptr += entry->oNextEntryOffset;
+        } // for
+        count = 1000;
+        rc = DosFindNext(hdir, findbuf, sizeof (findbuf), &count);
+    } // while
+
+    DosFindClose(hdir);
+    if (rc != ERROR_NO_MORE_FILES) {
+        fprintf(stderr, "DosFindNext('%s') failed: %u\n", spec, (unsigned int) rc);
+        return 0;
+    } // if
+
+    return 1;
+} // findMatches
+
+static int nameIndex(const char *name)
+{
+    for (int i = 0; i < total_names; i++) {
+        if (strcmp(names[i], name) == 0)
+            return i;
+    } // for
+    return -1;
+} // nameIndex
+
+static void cleanup(void)
+{
+    for (int i = 0; i < total_names; i++) {
+        if ((strcmp(names[i], ".") != 0) && (strcmp(names[i], "..") != 0)) {
+            char path[128];
+            snprintf(path, sizeof (path), "%s/%s", scratchdir, names[i]);
+            unlink(path);
+        } // if
+        free(names[i]);
+    } // for
+    rmdir(scratchdir);
+} // cleanup
+
+int main(void)
+{
+    static int found[MAX_NAMES];
+    const int total_cases = (int) (sizeof (cases) / sizeof (cases[0]));
+    int i;
+
+    strcpy(scratchdir, "/tmp/2ine-testwildcards-XXXXXX");
+    if (mkdtemp(scratchdir) == NULL) {
+        fprintf(stderr, "Couldn't create scratch directory!\n");
+        return 1;
+    } // if
+
+    for (i = 0; i < total_cases; i++) {
+        if (!addName(cases[i].name)) {
+            cleanup();
+            return 1;
+        } // if
+    } // for
+
+    for (i = 0; i < total_cases; i++) {
+        const WildcardCase *c = &cases[i];
+        if (!findMatches(c->pattern, found)) {
+            failures++;
+            continue;
+        } // if
+        if (found[nameIndex(c->name)] != c->matches) {
+            printf("FAIL: '%s' vs '%s': expected %s\n", c->pattern, c->name, c->matches ? "a match" : "no match");
+            failures++;
+        } // if
+    } // for
+
+    printf("%d known cases checked.\n", total_cases);
+
+    // now throw random names and patterns at it and see if it agrees with the reference.
+    srand(1);
+    while (total_names < RANDOM_NAMES) {
+        char name[8];
+        const int len = 1 + (rand() % 6);
+        for (int j = 0; j < len; j++)
+            name[j] = "aAbB."[rand() % 5];
+        name[len] = '\0';
+        if (!addName(name)) {
+            cleanup();
+            return 1;
+        } // if
+    } // while
+
+    for (i = 0; i < RANDOM_PATTERNS; i++) {
+        char pattern[8];
+        const int len = 1 + (rand() % 6);
+        for (int j = 0; j < len; j++)
+            pattern[j] = "aAb.*?"[rand() % 6];
+        pattern[len] = '\0';
+
+        if (!findMatches(pattern, found)) {
+            failures++;
+            continue;
+        } // if
+
+        for (int j = 0; j < total_names; j++) {
+            const int expected = referenceMatch(names[j], pattern, 0, strchr(names[j], '.') == NULL);
+            if (found[j] != expected) {
+                printf("FAIL: '%s' vs '%s': reference says %s\n", pattern, names[j], expected ? "a match" : "no match");
+                failures++;
+            } // if
+        } // for
+    } // for
+
+    printf("%d random patterns checked against %d names.\n", RANDOM_PATTERNS, total_names);
+
+    cleanup();
+
+    if (failures) {
+        printf("%d failures!\n", failures);
+        return 1;
+    } // if
+
+    printf("All tests passed.\n");
+    return 0;
+} // main
+
+// end of testwildcards.c ...